@@ -3,13 +3,23 @@
 ; Brief: ZK-RTOS Cortex-M3 context switch & interrupt handlers (ARM Keil)
 ; Version: 1.0.0
 ; Date: 2025-01-08
-; Note: 
+; Note: 需要以 --cpreproc 汇编 (读取 zk_config.h 中的 ZK_TASK_STATS_MODE)
 ;------------------------------------------------------------------------------
 
+#include "zk_config.h"
+
     EXTERN  g_current_tcb
     EXTERN  g_switch_next_tcb
     EXTERN  scheduler_increment_tick
+#if (ZK_TASK_STATS_MODE == 1) || (ZK_TASK_STATS_MODE == 3)
     EXTERN  task_update_runtime_stats
+#endif
+#if ZK_USING_PERF_COUNTERS
+    EXTERN  g_zk_perf_counters
+#endif
+#if ZK_USING_MPU_STACK_GUARD
+    EXTERN  zk_cpu_cm3_mpu_guard_switch
+#endif
 
     AREA |.text|, CODE, READONLY, ALIGN=2
     THUMB
@@ -74,6 +84,13 @@ zk_asm_pendsv_handler   PROC
     STMDB   r0!, {r4-r11}               ; 软件保存寄存器R4-R11到任务栈
     STR     r0, [r2]                    ; 将最终的栈指针保存回TCB
 
+    ; 读取 g_switch_next_tcb 到切换完成之间屏蔽可调用内核的中断, 与临界区一致
+    MOV     r0, #ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
+    MSR     basepri, r0
+    DSB
+    ISB
+
+#if (ZK_TASK_STATS_MODE == 1) || (ZK_TASK_STATS_MODE == 3)
     ; P1: 更新任务运行时统计
     PUSH    {r2, lr}                    ; 保存r2(old_tcb)和返回地址
     LDR     r3, =g_switch_next_tcb      ; 获取新任务TCB
@@ -81,10 +98,31 @@ zk_asm_pendsv_handler   PROC
     MOV     r0, r2                      ; r0 = old_tcb (r2已保存)
     BL      task_update_runtime_stats   ; 调用C函数更新统计
     POP     {r2, lr}                    ; 恢复r2和lr
+#elif (ZK_TASK_STATS_MODE == 2)
+    ; 内联 DWT 周期戳 (偏移见 task_control_block_t):
+    ; old->run_cycles += now - old->switch_in_cycles; new->switch_in_cycles = now
+    LDR     r0, =0xE0001004             ; DWT_CYCCNT
+    LDR     r0, [r0]                    ; r0 = now
+    LDR     r1, [r2, #4]                ; r1 = old->switch_in_cycles
+    SUB     r1, r0, r1                  ; r1 = 本次运行的周期数
+    LDRD    r3, r12, [r2, #8]           ; r3:r12 = old->run_cycles
+    ADDS    r3, r3, r1
+    ADC     r12, r12, #0
+    STRD    r3, r12, [r2, #8]
+    LDR     r3, =g_switch_next_tcb
+    LDR     r1, [r3]                    ; r1 = new_tcb
+    STR     r0, [r1, #4]                ; new->switch_in_cycles = now
+#endif
 
     ; 恢复即将切换进来任务的上下文
     LDR     r3, =g_switch_next_tcb      ; 获取下一个任务的TCB地址
     LDR     r1, [r3]                    ; r1 = 下一个任务的TCB指针
+#if ZK_USING_MPU_STACK_GUARD
+    PUSH    {r1, lr}                    ; 保护区移到新任务栈底
+    MOV     r0, r1
+    BL      zk_cpu_cm3_mpu_guard_switch
+    POP     {r1, lr}
+#endif
     LDR     r0, [r1]                    ; r0 = 新任务保存的栈指针
 
     LDMIA   r0!, {r4-r11}               ; 软件恢复寄存器R4-R11
@@ -92,6 +130,14 @@ zk_asm_pendsv_handler   PROC
     ISB
     LDR     R0, =g_current_tcb          ; R0 = &g_current_tcb
     STR     r1, [R0]                    ; g_current_tcb = r1
+#if ZK_USING_PERF_COUNTERS
+    LDR     r2, =g_zk_perf_counters     ; context_switches++ (偏移见 zk_perf_counters_t)
+    LDR     r3, [r2, #8]
+    ADD     r3, r3, #1
+    STR     r3, [r2, #8]
+#endif
+    MOV     r0, #0                      ; 清除BASEPRI
+    MSR     basepri, r0
     BX      r14                         ; 触发异常返回
     NOP
     ENDP
@@ -107,7 +153,7 @@ zk_asm_systick_handler   PROC
     PUSH    {lr}
 
     ; 提升BASEPRI以屏蔽低优先级中断
-    MOV     r0, #191                    ; ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
+    MOV     r0, #ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
     MSR     basepri, r0
     DSB
     ISB
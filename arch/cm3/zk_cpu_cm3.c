@@ -9,6 +9,9 @@
 #include "zk_cpu_cm3.h"
 #include "zk_internal.h"
 #include "zk_cpu.h"  /* 包含 zk_cpu_ops_t 类型定义 */
+#if ZK_USING_MPU_STACK_GUARD && ZK_USING_HOOK
+#include "zk_hook.h"
+#endif
 
 /* ==================== Static Function Declarations ==================== */
 static void zk_task_exit_error(void);
@@ -92,6 +95,88 @@ void *zk_arch_prepare_stack(void *stack_start, void *param)
 							 task_param->private_data);
 }
 
+/**
+ * @brief Release the context of a deleted task (the frame lives in its own stack)
+ */
+void zk_arch_release_stack(void *stack)
+{
+	(void) stack;
+}
+
+#if ZK_USING_MPU_STACK_GUARD
+/* ==================== MPU Stack Guard ==================== */
+
+/* 片上没有 MPU 时保持为 0, 切换时不访问 MPU 寄存器 */
+static zk_uint8 zk_mpu_guard_ready = 0;
+
+/**
+ * @brief Move the guard region to the lowest guard-aligned block of the task's stack
+ * @param tcb Task about to run
+ * @note  Called from PendSV (and once before the first task). The region size and
+ *        attributes never change, so one RBAR write with VALID retargets it.
+ */
+void zk_cpu_cm3_mpu_guard_switch(task_control_block_t *tcb)
+{
+	zk_uint32 base = 0;
+
+	if (!zk_mpu_guard_ready)
+	{
+		return;
+	}
+	base = ((zk_uint32) tcb->stack_base + ZK_MPU_GUARD_SIZE - 1UL) & ~(ZK_MPU_GUARD_SIZE - 1UL);
+	ZK_CM3_MPU_RBAR_REG = base | ZK_CM3_MPU_RBAR_VALID_BIT | ZK_MPU_GUARD_REGION;
+}
+
+/**
+ * @brief Program the guard region attributes and enable the MPU and MemManage fault
+ * @param tcb First task to run
+ */
+static void zk_cpu_cm3_mpu_guard_init(task_control_block_t *tcb)
+{
+	zk_uint32 size_field = 0;
+
+	if ((ZK_CM3_MPU_TYPE_REG & ZK_CM3_MPU_DREGION_MASK) == 0)
+	{
+		return;
+	}
+
+	/* RASR.SIZE = log2(size) - 1 */
+	while ((2UL << size_field) < ZK_MPU_GUARD_SIZE)
+	{
+		size_field++;
+	}
+
+	ZK_CM3_MPU_CTRL_REG = 0UL;
+	ZK_CM3_MPU_RNR_REG = ZK_MPU_GUARD_REGION;
+	ZK_CM3_MPU_RASR_REG =
+		ZK_CM3_MPU_RASR_XN_BIT | (size_field << 1UL) | ZK_CM3_MPU_RASR_ENABLE_BIT;
+	zk_mpu_guard_ready = 1;
+	zk_cpu_cm3_mpu_guard_switch(tcb);
+
+	ZK_CM3_SHCSR_REG |= ZK_CM3_MEMFAULTENA_BIT;
+	ZK_CM3_MPU_CTRL_REG = ZK_CM3_MPU_PRIVDEFENA_BIT | ZK_CM3_MPU_ENABLE_BIT;
+	ZK_CPU_DSB();
+	ZK_CPU_ISB();
+}
+
+/**
+ * @brief MemManage fault: the running task touched its guard band
+ * @note  Replaces the weak startup handler. The overflow is not recoverable, the hook only
+ *        gets to report the TCB; the MPU is turned off first so that it may inspect it.
+ */
+void MemManage_Handler(void)
+{
+	ZK_CM3_MPU_CTRL_REG = 0UL;
+#if ZK_USING_HOOK
+	zk_hook_call_stack_overflow(g_current_tcb);
+#endif
+	zk_cpu_irq_disable();
+	for (;;)
+	{
+	}
+}
+#endif
+
 /* ==================== Scheduler Startup ==================== */
 
 /**
@@ -107,6 +192,16 @@ zk_uint32 zk_cpu_cm3_start_scheduler(void)
 	zk_cpu_systick_config();
 	zk_critical_nesting = 0;
 
+#if ZK_TASK_STATS_CYCLES
+	/* 启动 DWT 周期计数器, PendSV 以其作为任务运行时间戳 */
+	ZK_CM3_DWT_CYCCNT_REG = 0UL;
+	zk_cpu_cycle_counter_init();
+#endif
+
+#if ZK_USING_MPU_STACK_GUARD
+	zk_cpu_cm3_mpu_guard_init(g_current_tcb);
+#endif
+
 	/* 启动第一个任务（汇编实现）*/
 	zk_asm_start_first_task();
 
@@ -119,10 +214,7 @@ zk_uint32 zk_cpu_cm3_start_scheduler(void)
 static void zk_task_exit_error(void)
 {
 	/* 任务退出错误：永久禁用所有中断 */
-	__asm
-	{
-        cpsid i /* 全局关中断 */
-	}
+	zk_cpu_irq_disable(); /* 全局关中断 */
 	for (;;)
 	{
 	}
@@ -147,16 +239,160 @@ void zk_cpu_systick_config(void)
 		(ZK_CM3_SYSTICK_CLK_BIT | ZK_CM3_SYSTICK_INT_BIT | ZK_CM3_SYSTICK_ENABLE_BIT);
 }
 
-/* ==================== Other Utility Functions ==================== */
+#if ZK_USING_TICKLESS
+/* ==================== Tickless Idle ==================== */
 
 /**
- * @brief Check if in interrupt context
+ * @brief Restart SysTick with a one-off first period
+ * @param first_cycles Cycles until the next SysTick interrupt
  */
-zk_uint8 zk_cpu_cm3_is_in_interrupt(void)
+static void zk_cpu_systick_restart(zk_uint32 first_cycles)
 {
-	return 0;
+	ZK_CM3_SYSTICK_LOAD_REG = first_cycles - 1UL;
+	ZK_CM3_SYSTICK_CURRENT_VALUE_REG = 0UL;
+	ZK_CM3_SYSTICK_CTRL_REG =
+		(ZK_CM3_SYSTICK_CLK_BIT | ZK_CM3_SYSTICK_INT_BIT | ZK_CM3_SYSTICK_ENABLE_BIT);
+
+	/* 新的 LOAD 值在下一次重装载时生效，恢复正常 Tick 周期 */
+	ZK_CM3_SYSTICK_LOAD_REG = ZK_CM3_CYCLES_PER_TICK - 1UL;
 }
 
+/**
+ * @brief Stop the periodic tick and sleep until the nearest wake-up
+ * @param idle_ticks Expected idle ticks (from scheduler_get_expected_idle_ticks)
+ * @note  Sleep longer than the 24-bit reload allows is split into chained segments.
+ *        The last tick of a completed sleep is left to the pending SysTick interrupt so that
+ *        wake-up processing runs through the normal scheduler_increment_tick() path.
+ */
+void zk_cpu_cm3_tickless_sleep(zk_uint32 idle_ticks)
+{
+	const zk_uint32 max_segment_ticks = ZK_CM3_SYSTICK_MAX_RELOAD / ZK_CM3_CYCLES_PER_TICK;
+	zk_uint32 stepped_ticks = 0;
+	zk_uint32 first_cycles = 0;
+	zk_uint32 segment_ticks = 0;
+	zk_uint32 loaded_cycles = 0;
+	zk_uint32 left_cycles = 0;
+	zk_uint32 ctrl = 0;
+
+	if (idle_ticks == 0)
+	{
+		return;
+	}
+
+	/* WFI 只能被 PRIMASK 之外的中断唤醒，BASEPRI 会屏蔽内核级中断 */
+	zk_cpu_irq_disable();
+
+	/* 关中断后重新确认：期间有任务就绪或 Tick 已挂起则放弃睡眠 */
+	if (ZK_CM3_INT_CTRL_REG & (ZK_CM3_PENDSVSET_BIT | ZK_CM3_PENDSTSET_BIT))
+	{
+		zk_cpu_irq_enable();
+		return;
+	}
+
+	/* 停止 SysTick，记录当前 Tick 周期剩余 cycle */
+	ZK_CM3_SYSTICK_CTRL_REG = (ZK_CM3_SYSTICK_CLK_BIT | ZK_CM3_SYSTICK_INT_BIT);
+	first_cycles = ZK_CM3_SYSTICK_CURRENT_VALUE_REG;
+	if (first_cycles == 0)
+	{
+		first_cycles = ZK_CM3_CYCLES_PER_TICK;
+	}
+
+	for (;;)
+	{
+		segment_ticks = idle_ticks - stepped_ticks;
+		if (segment_ticks > max_segment_ticks)
+		{
+			segment_ticks = max_segment_ticks;
+		}
+
+		loaded_cycles = first_cycles + (segment_ticks - 1UL) * ZK_CM3_CYCLES_PER_TICK;
+		ZK_CM3_SYSTICK_LOAD_REG = loaded_cycles - 1UL;
+		ZK_CM3_SYSTICK_CURRENT_VALUE_REG = 0UL;
+		ZK_CM3_SYSTICK_CTRL_REG =
+			(ZK_CM3_SYSTICK_CLK_BIT | ZK_CM3_SYSTICK_INT_BIT | ZK_CM3_SYSTICK_ENABLE_BIT);
+
+		ZK_CPU_DSB();
+		ZK_CPU_WFI();
+		ZK_CPU_ISB();
+
+		/* 读 CTRL 同时清除 COUNTFLAG */
+		ctrl = ZK_CM3_SYSTICK_CTRL_REG;
+		ZK_CM3_SYSTICK_CTRL_REG = (ZK_CM3_SYSTICK_CLK_BIT | ZK_CM3_SYSTICK_INT_BIT);
+
+		if (ctrl & ZK_CM3_SYSTICK_COUNTFLAG_BIT)
+		{
+			if (stepped_ticks + segment_ticks >= idle_ticks)
+			{
+				/* 睡眠完成：最后一个 Tick 由已挂起的 SysTick 中断处理 */
+				stepped_ticks += segment_ticks - 1UL;
+				zk_cpu_systick_restart(ZK_CM3_CYCLES_PER_TICK);
+				break;
+			}
+
+			/* 中间段结束：撤销挂起的 SysTick，自行计数后链式重装 */
+			ZK_CM3_INT_CTRL_REG = ZK_CM3_PENDSTCLR_BIT;
+			stepped_ticks += segment_ticks;
+			first_cycles = ZK_CM3_CYCLES_PER_TICK;
+			continue;
+		}
+
+		/* 被其他中断提前唤醒：只补偿已经完整经过的 Tick */
+		left_cycles = ZK_CM3_SYSTICK_CURRENT_VALUE_REG;
+		if ((left_cycles % ZK_CM3_CYCLES_PER_TICK) == 0)
+		{
+			stepped_ticks += segment_ticks - (left_cycles / ZK_CM3_CYCLES_PER_TICK);
+			zk_cpu_systick_restart(ZK_CM3_CYCLES_PER_TICK);
+		}
+		else
+		{
+			stepped_ticks += segment_ticks - (left_cycles / ZK_CM3_CYCLES_PER_TICK) - 1UL;
+			zk_cpu_systick_restart(left_cycles % ZK_CM3_CYCLES_PER_TICK);
+		}
+		break;
+	}
+
+	zk_time_step(stepped_ticks);
+
+	zk_cpu_irq_enable();
+}
+#endif
+
+/* ==================== Interrupt Priority Check ==================== */
+
+/**
+ * @brief Whether the running exception may call the kernel
+ * @return zk_bool ZK_TRUE in thread mode or when the active exception is masked by
+ *         ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
+ * @note  Backs ZK_ASSERT_ISR_PRIORITY() at the entry of the _from_isr APIs. An interrupt above
+ *        the threshold is never masked by the kernel critical sections, so any kernel call from
+ *        it can corrupt a list. Reset, NMI and HardFault have fixed negative priorities.
+ */
+zk_bool zk_cpu_cm3_isr_priority_valid(void)
+{
+	zk_uint32 exception = ZK_CM3_INT_CTRL_REG & ZK_CM3_VECTACTIVE_MASK;
+	zk_uint8 priority = 0;
+
+	if (exception == 0)
+	{
+		return ZK_TRUE;
+	}
+	if (exception < 4)
+	{
+		return ZK_FALSE;
+	}
+	if (exception < 16)
+	{
+		priority = ZK_CM3_SHPR_BYTES[exception - 4];
+	}
+	else
+	{
+		priority = ZK_CM3_NVIC_IPR_BYTES[exception - 16];
+	}
+	return (priority >= ZK_MAX_SYSCALL_INTERRUPT_PRIORITY) ? ZK_TRUE : ZK_FALSE;
+}
+
+/* ==================== Other Utility Functions ==================== */
+
 /* ==================== CPU Abstract Interface Implementation ==================== */
 
 /**
@@ -171,4 +407,7 @@ const zk_cpu_ops_t g_cpu_ops = {
     .start_scheduler = zk_cpu_cm3_start_scheduler,
     .stack_init = zk_cpu_cm3_stack_init,
     .is_in_interrupt = zk_cpu_cm3_is_in_interrupt,
+#if ZK_USING_TICKLESS
+    .tickless_sleep = zk_cpu_cm3_tickless_sleep,
+#endif
 };
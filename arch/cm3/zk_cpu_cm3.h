@@ -30,6 +30,17 @@ typedef unsigned int        zk_uint32;
 #define ZK_CM3_SYSTICK_CURRENT_VALUE_REG  (*((volatile zk_uint32 *)0xe000e018))
 #define ZK_CM3_SHPR3_REG                  (*((volatile zk_uint32 *)0xe000ed20))
 #define ZK_CM3_INT_CTRL_REG               (*((volatile zk_uint32 *)0xe000ed04))
+#define ZK_CM3_SHPR_BYTES                 ((volatile zk_uint8 *)0xe000ed18)  /* 异常 4-15 的优先级, 各一字节 */
+#define ZK_CM3_NVIC_IPR_BYTES             ((volatile zk_uint8 *)0xe000e400)  /* 外部中断的优先级, 各一字节 */
+#define ZK_CM3_DEMCR_REG                  (*((volatile zk_uint32 *)0xe000edfc))
+#define ZK_CM3_DWT_CTRL_REG               (*((volatile zk_uint32 *)0xe0001000))
+#define ZK_CM3_DWT_CYCCNT_REG             (*((volatile zk_uint32 *)0xe0001004))
+#define ZK_CM3_SHCSR_REG                  (*((volatile zk_uint32 *)0xe000ed24))
+#define ZK_CM3_MPU_TYPE_REG               (*((volatile zk_uint32 *)0xe000ed90))
+#define ZK_CM3_MPU_CTRL_REG               (*((volatile zk_uint32 *)0xe000ed94))
+#define ZK_CM3_MPU_RNR_REG                (*((volatile zk_uint32 *)0xe000ed98))
+#define ZK_CM3_MPU_RBAR_REG               (*((volatile zk_uint32 *)0xe000ed9c))
+#define ZK_CM3_MPU_RASR_REG               (*((volatile zk_uint32 *)0xe000eda0))
 
 /* 寄存器位定义 */
 #define ZK_CM3_SYSTICK_INT_BIT        (1UL << 1UL)
@@ -37,6 +48,23 @@ typedef unsigned int        zk_uint32;
 #define ZK_CM3_PENDSV_PRI             (((zk_uint32)ZK_KERNEL_INTERRUPT_PRIORITY) << 16UL)
 #define ZK_CM3_SYSTICK_PRI            (((zk_uint32)ZK_KERNEL_INTERRUPT_PRIORITY) << 24UL)
 #define ZK_CM3_PENDSVSET_BIT          (1UL << 28UL)
+#define ZK_CM3_VECTACTIVE_MASK        0x1FFUL        /* ICSR: 当前异常号, 线程模式为 0 */
+#define ZK_CM3_PENDSTSET_BIT          (1UL << 26UL)
+#define ZK_CM3_PENDSTCLR_BIT          (1UL << 25UL)
+#define ZK_CM3_SYSTICK_COUNTFLAG_BIT  (1UL << 16UL)
+#define ZK_CM3_DEMCR_TRCENA_BIT       (1UL << 24UL)
+#define ZK_CM3_DWT_CYCCNTENA_BIT      (1UL << 0UL)
+#define ZK_CM3_MEMFAULTENA_BIT        (1UL << 16UL)
+#define ZK_CM3_MPU_DREGION_MASK       (0xFFUL << 8UL)
+#define ZK_CM3_MPU_ENABLE_BIT         (1UL << 0UL)
+#define ZK_CM3_MPU_PRIVDEFENA_BIT     (1UL << 2UL)   /* 未覆盖的地址沿用默认存储映射 */
+#define ZK_CM3_MPU_RBAR_VALID_BIT     (1UL << 4UL)   /* RBAR 低 4 位同时写入区域号 */
+#define ZK_CM3_MPU_RASR_XN_BIT        (1UL << 28UL)  /* AP=000: 特权与非特权均不可访问 */
+#define ZK_CM3_MPU_RASR_ENABLE_BIT    (1UL << 0UL)
+
+/* SysTick 计数参数 */
+#define ZK_CM3_SYSTICK_MAX_RELOAD     (0x00FFFFFFUL)  /* 24 位重装载上限 */
+#define ZK_CM3_CYCLES_PER_TICK        (ZK_SYSTICK_CLOCK_HZ / ZK_TICK_RATE_HZ)
 
 /* 栈初始化常量 */
 #define ZK_CM3_INITIAL_XPSR           (0x01000000)
@@ -47,12 +75,37 @@ typedef unsigned int        zk_uint32;
 #define ZK_ENTER_CRITICAL()     zk_cpu_enter_critical()
 #define ZK_EXIT_CRITICAL()      zk_cpu_exit_critical()
 
-/* ==================== 内联函数：BASEPRI 操作 ==================== */
+/* ==================== 编译器适配 ==================== */
+/* __CC_ARM: Keil ARMCC (RVDS 内嵌汇编)；__GNUC__: arm-none-eabi-gcc / Clang (GNU 内联汇编) */
+#if defined(__CC_ARM)
+
 #define ZK_INLINE          __inline
 #define ZK_FORCE_INLINE    __inline
 
+/* 保证屏障前的存储先于屏障后的访存对其他执行流(中断/任务)可见 */
+#define ZK_MEMORY_BARRIER()     __dmb(0xF)
+#define ZK_CPU_DSB()            __dsb(0xF)
+#define ZK_CPU_ISB()            __isb(0xF)
+#define ZK_CPU_WFI()            __wfi()
+
+#elif defined(__GNUC__)
+
+#define ZK_INLINE          __inline
+#define ZK_FORCE_INLINE    __inline __attribute__((always_inline))
+
+#define ZK_MEMORY_BARRIER()     __asm__ volatile("dmb" ::: "memory")
+#define ZK_CPU_DSB()            __asm__ volatile("dsb" ::: "memory")
+#define ZK_CPU_ISB()            __asm__ volatile("isb" ::: "memory")
+#define ZK_CPU_WFI()            __asm__ volatile("wfi")
+
+#else
+#error "zk_cpu_cm3.h: unsupported compiler"
+#endif
+
 extern volatile zk_uint32 zk_critical_nesting;
 
+#if defined(__CC_ARM)
+
 /**
  * @brief FFS (Find First Set) 指令：查找最低位的 1
  * @param value 输入值（优先级位图）
@@ -67,9 +120,76 @@ __asm static ZK_FORCE_INLINE zk_uint8 zk_cpu_clz(zk_uint32 value)
     BX      lr          /* 返回 */
 }
 
+/**
+ * @brief FLS (Find Last Set) 指令：查找最高位的 1
+ * @param value 输入值（非 0）
+ * @return 最高位 1 的位置（0-31），用于 TLSF 的尺寸分级
+ */
+__asm static ZK_FORCE_INLINE zk_uint8 zk_cpu_fls(zk_uint32 value)
+{
+    CLZ     r0, r0          /* 前导零个数 */
+    RSB     r0, r0, #31     /* 31 - CLZ = 最高位 1 的位置 */
+    BX      lr
+}
+
+/**
+ * @brief LDREX：独占读取一个字
+ * @param addr 目标地址
+ * @return 读取到的值
+ * @note 必须与 zk_cpu_strex() 或 zk_cpu_clrex() 配对使用
+ */
+__asm static ZK_FORCE_INLINE zk_uint32 zk_cpu_ldrex(volatile zk_uint32 *addr)
+{
+    LDREX   r0, [r0]
+    BX      lr
+}
+
+/**
+ * @brief STREX：独占写入一个字
+ * @param value 写入值
+ * @param addr 目标地址（与上一次 zk_cpu_ldrex() 相同）
+ * @return 0 写入成功，1 独占被打断（写入未发生）
+ * @note 异常进入/返回会清除本地独占监视器，
+ *       LDREX 与 STREX 之间发生任务切换或中断时 STREX 必定失败
+ */
+__asm static ZK_FORCE_INLINE zk_uint32 zk_cpu_strex(zk_uint32 value, volatile zk_uint32 *addr)
+{
+    STREX   r2, r0, [r1]
+    MOV     r0, r2
+    BX      lr
+}
+
+/**
+ * @brief CLREX：放弃 zk_cpu_ldrex() 建立的独占访问
+ */
+__asm static ZK_FORCE_INLINE void zk_cpu_clrex(void)
+{
+    CLREX
+    BX      lr
+}
+
+/**
+ * @brief 关闭/打开全局中断 (PRIMASK)
+ */
+static ZK_FORCE_INLINE void zk_cpu_irq_disable(void)
+{
+    __asm
+    {
+        cpsid i
+    }
+}
+
+static ZK_FORCE_INLINE void zk_cpu_irq_enable(void)
+{
+    __asm
+    {
+        cpsie i
+    }
+}
+
 /**
  * @brief 进入临界区（内联函数，零开销）
- * @note 使用 BASEPRI 屏蔽优先级 >= 191 的中断
+ * @note 使用 BASEPRI 屏蔽优先级数值 >= ZK_MAX_SYSCALL_INTERRUPT_PRIORITY 的中断
  */
 static ZK_FORCE_INLINE void zk_cpu_enter_critical(void)
 {
@@ -100,11 +220,106 @@ static ZK_FORCE_INLINE void zk_cpu_exit_critical(void)
     }
 }
 
+/**
+ * @brief 判断当前是否在中断上下文
+ * @return 1: 处理模式 (IPSR 非 0), 0: 线程模式
+ */
+__asm static ZK_FORCE_INLINE zk_uint8 zk_cpu_cm3_is_in_interrupt(void)
+{
+    MRS     r0, IPSR        /* 当前异常号, 线程模式下为 0 */
+    CMP     r0, #0
+    IT      NE
+    MOVNE   r0, #1
+    BX      lr
+}
+
+#else /* __GNUC__ */
+
+/* 语义与上面的 ARMCC 版本一一对应，编译器可将其内联并参与优化 */
+
+static ZK_FORCE_INLINE zk_uint8 zk_cpu_clz(zk_uint32 value)
+{
+    zk_uint32 result;
+    __asm__("rbit %0, %1\n\t"
+            "clz  %0, %0"
+            : "=r"(result)
+            : "r"(value));
+    return (zk_uint8) result;
+}
+
+static ZK_FORCE_INLINE zk_uint8 zk_cpu_fls(zk_uint32 value)
+{
+    return (zk_uint8) (31U - (zk_uint32) __builtin_clz(value));
+}
+
+static ZK_FORCE_INLINE zk_uint32 zk_cpu_ldrex(volatile zk_uint32 *addr)
+{
+    zk_uint32 result;
+    __asm__ volatile("ldrex %0, [%1]" : "=r"(result) : "r"(addr) : "memory");
+    return result;
+}
+
+static ZK_FORCE_INLINE zk_uint32 zk_cpu_strex(zk_uint32 value, volatile zk_uint32 *addr)
+{
+    zk_uint32 result;
+    __asm__ volatile("strex %0, %1, [%2]" : "=&r"(result) : "r"(value), "r"(addr) : "memory");
+    return result;
+}
+
+static ZK_FORCE_INLINE void zk_cpu_clrex(void)
+{
+    __asm__ volatile("clrex" ::: "memory");
+}
+
+static ZK_FORCE_INLINE void zk_cpu_irq_disable(void)
+{
+    __asm__ volatile("cpsid i" ::: "memory");
+}
+
+static ZK_FORCE_INLINE void zk_cpu_irq_enable(void)
+{
+    __asm__ volatile("cpsie i" ::: "memory");
+}
+
+static ZK_FORCE_INLINE void zk_cpu_enter_critical(void)
+{
+    zk_uint32 basepri = ZK_MAX_SYSCALL_INTERRUPT_PRIORITY;
+    __asm__ volatile("msr basepri, %0\n\t"
+                     "dsb\n\t"
+                     "isb"
+                     :
+                     : "r"(basepri)
+                     : "memory");
+    zk_critical_nesting++;
+}
+
+static ZK_FORCE_INLINE void zk_cpu_exit_critical(void)
+{
+    zk_critical_nesting--;
+    if (zk_critical_nesting == 0)
+    {
+        __asm__ volatile("msr basepri, %0" : : "r"(0U) : "memory");
+    }
+}
+
+static ZK_FORCE_INLINE zk_uint8 zk_cpu_cm3_is_in_interrupt(void)
+{
+    zk_uint32 ipsr;
+    __asm__ volatile("mrs %0, ipsr" : "=r"(ipsr));
+    return (zk_uint8) (ipsr != 0U);
+}
+
+#endif /* __CC_ARM */
+
 /* ==================== 函数声明 ==================== */
 
-/* SysTick 和中断相关（zk_cpu_cm3.c 实现）*/
+/* SysTick 相关（zk_cpu_cm3.c 实现）*/
 void zk_cpu_systick_config(void);
-zk_uint8 zk_cpu_cm3_is_in_interrupt(void);
+
+#if ZK_USING_TICKLESS
+/* Tickless 空闲睡眠（zk_cpu_cm3.c 实现）*/
+void zk_cpu_cm3_tickless_sleep(zk_uint32 idle_ticks);
+#endif
 
 /* 栈初始化（zk_cpu_cm3.c 实现）*/
 void *zk_cpu_cm3_stack_init(zk_uint32 *stack_top,
@@ -112,11 +327,20 @@ void *zk_cpu_cm3_stack_init(zk_uint32 *stack_top,
                         void *param);
 
 void *zk_arch_prepare_stack(void *stack_start, void *param);
+void zk_arch_release_stack(void *stack);
 
 /* 调度器启动（zk_cpu_cm3.c 实现，调用汇编函数）*/
 zk_uint32 zk_cpu_cm3_start_scheduler(void);
 
-/* 汇编实现函数（context_rvds.s 实现）*/
+/* 当前异常能否调用内核（zk_cpu_cm3.c 实现，供 ZK_ASSERT_ISR_PRIORITY 使用）*/
+zk_bool zk_cpu_cm3_isr_priority_valid(void);
+
+#if ZK_USING_MPU_STACK_GUARD
+/* MPU 栈保护区（zk_cpu_cm3.c 实现，PendSV 在恢复新任务上下文前调用）*/
+void zk_cpu_cm3_mpu_guard_switch(task_control_block_t *tcb);
+#endif
+
+/* 汇编实现函数（context_rvds.s / context_gcc.S 实现）*/
 void zk_asm_start_first_task(void);
 void zk_asm_svc_handler(void);
 void zk_asm_pendsv_handler(void);
@@ -128,4 +352,35 @@ static inline void zk_cpu_trigger_pendsv(void)
     ZK_CM3_INT_CTRL_REG = ZK_CM3_PENDSVSET_BIT;
 }
 
+/* ==================== DWT 周期计数 ==================== */
+#define ZK_CPU_CYCLES_PER_TICK        ZK_CM3_CYCLES_PER_TICK
+
+/* 读取 DWT 周期计数器 (需先置位 DEMCR.TRCENA 与 DWT_CTRL.CYCCNTENA) */
+static inline zk_uint32 zk_cpu_cycle_count(void)
+{
+    return ZK_CM3_DWT_CYCCNT_REG;
+}
+
+/* 启动 DWT 周期计数器 (不清零, 可重复调用) */
+static inline void zk_cpu_cycle_counter_init(void)
+{
+    ZK_CM3_DEMCR_REG |= ZK_CM3_DEMCR_TRCENA_BIT;
+    ZK_CM3_DWT_CTRL_REG |= ZK_CM3_DWT_CYCCNTENA_BIT;
+}
+
+/* ==================== 编译期端口绑定 (ZK_PORT_STATIC) ==================== */
+/* 进出临界区与触发 PendSV 已由上面的同名内联函数提供，其余接口直接映射到本移植层 */
+#if ZK_PORT_STATIC
+#define zk_cpu_init_systick()                   zk_cpu_systick_config()
+#define zk_cpu_start_scheduler()                zk_cpu_cm3_start_scheduler()
+#define zk_cpu_stack_init(top, entry, param)    zk_cpu_cm3_stack_init(top, entry, param)
+#define zk_cpu_is_in_interrupt()                zk_cpu_cm3_is_in_interrupt()
+#if ZK_USING_TICKLESS
+#define zk_cpu_tickless_sleep(ticks)            zk_cpu_cm3_tickless_sleep(ticks)
+#endif
+#endif
+
+/* 调试断言总是需要，不受 ZK_PORT_STATIC 影响 */
+#define zk_cpu_isr_priority_valid()             zk_cpu_cm3_isr_priority_valid()
+
 #endif /* ZK_CPU_CM3_H */
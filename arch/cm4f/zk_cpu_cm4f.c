@@ -0,0 +1,358 @@
+/**
+ * @file    zk_cpu_cm4f.c
+ * @brief   ZK-RTOS Cortex-M4F/M7 (FPU) architecture-specific implementation
+ * @version 1.0
+ * @note    Implements abstract interfaces defined in zk_cpu.h
+ *          Includes stack initialization, critical section management, SysTick configuration, etc.
+ *          FPU context is stacked lazily: a task that never executes a floating-point
+ *          instruction switches exactly like on Cortex-M3
+ */
+
+#include "zk_cpu_cm4f.h"
+#include "zk_internal.h"
+#include "zk_cpu.h"  /* 包含 zk_cpu_ops_t 类型定义 */
+
+/* ==================== Static Function Declarations ==================== */
+static void zk_task_exit_error(void);
+
+/* ==================== Static Variables ==================== */
+volatile zk_uint32 zk_critical_nesting = 0xaaaaaaaa;
+
+/* ==================== Stack Initialization ==================== */
+
+/**
+ * @brief Stack frame structure (must match hardware/software stack push order!)
+ * @note Stack grows from high to low address, structure layout is from low to high address.
+ *       A new task starts without FPU context, S16-S31 are only stacked once the task has
+ *       used the FPU (see zk_asm_pendsv_handler)
+ */
+typedef struct
+{
+	/* 软件保存的寄存器 R4-R11（在栈的低地址端）*/
+	zk_uint32 r4;
+	zk_uint32 r5;
+	zk_uint32 r6;
+	zk_uint32 r7;
+	zk_uint32 r8;
+	zk_uint32 r9;
+	zk_uint32 r10;
+	zk_uint32 r11;
+
+	/* 软件保存的 EXC_RETURN：bit4 为 0 表示任务栈上还有 S16-S31 与浮点硬件帧 */
+	zk_uint32 exc_return;
+
+	/* 硬件自动保存的寄存器（异常入口时，在栈的高地址端）*/
+	zk_uint32 r0;
+	zk_uint32 r1;
+	zk_uint32 r2;
+	zk_uint32 r3;
+	zk_uint32 r12;
+	zk_uint32 lr;
+	zk_uint32 pc;
+	zk_uint32 psr;
+} zk_stack_frame_t;
+
+/**
+ * @brief Initialize task stack frame
+ * @param stack_top Stack top pointer (high address)
+ * @param task_entry Task entry function
+ * @param param Task parameter
+ * @return Initialized stack pointer (pointing to R4 position)
+ */
+void *zk_cpu_cm4f_stack_init(zk_uint32 *stack_top, zk_uint32 task_entry, void *param)
+{
+	zk_stack_frame_t *frame;
+
+	/* 8字节对齐（ARM EABI 要求）*/
+	stack_top = (zk_uint32 *) (((zk_uint32) stack_top) & ~(0x07UL));
+
+	/* 从栈顶向下分配栈帧空间 */
+	stack_top = (zk_uint32 *) ((zk_uint8 *) stack_top - sizeof(zk_stack_frame_t));
+	frame = (zk_stack_frame_t *) stack_top;
+
+	/* 清零整个栈帧（可选，用于调试）*/
+	zk_uint32 i;
+	for (i = 0; i < (sizeof(zk_stack_frame_t) / sizeof(zk_uint32)); i++)
+	{
+		((zk_uint32 *) frame)[i] = 0;
+	}
+
+	/* 初始化硬件栈帧（必须初始化的字段）*/
+	frame->psr = ZK_CM4F_INITIAL_XPSR;					/* xPSR: Thumb位 */
+	frame->pc = task_entry & ZK_CM4F_START_ADDRESS_MASK; /* PC: 任务入口 */
+	frame->lr = (zk_uint32) zk_task_exit_error;			/* LR: 错误退出函数 */
+	frame->r0 = (zk_uint32) param;						/* R0: 任务参数 */
+	frame->exc_return = ZK_CM4F_INITIAL_EXC_RETURN;		/* 线程模式 + PSP, 无浮点帧 */
+
+	/* 返回栈指针（指向 R4，即软件栈帧的起始位置）*/
+	return stack_top;
+}
+
+/**
+ * @brief Prepare task stack (extract information from task_init_parameter_t)
+ */
+void *zk_arch_prepare_stack(void *stack_start, void *param)
+{
+	task_init_parameter_t *task_param = (task_init_parameter_t *) param;
+	zk_uint32 *stack_top =
+		(zk_uint32 *) ((zk_uint32) stack_start + task_param->stack_size - sizeof(zk_uint32));
+	return zk_cpu_cm4f_stack_init(stack_top, (zk_uint32) (task_param->task_entry),
+							 task_param->private_data);
+}
+
+/**
+ * @brief Release the context of a deleted task (the frame lives in its own stack)
+ */
+void zk_arch_release_stack(void *stack)
+{
+	(void) stack;
+}
+
+/* ==================== Scheduler Startup ==================== */
+
+/**
+ * @brief Start the scheduler
+ */
+zk_uint32 zk_cpu_cm4f_start_scheduler(void)
+{
+	/* 设置 PendSV 和 SysTick 中断优先级最低 */
+	ZK_CM4F_SHPR3_REG |= ZK_CM4F_PENDSV_PRI;
+	ZK_CM4F_SHPR3_REG |= ZK_CM4F_SYSTICK_PRI;
+
+	/* 配置 SysTick 中断 */
+	zk_cpu_systick_config();
+	zk_critical_nesting = 0;
+
+	/* 使能 FPU (CP10/CP11)，并开启自动 + 惰性浮点上下文保存 */
+	ZK_CM4F_CPACR_REG |= ZK_CM4F_CPACR_CP10_CP11_FULL;
+	ZK_CM4F_FPCCR_REG |= (ZK_CM4F_FPCCR_ASPEN_BIT | ZK_CM4F_FPCCR_LSPEN_BIT);
+	__dsb(0xF);
+	__isb(0xF);
+
+#if ZK_TASK_STATS_CYCLES
+	/* 启动 DWT 周期计数器, PendSV 以其作为任务运行时间戳 */
+	ZK_CM4F_DWT_CYCCNT_REG = 0UL;
+	zk_cpu_cycle_counter_init();
+#endif
+
+	/* 启动第一个任务（汇编实现）*/
+	zk_asm_start_first_task();
+
+	return 0;
+}
+
+
+/* ==================== Task Exit Error Handling ==================== */
+
+static void zk_task_exit_error(void)
+{
+	/* 任务退出错误：永久禁用所有中断 */
+	__asm
+	{
+        cpsid i /* 全局关中断 */
+	}
+	for (;;)
+	{
+	}
+}
+
+/* ==================== SysTick Interrupt Handling ==================== */
+
+/**
+ * @brief Configure SysTick timer
+ */
+void zk_cpu_systick_config(void)
+{
+	/* 停止并清除SysTick */
+	ZK_CM4F_SYSTICK_CTRL_REG = 0UL;
+	ZK_CM4F_SYSTICK_CURRENT_VALUE_REG = 0UL;
+
+	/* 配置1ms中断 */
+	ZK_CM4F_SYSTICK_LOAD_REG = (ZK_SYSTICK_CLOCK_HZ / ZK_TICK_RATE_HZ) - 1UL;
+
+	/* 选择SysTick时钟源、启用SysTick中断、启动SysTick计数器 */
+	ZK_CM4F_SYSTICK_CTRL_REG =
+		(ZK_CM4F_SYSTICK_CLK_BIT | ZK_CM4F_SYSTICK_INT_BIT | ZK_CM4F_SYSTICK_ENABLE_BIT);
+}
+
+#if ZK_USING_TICKLESS
+/* ==================== Tickless Idle ==================== */
+
+/**
+ * @brief Restart SysTick with a one-off first period
+ * @param first_cycles Cycles until the next SysTick interrupt
+ */
+static void zk_cpu_systick_restart(zk_uint32 first_cycles)
+{
+	ZK_CM4F_SYSTICK_LOAD_REG = first_cycles - 1UL;
+	ZK_CM4F_SYSTICK_CURRENT_VALUE_REG = 0UL;
+	ZK_CM4F_SYSTICK_CTRL_REG =
+		(ZK_CM4F_SYSTICK_CLK_BIT | ZK_CM4F_SYSTICK_INT_BIT | ZK_CM4F_SYSTICK_ENABLE_BIT);
+
+	/* 新的 LOAD 值在下一次重装载时生效，恢复正常 Tick 周期 */
+	ZK_CM4F_SYSTICK_LOAD_REG = ZK_CM4F_CYCLES_PER_TICK - 1UL;
+}
+
+/**
+ * @brief Stop the periodic tick and sleep until the nearest wake-up
+ * @param idle_ticks Expected idle ticks (from scheduler_get_expected_idle_ticks)
+ * @note  Sleep longer than the 24-bit reload allows is split into chained segments.
+ *        The last tick of a completed sleep is left to the pending SysTick interrupt so that
+ *        wake-up processing runs through the normal scheduler_increment_tick() path.
+ */
+void zk_cpu_cm4f_tickless_sleep(zk_uint32 idle_ticks)
+{
+	const zk_uint32 max_segment_ticks = ZK_CM4F_SYSTICK_MAX_RELOAD / ZK_CM4F_CYCLES_PER_TICK;
+	zk_uint32 stepped_ticks = 0;
+	zk_uint32 first_cycles = 0;
+	zk_uint32 segment_ticks = 0;
+	zk_uint32 loaded_cycles = 0;
+	zk_uint32 left_cycles = 0;
+	zk_uint32 ctrl = 0;
+
+	if (idle_ticks == 0)
+	{
+		return;
+	}
+
+	/* WFI 只能被 PRIMASK 之外的中断唤醒，BASEPRI 会屏蔽内核级中断 */
+	__asm
+	{
+        cpsid i
+	}
+
+	/* 关中断后重新确认：期间有任务就绪或 Tick 已挂起则放弃睡眠 */
+	if (ZK_CM4F_INT_CTRL_REG & (ZK_CM4F_PENDSVSET_BIT | ZK_CM4F_PENDSTSET_BIT))
+	{
+		__asm
+		{
+            cpsie i
+		}
+		return;
+	}
+
+	/* 停止 SysTick，记录当前 Tick 周期剩余 cycle */
+	ZK_CM4F_SYSTICK_CTRL_REG = (ZK_CM4F_SYSTICK_CLK_BIT | ZK_CM4F_SYSTICK_INT_BIT);
+	first_cycles = ZK_CM4F_SYSTICK_CURRENT_VALUE_REG;
+	if (first_cycles == 0)
+	{
+		first_cycles = ZK_CM4F_CYCLES_PER_TICK;
+	}
+
+	for (;;)
+	{
+		segment_ticks = idle_ticks - stepped_ticks;
+		if (segment_ticks > max_segment_ticks)
+		{
+			segment_ticks = max_segment_ticks;
+		}
+
+		loaded_cycles = first_cycles + (segment_ticks - 1UL) * ZK_CM4F_CYCLES_PER_TICK;
+		ZK_CM4F_SYSTICK_LOAD_REG = loaded_cycles - 1UL;
+		ZK_CM4F_SYSTICK_CURRENT_VALUE_REG = 0UL;
+		ZK_CM4F_SYSTICK_CTRL_REG =
+			(ZK_CM4F_SYSTICK_CLK_BIT | ZK_CM4F_SYSTICK_INT_BIT | ZK_CM4F_SYSTICK_ENABLE_BIT);
+
+		__dsb(0xF);
+		__wfi();
+		__isb(0xF);
+
+		/* 读 CTRL 同时清除 COUNTFLAG */
+		ctrl = ZK_CM4F_SYSTICK_CTRL_REG;
+		ZK_CM4F_SYSTICK_CTRL_REG = (ZK_CM4F_SYSTICK_CLK_BIT | ZK_CM4F_SYSTICK_INT_BIT);
+
+		if (ctrl & ZK_CM4F_SYSTICK_COUNTFLAG_BIT)
+		{
+			if (stepped_ticks + segment_ticks >= idle_ticks)
+			{
+				/* 睡眠完成：最后一个 Tick 由已挂起的 SysTick 中断处理 */
+				stepped_ticks += segment_ticks - 1UL;
+				zk_cpu_systick_restart(ZK_CM4F_CYCLES_PER_TICK);
+				break;
+			}
+
+			/* 中间段结束：撤销挂起的 SysTick，自行计数后链式重装 */
+			ZK_CM4F_INT_CTRL_REG = ZK_CM4F_PENDSTCLR_BIT;
+			stepped_ticks += segment_ticks;
+			first_cycles = ZK_CM4F_CYCLES_PER_TICK;
+			continue;
+		}
+
+		/* 被其他中断提前唤醒：只补偿已经完整经过的 Tick */
+		left_cycles = ZK_CM4F_SYSTICK_CURRENT_VALUE_REG;
+		if ((left_cycles % ZK_CM4F_CYCLES_PER_TICK) == 0)
+		{
+			stepped_ticks += segment_ticks - (left_cycles / ZK_CM4F_CYCLES_PER_TICK);
+			zk_cpu_systick_restart(ZK_CM4F_CYCLES_PER_TICK);
+		}
+		else
+		{
+			stepped_ticks += segment_ticks - (left_cycles / ZK_CM4F_CYCLES_PER_TICK) - 1UL;
+			zk_cpu_systick_restart(left_cycles % ZK_CM4F_CYCLES_PER_TICK);
+		}
+		break;
+	}
+
+	zk_time_step(stepped_ticks);
+
+	__asm
+	{
+        cpsie i
+	}
+}
+#endif
+
+/* ==================== Interrupt Priority Check ==================== */
+
+/**
+ * @brief Whether the running exception may call the kernel
+ * @return zk_bool ZK_TRUE in thread mode or when the active exception is masked by
+ *         ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
+ * @note  Backs ZK_ASSERT_ISR_PRIORITY() at the entry of the _from_isr APIs. An interrupt above
+ *        the threshold is never masked by the kernel critical sections, so any kernel call from
+ *        it can corrupt a list. Reset, NMI and HardFault have fixed negative priorities.
+ */
+zk_bool zk_cpu_cm4f_isr_priority_valid(void)
+{
+	zk_uint32 exception = ZK_CM4F_INT_CTRL_REG & ZK_CM4F_VECTACTIVE_MASK;
+	zk_uint8 priority = 0;
+
+	if (exception == 0)
+	{
+		return ZK_TRUE;
+	}
+	if (exception < 4)
+	{
+		return ZK_FALSE;
+	}
+	if (exception < 16)
+	{
+		priority = ZK_CM4F_SHPR_BYTES[exception - 4];
+	}
+	else
+	{
+		priority = ZK_CM4F_NVIC_IPR_BYTES[exception - 16];
+	}
+	return (priority >= ZK_MAX_SYSCALL_INTERRUPT_PRIORITY) ? ZK_TRUE : ZK_FALSE;
+}
+
+/* ==================== Other Utility Functions ==================== */
+
+/* ==================== CPU Abstract Interface Implementation ==================== */
+
+/**
+ * @brief Cortex-M4F/M7 CPU operations interface implementation
+ * @note  Implements abstract interfaces defined in zk_cpu_port.h
+ */
+const zk_cpu_ops_t g_cpu_ops = {
+    .init_systick = zk_cpu_systick_config,
+    .trigger_context_switch = zk_cpu_trigger_pendsv,
+    .enter_critical = zk_cpu_enter_critical,
+    .exit_critical = zk_cpu_exit_critical,
+    .start_scheduler = zk_cpu_cm4f_start_scheduler,
+    .stack_init = zk_cpu_cm4f_stack_init,
+    .is_in_interrupt = zk_cpu_cm4f_is_in_interrupt,
+#if ZK_USING_TICKLESS
+    .tickless_sleep = zk_cpu_cm4f_tickless_sleep,
+#endif
+};
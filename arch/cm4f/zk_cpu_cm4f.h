@@ -0,0 +1,262 @@
+/**
+ * @file    zk_cpu_cm4f.h
+ * @brief   ZK-RTOS Cortex-M4F/M7 (带 FPU) 架构具体实现头文件
+ * @version 1.0
+ * @note    实现 zk_cpu.h 中定义的抽象接口
+ *          包含 Cortex-M4F 特有的寄存器定义和内联函数
+ *          浮点上下文采用惰性压栈 (FPCCR.ASPEN | FPCCR.LSPEN)：
+ *          只有用过 FPU 的任务切换时才保存/恢复 S16-S31
+ *
+ * ⚠️  警告: 此文件为内核代码,用户不应修改!
+ *          硬件配置请修改 config/zk_config.h
+ */
+
+#ifndef ZK_CPU_CM4F_H
+#define ZK_CPU_CM4F_H
+
+/* ==================== 包含配置文件 ==================== */
+#include "zk_config.h"  /* 包含用户配置(CPU频率、中断优先级等) */
+#include "zk_def.h"
+/* ==================== 前置声明：避免循环依赖 ==================== */
+#ifndef ZK_DEF_H
+typedef unsigned char       zk_uint8;
+typedef unsigned int        zk_uint32;
+#endif
+
+/* ==================== SysTick 时钟源计算 ==================== */
+#define ZK_CM4F_SYSTICK_CLK_BIT       (1UL << 2UL)  /* 使用CPU时钟 */
+
+/* ==================== Cortex-M4F 寄存器定义 ==================== */
+#define ZK_CM4F_SYSTICK_CTRL_REG           (*((volatile zk_uint32 *)0xe000e010))
+#define ZK_CM4F_SYSTICK_LOAD_REG           (*((volatile zk_uint32 *)0xe000e014))
+#define ZK_CM4F_SYSTICK_CURRENT_VALUE_REG  (*((volatile zk_uint32 *)0xe000e018))
+#define ZK_CM4F_SHPR3_REG                  (*((volatile zk_uint32 *)0xe000ed20))
+#define ZK_CM4F_INT_CTRL_REG               (*((volatile zk_uint32 *)0xe000ed04))
+#define ZK_CM4F_SHPR_BYTES                 ((volatile zk_uint8 *)0xe000ed18)  /* 异常 4-15 的优先级, 各一字节 */
+#define ZK_CM4F_NVIC_IPR_BYTES             ((volatile zk_uint8 *)0xe000e400)  /* 外部中断的优先级, 各一字节 */
+#define ZK_CM4F_DEMCR_REG                  (*((volatile zk_uint32 *)0xe000edfc))
+#define ZK_CM4F_DWT_CTRL_REG               (*((volatile zk_uint32 *)0xe0001000))
+#define ZK_CM4F_DWT_CYCCNT_REG             (*((volatile zk_uint32 *)0xe0001004))
+#define ZK_CM4F_CPACR_REG                  (*((volatile zk_uint32 *)0xe000ed88))
+#define ZK_CM4F_FPCCR_REG                  (*((volatile zk_uint32 *)0xe000ef34))
+
+/* 寄存器位定义 */
+#define ZK_CM4F_SYSTICK_INT_BIT        (1UL << 1UL)
+#define ZK_CM4F_SYSTICK_ENABLE_BIT     (1UL << 0UL)
+#define ZK_CM4F_PENDSV_PRI             (((zk_uint32)ZK_KERNEL_INTERRUPT_PRIORITY) << 16UL)
+#define ZK_CM4F_SYSTICK_PRI            (((zk_uint32)ZK_KERNEL_INTERRUPT_PRIORITY) << 24UL)
+#define ZK_CM4F_PENDSVSET_BIT          (1UL << 28UL)
+#define ZK_CM4F_VECTACTIVE_MASK        0x1FFUL        /* ICSR: 当前异常号, 线程模式为 0 */
+#define ZK_CM4F_PENDSTSET_BIT          (1UL << 26UL)
+#define ZK_CM4F_PENDSTCLR_BIT          (1UL << 25UL)
+#define ZK_CM4F_SYSTICK_COUNTFLAG_BIT  (1UL << 16UL)
+#define ZK_CM4F_DEMCR_TRCENA_BIT       (1UL << 24UL)
+#define ZK_CM4F_DWT_CYCCNTENA_BIT      (1UL << 0UL)
+#define ZK_CM4F_CPACR_CP10_CP11_FULL   (0xFUL << 20UL)  /* CP10/CP11 完全访问 */
+#define ZK_CM4F_FPCCR_ASPEN_BIT        (1UL << 31UL)    /* 执行浮点指令时自动置位 CONTROL.FPCA */
+#define ZK_CM4F_FPCCR_LSPEN_BIT        (1UL << 30UL)    /* 异常入口惰性保存 S0-S15/FPSCR */
+
+/* SysTick 计数参数 */
+#define ZK_CM4F_SYSTICK_MAX_RELOAD     (0x00FFFFFFUL)  /* 24 位重装载上限 */
+#define ZK_CM4F_CYCLES_PER_TICK        (ZK_SYSTICK_CLOCK_HZ / ZK_TICK_RATE_HZ)
+
+/* 栈初始化常量 */
+#define ZK_CM4F_INITIAL_XPSR           (0x01000000)
+#define ZK_CM4F_START_ADDRESS_MASK     (0xfffffffeUL)
+#define ZK_CM4F_INITIAL_EXC_RETURN     (0xfffffffdUL)   /* 返回线程模式, 使用 PSP, 无浮点帧 */
+
+
+/* ==================== 临界区宏 ==================== */
+#define ZK_ENTER_CRITICAL()     zk_cpu_enter_critical()
+#define ZK_EXIT_CRITICAL()      zk_cpu_exit_critical()
+
+/* ==================== 内存屏障 ==================== */
+/* 保证屏障前的存储先于屏障后的访存对其他执行流(中断/任务)可见 */
+#define ZK_MEMORY_BARRIER()     __dmb(0xF)
+
+/* ==================== 内联函数：BASEPRI 操作 ==================== */
+#define ZK_INLINE          __inline
+#define ZK_FORCE_INLINE    __inline
+
+extern volatile zk_uint32 zk_critical_nesting;
+
+/**
+ * @brief FFS (Find First Set) 指令：查找最低位的 1
+ * @param value 输入值（优先级位图）
+ * @return 最低位 1 的位置（0-31），用于查找最高优先级
+ * @note 实现原理：RBIT（位反转）+ CLZ（前导零计数）
+ *       bit 0 = 优先级 0（最高优先级）
+ */
+__asm static ZK_FORCE_INLINE zk_uint8 zk_cpu_clz(zk_uint32 value)
+{
+    RBIT    r0, r0      /* 位反转：最低位变最高位 */
+    CLZ     r0, r0      /* 计算前导零 = 原最低位 1 的位置 */
+    BX      lr          /* 返回 */
+}
+
+/**
+ * @brief FLS (Find Last Set) 指令：查找最高位的 1
+ * @param value 输入值（非 0）
+ * @return 最高位 1 的位置（0-31），用于 TLSF 的尺寸分级
+ */
+__asm static ZK_FORCE_INLINE zk_uint8 zk_cpu_fls(zk_uint32 value)
+{
+    CLZ     r0, r0          /* 前导零个数 */
+    RSB     r0, r0, #31     /* 31 - CLZ = 最高位 1 的位置 */
+    BX      lr
+}
+
+/**
+ * @brief LDREX：独占读取一个字
+ * @param addr 目标地址
+ * @return 读取到的值
+ * @note 必须与 zk_cpu_strex() 或 zk_cpu_clrex() 配对使用
+ */
+__asm static ZK_FORCE_INLINE zk_uint32 zk_cpu_ldrex(volatile zk_uint32 *addr)
+{
+    LDREX   r0, [r0]
+    BX      lr
+}
+
+/**
+ * @brief STREX：独占写入一个字
+ * @param value 写入值
+ * @param addr 目标地址（与上一次 zk_cpu_ldrex() 相同）
+ * @return 0 写入成功，1 独占被打断（写入未发生）
+ * @note 异常进入/返回会清除本地独占监视器，
+ *       LDREX 与 STREX 之间发生任务切换或中断时 STREX 必定失败
+ */
+__asm static ZK_FORCE_INLINE zk_uint32 zk_cpu_strex(zk_uint32 value, volatile zk_uint32 *addr)
+{
+    STREX   r2, r0, [r1]
+    MOV     r0, r2
+    BX      lr
+}
+
+/**
+ * @brief CLREX：放弃 zk_cpu_ldrex() 建立的独占访问
+ */
+__asm static ZK_FORCE_INLINE void zk_cpu_clrex(void)
+{
+    CLREX
+    BX      lr
+}
+
+/**
+ * @brief 进入临界区（内联函数，零开销）
+ * @note 使用 BASEPRI 屏蔽优先级数值 >= ZK_MAX_SYSCALL_INTERRUPT_PRIORITY 的中断
+ *       写 BASEPRI 前后短暂关中断，规避 Cortex-M7 r0p1 勘误 837070
+ *       (写 BASEPRI 后仍可能被一个本应屏蔽的中断抢占)
+ */
+static ZK_FORCE_INLINE void zk_cpu_enter_critical(void)
+{
+    zk_uint32 basepri = ZK_MAX_SYSCALL_INTERRUPT_PRIORITY;
+    __asm
+    {
+        cpsid i
+        msr basepri, basepri
+        dsb
+        isb
+        cpsie i
+    }
+    zk_critical_nesting++;
+}
+
+
+/**
+ * @brief 退出临界区
+ */
+static ZK_FORCE_INLINE void zk_cpu_exit_critical(void)
+{
+    zk_critical_nesting--;
+    if (zk_critical_nesting == 0)
+    {
+        zk_uint32 basepri_zero = 0;
+        __asm
+        {
+            msr basepri, basepri_zero
+        }
+    }
+}
+
+/* ==================== 函数声明 ==================== */
+
+/* SysTick 相关（zk_cpu_cm4f.c 实现）*/
+void zk_cpu_systick_config(void);
+
+#if ZK_USING_TICKLESS
+/* Tickless 空闲睡眠（zk_cpu_cm4f.c 实现）*/
+void zk_cpu_cm4f_tickless_sleep(zk_uint32 idle_ticks);
+#endif
+
+/* 栈初始化（zk_cpu_cm4f.c 实现）*/
+void *zk_cpu_cm4f_stack_init(zk_uint32 *stack_top,
+                        zk_uint32 task_entry,
+                        void *param);
+
+void *zk_arch_prepare_stack(void *stack_start, void *param);
+void zk_arch_release_stack(void *stack);
+
+/* 调度器启动（zk_cpu_cm4f.c 实现，调用汇编函数）*/
+zk_uint32 zk_cpu_cm4f_start_scheduler(void);
+
+/* 当前异常能否调用内核（zk_cpu_cm4f.c 实现，供 ZK_ASSERT_ISR_PRIORITY 使用）*/
+zk_bool zk_cpu_cm4f_isr_priority_valid(void);
+
+/* 汇编实现函数（context_rvds.s 实现）*/
+void zk_asm_start_first_task(void);
+void zk_asm_svc_handler(void);
+void zk_asm_pendsv_handler(void);
+void zk_asm_systick_handler(void);
+
+/* 触发 PendSV */
+static inline void zk_cpu_trigger_pendsv(void)
+{
+    ZK_CM4F_INT_CTRL_REG = ZK_CM4F_PENDSVSET_BIT;
+}
+
+/**
+ * @brief 判断当前是否在中断上下文
+ * @return 1: 处理模式 (IPSR 非 0), 0: 线程模式
+ */
+__asm static ZK_FORCE_INLINE zk_uint8 zk_cpu_cm4f_is_in_interrupt(void)
+{
+    MRS     r0, IPSR        /* 当前异常号, 线程模式下为 0 */
+    CMP     r0, #0
+    IT      NE
+    MOVNE   r0, #1
+    BX      lr
+}
+
+/* ==================== DWT 周期计数 ==================== */
+#define ZK_CPU_CYCLES_PER_TICK        ZK_CM4F_CYCLES_PER_TICK
+
+/* 读取 DWT 周期计数器 (需先置位 DEMCR.TRCENA 与 DWT_CTRL.CYCCNTENA) */
+static inline zk_uint32 zk_cpu_cycle_count(void)
+{
+    return ZK_CM4F_DWT_CYCCNT_REG;
+}
+
+/* 启动 DWT 周期计数器 (不清零, 可重复调用) */
+static inline void zk_cpu_cycle_counter_init(void)
+{
+    ZK_CM4F_DEMCR_REG |= ZK_CM4F_DEMCR_TRCENA_BIT;
+    ZK_CM4F_DWT_CTRL_REG |= ZK_CM4F_DWT_CYCCNTENA_BIT;
+}
+
+/* ==================== 编译期端口绑定 (ZK_PORT_STATIC) ==================== */
+/* 进出临界区与触发 PendSV 已由上面的同名内联函数提供，其余接口直接映射到本移植层 */
+#if ZK_PORT_STATIC
+#define zk_cpu_init_systick()                   zk_cpu_systick_config()
+#define zk_cpu_start_scheduler()                zk_cpu_cm4f_start_scheduler()
+#define zk_cpu_stack_init(top, entry, param)    zk_cpu_cm4f_stack_init(top, entry, param)
+#define zk_cpu_is_in_interrupt()                zk_cpu_cm4f_is_in_interrupt()
+#if ZK_USING_TICKLESS
+#define zk_cpu_tickless_sleep(ticks)            zk_cpu_cm4f_tickless_sleep(ticks)
+#endif
+#endif
+
+/* 调试断言总是需要，不受 ZK_PORT_STATIC 影响 */
+#define zk_cpu_isr_priority_valid()             zk_cpu_cm4f_isr_priority_valid()
+
+#endif /* ZK_CPU_CM4F_H */
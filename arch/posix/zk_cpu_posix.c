@@ -0,0 +1,337 @@
+/**
+ * @file    zk_cpu_posix.c
+ * @brief   ZK-RTOS POSIX host simulator port
+ * @version 1.0
+ * @note    Implements abstract interfaces defined in zk_cpu.h on top of ucontext and signals.
+ *          All tasks share one host thread; the SIGALRM handler plays the SysTick interrupt
+ *          and a context switch is a swapcontext() between two task contexts.
+ */
+
+#include "zk_cpu_posix.h"
+#include "zk_internal.h"
+#include "zk_cpu.h" /* 包含 zk_cpu_ops_t 类型定义 */
+#include "zk_posix_host.h"
+
+/* ==================== Task Context ==================== */
+
+/**
+ * @brief Host context of one task, tcb->stack points here
+ */
+typedef struct
+{
+	zk_posix_host_context_t *host;
+	task_function_t entry;
+	void *param;
+	zk_uint8 in_use; /* Cleared when the task is deleted, the host context is then reused */
+} zk_posix_task_t;
+
+static zk_posix_task_t g_posix_tasks[ZK_POSIX_MAX_TASKS];
+static zk_uint32 g_posix_task_count = 0;
+
+#define ZK_POSIX_TASK_OF(tcb) ((zk_posix_task_t *) (tcb)->stack)
+
+/* ==================== Static Variables ==================== */
+volatile zk_uint32 zk_critical_nesting = 0xaaaaaaaa;
+
+/* "BASEPRI": set inside critical sections, the tick handler and the switch path */
+volatile zk_uint32 g_zk_posix_irq_masked = 1;
+/* Local exclusive monitor of the LDREX/STREX emulation */
+volatile zk_uint32 *volatile g_zk_posix_exclusive = ZK_NULL;
+
+static volatile zk_uint32 g_posix_in_isr = 0;
+static volatile zk_uint32 g_posix_tick_pending = 0;
+static volatile zk_uint32 g_posix_switch_pending = 0;
+
+extern task_control_block_t *volatile g_current_tcb;
+extern task_control_block_t *volatile g_switch_next_tcb;
+
+/* ==================== Context Switch (PendSV) ==================== */
+
+/**
+ * @brief Switch from g_current_tcb to g_switch_next_tcb
+ * @note  Called with interrupts masked; returns once the calling task is switched back in
+ */
+static void zk_posix_switch_context(void)
+{
+	task_control_block_t *old_tcb = g_current_tcb;
+	task_control_block_t *new_tcb = g_switch_next_tcb;
+
+	g_zk_posix_exclusive = ZK_NULL;
+
+#if (ZK_TASK_STATS_MODE == 1) || (ZK_TASK_STATS_MODE == 3)
+	task_update_runtime_stats(old_tcb, new_tcb);
+#elif (ZK_TASK_STATS_MODE == 2)
+	{
+		zk_uint32 now = zk_cpu_cycle_count();
+		old_tcb->run_cycles += (zk_uint32) (now - old_tcb->switch_in_cycles);
+		new_tcb->switch_in_cycles = now;
+	}
+#endif
+
+	g_current_tcb = new_tcb;
+	ZK_PERF_ADD(context_switches, 1);
+	if (old_tcb != new_tcb)
+	{
+		zk_posix_host_context_switch(ZK_POSIX_TASK_OF(old_tcb)->host,
+									 ZK_POSIX_TASK_OF(new_tcb)->host);
+	}
+}
+
+/**
+ * @brief Run pending "interrupts" (tick, then context switch) until none is left
+ * @note  Entered with interrupts unmasked, leaves them unmasked
+ */
+static void zk_posix_service_pending(void)
+{
+	for (;;)
+	{
+		g_zk_posix_irq_masked = 1;
+		ZK_MEMORY_BARRIER();
+
+		if (g_posix_tick_pending)
+		{
+			g_posix_tick_pending = 0;
+			g_posix_in_isr = 1;
+			g_zk_posix_exclusive = ZK_NULL;
+			scheduler_increment_tick();
+			g_posix_in_isr = 0;
+			continue;
+		}
+
+		if (g_posix_switch_pending)
+		{
+			g_posix_switch_pending = 0;
+			zk_posix_switch_context();
+			continue;
+		}
+
+		g_zk_posix_irq_masked = 0;
+		ZK_MEMORY_BARRIER();
+
+		/* a tick may have been latched between the last check and the unmask */
+		if (!g_posix_tick_pending)
+		{
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Drop the interrupt mask and service what was latched meanwhile
+ */
+void zk_cpu_posix_irq_unmask(void)
+{
+	if (g_posix_in_isr || zk_critical_nesting != 0)
+	{
+		return;
+	}
+	zk_posix_service_pending();
+}
+
+void zk_cpu_posix_trigger_pendsv(void)
+{
+	g_posix_switch_pending = 1;
+	if (!g_posix_in_isr && zk_critical_nesting == 0)
+	{
+		zk_posix_service_pending();
+	}
+}
+
+zk_uint8 zk_cpu_posix_is_in_interrupt(void)
+{
+	return (zk_uint8) (g_posix_in_isr != 0);
+}
+
+zk_uint32 zk_cpu_strex(zk_uint32 value, volatile zk_uint32 *addr)
+{
+	zk_uint32 failed = 1;
+	zk_uint32 masked = g_zk_posix_irq_masked;
+
+	g_zk_posix_irq_masked = 1;
+	ZK_MEMORY_BARRIER();
+	if (g_zk_posix_exclusive == addr)
+	{
+		*addr = value;
+		failed = 0;
+	}
+	g_zk_posix_exclusive = ZK_NULL;
+
+	if (!masked)
+	{
+		zk_posix_service_pending();
+	}
+	return failed;
+}
+
+/* ==================== SysTick ==================== */
+
+/**
+ * @brief SIGALRM handler, the simulated SysTick interrupt
+ */
+static void zk_posix_tick_handler(void)
+{
+	g_posix_tick_pending = 1;
+	g_zk_posix_exclusive = ZK_NULL;
+	if (!g_zk_posix_irq_masked)
+	{
+		/* may switch to another task; this frame resumes when the task is switched back */
+		zk_posix_service_pending();
+	}
+}
+
+/**
+ * @brief Start the periodic tick timer
+ */
+void zk_cpu_systick_config(void)
+{
+	zk_posix_host_tick_start(zk_posix_tick_handler, 1000000UL / ZK_TICK_RATE_HZ);
+}
+
+#if ZK_USING_TICKLESS
+/**
+ * @brief Suspend the host thread until the next tick signal
+ * @param idle_ticks Expected idle ticks (unused, ticks keep running while asleep)
+ * @note  The host timer is never stopped, so there is no elapsed time to compensate
+ */
+void zk_cpu_posix_tickless_sleep(zk_uint32 idle_ticks)
+{
+	(void) idle_ticks;
+	zk_posix_host_wait_tick(&g_posix_tick_pending);
+}
+#endif
+
+zk_uint32 zk_cpu_cycle_count(void)
+{
+	return zk_posix_host_time_ns();
+}
+
+/* ==================== Task Context Initialization ==================== */
+
+static void zk_posix_task_entry(void)
+{
+	zk_posix_task_t *task = ZK_POSIX_TASK_OF(g_current_tcb);
+
+	/* a new task starts like an exception return: unmasked, nesting 0 */
+	zk_posix_service_pending();
+	task->entry(task->param);
+
+	zk_posix_host_fatal("task returned from its entry function");
+}
+
+static void *zk_posix_task_init(task_function_t entry, void *param)
+{
+	zk_posix_task_t *task = ZK_NULL;
+	zk_uint32 i = 0;
+
+	for (i = 0; i < g_posix_task_count; i++)
+	{
+		if (!g_posix_tasks[i].in_use)
+		{
+			task = &g_posix_tasks[i];
+			zk_posix_host_context_reset(task->host, zk_posix_task_entry);
+			task->entry = entry;
+			task->param = param;
+			task->in_use = 1;
+			return task;
+		}
+	}
+
+	if (g_posix_task_count >= ZK_POSIX_MAX_TASKS)
+	{
+		zk_posix_host_fatal("out of task contexts, raise ZK_POSIX_MAX_TASKS");
+	}
+
+	/* handles are TCB addresses kept in zk_uint32 by the kernel */
+	if ((unsigned long) g_heap > 0xFFFFFFFFUL)
+	{
+		zk_posix_host_fatal("static data above 4GB, link with -no-pie");
+	}
+
+	task = &g_posix_tasks[g_posix_task_count];
+	task->host = zk_posix_host_context_create(zk_posix_task_entry, ZK_POSIX_TASK_STACK_SIZE,
+											  ZK_POSIX_MAX_TASKS);
+	if (task->host == ZK_NULL)
+	{
+		zk_posix_host_fatal("cannot allocate a host task context");
+	}
+	g_posix_task_count++;
+
+	task->entry = entry;
+	task->param = param;
+	task->in_use = 1;
+	return task;
+}
+
+/**
+ * @brief Initialize task context
+ * @param stack_top Kernel stack top (unused, tasks run on host stacks)
+ * @param task_entry Task entry function
+ * @param param Task parameter
+ * @return Host context stored in tcb->stack
+ */
+void *zk_cpu_posix_stack_init(zk_uint32 *stack_top, zk_uint32 task_entry, void *param)
+{
+	(void) stack_top;
+	return zk_posix_task_init((task_function_t) (unsigned long) task_entry, param);
+}
+
+/**
+ * @brief Prepare task context (extract information from task_init_parameter_t)
+ */
+void *zk_arch_prepare_stack(void *stack_start, void *param)
+{
+	task_init_parameter_t *task_param = (task_init_parameter_t *) param;
+
+	(void) stack_start;
+	return zk_posix_task_init(task_param->task_entry, task_param->private_data);
+}
+
+/**
+ * @brief Release the host context of a deleted task for the next task_create()
+ * @note  Called from the idle task, never on the context being released
+ */
+void zk_arch_release_stack(void *stack)
+{
+	((zk_posix_task_t *) stack)->in_use = 0;
+}
+
+/* ==================== Scheduler Startup ==================== */
+
+/**
+ * @brief Start the scheduler, never returns
+ */
+zk_uint32 zk_cpu_posix_start_scheduler(void)
+{
+	g_posix_switch_pending = 0;
+	g_posix_tick_pending = 0;
+	zk_critical_nesting = 0;
+
+#if ZK_TASK_STATS_CYCLES
+	g_current_tcb->switch_in_cycles = zk_cpu_cycle_count();
+#endif
+
+	zk_cpu_systick_config();
+
+	/* the first task unmasks interrupts in zk_posix_task_entry() */
+	zk_posix_host_context_start(ZK_POSIX_TASK_OF(g_current_tcb)->host);
+
+	return 0;
+}
+
+/* ==================== CPU Abstract Interface Implementation ==================== */
+
+/**
+ * @brief POSIX simulator CPU operations interface implementation
+ */
+const zk_cpu_ops_t g_cpu_ops = {
+	.init_systick = zk_cpu_systick_config,
+	.trigger_context_switch = zk_cpu_posix_trigger_pendsv,
+	.enter_critical = zk_cpu_enter_critical,
+	.exit_critical = zk_cpu_exit_critical,
+	.start_scheduler = zk_cpu_posix_start_scheduler,
+	.stack_init = zk_cpu_posix_stack_init,
+	.is_in_interrupt = zk_cpu_posix_is_in_interrupt,
+#if ZK_USING_TICKLESS
+	.tickless_sleep = zk_cpu_posix_tickless_sleep,
+#endif
+};
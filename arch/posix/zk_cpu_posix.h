@@ -0,0 +1,175 @@
+/**
+ * @file    zk_cpu_posix.h
+ * @brief   ZK-RTOS POSIX 主机模拟移植层头文件
+ * @version 1.0
+ * @note    实现 zk_cpu.h 中定义的抽象接口, 让内核源码不经修改地运行在 Linux 主机上
+ *          - 任务: 每个任务一个 ucontext, 全部运行在同一个主机线程中
+ *          - SysTick: ITIMER_REAL 定时器产生的 SIGALRM, 信号处理函数即 "中断"
+ *          - BASEPRI: 临界区只置位屏蔽标志, 期间到来的 Tick 挂起到退出临界区时处理
+ *          - PendSV: 屏蔽期间请求的切换挂起, 解除屏蔽时以 swapcontext 完成
+ *          内核以 zk_uint32 保存句柄与地址, 主机程序需以 -no-pie 链接
+ *          (静态数据位于 4GB 以下), 见 sim/CMakeLists.txt
+ *
+ * ⚠️  警告: 此文件为内核代码,用户不应修改!
+ */
+
+#ifndef ZK_CPU_POSIX_H
+#define ZK_CPU_POSIX_H
+
+/* ==================== 包含配置文件 ==================== */
+#include "zk_config.h"
+#include "zk_def.h"
+
+/* ==================== 模拟器参数 ==================== */
+/* 可同时存在的任务数 (含空闲任务) */
+#ifndef ZK_POSIX_MAX_TASKS
+#define ZK_POSIX_MAX_TASKS          16
+#endif
+
+/* 每个任务的主机栈大小 (字节), 与 task_init_parameter_t.stack_size 无关: 主机
+ * 信号帧与 libc 调用远大于 MCU 上的任务栈, 内核分配的任务栈在模拟器中只作记账 */
+#ifndef ZK_POSIX_TASK_STACK_SIZE
+#define ZK_POSIX_TASK_STACK_SIZE    (64 * 1024)
+#endif
+
+/* ==================== 临界区宏 ==================== */
+#define ZK_ENTER_CRITICAL()     zk_cpu_enter_critical()
+#define ZK_EXIT_CRITICAL()      zk_cpu_exit_critical()
+
+/* ==================== 编译器适配 ==================== */
+#define ZK_INLINE          __inline
+#define ZK_FORCE_INLINE    __inline __attribute__((always_inline))
+
+/* 单线程执行, 只需阻止编译器跨越屏障重排 (信号处理函数与任务之间) */
+#define ZK_MEMORY_BARRIER()     __atomic_signal_fence(__ATOMIC_SEQ_CST)
+
+extern volatile zk_uint32 zk_critical_nesting;
+extern volatile zk_uint32 g_zk_posix_irq_masked;
+extern volatile zk_uint32 *volatile g_zk_posix_exclusive;
+
+void zk_cpu_posix_irq_unmask(void);
+
+/**
+ * @brief FFS：查找最低位的 1 (与 RBIT + CLZ 一致, 输入 0 时返回 32)
+ */
+static ZK_FORCE_INLINE zk_uint8 zk_cpu_clz(zk_uint32 value)
+{
+    return (value == 0U) ? 32U : (zk_uint8) __builtin_ctz(value);
+}
+
+/**
+ * @brief FLS：查找最高位的 1 (输入非 0)
+ */
+static ZK_FORCE_INLINE zk_uint8 zk_cpu_fls(zk_uint32 value)
+{
+    return (zk_uint8) (31U - (zk_uint32) __builtin_clz(value));
+}
+
+/**
+ * @brief LDREX 模拟：记录独占地址后读取
+ * @note 与 Cortex-M 相同, 每次 "异常" (Tick、任务切换) 都会清除独占记录
+ */
+static ZK_FORCE_INLINE zk_uint32 zk_cpu_ldrex(volatile zk_uint32 *addr)
+{
+    g_zk_posix_exclusive = addr;
+    ZK_MEMORY_BARRIER();
+    return *addr;
+}
+
+/**
+ * @brief STREX 模拟
+ * @return 0 写入成功，1 独占被打断（写入未发生）
+ */
+zk_uint32 zk_cpu_strex(zk_uint32 value, volatile zk_uint32 *addr);
+
+/**
+ * @brief CLREX 模拟
+ */
+static ZK_FORCE_INLINE void zk_cpu_clrex(void)
+{
+    g_zk_posix_exclusive = ZK_NULL;
+}
+
+/**
+ * @brief 进入临界区 (相当于写 BASEPRI)
+ */
+static ZK_FORCE_INLINE void zk_cpu_enter_critical(void)
+{
+    g_zk_posix_irq_masked = 1;
+    ZK_MEMORY_BARRIER();
+    zk_critical_nesting++;
+}
+
+/**
+ * @brief 退出临界区, 最外层退出时处理屏蔽期间挂起的 Tick 与任务切换
+ */
+static ZK_FORCE_INLINE void zk_cpu_exit_critical(void)
+{
+    zk_critical_nesting--;
+    if (zk_critical_nesting == 0)
+    {
+        zk_cpu_posix_irq_unmask();
+    }
+}
+
+/* ==================== 函数声明 ==================== */
+
+/* Tick 定时器（zk_cpu_posix.c 实现）*/
+void zk_cpu_systick_config(void);
+
+#if ZK_USING_TICKLESS
+/* 空闲睡眠: 挂起主机线程直到下一个 Tick 信号 */
+void zk_cpu_posix_tickless_sleep(zk_uint32 idle_ticks);
+#endif
+
+/* 任务上下文初始化 */
+void *zk_cpu_posix_stack_init(zk_uint32 *stack_top,
+                              zk_uint32 task_entry,
+                              void *param);
+
+void *zk_arch_prepare_stack(void *stack_start, void *param);
+void zk_arch_release_stack(void *stack);
+
+/* 调度器启动（不返回）*/
+zk_uint32 zk_cpu_posix_start_scheduler(void);
+
+/* 请求任务切换 (PendSV): 屏蔽期间挂起, 否则立即切换 */
+void zk_cpu_posix_trigger_pendsv(void);
+
+static inline void zk_cpu_trigger_pendsv(void)
+{
+    zk_cpu_posix_trigger_pendsv();
+}
+
+/* 是否处于模拟的中断上下文 (Tick 信号处理中) */
+zk_uint8 zk_cpu_posix_is_in_interrupt(void);
+
+/* ==================== 运行时间戳 ==================== */
+/* 以 CLOCK_MONOTONIC 纳秒计数代替 DWT 周期计数 */
+#define ZK_CPU_CYCLES_PER_TICK        (1000000000UL / ZK_TICK_RATE_HZ)
+
+zk_uint32 zk_cpu_cycle_count(void);
+
+/* 主机单调时钟始终运行, 无需启动 */
+static inline void zk_cpu_cycle_counter_init(void)
+{
+}
+
+/* 模拟中断没有优先级, 任何信号处理函数都可调用内核 (ZK_ASSERT_ISR_PRIORITY) */
+static inline zk_bool zk_cpu_isr_priority_valid(void)
+{
+    return ZK_TRUE;
+}
+
+/* ==================== 编译期端口绑定 (ZK_PORT_STATIC) ==================== */
+#if ZK_PORT_STATIC
+#define zk_cpu_init_systick()                   zk_cpu_systick_config()
+#define zk_cpu_start_scheduler()                zk_cpu_posix_start_scheduler()
+#define zk_cpu_stack_init(top, entry, param)    zk_cpu_posix_stack_init(top, entry, param)
+#define zk_cpu_is_in_interrupt()                zk_cpu_posix_is_in_interrupt()
+#if ZK_USING_TICKLESS
+#define zk_cpu_tickless_sleep(ticks)            zk_cpu_posix_tickless_sleep(ticks)
+#endif
+#endif
+
+#endif /* ZK_CPU_POSIX_H */
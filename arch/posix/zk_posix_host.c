@@ -0,0 +1,136 @@
+/**
+ * @file    zk_posix_host.c
+ * @brief   ZK-RTOS POSIX simulator host services (ucontext, SIGALRM, monotonic clock)
+ * @note    Does not include kernel headers, see zk_posix_host.h
+ */
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "zk_posix_host.h"
+
+#define ZK_POSIX_HOST_MAX_CONTEXTS 64
+
+struct zk_posix_host_context
+{
+	ucontext_t context;
+	unsigned char *stack;
+};
+
+/* Static pool so that every context (and so every tcb->stack) lives below 4GB */
+static struct zk_posix_host_context g_host_contexts[ZK_POSIX_HOST_MAX_CONTEXTS];
+static unsigned int g_host_context_count = 0;
+static void (*g_host_tick_handler)(void) = 0;
+
+zk_posix_host_context_t *zk_posix_host_context_create(void (*entry)(void),
+														unsigned long stack_size,
+														unsigned int max_contexts)
+{
+	struct zk_posix_host_context *ctx = 0;
+
+	if (g_host_context_count >= max_contexts ||
+		g_host_context_count >= ZK_POSIX_HOST_MAX_CONTEXTS)
+	{
+		return 0;
+	}
+
+	ctx = &g_host_contexts[g_host_context_count];
+	ctx->stack = malloc(stack_size);
+	if (ctx->stack == 0)
+	{
+		return 0;
+	}
+	g_host_context_count++;
+
+	ctx->context.uc_stack.ss_size = stack_size;
+	zk_posix_host_context_reset(ctx, entry);
+
+	return ctx;
+}
+
+void zk_posix_host_context_reset(zk_posix_host_context_t *ctx, void (*entry)(void))
+{
+	unsigned long stack_size = ctx->context.uc_stack.ss_size;
+
+	getcontext(&ctx->context);
+	ctx->context.uc_stack.ss_sp = ctx->stack;
+	ctx->context.uc_stack.ss_size = stack_size;
+	ctx->context.uc_link = 0;
+	sigemptyset(&ctx->context.uc_sigmask);
+	makecontext(&ctx->context, entry, 0);
+}
+
+void zk_posix_host_context_switch(zk_posix_host_context_t *from, zk_posix_host_context_t *to)
+{
+	swapcontext(&from->context, &to->context);
+}
+
+void zk_posix_host_context_start(zk_posix_host_context_t *to)
+{
+	setcontext(&to->context);
+	zk_posix_host_fatal("setcontext failed");
+}
+
+static void zk_posix_host_signal(int signo)
+{
+	(void) signo;
+	g_host_tick_handler();
+}
+
+void zk_posix_host_tick_start(void (*handler)(void), unsigned long period_us)
+{
+	struct sigaction action;
+	struct itimerval timer;
+
+	g_host_tick_handler = handler;
+
+	action.sa_handler = zk_posix_host_signal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGALRM, &action, 0);
+
+	timer.it_interval.tv_sec = (time_t) (period_us / 1000000UL);
+	timer.it_interval.tv_usec = (suseconds_t) (period_us % 1000000UL);
+	timer.it_value = timer.it_interval;
+	if (setitimer(ITIMER_REAL, &timer, 0) != 0)
+	{
+		zk_posix_host_fatal("setitimer failed");
+	}
+}
+
+void zk_posix_host_wait_tick(volatile unsigned int *pending)
+{
+	sigset_t block;
+	sigset_t old;
+
+	/* block first so that a tick between the check and the sleep is not lost */
+	sigemptyset(&block);
+	sigaddset(&block, SIGALRM);
+	sigprocmask(SIG_BLOCK, &block, &old);
+	if (*pending == 0)
+	{
+		sigsuspend(&old);
+	}
+	sigprocmask(SIG_SETMASK, &old, 0);
+}
+
+unsigned int zk_posix_host_time_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned int) ((unsigned long long) now.tv_sec * 1000000000ULL +
+						   (unsigned long long) now.tv_nsec);
+}
+
+void zk_posix_host_fatal(const char *reason)
+{
+	fprintf(stderr, "zkRTOS posix port: %s\n", reason);
+	abort();
+}
@@ -0,0 +1,42 @@
+/**
+ * @file    zk_posix_host.h
+ * @brief   ZK-RTOS POSIX 模拟器主机接口
+ * @note    zk_posix_host.c 使用 ucontext/信号/时钟等主机接口, 本头文件只用基本 C 类型,
+ *          避免内核头文件与系统头文件同时包含 (timer_t、timer_create 等命名冲突)
+ *
+ * ⚠️  警告: 此文件为内核代码,用户不应修改!
+ */
+
+#ifndef ZK_POSIX_HOST_H
+#define ZK_POSIX_HOST_H
+
+/* 主机上下文 (不透明), 栈大小 ZK_POSIX_TASK_STACK_SIZE */
+typedef struct zk_posix_host_context zk_posix_host_context_t;
+
+/* 分配任务上下文, 切入时从 entry() 开始执行; 上下文池耗尽返回 0 */
+zk_posix_host_context_t *zk_posix_host_context_create(void (*entry)(void),
+														unsigned long stack_size,
+														unsigned int max_contexts);
+
+/* 在原有栈上重建上下文, 下次切入时重新从 entry() 开始 */
+void zk_posix_host_context_reset(zk_posix_host_context_t *ctx, void (*entry)(void));
+
+/* 保存当前上下文到 from 并切换到 to, 再次切回 from 时返回 */
+void zk_posix_host_context_switch(zk_posix_host_context_t *from, zk_posix_host_context_t *to);
+
+/* 丢弃当前执行流, 切换到 to (不返回) */
+void zk_posix_host_context_start(zk_posix_host_context_t *to);
+
+/* 以 period_us 为周期启动 SIGALRM, 每次到期调用 handler() */
+void zk_posix_host_tick_start(void (*handler)(void), unsigned long period_us);
+
+/* 挂起主机线程直到下一个 Tick 信号, 若 *pending 非 0 则立即返回 */
+void zk_posix_host_wait_tick(volatile unsigned int *pending);
+
+/* CLOCK_MONOTONIC 纳秒计数 (低 32 位) */
+unsigned int zk_posix_host_time_ns(void);
+
+/* 打印原因后终止进程 */
+void zk_posix_host_fatal(const char *reason);
+
+#endif /* ZK_POSIX_HOST_H */
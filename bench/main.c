@@ -0,0 +1,23 @@
+/**
+ * @file    main.c
+ * @brief   Benchmark image entry: replaces the BSP main.c in the bench targets
+ */
+
+#include "zk_rtos.h"
+#include "zk_bench.h"
+
+extern void board_init(void);
+
+int main(void)
+{
+	board_init();
+	zk_kernel_init();
+
+	zk_bench_init();
+
+	zk_start_scheduler();
+
+	while (1)
+	{
+	}
+}
@@ -0,0 +1,214 @@
+/**
+ * @file    zk_bench.c
+ * @brief   Benchmark statistics, peer task and runner
+ */
+
+#include "zk_bench.h"
+
+static zk_uint32 g_bench_peer_sem;
+static zk_bench_peer_fn_t volatile g_bench_peer_fn = ZK_NULL;
+
+/* ==================== Sample statistics ==================== */
+
+void zk_bench_stat_reset(zk_bench_stat_t *stat, const char *name)
+{
+	stat->name = name;
+	stat->count = 0;
+	stat->min = 0xFFFFFFFFUL;
+	stat->max = 0;
+	stat->sum = 0;
+}
+
+void zk_bench_stat_add(zk_bench_stat_t *stat, zk_uint32 sample)
+{
+	if (sample < stat->min)
+	{
+		stat->min = sample;
+	}
+	if (sample > stat->max)
+	{
+		stat->max = sample;
+	}
+	stat->sum += sample;
+	stat->count++;
+}
+
+void zk_bench_stat_print(const zk_bench_stat_t *stat)
+{
+	if (stat->count == 0)
+	{
+		zk_printf("%s: no samples\r\n", stat->name);
+		return;
+	}
+	zk_printf("%s: n=%u min=%u avg=%u max=%u\r\n", stat->name, stat->count, stat->min,
+			  (zk_uint32) (stat->sum / stat->count), stat->max);
+}
+
+/* ==================== Tasks ==================== */
+
+zk_uint32 zk_bench_task_create(task_function_t entry, const char *name, zk_uint8 priority,
+							   zk_uint32 stack_size, void *param)
+{
+	task_init_parameter_t parameter;
+	zk_uint32 handle = 0;
+	zk_uint32 i = 0;
+
+	zk_memclear(&parameter, sizeof(parameter));
+	for (i = 0; name[i] != '\0' && i < CONFIG_TASK_NAME_LEN - 1; i++)
+	{
+		parameter.name[i] = (zk_uint8) name[i];
+	}
+	parameter.task_entry = entry;
+	parameter.priority = priority;
+	parameter.stack_size = stack_size;
+	parameter.private_data = param;
+
+	if (task_create(&parameter, &handle) != ZK_SUCCESS)
+	{
+		zk_printf("bench: cannot create task %s\r\n", name);
+		return 0;
+	}
+	return handle;
+}
+
+static void zk_bench_peer_task(void *param)
+{
+	(void) param;
+	for (;;)
+	{
+		sem_get(g_bench_peer_sem);
+		g_bench_peer_fn();
+	}
+}
+
+void zk_bench_peer_start(zk_bench_peer_fn_t fn)
+{
+	g_bench_peer_fn = fn;
+	sem_release(g_bench_peer_sem);
+}
+
+/* ==================== Runner ==================== */
+
+/**
+ * @brief Measure the cost of reading the cycle counter itself
+ */
+static void zk_bench_overhead_run(void)
+{
+	zk_bench_stat_t stat;
+	zk_uint32 start = 0;
+	zk_uint32 i = 0;
+
+	zk_bench_stat_reset(&stat, "overhead.timer_read");
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		start = zk_bench_now();
+		zk_bench_stat_add(&stat, zk_bench_now() - start);
+	}
+	zk_bench_stat_print(&stat);
+}
+
+#if ZK_USING_CRITICAL_STATS
+/**
+ * @brief Report the interrupt-masked time accumulated while the cases ran
+ */
+static void zk_bench_critical_report(void)
+{
+	static const char *const names[ZK_CRITICAL_SUBSYS_NUM] = {"other", "mem", "queue", "sched",
+																"timer"};
+	zk_critical_stats_t stats;
+	zk_uint32 subsys = 0;
+	zk_uint32 bucket = 0;
+
+	for (subsys = 0; subsys < ZK_CRITICAL_SUBSYS_NUM; subsys++)
+	{
+		zk_critical_get_stats(subsys, &stats);
+		if (stats.count == 0)
+		{
+			continue;
+		}
+		zk_printf("critical.%s: n=%u avg=%u max=%u site=0x%x hist=", names[subsys], stats.count,
+				  (zk_uint32) (stats.total_cycles / stats.count), stats.max_cycles,
+				  stats.max_site);
+		for (bucket = 0; bucket < ZK_CRITICAL_HIST_BUCKETS; bucket++)
+		{
+			zk_printf("%u ", stats.histogram[bucket]);
+		}
+		zk_printf("\r\n");
+	}
+}
+#endif
+
+#if ZK_USING_TRACE
+/**
+ * @brief Drain the trace ring and count the records of each kernel event
+ * @note The ring keeps only the newest ZK_TRACE_BUFFER_RECORDS records of the run
+ */
+static void zk_bench_trace_report(void)
+{
+	zk_trace_record_t records[16];
+	zk_uint32 counts[0x42];
+	zk_uint32 count = 0;
+	zk_uint32 event = 0;
+	zk_uint32 i = 0;
+
+	zk_memclear(counts, sizeof(counts));
+	while ((count = zk_trace_read(records, ZK_BENCH_ARRAY_SIZE(records))) > 0)
+	{
+		for (i = 0; i < count; i++)
+		{
+			event = records[i].info & 0xFFUL;
+			if (event < ZK_BENCH_ARRAY_SIZE(counts))
+			{
+				counts[event]++;
+			}
+		}
+	}
+	zk_printf("trace: switch=%u ready=%u block=%u delay=%u tick=%u sem=%u/%u queue=%u/%u "
+			  "mutex=%u/%u\r\n",
+			  counts[ZK_TRACE_EV_SWITCH], counts[ZK_TRACE_EV_READY], counts[ZK_TRACE_EV_BLOCK],
+			  counts[ZK_TRACE_EV_DELAY], counts[ZK_TRACE_EV_TICK], counts[ZK_TRACE_EV_SEM_GET],
+			  counts[ZK_TRACE_EV_SEM_RELEASE], counts[ZK_TRACE_EV_QUEUE_WRITE],
+			  counts[ZK_TRACE_EV_QUEUE_READ], counts[ZK_TRACE_EV_MUTEX_LOCK],
+			  counts[ZK_TRACE_EV_MUTEX_UNLOCK]);
+}
+#endif
+
+static void zk_bench_runner_task(void *param)
+{
+	(void) param;
+
+	zk_cpu_cycle_counter_init();
+#if ZK_USING_CRITICAL_STATS
+	zk_critical_reset_stats();
+#endif
+
+	zk_printf("\r\n=== zkRTOS bench: %u samples, unit " ZK_BENCH_UNIT " ===\r\n",
+			  (zk_uint32) ZK_BENCH_ITERATIONS);
+	zk_bench_overhead_run();
+	zk_bench_switch_run();
+	zk_bench_queue_run();
+	zk_bench_mutex_run();
+	zk_bench_mem_run();
+	zk_bench_tick_run();
+#if ZK_USING_CRITICAL_STATS
+	zk_bench_critical_report();
+#endif
+#if ZK_USING_TRACE
+	zk_bench_trace_report();
+#endif
+	zk_printf("=== bench done ===\r\n");
+
+	for (;;)
+	{
+		task_delay(ZK_TICK_RATE_HZ);
+	}
+}
+
+void zk_bench_init(void)
+{
+	sem_create(&g_bench_peer_sem, 0);
+	zk_bench_task_create(zk_bench_peer_task, "b_peer", ZK_BENCH_PEER_PRIO,
+						 ZK_BENCH_PEER_STACK_SIZE, ZK_NULL);
+	zk_bench_task_create(zk_bench_runner_task, "b_runner", ZK_BENCH_RUNNER_PRIO,
+						 ZK_BENCH_RUNNER_STACK_SIZE, ZK_NULL);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file    zk_bench.h
+ * @brief   ZK-RTOS kernel micro-benchmark suite
+ * @note    Every case samples the port cycle counter (DWT CYCCNT on Cortex-M, CLOCK_MONOTONIC
+ *          nanoseconds on the POSIX simulator) and reports min/avg/max through zk_printf.
+ *          Build it with mdk/zkRTOS_bench.uvprojx, gcc/ (-DZK_BUILD_BENCH=ON) or sim/.
+ */
+
+#ifndef ZK_BENCH_H
+#define ZK_BENCH_H
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if !ZK_USING_SEMAPHORE || !ZK_USING_MUTEX || !ZK_USING_QUEUE
+#error "the bench needs ZK_USING_SEMAPHORE, ZK_USING_MUTEX and ZK_USING_QUEUE"
+#endif
+
+/* ==================== Bench configuration ==================== */
+/* Samples taken per measurement */
+#ifndef ZK_BENCH_ITERATIONS
+#define ZK_BENCH_ITERATIONS 64
+#endif
+
+/* Runner task: lower priority than the peer so every wakeup of the peer preempts it */
+#define ZK_BENCH_RUNNER_PRIO 10
+#define ZK_BENCH_PEER_PRIO 5
+#define ZK_BENCH_RUNNER_STACK_SIZE 1024
+#define ZK_BENCH_PEER_STACK_SIZE 512
+
+#define ZK_BENCH_ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#if ZK_CPU_ARCH == ZK_ARCH_POSIX
+#define ZK_BENCH_UNIT "ns"
+#else
+#define ZK_BENCH_UNIT "cycles"
+#endif
+
+/* ==================== Sample statistics ==================== */
+typedef struct
+{
+	const char *name;
+	zk_uint32 count;
+	zk_uint32 min;
+	zk_uint32 max;
+	zk_uint64 sum;
+} zk_bench_stat_t;
+
+typedef void (*zk_bench_peer_fn_t)(void);
+
+static inline zk_uint32 zk_bench_now(void)
+{
+	return zk_cpu_cycle_count();
+}
+
+void zk_bench_stat_reset(zk_bench_stat_t *stat, const char *name);
+void zk_bench_stat_add(zk_bench_stat_t *stat, zk_uint32 sample);
+void zk_bench_stat_print(const zk_bench_stat_t *stat);
+
+/**
+ * @brief Create a benchmark task from the heap
+ * @return Task handle, 0 on failure
+ */
+zk_uint32 zk_bench_task_create(task_function_t entry, const char *name, zk_uint8 priority,
+							   zk_uint32 stack_size, void *param);
+
+/**
+ * @brief Run fn once in the peer task (ZK_BENCH_PEER_PRIO)
+ * @note  Returns to the caller as soon as the peer blocks; the peer parks again when fn
+ *        returns
+ */
+void zk_bench_peer_start(zk_bench_peer_fn_t fn);
+
+/* ==================== Bench cases ==================== */
+void zk_bench_switch_run(void);
+void zk_bench_queue_run(void);
+void zk_bench_mem_run(void);
+void zk_bench_mutex_run(void);
+void zk_bench_tick_run(void);
+
+/**
+ * @brief Create the runner task that executes all cases in order
+ * @note  Call after zk_kernel_init() and before zk_start_scheduler()
+ */
+void zk_bench_init(void);
+
+#endif /* ZK_BENCH_H */
@@ -0,0 +1,81 @@
+/**
+ * @file    zk_bench_mem.c
+ * @brief   mem_alloc/mem_free latency under increasing heap fragmentation
+ * @note    Fragmentation is built by allocating pairs of small blocks and freeing one of each
+ *          pair, leaving holes too small for the measured request in front of the free tail.
+ */
+
+#include "zk_bench.h"
+
+#define ZK_BENCH_MEM_HOLE_SIZE 16
+#define ZK_BENCH_MEM_REQUEST_SIZE 64
+#define ZK_BENCH_MEM_MAX_HOLES 32
+
+static const zk_uint32 g_mem_hole_counts[] = {0, 8, 16, 32};
+static const char *const g_mem_alloc_names[] = {
+	"mem.alloc_0_holes",
+	"mem.alloc_8_holes",
+	"mem.alloc_16_holes",
+	"mem.alloc_32_holes",
+};
+static const char *const g_mem_free_names[] = {
+	"mem.free_0_holes",
+	"mem.free_8_holes",
+	"mem.free_16_holes",
+	"mem.free_32_holes",
+};
+
+static void *g_mem_blocks[ZK_BENCH_MEM_MAX_HOLES * 2];
+
+void zk_bench_mem_run(void)
+{
+	zk_bench_stat_t alloc_stat;
+	zk_bench_stat_t free_stat;
+	zk_uint32 level = 0;
+	zk_uint32 holes = 0;
+	zk_uint32 start = 0;
+	zk_uint32 allocated = 0;
+	zk_uint32 i = 0;
+	void *block = ZK_NULL;
+
+	for (level = 0; level < ZK_BENCH_ARRAY_SIZE(g_mem_hole_counts); level++)
+	{
+		holes = g_mem_hole_counts[level];
+		for (i = 0; i < holes * 2; i++)
+		{
+			g_mem_blocks[i] = mem_alloc(ZK_BENCH_MEM_HOLE_SIZE);
+		}
+		for (i = 0; i < holes * 2; i += 2)
+		{
+			mem_free(g_mem_blocks[i]);
+			g_mem_blocks[i] = ZK_NULL;
+		}
+
+		zk_bench_stat_reset(&alloc_stat, g_mem_alloc_names[level]);
+		zk_bench_stat_reset(&free_stat, g_mem_free_names[level]);
+		for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+		{
+			start = zk_bench_now();
+			block = mem_alloc(ZK_BENCH_MEM_REQUEST_SIZE);
+			allocated = zk_bench_now();
+			mem_free(block);
+			zk_bench_stat_add(&alloc_stat, allocated - start);
+			zk_bench_stat_add(&free_stat, zk_bench_now() - allocated);
+			if (block == ZK_NULL)
+			{
+				zk_printf("bench: mem_alloc failed\r\n");
+				break;
+			}
+		}
+
+		zk_bench_stat_print(&alloc_stat);
+		zk_bench_stat_print(&free_stat);
+		zk_printf("mem.fragmentation_percent_%u_holes: %u\r\n", holes, mem_get_fragmentation());
+
+		for (i = 1; i < holes * 2; i += 2)
+		{
+			mem_free(g_mem_blocks[i]);
+			g_mem_blocks[i] = ZK_NULL;
+		}
+	}
+}
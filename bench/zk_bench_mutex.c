@@ -0,0 +1,80 @@
+/**
+ * @file    zk_bench_mutex.c
+ * @brief   mutex_lock/mutex_unlock, uncontended and contended (priority inheritance)
+ */
+
+#include "zk_bench.h"
+
+static zk_uint32 g_mutex_handle;
+static zk_uint32 g_mutex_go_sem;
+static volatile zk_uint32 g_mutex_stamp;
+
+static zk_bench_stat_t g_lock_block_stat;
+static zk_bench_stat_t g_unlock_handoff_stat;
+
+/**
+ * @brief Peer side: blocks on the mutex the runner holds, takes it over on unlock
+ */
+static void zk_bench_mutex_peer(void)
+{
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		sem_get(g_mutex_go_sem);
+		g_mutex_stamp = zk_bench_now();
+		mutex_lock(g_mutex_handle);
+		zk_bench_stat_add(&g_unlock_handoff_stat, zk_bench_now() - g_mutex_stamp);
+		mutex_unlock(g_mutex_handle);
+	}
+}
+
+void zk_bench_mutex_run(void)
+{
+	zk_bench_stat_t lock_stat;
+	zk_bench_stat_t unlock_stat;
+	zk_uint32 start = 0;
+	zk_uint32 locked = 0;
+	zk_uint32 i = 0;
+
+	zk_bench_stat_reset(&lock_stat, "mutex.lock_uncontended");
+	zk_bench_stat_reset(&unlock_stat, "mutex.unlock_uncontended");
+	zk_bench_stat_reset(&g_lock_block_stat, "mutex.lock_block_to_owner");
+	zk_bench_stat_reset(&g_unlock_handoff_stat, "mutex.unlock_handoff_to_waiter");
+
+	if (mutex_create(&g_mutex_handle) != ZK_SUCCESS)
+	{
+		zk_printf("bench: mutex_create failed\r\n");
+		return;
+	}
+	sem_create(&g_mutex_go_sem, 0);
+
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		start = zk_bench_now();
+		mutex_lock(g_mutex_handle);
+		locked = zk_bench_now();
+		mutex_unlock(g_mutex_handle);
+		zk_bench_stat_add(&lock_stat, locked - start);
+		zk_bench_stat_add(&unlock_stat, zk_bench_now() - locked);
+	}
+
+	/* runner owns the mutex, the higher-priority peer blocks on it and boosts the runner */
+	zk_bench_peer_start(zk_bench_mutex_peer);
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		mutex_lock(g_mutex_handle);
+		sem_release(g_mutex_go_sem);
+		zk_bench_stat_add(&g_lock_block_stat, zk_bench_now() - g_mutex_stamp);
+		g_mutex_stamp = zk_bench_now();
+		mutex_unlock(g_mutex_handle);
+	}
+
+	sem_destroy(g_mutex_go_sem);
+	mutex_destroy(g_mutex_handle);
+
+	zk_bench_stat_print(&lock_stat);
+	zk_bench_stat_print(&unlock_stat);
+	zk_bench_stat_print(&g_lock_block_stat);
+	zk_bench_stat_print(&g_unlock_handoff_stat);
+}
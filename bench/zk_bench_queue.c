@@ -0,0 +1,171 @@
+/**
+ * @file    zk_bench_queue.c
+ * @brief   queue_write -> queue_read round-trip at several element sizes (and mbox_*, mpmc_*)
+ */
+
+#include "zk_bench.h"
+
+#define ZK_BENCH_QUEUE_DEPTH 4
+#define ZK_BENCH_QUEUE_MAX_ELEMENT 64
+
+static const zk_uint32 g_queue_sizes[] = {4, 16, 64};
+static const char *const g_queue_wake_names[] = {
+	"queue.write_to_reader_4B",
+	"queue.write_to_reader_16B",
+	"queue.write_to_reader_64B",
+};
+static const char *const g_queue_local_names[] = {
+	"queue.write_read_local_4B",
+	"queue.write_read_local_16B",
+	"queue.write_read_local_64B",
+};
+
+static zk_uint32 g_queue_handle;
+static zk_uint32 g_queue_element_size;
+static volatile zk_uint32 g_queue_stamp;
+static zk_bench_stat_t g_queue_wake_stat;
+#if ZK_USING_MPMC
+static zk_mpmc_t g_mpmc;
+static zk_uint32 g_mpmc_storage[ZK_MPMC_STORAGE_SIZE(4, ZK_BENCH_QUEUE_DEPTH) / sizeof(zk_uint32)];
+#endif
+
+/**
+ * @brief Peer side: blocked in queue_read, woken by the runner's queue_write
+ */
+static void zk_bench_queue_peer(void)
+{
+	zk_uint8 buffer[ZK_BENCH_QUEUE_MAX_ELEMENT];
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		queue_read(g_queue_handle, buffer, g_queue_element_size);
+		zk_bench_stat_add(&g_queue_wake_stat, zk_bench_now() - g_queue_stamp);
+	}
+}
+
+#if ZK_USING_MPMC
+/**
+ * @brief Peer side: blocked in mpmc_read, woken by the runner's mpmc_write
+ */
+static void zk_bench_mpmc_peer(void)
+{
+	zk_uint32 element = 0;
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		mpmc_read(&g_mpmc, &element, ZK_TIMEOUT_INFINITE);
+		zk_bench_stat_add(&g_queue_wake_stat, zk_bench_now() - g_queue_stamp);
+	}
+}
+
+/**
+ * @brief The queue.*_4B cases through the lock-free queue
+ */
+static void zk_bench_mpmc_run(void)
+{
+	zk_bench_stat_t local_stat;
+	zk_uint32 element = 0;
+	zk_uint32 start = 0;
+	zk_uint32 i = 0;
+
+	if (mpmc_init(&g_mpmc, g_mpmc_storage, sizeof(element), ZK_BENCH_QUEUE_DEPTH) !=
+		ZK_SUCCESS)
+	{
+		zk_printf("bench: mpmc_init failed\r\n");
+		return;
+	}
+
+	/* no waiter: two claims and copies, no critical section */
+	zk_bench_stat_reset(&local_stat, "mpmc.write_read_local_4B");
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		start = zk_bench_now();
+		mpmc_write(&g_mpmc, &element, ZK_TIMEOUT_INFINITE);
+		mpmc_read(&g_mpmc, &element, ZK_TIMEOUT_INFINITE);
+		zk_bench_stat_add(&local_stat, zk_bench_now() - start);
+	}
+
+	/* reader blocked on the empty queue: write, wake and switch to the reader */
+	zk_bench_stat_reset(&g_queue_wake_stat, "mpmc.write_to_reader_4B");
+	zk_bench_peer_start(zk_bench_mpmc_peer);
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		g_queue_stamp = zk_bench_now();
+		mpmc_write(&g_mpmc, &element, ZK_TIMEOUT_INFINITE);
+	}
+
+	zk_bench_stat_print(&local_stat);
+	zk_bench_stat_print(&g_queue_wake_stat);
+}
+#endif
+
+void zk_bench_queue_run(void)
+{
+	zk_uint8 buffer[ZK_BENCH_QUEUE_MAX_ELEMENT];
+	zk_bench_stat_t local_stat;
+	zk_uint32 size_index = 0;
+	zk_uint32 start = 0;
+	zk_uint32 i = 0;
+
+	zk_memclear(buffer, sizeof(buffer));
+
+	for (size_index = 0; size_index < ZK_BENCH_ARRAY_SIZE(g_queue_sizes); size_index++)
+	{
+		g_queue_element_size = g_queue_sizes[size_index];
+		if (queue_create(&g_queue_handle, g_queue_element_size, ZK_BENCH_QUEUE_DEPTH) !=
+			ZK_SUCCESS)
+		{
+			zk_printf("bench: queue_create failed\r\n");
+			return;
+		}
+
+		/* no waiter: both copies and the bookkeeping, no switch */
+		zk_bench_stat_reset(&local_stat, g_queue_local_names[size_index]);
+		for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+		{
+			start = zk_bench_now();
+			queue_write(g_queue_handle, buffer, g_queue_element_size);
+			queue_read(g_queue_handle, buffer, g_queue_element_size);
+			zk_bench_stat_add(&local_stat, zk_bench_now() - start);
+		}
+
+		/* waiter blocked on the empty queue: write, wake and switch to the reader */
+		zk_bench_stat_reset(&g_queue_wake_stat, g_queue_wake_names[size_index]);
+		zk_bench_peer_start(zk_bench_queue_peer);
+		for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+		{
+			g_queue_stamp = zk_bench_now();
+			queue_write(g_queue_handle, buffer, g_queue_element_size);
+		}
+
+		queue_destroy(g_queue_handle);
+
+		zk_bench_stat_print(&local_stat);
+		zk_bench_stat_print(&g_queue_wake_stat);
+	}
+
+#if ZK_USING_MAILBOX
+	/* same round trip as queue.write_read_local_4B through the single-word path */
+	if (mbox_create(&g_queue_handle, ZK_BENCH_QUEUE_DEPTH) == ZK_SUCCESS)
+	{
+		void *msg = ZK_NULL;
+
+		zk_bench_stat_reset(&local_stat, "mbox.post_fetch_local");
+		for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+		{
+			start = zk_bench_now();
+			mbox_post(g_queue_handle, buffer, ZK_TIMEOUT_INFINITE);
+			mbox_fetch(g_queue_handle, &msg, ZK_TIMEOUT_INFINITE);
+			zk_bench_stat_add(&local_stat, zk_bench_now() - start);
+		}
+		queue_destroy(g_queue_handle);
+		zk_bench_stat_print(&local_stat);
+	}
+#endif
+
+#if ZK_USING_MPMC
+	zk_bench_mpmc_run();
+#endif
+}
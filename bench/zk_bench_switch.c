@@ -0,0 +1,93 @@
+/**
+ * @file    zk_bench_switch.c
+ * @brief   Task-to-task switch: semaphore ping-pong and task_delay preemption
+ */
+
+#include "zk_bench.h"
+
+static zk_uint32 g_switch_sem;
+static volatile zk_uint32 g_switch_stamp;
+static volatile zk_uint32 g_spin_stamp;
+static volatile zk_uint32 g_delay_stamp;
+static volatile zk_uint32 g_delay_done;
+
+static zk_bench_stat_t g_sem_wake_stat;
+static zk_bench_stat_t g_sem_block_stat;
+static zk_bench_stat_t g_delay_block_stat;
+static zk_bench_stat_t g_tick_wake_stat;
+
+/**
+ * @brief Peer side of the ping-pong: wakes on sem_release, stamps, blocks again
+ */
+static void zk_bench_sem_peer(void)
+{
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		g_switch_stamp = zk_bench_now();
+		sem_get(g_switch_sem);
+		zk_bench_stat_add(&g_sem_wake_stat, zk_bench_now() - g_switch_stamp);
+	}
+	g_switch_stamp = zk_bench_now();
+}
+
+/**
+ * @brief Peer side of the delay case: blocks in task_delay(1), woken by the tick
+ */
+static void zk_bench_delay_peer(void)
+{
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		g_delay_stamp = zk_bench_now();
+		task_delay(1);
+		zk_bench_stat_add(&g_tick_wake_stat, zk_bench_now() - g_spin_stamp);
+	}
+	g_delay_done = 1;
+}
+
+void zk_bench_switch_run(void)
+{
+	zk_uint32 i = 0;
+
+	zk_bench_stat_reset(&g_sem_wake_stat, "switch.sem_release_to_waiter");
+	zk_bench_stat_reset(&g_sem_block_stat, "switch.sem_get_block_to_releaser");
+	zk_bench_stat_reset(&g_delay_block_stat, "switch.task_delay_to_lower");
+	zk_bench_stat_reset(&g_tick_wake_stat, "switch.tick_preempt_to_delayed");
+
+	sem_create(&g_switch_sem, 0);
+
+	/* the peer runs until its first sem_get blocks */
+	zk_bench_peer_start(zk_bench_sem_peer);
+	for (i = 0; i < ZK_BENCH_ITERATIONS; i++)
+	{
+		zk_bench_stat_add(&g_sem_block_stat, zk_bench_now() - g_switch_stamp);
+		g_switch_stamp = zk_bench_now();
+		sem_release(g_switch_sem);
+	}
+
+	/* spin as the lower-priority task until the peer is done: our last spin stamp is the
+	 * last instruction before the tick that wakes the peer preempts us */
+	g_delay_stamp = 0;
+	g_delay_done = 0;
+	g_spin_stamp = zk_bench_now();
+	zk_bench_peer_start(zk_bench_delay_peer);
+	while (!g_delay_done)
+	{
+		if (g_delay_stamp != 0)
+		{
+			zk_bench_stat_add(&g_delay_block_stat, zk_bench_now() - g_delay_stamp);
+			g_delay_stamp = 0;
+		}
+		g_spin_stamp = zk_bench_now();
+	}
+
+	sem_destroy(g_switch_sem);
+
+	zk_bench_stat_print(&g_sem_wake_stat);
+	zk_bench_stat_print(&g_sem_block_stat);
+	zk_bench_stat_print(&g_delay_block_stat);
+	zk_bench_stat_print(&g_tick_wake_stat);
+}
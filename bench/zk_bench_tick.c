@@ -0,0 +1,75 @@
+/**
+ * @file    zk_bench_tick.c
+ * @brief   SysTick handler cost versus the number of delayed tasks
+ * @note    The runner spins reading the cycle counter; any gap longer than
+ *          ZK_BENCH_TICK_GAP_MIN is the tick interrupt (entry, scheduler_increment_tick, exit)
+ *          since no other task can become ready meanwhile.
+ */
+
+#include "zk_bench.h"
+
+#if ZK_CPU_ARCH == ZK_ARCH_POSIX
+#define ZK_BENCH_TICK_GAP_MIN 1000
+#else
+#define ZK_BENCH_TICK_GAP_MIN 40
+#endif
+
+/* Delayed tasks wake far in the future, one tick apart */
+#define ZK_BENCH_TICK_PARK_TICKS 60000
+#define ZK_BENCH_TICK_STACK_SIZE 256
+#define ZK_BENCH_TICK_MAX_TASKS 8
+
+static const zk_uint32 g_tick_task_counts[] = {0, 2, 4, 8};
+static const char *const g_tick_names[] = {
+	"tick.handler_0_delayed",
+	"tick.handler_2_delayed",
+	"tick.handler_4_delayed",
+	"tick.handler_8_delayed",
+};
+
+static void zk_bench_tick_parked_task(void *param)
+{
+	zk_uint32 index = (zk_uint32) (unsigned long) param;
+
+	for (;;)
+	{
+		task_delay(ZK_BENCH_TICK_PARK_TICKS + index);
+	}
+}
+
+void zk_bench_tick_run(void)
+{
+	zk_bench_stat_t stat;
+	zk_uint32 created = 0;
+	zk_uint32 level = 0;
+	zk_uint32 last = 0;
+	zk_uint32 now = 0;
+
+	for (level = 0; level < ZK_BENCH_ARRAY_SIZE(g_tick_task_counts); level++)
+	{
+		/* higher priority than the runner: each new task runs at once and parks itself */
+		while (created < g_tick_task_counts[level])
+		{
+			if (zk_bench_task_create(zk_bench_tick_parked_task, "b_park", ZK_BENCH_PEER_PRIO,
+									 ZK_BENCH_TICK_STACK_SIZE,
+									 (void *) (unsigned long) created) == 0)
+			{
+				return;
+			}
+			created++;
+		}
+
+		zk_bench_stat_reset(&stat, g_tick_names[level]);
+		last = zk_bench_now();
+		while (stat.count < ZK_BENCH_ITERATIONS)
+		{
+			now = zk_bench_now();
+			if (now - last > ZK_BENCH_TICK_GAP_MIN)
+			{
+				zk_bench_stat_add(&stat, now - last);
+			}
+			last = now;
+		}
+		zk_bench_stat_print(&stat);
+	}
+}
@@ -0,0 +1,28 @@
+/**
+ * @file    board.c
+ * @brief   POSIX host simulator board layer
+ * @note    Console output goes to stdout with write(2), which is safe to call from a task
+ *          that the tick signal may preempt at any point
+ */
+
+#include <unistd.h>
+
+#include "zk_rtos.h"
+
+void board_init(void)
+{
+}
+
+/**
+ * @brief Blocking delay (sleeps the host thread, does NOT use scheduler)
+ * @param ms Delay time in milliseconds
+ */
+void zk_delay_ms(zk_uint32 ms)
+{
+	usleep((useconds_t) ms * 1000U);
+}
+
+void zk_putc(char c)
+{
+	(void) write(STDOUT_FILENO, &c, 1);
+}
@@ -0,0 +1,92 @@
+/**
+ * @file    main.c
+ * @brief   POSIX simulator demo: semaphore ping-pong plus a preempted busy task
+ */
+
+#include "zk_rtos.h"
+
+#if !ZK_USING_SEMAPHORE
+#error "the simulator demo needs ZK_USING_SEMAPHORE"
+#endif
+
+extern void board_init(void);
+
+#define DEMO_ROUNDS 5
+
+static zk_uint32 g_ping_sem;
+static zk_uint32 g_pong_sem;
+
+static void demo_create_task(task_function_t entry, const char *name, zk_uint8 priority)
+{
+	task_init_parameter_t parameter;
+	zk_uint32 handle = 0;
+	zk_uint32 i = 0;
+
+	zk_memclear(&parameter, sizeof(parameter));
+	for (i = 0; name[i] != '\0' && i < CONFIG_TASK_NAME_LEN - 1; i++)
+	{
+		parameter.name[i] = (zk_uint8) name[i];
+	}
+	parameter.task_entry = entry;
+	parameter.priority = priority;
+	parameter.stack_size = 512;
+	task_create(&parameter, &handle);
+}
+
+static void ping_task(void *param)
+{
+	zk_uint32 round = 0;
+
+	(void) param;
+	for (round = 0; round < DEMO_ROUNDS; round++)
+	{
+		zk_printf("[%u] ping %u\r\n", get_current_time(), round);
+		sem_release(g_ping_sem);
+		sem_get(g_pong_sem);
+		task_delay_ms(100);
+	}
+	zk_printf("[%u] done\r\n", get_current_time());
+	for (;;)
+	{
+		task_delay_ms(1000);
+	}
+}
+
+static void pong_task(void *param)
+{
+	(void) param;
+	for (;;)
+	{
+		sem_get(g_ping_sem);
+		zk_printf("[%u] pong\r\n", get_current_time());
+		sem_release(g_pong_sem);
+	}
+}
+
+/* never blocks: only runs because the tick preempts it and the others block */
+static void busy_task(void *param)
+{
+	volatile zk_uint32 spins = 0;
+
+	(void) param;
+	for (;;)
+	{
+		spins++;
+	}
+}
+
+int main(void)
+{
+	board_init();
+	zk_kernel_init();
+
+	sem_create(&g_ping_sem, 0);
+	sem_create(&g_pong_sem, 0);
+	demo_create_task(ping_task, "ping", 2);
+	demo_create_task(pong_task, "pong", 3);
+	demo_create_task(busy_task, "busy", 5);
+
+	zk_start_scheduler();
+
+	return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file    board.c
+ * @brief   STM32F103 board initialization
+ * @note    Clock tree, vector table and debug output setup; called from main() before
+ *          zk_kernel_init()
+ */
+
+#include "zk_rtos.h"
+#include "stm32f10x_it.h"
+#include "serial.h"
+
+#if (ZK_CONSOLE_BACKEND == ZK_CONSOLE_ITM)
+extern void SWO_Init(void);
+#endif
+
+/**
+ * @brief Run SYSCLK at 72 MHz from the PLL on the 8 MHz HSE
+ * @note  Also called by the power management driver after STOP, which leaves the chip on HSI
+ */
+void board_clock_config(void)
+{
+	/* Enable HSE (high speed external clock). */
+	RCC_HSEConfig(RCC_HSE_ON);
+	/* Wait till HSE is ready. */
+	while (RCC_GetFlagStatus(RCC_FLAG_HSERDY) == RESET)
+	{
+	}
+	/* 2 wait states required on the flash. */
+	*((unsigned long *) 0x40022000) = 0x02;
+
+	/* HCLK = SYSCLK */
+	RCC_HCLKConfig(RCC_SYSCLK_Div1);
+	/* PCLK2 = HCLK */
+	RCC_PCLK2Config(RCC_HCLK_Div1);
+	/* PCLK1 = HCLK/2 */
+	RCC_PCLK1Config(RCC_HCLK_Div2);
+	/* PLLCLK = 8MHz * 9 = 72 MHz. */
+	RCC_PLLConfig(RCC_PLLSource_HSE_Div1, RCC_PLLMul_9);
+	/* Enable PLL. */
+	RCC_PLLCmd(ENABLE);
+	/* Wait till PLL is ready. */
+	while (RCC_GetFlagStatus(RCC_FLAG_PLLRDY) == RESET)
+	{
+	}
+	/* Select PLL as system clock source. */
+	RCC_SYSCLKConfig(RCC_SYSCLKSource_PLLCLK);
+	/* Wait till PLL is used as system clock source. */
+	while (RCC_GetSYSCLKSource() != 0x08)
+	{
+	}
+}
+
+/**
+ * @brief setup hardware clock and peripherals
+ */
+static void setup_hardware(void)
+{
+	RCC_DeInit();
+	board_clock_config();
+	/* Enable GPIOA, GPIOB, GPIOC, GPIOD, GPIOE and AFIO clocks */
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOB | RCC_APB2Periph_GPIOC |
+							   RCC_APB2Periph_GPIOD | RCC_APB2Periph_GPIOE | RCC_APB2Periph_AFIO,
+						   ENABLE);
+	/* SPI2 Periph clock enable */
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_SPI2, ENABLE);
+	/* Set the Vector Table base address at 0x08000000 */
+	NVIC_SetVectorTable(NVIC_VectTab_FLASH, 0x0);
+	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
+	/* Configure HCLK clock as SysTick clock source. */
+	SysTick_CLKSourceConfig(SysTick_CLKSource_HCLK);
+}
+
+void board_init(void)
+{
+	setup_hardware();
+#if (ZK_CONSOLE_BACKEND == ZK_CONSOLE_ITM)
+	SWO_Init();
+#else
+	UART_Init(ZK_UART_BAUD_RATE);
+#endif
+}
+
+/**
+ * @brief Simple blocking delay function (busy-wait)
+ * @param ms Delay time in milliseconds
+ * @note  This is a simple busy-wait delay, does NOT use scheduler
+ *        Use this in initialization code or when scheduler is not running
+ *        For tasks, use task_delay() instead
+ */
+void zk_delay_ms(zk_uint32 ms)
+{
+	/* At 72MHz, approximately 72000 cycles per millisecond */
+	/* Divided by loop overhead (~3 cycles per iteration) = ~24000 iterations/ms */
+	volatile zk_uint32 count = ms * 24000;
+	while (count--)
+	{
+		/* Busy wait */
+	}
+}
@@ -1,4 +1,9 @@
 #include "zk_rtos.h"
+#include "serial.h"
+#include "hrtimer.h"
+#include "dma_copy.h"
+#include "pm.h"
+#include "watchdog.h"
 
 extern void task_test_main(void);
 extern void board_init(void);
@@ -7,6 +12,21 @@ int main(void)
 {
 	board_init();
 	zk_kernel_init();
+#if (ZK_CONSOLE_BACKEND == ZK_CONSOLE_UART) && ZK_UART_ASYNC
+	UART_StartAsync();
+#endif
+#if ZK_USING_HRTIMER
+	HRTimer_Init();
+#endif
+#if ZK_USING_DMA_COPY
+	DMACopy_Init();
+#endif
+#if ZK_USING_PM
+	PM_Init();
+#endif
+#if ZK_USING_IWDG
+	Watchdog_Init();
+#endif
 
 	zk_start_scheduler();
 
@@ -38,14 +38,14 @@
 //#define _CAN
 
 /************************************* DMA ************************************/
-//#define _DMA
+#define _DMA
 //#define _DMA_Channel1
 //#define _DMA_Channel2
 //#define _DMA_Channel3
-//#define _DMA_Channel4
+#define _DMA_Channel4
 //#define _DMA_Channel5
 //#define _DMA_Channel6
-//#define _DMA_Channel7
+#define _DMA_Channel7
 
 /************************************* EXTI ***********************************/
 #define _EXTI
@@ -65,23 +65,23 @@
 //#define _I2C2
 
 /************************************* IWDG ***********************************/
-//#define _IWDG
+#define _IWDG
 
 /************************************* NVIC ***********************************/
 #define _NVIC
 #define _SCB
 
 /************************************* BKP ************************************/
-//#define _BKP
+#define _BKP
 
 /************************************* PWR ************************************/
-//#define _PWR
+#define _PWR
 
 /************************************* RCC ************************************/
 #define _RCC
 
 /************************************* RTC ************************************/
-//#define _RTC
+#define _RTC
 
 /************************************* SPI ************************************/
 #define _SPI
@@ -92,7 +92,7 @@
 #define _SysTick
 
 /************************************* TIM ************************************/
-//#define _TIM
+#define _TIM
 #define _TIM2
 #define _TIM3
 //#define _TIM4
@@ -0,0 +1,245 @@
+/**
+ * @file    dma_copy.c
+ * @brief   Memory-to-memory DMA copies for large buffers (ZK_USING_DMA_COPY)
+ * @note    DMA1 channel 7 runs in M2M mode. The calling task sleeps on a semaphore until the
+ *          transfer-complete interrupt, so neither the CPU nor the interrupts are held while
+ *          the bytes move. One transfer owns the channel at a time, tasks queue on a mutex.
+ *          Copies below ZK_DMA_COPY_MIN, and callers that cannot sleep, use zk_memcpy().
+ */
+
+#include "stm32f10x_lib.h"
+#include "zk_rtos.h"
+#include "zk_internal.h"
+#include "dma_copy.h"
+
+#if ZK_USING_DMA_COPY
+
+#if !ZK_USING_MUTEX || !ZK_USING_SEMAPHORE || !ZK_USING_QUEUE
+#error "ZK_USING_DMA_COPY needs ZK_USING_MUTEX, ZK_USING_SEMAPHORE and ZK_USING_QUEUE"
+#endif
+
+/* Numerically above ZK_MAX_SYSCALL_INTERRUPT_PRIORITY: masked by the kernel, may call it */
+#define DMA_COPY_IRQ_PRIORITY 	13
+#if ZK_NVIC_PRIORITY(DMA_COPY_IRQ_PRIORITY) < ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
+#error "DMA_COPY_IRQ_PRIORITY is above the kernel threshold but calls the kernel"
+#endif
+#define DMA_COPY_CHANNEL 		DMA_Channel7 	/* no peripheral request line used on this BSP */
+#define DMA_COPY_FLAG_GL 		DMA_FLAG_GL7
+#define DMA_COPY_MAX_COUNT 		0xFFFFUL 		/* CNDTR is 16 bits wide */
+
+static zk_uint32 g_dma_copy_lock; /* mutex, one transfer on the channel at a time */
+static zk_uint32 g_dma_copy_done; /* released by the transfer-complete interrupt */
+static zk_uint8 g_dma_copy_ready = 0;
+
+/**
+ * @brief Whether the caller may sleep until the transfer completes
+ */
+static zk_bool dma_copy_can_block(void)
+{
+	return (g_current_tcb != ZK_NULL && !zk_cpu_is_in_interrupt() && zk_critical_nesting == 0 &&
+			!is_scheduler_suspending());
+}
+
+/**
+ * @brief Start one transfer of count units of width bytes
+ * @note  The source sits on the "peripheral" side of the channel, both sides increment
+ */
+static void dma_copy_start(zk_uint8 *dest, const zk_uint8 *src, zk_uint32 count,
+						   zk_uint32 width)
+{
+	DMA_InitTypeDef DMA_InitStructure;
+
+	DMA_Cmd(DMA_COPY_CHANNEL, DISABLE);
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (u32) src;
+	DMA_InitStructure.DMA_MemoryBaseAddr = (u32) dest;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+	DMA_InitStructure.DMA_BufferSize = count;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Enable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	if (width == 4)
+	{
+		DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+		DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+	}
+	else if (width == 2)
+	{
+		DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+		DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	}
+	else
+	{
+		DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+		DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	}
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+	DMA_InitStructure.DMA_M2M = DMA_M2M_Enable;
+	DMA_Init(DMA_COPY_CHANNEL, &DMA_InitStructure);
+	DMA_ITConfig(DMA_COPY_CHANNEL, DMA_IT_TC, ENABLE);
+	DMA_Cmd(DMA_COPY_CHANNEL, ENABLE);
+}
+
+/**
+ * @brief Copy through the channel, or by the CPU when the DMA does not pay off
+ * @note  The widest unit that divides both addresses and the size is used, a 1 KB frame of
+ *        aligned words is 256 bus transfers
+ */
+static void dma_copy_run(void *dest, const void *src, zk_uint32 size)
+{
+	zk_uint8 *dest_addr = (zk_uint8 *) dest;
+	const zk_uint8 *src_addr = (const zk_uint8 *) src;
+	zk_uint32 align = (zk_uint32) dest_addr | (zk_uint32) src_addr | size;
+	zk_uint32 width = ((align & 3) == 0) ? 4 : (((align & 1) == 0) ? 2 : 1);
+	zk_uint32 count = 0;
+
+	if (size < ZK_DMA_COPY_MIN || g_dma_copy_ready == 0 || !dma_copy_can_block() ||
+		mutex_lock(g_dma_copy_lock) != ZK_SUCCESS)
+	{
+		zk_memcpy(dest, src, size);
+		return;
+	}
+
+#if ZK_USING_PM
+	/* the DMA halts in STOP, the idle task may only WFI until the copy is done */
+	pm_constraint_get(ZK_PM_MODE_STOP);
+#endif
+	while (size > 0)
+	{
+		count = size / width;
+		if (count > DMA_COPY_MAX_COUNT)
+		{
+			count = DMA_COPY_MAX_COUNT;
+		}
+		dma_copy_start(dest_addr, src_addr, count, width);
+		sem_get(g_dma_copy_done);
+		dest_addr += count * width;
+		src_addr += count * width;
+		size -= count * width;
+	}
+#if ZK_USING_PM
+	pm_constraint_put(ZK_PM_MODE_STOP);
+#endif
+
+	mutex_unlock(g_dma_copy_lock);
+}
+
+void DMAChannel7_IRQHandler(void)
+{
+	zk_bool woken = ZK_FALSE;
+
+	DMA_ClearFlag(DMA_COPY_FLAG_GL);
+	sem_release_from_isr(g_dma_copy_done, &woken);
+	zk_yield_from_isr(woken);
+}
+
+/**
+ * @brief Enable the DMA clock and create the channel lock and completion semaphore
+ * @note  Call from main() after zk_kernel_init(), until then every copy uses the CPU
+ */
+void DMACopy_Init(void)
+{
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	if (mutex_create(&g_dma_copy_lock) != ZK_SUCCESS ||
+		sem_create(&g_dma_copy_done, 0) != ZK_SUCCESS)
+	{
+		return;
+	}
+
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA, ENABLE);
+	DMA_DeInit(DMA_COPY_CHANNEL);
+
+	NVIC_InitStructure.NVIC_IRQChannel = DMAChannel7_IRQChannel;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = DMA_COPY_IRQ_PRIORITY;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	g_dma_copy_ready = 1;
+}
+
+/**
+ * @brief Copy size bytes, sleeping while the DMA moves them
+ * @param dest destination, must not overlap src
+ * @param src source
+ * @param size bytes to copy
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note  From an ISR, a critical section or before the scheduler runs the CPU copies instead
+ */
+zk_error_code_t dma_copy(void *dest, const void *src, zk_uint32 size)
+{
+	ZK_CHECK_PARAM_NOT_NULL(dest);
+	ZK_CHECK_PARAM_NOT_NULL(src);
+
+	dma_copy_run(dest, src, size);
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Write one element, the DMA fills the reserved slot
+ * @param queue_handle queue handle
+ * @param buffer source, size bytes (at most the element size)
+ * @param size size
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE to wait for a free slot
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_QUEUE_SIZE_MISMATCH if size exceeds the
+ *         element size, otherwise the error of queue_reserve()
+ * @note  The slot is published once the transfer is complete. Meanwhile other writers wait
+ *        as if the queue were full, readers still take the elements before it.
+ */
+zk_error_code_t queue_write_dma(zk_uint32 queue_handle, const void *buffer, zk_uint32 size,
+								zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	void *slot = ZK_NULL;
+
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+
+	/* the transfer must not run past the slot */
+	ret = queue_check_size(queue_handle, size);
+	if (ret != ZK_SUCCESS)
+	{
+		return ret;
+	}
+	ret = queue_reserve(queue_handle, &slot, timeout);
+	if (ret != ZK_SUCCESS)
+	{
+		return ret;
+	}
+	dma_copy_run(slot, buffer, size);
+	return queue_commit(queue_handle);
+}
+
+/**
+ * @brief Read one element, the DMA drains the oldest slot in place
+ * @param queue_handle queue handle
+ * @param buffer destination, size bytes (at most the element size)
+ * @param size size
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE to wait for an element
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_QUEUE_SIZE_MISMATCH if size exceeds the
+ *         element size, otherwise the error of queue_peek()
+ * @note  The slot goes back to the writers once the transfer is complete
+ */
+zk_error_code_t queue_read_dma(zk_uint32 queue_handle, void *buffer, zk_uint32 size,
+							   zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	void *slot = ZK_NULL;
+
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+
+	/* the transfer must not run past the slot */
+	ret = queue_check_size(queue_handle, size);
+	if (ret != ZK_SUCCESS)
+	{
+		return ret;
+	}
+	ret = queue_peek(queue_handle, &slot, timeout);
+	if (ret != ZK_SUCCESS)
+	{
+		return ret;
+	}
+	dma_copy_run(buffer, slot, size);
+	return queue_release(queue_handle);
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef __DMA_COPY_H
+#define __DMA_COPY_H
+
+#include "zk_rtos.h"
+
+#if ZK_USING_DMA_COPY
+extern void DMACopy_Init(void);
+extern zk_error_code_t dma_copy(void *dest, const void *src, zk_uint32 size);
+/* Zero-copy queue slot filled / drained by the DMA, the caller sleeps during the transfer */
+extern zk_error_code_t queue_write_dma(zk_uint32 queue_handle, const void *buffer, zk_uint32 size,
+									   zk_uint32 timeout);
+extern zk_error_code_t queue_read_dma(zk_uint32 queue_handle, void *buffer, zk_uint32 size,
+									  zk_uint32 timeout);
+#endif
+
+#endif
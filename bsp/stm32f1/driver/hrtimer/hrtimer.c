@@ -0,0 +1,427 @@
+/**
+ * @file    hrtimer.c
+ * @brief   High-resolution one-shot timers on TIM2 (ZK_USING_HRTIMER)
+ * @note    TIM2 free-runs at 1 MHz over its full 16-bit range; the update interrupt extends
+ *          the count to 32 bits (wraps after ~71 minutes). Pending timers share compare
+ *          channel 1, which is always loaded with the nearest deadline once it is less than
+ *          one counter period away. Callbacks and task_delay_us() wakeups run in the TIM2
+ *          interrupt, so their latency is the interrupt entry plus the longest kernel
+ *          critical section, independent of the SysTick period.
+ */
+
+#include "stm32f10x_lib.h"
+#include "zk_rtos.h"
+#include "zk_internal.h"
+#include "hrtimer.h"
+
+#if ZK_USING_HRTIMER
+
+#if !ZK_USING_SEMAPHORE
+#error "ZK_USING_HRTIMER needs ZK_USING_SEMAPHORE"
+#endif
+
+/* Numerically above ZK_MAX_SYSCALL_INTERRUPT_PRIORITY: masked by the kernel, may call it;
+ * the highest such level, ahead of the UART */
+#define HRTIMER_IRQ_PRIORITY 	11
+#if ZK_NVIC_PRIORITY(HRTIMER_IRQ_PRIORITY) < ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
+#error "HRTIMER_IRQ_PRIORITY is above the kernel threshold but calls the kernel"
+#endif
+#define HRTIMER_TIM 			TIM2
+#define HRTIMER_PERIOD 			0x10000UL
+/* a compare closer than this to the counter may already have been passed while loading it */
+#define HRTIMER_MIN_LEAD_US 	2
+#define HRTIMER_MAX_US 			0x7FFFFFFFUL
+
+typedef struct hrtimer
+{
+	zk_uint32 expire;		   /* absolute deadline in microseconds */
+	hrtimer_handler_t handler; /* ZK_NULL: release sem for task_delay_us() */
+	void *param;
+	zk_uint32 sem;	  /* binary semaphore of the slot, created by HRTimer_Init() */
+	zk_uint8 active;
+} hrtimer_t;
+
+static hrtimer_t g_hrtimer_pool[ZK_HRTIMER_MAX_NUM];
+/* upper 16 bits of the microsecond count, only touched with interrupts masked */
+static zk_uint32 g_hrtimer_high = 0;
+static zk_uint8 g_hrtimer_ready = 0;
+#if ZK_USING_PM
+/* TIM2 stops in STOP, the chip stays out of it while a timer is pending */
+static zk_uint8 g_hrtimer_pm_held = 0;
+#endif
+
+/**
+ * @brief 32-bit microsecond time
+ * @note  Call with interrupts masked. A wrap whose update interrupt is still pending is
+ *        accounted here, the counter is re-read so it is known to be past the wrap.
+ */
+static zk_uint32 hrtimer_now_locked(void)
+{
+	zk_uint32 high = g_hrtimer_high;
+	zk_uint32 count = HRTIMER_TIM->CNT;
+
+	if ((HRTIMER_TIM->SR & TIM_FLAG_Update) != 0)
+	{
+		count = HRTIMER_TIM->CNT;
+		high += HRTIMER_PERIOD;
+	}
+	return high | count;
+}
+
+#if ZK_USING_PM
+/**
+ * @brief Hold a STOP constraint exactly while some timer is pending
+ * @note  Call with interrupts masked
+ */
+static void hrtimer_pm_update(void)
+{
+	zk_uint8 pending = 0;
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_HRTIMER_MAX_NUM; i++)
+	{
+		pending |= g_hrtimer_pool[i].active;
+	}
+	if (pending && !g_hrtimer_pm_held)
+	{
+		pm_constraint_get(ZK_PM_MODE_STOP);
+	}
+	else if (!pending && g_hrtimer_pm_held)
+	{
+		pm_constraint_put(ZK_PM_MODE_STOP);
+	}
+	g_hrtimer_pm_held = pending;
+}
+#endif
+
+/**
+ * @brief Load compare channel 1 with the nearest deadline
+ * @note  Call with interrupts masked. Deadlines a counter period or more away are left to
+ *        a later update interrupt, one that is already due raises the compare event by software.
+ */
+static void hrtimer_program(void)
+{
+	zk_uint32 now = hrtimer_now_locked();
+	zk_uint32 nearest = HRTIMER_MAX_US;
+	zk_uint32 distance = 0;
+	zk_uint32 expire = 0;
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_HRTIMER_MAX_NUM; i++)
+	{
+		if (g_hrtimer_pool[i].active == 0)
+		{
+			continue;
+		}
+		distance = zk_time_is_reached(now, g_hrtimer_pool[i].expire)
+					   ? 0
+					   : g_hrtimer_pool[i].expire - now;
+		if (distance < nearest)
+		{
+			nearest = distance;
+			expire = g_hrtimer_pool[i].expire;
+		}
+	}
+
+#if ZK_USING_PM
+	hrtimer_pm_update();
+#endif
+
+	if (nearest >= HRTIMER_PERIOD)
+	{
+		TIM_ITConfig(HRTIMER_TIM, TIM_IT_CC1, DISABLE);
+		return;
+	}
+
+	TIM_SetCompare1(HRTIMER_TIM, (u16) expire);
+	TIM_ClearITPendingBit(HRTIMER_TIM, TIM_IT_CC1);
+	TIM_ITConfig(HRTIMER_TIM, TIM_IT_CC1, ENABLE);
+	if ((zk_int32) (expire - hrtimer_now_locked()) < HRTIMER_MIN_LEAD_US)
+	{
+		TIM_GenerateEvent(HRTIMER_TIM, TIM_EventSource_CC1);
+	}
+}
+
+/**
+ * @brief Queue a slot, handler ZK_NULL means "wake the task in task_delay_us()"
+ */
+static zk_error_code_t hrtimer_insert(zk_uint32 us, hrtimer_handler_t handler, void *param,
+									  zk_uint32 *handle)
+{
+	zk_error_code_t ret = ZK_ERR_RESOURCE_UNAVAILABLE;
+	zk_uint32 i = 0;
+
+	if (g_hrtimer_ready == 0)
+	{
+		return ZK_ERR_STATE;
+	}
+	if (us == 0 || us > HRTIMER_MAX_US)
+	{
+		return ZK_ERR_OUT_OF_RANGE;
+	}
+
+	ZK_ENTER_CRITICAL();
+	for (i = 0; i < ZK_HRTIMER_MAX_NUM; i++)
+	{
+		if (g_hrtimer_pool[i].active == 0)
+		{
+			break;
+		}
+	}
+	if (i >= ZK_HRTIMER_MAX_NUM)
+	{
+		goto hrtimer_insert_exit;
+	}
+
+	g_hrtimer_pool[i].expire = hrtimer_now_locked() + us;
+	g_hrtimer_pool[i].handler = handler;
+	g_hrtimer_pool[i].param = param;
+	g_hrtimer_pool[i].active = 1;
+	hrtimer_program();
+	if (handle != ZK_NULL)
+	{
+		*handle = i;
+	}
+	ret = ZK_SUCCESS;
+
+hrtimer_insert_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Take the due timer with the earliest deadline off the pool
+ * @return Slot, ZK_NULL when nothing is due
+ * @note  Call with interrupts masked
+ */
+static hrtimer_t *hrtimer_take_expired(void)
+{
+	hrtimer_t *found = ZK_NULL;
+	zk_uint32 now = hrtimer_now_locked();
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_HRTIMER_MAX_NUM; i++)
+	{
+		if (g_hrtimer_pool[i].active == 0 || !zk_time_is_reached(now, g_hrtimer_pool[i].expire))
+		{
+			continue;
+		}
+		if (found == ZK_NULL || zk_time_is_before(g_hrtimer_pool[i].expire, found->expire))
+		{
+			found = &g_hrtimer_pool[i];
+		}
+	}
+	if (found != ZK_NULL)
+	{
+		found->active = 0;
+	}
+	return found;
+}
+
+void TIM2_IRQHandler(void)
+{
+	zk_bool woken = ZK_FALSE;
+	hrtimer_t *timer = ZK_NULL;
+	hrtimer_handler_t handler = ZK_NULL;
+	void *param = ZK_NULL;
+	zk_uint32 sem = 0;
+
+	ZK_ENTER_CRITICAL();
+	if (TIM_GetITStatus(HRTIMER_TIM, TIM_IT_Update) != RESET)
+	{
+		TIM_ClearITPendingBit(HRTIMER_TIM, TIM_IT_Update);
+		g_hrtimer_high += HRTIMER_PERIOD;
+	}
+	TIM_ClearITPendingBit(HRTIMER_TIM, TIM_IT_CC1);
+	ZK_EXIT_CRITICAL();
+
+	/* one timer per pass, a handler may start new ones */
+	for (;;)
+	{
+		ZK_ENTER_CRITICAL();
+		timer = hrtimer_take_expired();
+		if (timer == ZK_NULL)
+		{
+			hrtimer_program();
+			ZK_EXIT_CRITICAL();
+			break;
+		}
+		handler = timer->handler;
+		param = timer->param;
+		sem = timer->sem;
+		ZK_EXIT_CRITICAL();
+
+		if (handler != ZK_NULL)
+		{
+			handler(param, &woken);
+		}
+		else
+		{
+			sem_release_from_isr(sem, &woken);
+		}
+	}
+	zk_yield_from_isr(woken);
+}
+
+/**
+ * @brief Start TIM2 as the 1 MHz time base and create the wakeup semaphores
+ * @note  Call from main() after zk_kernel_init(), the semaphore pool must be ready
+ */
+void HRTimer_Init(void)
+{
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+	TIM_OCInitTypeDef TIM_OCInitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_HRTIMER_MAX_NUM; i++)
+	{
+		g_hrtimer_pool[i].active = 0;
+		if (sem_create(&g_hrtimer_pool[i].sem, 0) != ZK_SUCCESS)
+		{
+			return;
+		}
+	}
+
+	/* APB1 runs at HCLK/2, so the timer kernel clock is doubled back to ZK_CPU_CLOCK_HZ */
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+	TIM_DeInit(HRTIMER_TIM);
+	TIM_TimeBaseStructure.TIM_Period = (u16) (HRTIMER_PERIOD - 1);
+	TIM_TimeBaseStructure.TIM_Prescaler = (u16) (ZK_CPU_CLOCK_HZ / 1000000UL - 1);
+	TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(HRTIMER_TIM, &TIM_TimeBaseStructure);
+	TIM_PrescalerConfig(HRTIMER_TIM, (u16) (ZK_CPU_CLOCK_HZ / 1000000UL - 1),
+						TIM_PSCReloadMode_Immediate);
+
+	TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_Timing;
+	TIM_OCInitStructure.TIM_Channel = TIM_Channel_1;
+	TIM_OCInitStructure.TIM_Pulse = 0;
+	TIM_OCInitStructure.TIM_OCPolarity = TIM_OCPolarity_High;
+	TIM_OCInit(HRTIMER_TIM, &TIM_OCInitStructure);
+	TIM_OC1PreloadConfig(HRTIMER_TIM, TIM_OCPreload_Disable);
+
+	/* the immediate prescaler reload raised the update flag, it is not a wrap */
+	TIM_ClearITPendingBit(HRTIMER_TIM, TIM_IT_Update | TIM_IT_CC1);
+	TIM_ITConfig(HRTIMER_TIM, TIM_IT_Update, ENABLE);
+
+	NVIC_InitStructure.NVIC_IRQChannel = TIM2_IRQChannel;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HRTIMER_IRQ_PRIORITY;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	TIM_Cmd(HRTIMER_TIM, ENABLE);
+	g_hrtimer_ready = 1;
+}
+
+/**
+ * @brief Current time in microseconds
+ */
+zk_uint32 hrtimer_now(void)
+{
+	zk_uint32 now = 0;
+
+	ZK_ENTER_CRITICAL();
+	now = hrtimer_now_locked();
+	ZK_EXIT_CRITICAL();
+	return now;
+}
+
+/**
+ * @brief Call handler once, us microseconds from now
+ * @param us Delay in microseconds, 1..0x7FFFFFFF
+ * @param handler Callback, runs in the TIM2 interrupt
+ * @param param Passed to handler
+ * @param handle Output slot for hrtimer_cancel(), may be ZK_NULL
+ * @return zk_error_code_t ZK_ERR_RESOURCE_UNAVAILABLE if all ZK_HRTIMER_MAX_NUM slots wait
+ * @note  Callable from tasks and from interrupts, including from a handler
+ */
+zk_error_code_t hrtimer_start(zk_uint32 us, hrtimer_handler_t handler, void *param,
+							  zk_uint32 *handle)
+{
+	ZK_CHECK_PARAM_NOT_NULL(handler);
+	return hrtimer_insert(us, handler, param, handle);
+}
+
+/**
+ * @brief Cancel a pending timer
+ * @return zk_error_code_t ZK_ERR_STATE if it already fired (or was never started)
+ */
+zk_error_code_t hrtimer_cancel(zk_uint32 handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	if (handle >= ZK_HRTIMER_MAX_NUM)
+	{
+		return ZK_ERR_INVALID_HANDLE;
+	}
+
+	ZK_ENTER_CRITICAL();
+	if (g_hrtimer_pool[handle].active == 0 || g_hrtimer_pool[handle].handler == ZK_NULL)
+	{
+		ret = ZK_ERR_STATE;
+	}
+	else
+	{
+		g_hrtimer_pool[handle].active = 0;
+		hrtimer_program();
+	}
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Whether the caller may sleep on a semaphore
+ */
+static zk_bool hrtimer_can_block(void)
+{
+	return (g_current_tcb != ZK_NULL && !zk_cpu_is_in_interrupt() && zk_critical_nesting == 0 &&
+			!is_scheduler_suspending());
+}
+
+/**
+ * @brief Delay the current task with microsecond resolution
+ * @param us Delay in microseconds
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note  Delays below ZK_HRTIMER_SPIN_US (cheaper than two context switches) and callers
+ *        that cannot block spin on the counter instead; longer ones sleep until the TIM2
+ *        interrupt releases the semaphore of their slot
+ */
+zk_error_code_t task_delay_us(zk_uint32 us)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 handle = 0;
+	zk_uint32 start = 0;
+
+	if (g_hrtimer_ready == 0)
+	{
+		return ZK_ERR_STATE;
+	}
+	if (us == 0)
+	{
+		return ZK_SUCCESS;
+	}
+
+	if (us >= ZK_HRTIMER_SPIN_US && hrtimer_can_block())
+	{
+		ret = hrtimer_insert(us, ZK_NULL, ZK_NULL, &handle);
+		if (ret == ZK_SUCCESS)
+		{
+			return sem_get(g_hrtimer_pool[handle].sem);
+		}
+		if (ret != ZK_ERR_RESOURCE_UNAVAILABLE)
+		{
+			return ret;
+		}
+		/* every slot is taken: fall back to spinning */
+	}
+
+	start = hrtimer_now();
+	while (hrtimer_now() - start < us)
+	{
+	}
+	return ZK_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __HRTIMER_H
+#define __HRTIMER_H
+
+#include "zk_rtos.h"
+
+#if ZK_USING_HRTIMER
+/* Runs in the TIM2 interrupt: only _from_isr kernel calls, report wakeups through the flag */
+typedef void (*hrtimer_handler_t)(void *param, zk_bool *higher_priority_woken);
+
+extern void HRTimer_Init(void);
+extern zk_uint32 hrtimer_now(void);
+extern zk_error_code_t hrtimer_start(zk_uint32 us, hrtimer_handler_t handler, void *param,
+									 zk_uint32 *handle);
+extern zk_error_code_t hrtimer_cancel(zk_uint32 handle);
+extern zk_error_code_t task_delay_us(zk_uint32 us);
+#endif
+
+#endif
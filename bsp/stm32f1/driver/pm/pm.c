@@ -0,0 +1,197 @@
+/**
+ * @file    pm.c
+ * @brief   STOP and STANDBY modes of the STM32F103 for the kernel power management (ZK_USING_PM)
+ * @note    The RTC counts the LSE divided down to 1024 Hz in the backup domain; its alarm,
+ *          routed to EXTI line 17, ends a STOP. STOP switches the HSE and the PLL off and wakes
+ *          on HSI, so the clock tree of setup_hardware() is restored first, timed with the cycle
+ *          counter. The RTC counter then tells how much system time SysTick missed.
+ */
+
+#include "stm32f10x_lib.h"
+#include "zk_rtos.h"
+#include "zk_internal.h"
+#include "pm.h"
+
+#if ZK_USING_PM
+
+extern void board_clock_config(void);
+
+/* Only clears flags, below the kernel interrupts */
+#define PM_RTC_IRQ_PRIORITY 	14
+#define PM_LSE_HZ 				32768UL
+#define PM_RTC_HZ 				1024UL
+/* the cycle counter runs on HSI until board_clock_config() has the PLL back */
+#define PM_HSI_MHZ 				8UL
+/* an alarm closer than this may be passed before STOP is entered */
+#define PM_RTC_MIN_COUNTS 		2UL
+#define PM_RTC_MAX_COUNTS 		0x7FFFFFFFUL
+
+static zk_uint32 pm_stm32_enter(zk_pm_mode_t mode, zk_uint32 ticks);
+
+static const zk_pm_ops_t g_pm_stm32_ops = {
+	.enter = pm_stm32_enter,
+	.min_ticks = {0, ZK_PM_STOP_MIN_TICKS, ZK_PM_STANDBY_MIN_TICKS},
+};
+
+/* RTC counts times ZK_TICK_RATE_HZ not yet turned into whole ticks */
+static zk_uint32 g_pm_rtc_residue = 0;
+static zk_uint8 g_pm_from_standby = 0;
+
+/**
+ * @brief Arm the RTC alarm ticks - 1 ticks from start
+ * @return zk_bool ZK_FALSE if that is too close to sleep for
+ * @note  The last tick, and the wakeups due at it, come from SysTick as in the tickless idle
+ */
+static zk_bool pm_rtc_set_alarm(zk_uint32 start, zk_uint32 ticks)
+{
+	zk_uint64 counts = ((zk_uint64) (ticks - 1) * PM_RTC_HZ) / ZK_TICK_RATE_HZ;
+
+	if (counts < PM_RTC_MIN_COUNTS)
+	{
+		return ZK_FALSE;
+	}
+	if (counts > PM_RTC_MAX_COUNTS)
+	{
+		counts = PM_RTC_MAX_COUNTS;
+	}
+
+	RTC_WaitForLastTask();
+	RTC_SetAlarm(start + (zk_uint32) counts);
+	RTC_WaitForLastTask();
+	RTC_ClearFlag(RTC_FLAG_ALR);
+	EXTI_ClearITPendingBit(EXTI_Line17);
+	return ZK_TRUE;
+}
+
+/**
+ * @brief Advance the system time by the RTC counts elapsed since start
+ * @note  Call with interrupts masked
+ */
+static void pm_rtc_step_time(zk_uint32 start)
+{
+	zk_uint64 scaled = 0;
+
+	RTC_WaitForSynchro(); /* the RTC APB interface stopped with the clocks */
+	scaled = (zk_uint64) (RTC_GetCounter() - start) * ZK_TICK_RATE_HZ + g_pm_rtc_residue;
+	g_pm_rtc_residue = (zk_uint32) (scaled % PM_RTC_HZ);
+	zk_time_step((zk_uint32) (scaled / PM_RTC_HZ));
+}
+
+/**
+ * @brief zk_pm_ops_t.enter() of this board
+ * @return zk_uint32 Microseconds from the wakeup to 72 MHz, ZK_PM_NOT_ENTERED if it backed out
+ */
+static zk_uint32 pm_stm32_enter(zk_pm_mode_t mode, zk_uint32 ticks)
+{
+	zk_uint32 start = 0;
+	zk_uint32 wake_cycles = 0;
+
+	/* WFI only wakes on interrupts PRIMASK lets pend, BASEPRI would mask the kernel ones */
+	zk_cpu_irq_disable();
+
+	/* a task made ready or a tick pended since the idle estimate: stay awake */
+	if (ZK_CM3_INT_CTRL_REG & (ZK_CM3_PENDSVSET_BIT | ZK_CM3_PENDSTSET_BIT))
+	{
+		zk_cpu_irq_enable();
+		return ZK_PM_NOT_ENTERED;
+	}
+
+	start = RTC_GetCounter();
+	if (!pm_rtc_set_alarm(start, ticks))
+	{
+		zk_cpu_irq_enable();
+		return ZK_PM_NOT_ENTERED;
+	}
+
+	if (mode == ZK_PM_MODE_STANDBY)
+	{
+		PWR_ClearFlag(PWR_FLAG_WU);
+		PWR_EnterSTANDBYMode(); /* does not return, the alarm resets the chip */
+	}
+
+	PWR_EnterSTOPMode(PWR_Regulator_LowPower, PWR_STOPEntry_WFI);
+	wake_cycles = zk_cpu_cycle_count();
+	/* SLEEPDEEP stays set after STOP, the tickless WFI must stay a plain sleep */
+	NVIC_SystemLPConfig(NVIC_LP_SLEEPDEEP, DISABLE);
+	board_clock_config();
+	wake_cycles = zk_cpu_cycle_count() - wake_cycles;
+
+	pm_rtc_step_time(start);
+
+	/* the RTC alarm, or whichever interrupt woke the chip, is taken here */
+	zk_cpu_irq_enable();
+
+	return wake_cycles / PM_HSI_MHZ;
+}
+
+void RTCAlarm_IRQHandler(void)
+{
+	EXTI_ClearITPendingBit(EXTI_Line17);
+	RTC_ClearITPendingBit(RTC_IT_ALR);
+	RTC_WaitForLastTask();
+}
+
+/**
+ * @brief Start the RTC wake-up source and register STOP / STANDBY with the kernel
+ * @note  Call from main() after zk_kernel_init(). The LSE and the RTC are set up on the first
+ *        power-on only, the backup domain keeps them running through STANDBY and resets.
+ */
+void PM_Init(void)
+{
+	EXTI_InitTypeDef EXTI_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+	PWR_BackupAccessCmd(ENABLE);
+
+	g_pm_from_standby = (PWR_GetFlagStatus(PWR_FLAG_SB) != RESET);
+	PWR_ClearFlag(PWR_FLAG_SB);
+	PWR_ClearFlag(PWR_FLAG_WU);
+
+	if (RCC_GetFlagStatus(RCC_FLAG_LSERDY) == RESET)
+	{
+		RCC_LSEConfig(RCC_LSE_ON);
+		while (RCC_GetFlagStatus(RCC_FLAG_LSERDY) == RESET)
+		{
+		}
+		RCC_RTCCLKConfig(RCC_RTCCLKSource_LSE);
+		RCC_RTCCLKCmd(ENABLE);
+		RTC_WaitForSynchro();
+		RTC_WaitForLastTask();
+		RTC_SetPrescaler(PM_LSE_HZ / PM_RTC_HZ - 1UL);
+		RTC_WaitForLastTask();
+	}
+	else
+	{
+		RTC_WaitForSynchro();
+	}
+	RTC_ITConfig(RTC_IT_ALR, ENABLE);
+	RTC_WaitForLastTask();
+
+	EXTI_ClearITPendingBit(EXTI_Line17);
+	EXTI_InitStructure.EXTI_Line = EXTI_Line17;
+	EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+	EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising;
+	EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+	EXTI_Init(&EXTI_InitStructure);
+
+	NVIC_InitStructure.NVIC_IRQChannel = RTCAlarm_IRQChannel;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = PM_RTC_IRQ_PRIORITY;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	/* wake-up latency is measured with the cycle counter */
+	zk_cpu_cycle_counter_init();
+	pm_register(&g_pm_stm32_ops);
+}
+
+/**
+ * @brief Whether this boot is the wakeup from a STANDBY entered by the idle task
+ */
+zk_bool PM_WokeFromStandby(void)
+{
+	return g_pm_from_standby;
+}
+
+#endif /* ZK_USING_PM */
@@ -0,0 +1,11 @@
+#ifndef __PM_H
+#define __PM_H
+
+#include "zk_rtos.h"
+
+#if ZK_USING_PM
+extern void PM_Init(void);
+extern zk_bool PM_WokeFromStandby(void);
+#endif
+
+#endif
@@ -2,15 +2,288 @@
 #include <stdio.h>
 #include "stm32f10x_lib.h"
 #include "zk_rtos.h" 
+#include "zk_internal.h"
+#include "serial.h"
 
-void vUARTInterruptHandler( void )
+#if (ZK_CONSOLE_BACKEND == ZK_CONSOLE_UART) && ZK_UART_ASYNC
+
+#if !ZK_USING_RING || !ZK_USING_SEMAPHORE
+#error "ZK_UART_ASYNC needs ZK_USING_RING and ZK_USING_SEMAPHORE"
+#endif
+
+/* Numerically above ZK_MAX_SYSCALL_INTERRUPT_PRIORITY: masked by the kernel, may call it */
+#define UART_IRQ_PRIORITY 		12
+#if ZK_NVIC_PRIORITY(UART_IRQ_PRIORITY) < ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
+#error "UART_IRQ_PRIORITY is above the kernel threshold but calls the kernel"
+#endif
+#define UART_TX_DMA_CHANNEL 	DMA_Channel4	/* USART1_TX request line */
+#define UART_TX_DMA_FLAG_TC 	DMA_FLAG_TC4
+#define UART_TX_DMA_FLAG_GL 	DMA_FLAG_GL4
+
+static zk_uint8 g_uart_tx_storage[ZK_UART_TX_BUF_SIZE];
+static zk_uint8 g_uart_rx_storage[ZK_UART_RX_BUF_SIZE];
+static zk_ring_t g_uart_tx_ring;
+static zk_ring_t g_uart_rx_ring;
+static zk_uint32 g_uart_tx_sem;
+static zk_uint32 g_uart_rx_sem;
+/* everything below is only touched with interrupts masked */
+static zk_uint8 g_uart_async_ready = 0;		/* UART_StartAsync() done, zk_putc polls until then */
+static zk_uint32 g_uart_tx_inflight = 0;	/* bytes owned by the running DMA transfer, 0 = idle */
+static zk_uint32 g_uart_tx_waiters = 0;		/* writers sleeping on g_uart_tx_sem for space */
+static volatile zk_uint32 g_uart_rx_overrun = 0;
+
+/**
+ * @brief Hand the oldest contiguous bytes of the TX ring to the DMA if it is idle
+ * @note  Call with interrupts masked
+ */
+static void uart_tx_kick(void)
 {
+	const zk_uint8 *span = ZK_NULL;
+	zk_uint32 len = 0;
+
+	if (g_uart_tx_inflight != 0)
+	{
+		return;
+	}
+	len = ring_read_span(&g_uart_tx_ring, &span);
+	if (len == 0)
+	{
+		return;
+	}
+
+	g_uart_tx_inflight = len;
+	DMA_Cmd(UART_TX_DMA_CHANNEL, DISABLE);
+	UART_TX_DMA_CHANNEL->CMAR = (u32) span;
+	UART_TX_DMA_CHANNEL->CNDTR = len;
+	DMA_Cmd(UART_TX_DMA_CHANNEL, ENABLE);
 }
 
-/*-----------------------------------------------------------*/
+/**
+ * @brief Retire a finished transfer and chain the next one
+ * @note  Call with interrupts masked, from the DMA ISR or from a polling writer
+ */
+static void uart_tx_complete(void)
+{
+	if (DMA_GetFlagStatus(UART_TX_DMA_FLAG_TC) == RESET)
+	{
+		return;
+	}
+	DMA_ClearFlag(UART_TX_DMA_FLAG_GL);
+	ring_consume(&g_uart_tx_ring, g_uart_tx_inflight);
+	g_uart_tx_inflight = 0;
+	uart_tx_kick();
+}
+
+/**
+ * @brief Whether the caller may sleep until the DMA frees space
+ */
+static zk_bool uart_can_block(void)
+{
+	return (g_current_tcb != ZK_NULL && !zk_cpu_is_in_interrupt() && zk_critical_nesting == 0 &&
+			!is_scheduler_suspending());
+}
+
+/**
+ * @brief Wait until the TX ring has space again
+ * @note  Tasks sleep on g_uart_tx_sem. ISRs, critical sections and code running before the
+ *        scheduler cannot, they drive the DMA chain themselves by polling its flag.
+ */
+static void uart_tx_wait(void)
+{
+	zk_bool sleep = ZK_FALSE;
+
+	if (!uart_can_block())
+	{
+		ZK_ENTER_CRITICAL();
+		uart_tx_complete();
+		ZK_EXIT_CRITICAL();
+		return;
+	}
+
+	ZK_ENTER_CRITICAL();
+	if (ring_free(&g_uart_tx_ring) == 0)
+	{
+		g_uart_tx_waiters++;
+		sleep = ZK_TRUE;
+	}
+	ZK_EXIT_CRITICAL();
+
+	if (sleep)
+	{
+		sem_get(g_uart_tx_sem);
+	}
+}
+
+void DMAChannel4_IRQHandler(void)
+{
+	zk_bool woken = ZK_FALSE;
+	zk_uint32 waiters = 0;
+
+	ZK_ENTER_CRITICAL();
+	uart_tx_complete();
+	/* every sleeping writer re-checks the space, the ones that lose go back to sleep */
+	if (ring_free(&g_uart_tx_ring) > 0)
+	{
+		waiters = g_uart_tx_waiters;
+		g_uart_tx_waiters = 0;
+	}
+	ZK_EXIT_CRITICAL();
+
+	while (waiters > 0)
+	{
+		sem_release_from_isr(g_uart_tx_sem, &woken);
+		waiters--;
+	}
+	zk_yield_from_isr(woken);
+}
+
+/* UART interrupt handler: RX bytes go into the lock-free RX ring. */
+void vUARTInterruptHandler(void)
+{
+	zk_bool woken = ZK_FALSE;
+	zk_uint8 byte = 0;
+
+	if (USART_GetITStatus(USART1, USART_IT_RXNE) != RESET)
+	{
+		/* reading DR also clears a pending overrun */
+		byte = (zk_uint8) USART_ReceiveData(USART1);
+		if (ring_write_from_isr(&g_uart_rx_ring, &byte, 1, &woken) == 0)
+		{
+			g_uart_rx_overrun++;
+		}
+	}
+	zk_yield_from_isr(woken);
+}
 
-/* UART interrupt handler. */
-void vUARTInterruptHandler( void );
+/**
+ * @brief Switch USART1 to DMA transmit and interrupt receive
+ * @note  Call after zk_kernel_init() (needs semaphores) and before the scheduler starts;
+ *        zk_putc() keeps polling the UART until then
+ */
+void UART_StartAsync(void)
+{
+	DMA_InitTypeDef DMA_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	ring_init(&g_uart_tx_ring, g_uart_tx_storage, sizeof(g_uart_tx_storage));
+	ring_init(&g_uart_rx_ring, g_uart_rx_storage, sizeof(g_uart_rx_storage));
+	sem_create(&g_uart_tx_sem, 0);
+	sem_create(&g_uart_rx_sem, 0);
+	ring_bind_notify(&g_uart_rx_ring, g_uart_rx_sem);
+
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA, ENABLE);
+	DMA_DeInit(UART_TX_DMA_CHANNEL);
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (u32) &USART1->DR;
+	DMA_InitStructure.DMA_MemoryBaseAddr = (u32) g_uart_tx_storage;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+	DMA_InitStructure.DMA_BufferSize = 1;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+	DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+	DMA_Init(UART_TX_DMA_CHANNEL, &DMA_InitStructure);
+	DMA_ITConfig(UART_TX_DMA_CHANNEL, DMA_IT_TC, ENABLE);
+	USART_DMACmd(USART1, USART_DMAReq_Tx, ENABLE);
+
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = UART_IRQ_PRIORITY;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStructure.NVIC_IRQChannel = DMAChannel4_IRQChannel;
+	NVIC_Init(&NVIC_InitStructure);
+	NVIC_InitStructure.NVIC_IRQChannel = USART1_IRQChannel;
+	NVIC_Init(&NVIC_InitStructure);
+
+#if ZK_USING_PM
+	/* the receiver is always listening and USART1 is no STOP wake-up source */
+	pm_constraint_get(ZK_PM_MODE_STOP);
+#endif
+
+	ZK_ENTER_CRITICAL();
+	g_uart_async_ready = 1;
+	ZK_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Queue bytes for transmission
+ * @param data bytes to send
+ * @param len number of bytes
+ * @note  Returns once everything is in the TX ring; only waits while the ring is full
+ */
+void UART_Write(const zk_uint8 *data, zk_uint32 len)
+{
+	zk_uint32 written = 0;
+
+	while (len > 0)
+	{
+		ZK_ENTER_CRITICAL();
+		/* interrupts masked: any task or ISR may write, the ring itself has one producer */
+		written = ring_write(&g_uart_tx_ring, data, len);
+		uart_tx_kick();
+		ZK_EXIT_CRITICAL();
+
+		data += written;
+		len -= written;
+		if (len > 0)
+		{
+			uart_tx_wait();
+		}
+	}
+}
+
+/**
+ * @brief Read received bytes
+ * @param data destination
+ * @param len maximum number of bytes
+ * @param read output, bytes actually read (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if at least one byte was read, otherwise error code
+ * @note  Single reader; the caller sleeps on the RX semaphore while nothing has arrived
+ */
+zk_error_code_t UART_Read(zk_uint8 *data, zk_uint32 len, zk_uint32 *read, zk_uint32 timeout)
+{
+	return ring_read_timeout(&g_uart_rx_ring, data, len, read, timeout);
+}
+
+/**
+ * @brief Wait until everything queued has left the TX ring
+ * @note  The last byte may still be in the shift register when this returns
+ */
+void UART_Flush(void)
+{
+	while (ring_used(&g_uart_tx_ring) > 0)
+	{
+		if (uart_can_block())
+		{
+			task_delay(1);
+		}
+		else
+		{
+			ZK_ENTER_CRITICAL();
+			uart_tx_complete();
+			ZK_EXIT_CRITICAL();
+		}
+	}
+}
+
+/**
+ * @brief Number of received bytes dropped because the RX ring was full
+ */
+zk_uint32 UART_GetRxOverrun(void)
+{
+	return g_uart_rx_overrun;
+}
+
+#else
+
+/* UART interrupt handler, RX is not used by the polled driver. */
+void vUARTInterruptHandler(void)
+{
+}
+
+#endif
 
 /*-----------------------------------------------------------*/
 
@@ -55,16 +328,29 @@ void UART_Init(unsigned long ulWantedBaud)
 
 
 
+#if (ZK_CONSOLE_BACKEND == ZK_CONSOLE_UART)
 /*****************************************************
  * @brief   ZK-RTOS put character to UART
  * @param   c character to be printed
- * @note    redirect printf to UART
+ * @note    redirect printf to UART; ZK_CONSOLE_ITM uses swo.c instead.
+ *          With ZK_UART_ASYNC the byte is queued for DMA once
+ *          UART_StartAsync() has run.
  ******************************************************/
 void zk_putc(char c)
 {
+#if ZK_UART_ASYNC
+	zk_uint8 byte = (zk_uint8) c;
+
+	if (g_uart_async_ready)
+	{
+		UART_Write(&byte, 1);
+		return;
+	}
+#endif
 	while (!USART_GetFlagStatus(USART1, USART_FLAG_TXE));
 	USART_SendData(USART1, (uint8_t)c);
 }
+#endif
 
 
 
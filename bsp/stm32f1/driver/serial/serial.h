@@ -0,0 +1,18 @@
+#ifndef __SERIAL_H
+#define __SERIAL_H
+
+#include "zk_rtos.h"
+
+extern void UART_Init(unsigned long ulWantedBaud);
+
+#if (ZK_CONSOLE_BACKEND == ZK_CONSOLE_UART) && ZK_UART_ASYNC
+/* DMA transmit / interrupt receive, see ZK_UART_ASYNC in zk_config.h */
+extern void UART_StartAsync(void);
+extern void UART_Write(const zk_uint8 *data, zk_uint32 len);
+extern zk_error_code_t UART_Read(zk_uint8 *data, zk_uint32 len, zk_uint32 *read,
+								 zk_uint32 timeout);
+extern void UART_Flush(void);
+extern zk_uint32 UART_GetRxOverrun(void);
+#endif
+
+#endif
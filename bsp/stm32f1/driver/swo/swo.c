@@ -0,0 +1,118 @@
+/**
+ * @file    swo.c
+ * @brief   ITM/SWO debug output backend (ZK_CONSOLE_BACKEND == ZK_CONSOLE_ITM)
+ * @note    zk_putc() writes text to stimulus port ZK_ITM_CONSOLE_PORT and the trace stream
+ *          goes to ZK_ITM_TRACE_PORT as 32-bit packets. A write only waits for the one-word
+ *          stimulus FIFO, which the SWO pin drains at ZK_SWO_BAUD_RATE, so a character costs
+ *          a few cycles instead of a full UART frame. Nothing is sent (and nothing blocks)
+ *          while the debugger has ITM or the port disabled.
+ */
+
+#include "zk_rtos.h"
+
+#if (ZK_CONSOLE_BACKEND == ZK_CONSOLE_ITM)
+
+#if (ZK_CPU_CLOCK_HZ % ZK_SWO_BAUD_RATE) != 0
+#error "ZK_SWO_BAUD_RATE must divide ZK_CPU_CLOCK_HZ"
+#endif
+
+#define ITM_STIM_U8(port) (*((volatile zk_uint8 *) (0xE0000000UL + 4UL * (port))))
+#define ITM_STIM_U32(port) (*((volatile zk_uint32 *) (0xE0000000UL + 4UL * (port))))
+#define ITM_TER_REG (*((volatile zk_uint32 *) 0xE0000E00UL))
+#define ITM_TPR_REG (*((volatile zk_uint32 *) 0xE0000E40UL))
+#define ITM_TCR_REG (*((volatile zk_uint32 *) 0xE0000E80UL))
+#define ITM_LAR_REG (*((volatile zk_uint32 *) 0xE0000FB0UL))
+#define TPIU_ACPR_REG (*((volatile zk_uint32 *) 0xE0040010UL))
+#define TPIU_SPPR_REG (*((volatile zk_uint32 *) 0xE00400F0UL))
+#define TPIU_FFCR_REG (*((volatile zk_uint32 *) 0xE0040304UL))
+#define DBGMCU_CR_REG (*((volatile zk_uint32 *) 0xE0042004UL))
+#define DEMCR_REG (*((volatile zk_uint32 *) 0xE000EDFCUL))
+
+#define DEMCR_TRCENA (1UL << 24)
+#define DBGMCU_TRACE_IOEN (1UL << 5) /* TRACE_MODE = 00: asynchronous, SWO on PB3 */
+#define TPIU_SPPR_NRZ 2UL
+#define TPIU_FFCR_TRIGIN (1UL << 8) /* formatter off, ITM packets straight to SWO */
+#define ITM_LAR_UNLOCK 0xC5ACCE55UL
+#define ITM_TCR_ITMENA (1UL << 0)
+#define ITM_TCR_SYNCENA (1UL << 2)
+#define ITM_TCR_TRACEBUSID (1UL << 16)
+#define ITM_STIM_READY (1UL << 0)
+
+/**
+ * @brief Route ITM to the SWO pin at ZK_SWO_BAUD_RATE
+ * @note  Debuggers that configure SWO themselves overwrite these settings, which is fine
+ */
+void SWO_Init(void)
+{
+	DEMCR_REG |= DEMCR_TRCENA;
+	DBGMCU_CR_REG |= DBGMCU_TRACE_IOEN;
+
+	TPIU_SPPR_REG = TPIU_SPPR_NRZ;
+	TPIU_ACPR_REG = (ZK_CPU_CLOCK_HZ / ZK_SWO_BAUD_RATE) - 1;
+	TPIU_FFCR_REG = TPIU_FFCR_TRIGIN;
+
+	ITM_LAR_REG = ITM_LAR_UNLOCK;
+	ITM_TCR_REG = ITM_TCR_TRACEBUSID | ITM_TCR_SYNCENA | ITM_TCR_ITMENA;
+	ITM_TPR_REG = 0; /* stimulus ports writable unprivileged */
+	ITM_TER_REG = (1UL << ZK_ITM_CONSOLE_PORT) | (1UL << ZK_ITM_TRACE_PORT);
+}
+
+static inline zk_bool swo_port_enabled(zk_uint32 port)
+{
+	return ((ITM_TCR_REG & ITM_TCR_ITMENA) != 0) && ((ITM_TER_REG & (1UL << port)) != 0);
+}
+
+/**
+ * @brief ZK-RTOS put character to ITM stimulus port
+ * @param c character to be printed
+ */
+void zk_putc(char c)
+{
+	if (!swo_port_enabled(ZK_ITM_CONSOLE_PORT))
+	{
+		return;
+	}
+	while ((ITM_STIM_U32(ZK_ITM_CONSOLE_PORT) & ITM_STIM_READY) == 0)
+	{
+	}
+	ITM_STIM_U8(ZK_ITM_CONSOLE_PORT) = (zk_uint8) c;
+}
+
+#if ZK_USING_TRACE
+/**
+ * @brief Trace byte sink on its own stimulus port, replaces the zk_putc default
+ * @note  Whole words go out as one 5-byte SWO packet, four 1-byte writes would cost 8;
+ *        the host reassembles the little-endian stream per port
+ */
+void zk_trace_output(const zk_uint8 *data, zk_uint32 len)
+{
+	zk_uint32 word = 0;
+
+	if (!swo_port_enabled(ZK_ITM_TRACE_PORT))
+	{
+		return;
+	}
+	while (len >= 4)
+	{
+		word = (zk_uint32) data[0] | ((zk_uint32) data[1] << 8) | ((zk_uint32) data[2] << 16) |
+			   ((zk_uint32) data[3] << 24);
+		while ((ITM_STIM_U32(ZK_ITM_TRACE_PORT) & ITM_STIM_READY) == 0)
+		{
+		}
+		ITM_STIM_U32(ZK_ITM_TRACE_PORT) = word;
+		data += 4;
+		len -= 4;
+	}
+	while (len > 0)
+	{
+		while ((ITM_STIM_U32(ZK_ITM_TRACE_PORT) & ITM_STIM_READY) == 0)
+		{
+		}
+		ITM_STIM_U8(ZK_ITM_TRACE_PORT) = *data;
+		data++;
+		len--;
+	}
+}
+#endif
+
+#endif
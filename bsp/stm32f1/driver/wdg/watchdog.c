@@ -0,0 +1,72 @@
+/**
+ * @file    watchdog.c
+ * @brief   Independent watchdog of the STM32F103 fed by the kernel heartbeat monitor
+ * @note    Once started the IWDG cannot be stopped and keeps counting on the LSI in STOP.
+ *          Feeding is left to heartbeat_check(), which stops as soon as a monitored task is
+ *          late, so the reset that follows is always preceded by a heartbeat miss report.
+ */
+
+#include "stm32f10x_lib.h"
+#include "zk_rtos.h"
+#include "watchdog.h"
+
+#if ZK_USING_IWDG
+
+#if !ZK_USING_HEARTBEAT
+#error "ZK_USING_IWDG needs ZK_USING_HEARTBEAT"
+#endif
+
+/* LSI is 40 kHz nominal but may run up to 60 kHz, a third shorter than configured */
+#define WDG_LSI_HZ 				40000UL
+#define WDG_PRESCALER_DIV 		64UL
+#define WDG_RELOAD 				(ZK_IWDG_TIMEOUT_MS * (WDG_LSI_HZ / WDG_PRESCALER_DIV) / 1000UL)
+/* DBGMCU_CR.DBG_IWDG_STOP: the counter stops while the core is halted by the debugger */
+#define WDG_DBGMCU_CR 			(*(volatile zk_uint32 *) 0xE0042004UL)
+#define WDG_DBG_IWDG_STOP 		(1UL << 8)
+
+#if (WDG_RELOAD < 1) || (WDG_RELOAD > 0xFFF)
+#error "ZK_IWDG_TIMEOUT_MS out of the range of the IWDG at prescaler 64"
+#endif
+
+#if (ZK_HEARTBEAT_FEED_TICKS * 1000UL / ZK_TICK_RATE_HZ) * 2 > ZK_IWDG_TIMEOUT_MS
+#error "ZK_HEARTBEAT_FEED_TICKS must be under half of ZK_IWDG_TIMEOUT_MS"
+#endif
+
+static zk_uint8 g_wdg_caused_reset = 0;
+
+/**
+ * @brief Reload the counter, called by the heartbeat monitor in SysTick interrupt
+ */
+static void watchdog_feed(void)
+{
+	IWDG_ReloadCounter();
+}
+
+/**
+ * @brief Start the IWDG and hand its feeding to the heartbeat monitor
+ */
+void Watchdog_Init(void)
+{
+	g_wdg_caused_reset = (RCC_GetFlagStatus(RCC_FLAG_IWDGRST) != RESET);
+	RCC_ClearFlag();
+
+	WDG_DBGMCU_CR |= WDG_DBG_IWDG_STOP;
+
+	IWDG_WriteAccessCmd(IWDG_WriteAccess_Enable);
+	IWDG_SetPrescaler(IWDG_Prescaler_64);
+	IWDG_SetReload((u16) (WDG_RELOAD - 1UL));
+	IWDG_ReloadCounter();
+	IWDG_Enable();
+
+	heartbeat_set_watchdog(watchdog_feed);
+}
+
+/**
+ * @brief Whether this boot is a reset by the IWDG
+ */
+zk_bool Watchdog_CausedReset(void)
+{
+	return g_wdg_caused_reset;
+}
+
+#endif /* ZK_USING_IWDG */
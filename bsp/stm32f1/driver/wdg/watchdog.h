@@ -0,0 +1,11 @@
+#ifndef __WATCHDOG_H
+#define __WATCHDOG_H
+
+#include "zk_rtos.h"
+
+#if ZK_USING_IWDG
+extern void Watchdog_Init(void);
+extern zk_bool Watchdog_CausedReset(void);
+#endif
+
+#endif
@@ -8,12 +8,56 @@
  */
 
 
+/**
+ * @brief 内核裁剪档位
+ * @note  ZK_PROFILE_CUSTOM: 使用下面逐项的功能开关及 ZK_USING_TICKLESS
+ *        ZK_PROFILE_MINIMAL: 只有调度器/任务/延时/堆, 关闭全部可选子系统
+ *        ZK_PROFILE_STANDARD: 信号量/互斥锁/消息队列/软件定时器/钩子 (与下面的默认开关相同)
+ *        ZK_PROFILE_FULL: 打开全部内核功能 (含 ZK_USING_TICKLESS), 用于开发调试
+ *        非 CUSTOM 档位忽略下面的功能开关, 取值见 include/private/zk_feature.h.
+ *        所有开关都以 #if 判断, 关闭的子系统不占 Flash/RAM, 也不进入 SysTick 处理
+ */
+#define ZK_PROFILE_CUSTOM 	0
+#define ZK_PROFILE_MINIMAL 	1
+#define ZK_PROFILE_STANDARD 2
+#define ZK_PROFILE_FULL 	3
+#define ZK_CONFIG_PROFILE 	ZK_PROFILE_CUSTOM
+
 /* IPC 功能开关 (0=禁用, 1=启用) */
-#define ZK_USING_SEMAPHORE 	0 	// 信号量
-#define ZK_USING_MUTEX		0 	// 互斥锁
-#define ZK_USING_QUEUE 		0	// 消息队列
-#define ZK_USING_TIMER 		0	// 软件定时器
-#define ZK_USING_HOOK 		0	// 钩子函数机制
+#define ZK_USING_SEMAPHORE 	1 	// 信号量
+#define ZK_USING_MUTEX		1 	// 互斥锁
+#define ZK_USING_QUEUE 		1	// 消息队列
+#define ZK_USING_TIMER 		1	// 软件定时器 (ZK_TIMER_MODE_TASK 需要 ZK_USING_SEMAPHORE)
+#define ZK_USING_HOOK 		1	// 钩子函数机制
+#define ZK_USING_RING 		0	// 单生产者/单消费者无锁环形缓冲区
+#define ZK_USING_MPMC 		0	// 多生产者/多消费者无锁有界队列 (mpmc_*), LDREX/STREX 认领槽位, 只在空/满时阻塞
+#define ZK_USING_MEM_POOL 	0	// 固定块内存池
+#define ZK_USING_TASK_NOTIFY 0	// 任务直接通知
+#define ZK_USING_EVENT 		0	// 事件标志组
+#define ZK_USING_MUTEX_CEILING 0	// 互斥锁优先级天花板协议 (mutex_create_ceiling)
+#define ZK_USING_RWLOCK 	0	// 读写锁 (写者优先)
+#define ZK_USING_CRITICAL_STATS 0	// 临界区 (中断屏蔽) 时长统计, 见 zk_critical_get_stats()
+#define ZK_USING_TRACE 		0	// 调度器/IPC 二进制跟踪缓冲区, 格式见 docs/二进制跟踪格式.md
+#define ZK_USING_PERF_COUNTERS 0	// 内核性能计数块 g_zk_perf_counters (切换/Tick/唤醒/阻塞/超时/分配耗时), 调试器可直接读取
+#define ZK_USING_DEFERRED_LOG 0	// 延迟日志 zk_log(), 由后台日志任务格式化输出 (需要 ZK_USING_RING 和 ZK_USING_SEMAPHORE)
+#define ZK_USING_SLACK 		0	// 定时器/延时的唤醒容差 (timer_set_slack, task_delay_slack), 合并相近的唤醒
+#define ZK_USING_EDF 		0	// 最早截止期优先 (EDF) 调度类, 占用优先级 ZK_EDF_PRIORITY
+#define ZK_USING_BUDGET 	0	// 任务执行预算, 每周期耗尽后降到 ZK_BUDGET_BACKGROUND_PRIORITY 直到补充
+#define ZK_USING_STACK_WATCH 0	// 空闲任务分段刷新所有任务的栈水位, 见 task_get_all_stack_stats()
+#define ZK_USING_MPU_STACK_GUARD 0	// CM3 MPU 栈保护区, 溢出立即触发 MemManage (芯片需带 MPU)
+#define ZK_USING_QUEUE_SET 	0	// 队列集合, 一次阻塞等待多个队列/信号量 (queue_set_select)
+#define ZK_USING_MSGBUF 	0	// 变长消息缓冲区 / 字节流缓冲区 (msgbuf_*)
+#define ZK_USING_MAILBOX 	0	// 指针邮箱 (mbox_*), 基于消息队列, 配合内存池转移消息所有权
+#define ZK_USING_TIME64 	0	// 64 位单调 Tick (get_current_time64) 与 64 位绝对截止期等待 (*_until64)
+#define ZK_USING_PREEMPT_THRESHOLD 0	// 任务抢占阈值, 只有优先级高于阈值的任务才能抢占运行中的任务
+#define ZK_USING_WORKQUEUE 	0	// 工作队列, 中断的耗时处理推迟到工作任务执行 (work_submit, 需要 ZK_USING_SEMAPHORE)
+#define ZK_USING_COROUTINE 	0	// 无栈协程, 多个状态机作业共用一个宿主任务和栈 (co_*, 需要 ZK_USING_SEMAPHORE)
+#define ZK_USING_TASK_MONITOR 	0	// 任务监视, 无分配地快照所有任务的状态/优先级/CPU 占用/栈峰值/等待对象 (task_monitor_*)
+#define ZK_USING_PM 		0	// 空闲功耗管理, 按预计空闲时间在 WFI/STOP/STANDBY 间选择, 驱动可禁止深睡 (pm_*, 需要 ZK_USING_TICKLESS)
+#define ZK_USING_WAIT_INDEX 0	// IPC 等待队列的优先级位图索引, 等待者多的对象按优先级阻塞/唤醒都是 O(1)
+#define ZK_USING_ARENA 		0	// 线性分配器 (arena_*), 按指针递增分配, arena_reset() 一次释放全部, 任务可设默认 arena
+#define ZK_USING_SYSTEM_TABLE 0	// 系统定义表 (ZK_SYS_*), 常量表放在 Flash, zk_system_create() 一次创建其中的任务和 IPC 对象, 不用堆
+#define ZK_USING_HEARTBEAT 	0	// 任务心跳/截止期监视 (task_heartbeat), 错过截止期时报告并停止喂看门狗
 
 /*----------------------------------------------------------------------------
  *                          资源池配置
@@ -23,6 +67,20 @@
 #define MUTEX_MAX_NUM 		10 	// 互斥锁最大数量
 #define QUEUE_MAX_NUM 		10 	// 消息队列最大数量
 #define TIMER_MAX_NUM 		10 	// 软件定时器最大数量
+#define EVENT_MAX_NUM 		10 	// 事件标志组最大数量
+#define RWLOCK_MAX_NUM 		4 	// 读写锁最大数量
+#define MSGBUF_MAX_NUM 		4 	// 消息/流缓冲区最大数量
+#define MEM_POOL_MAX_NUM 	4 	// 固定块内存池最大数量
+#define MEM_REGION_MAX_NUM 	1 	// 堆区域最大数量 (区域 0 为内部 g_heap)
+
+/**
+ * @brief 等待队列位图索引 (ZK_USING_WAIT_INDEX)
+ * @note  按优先级阻塞时遍历到 ZK_WAIT_INDEX_THRESHOLD 个等待者, 就从池中为该等待队列
+ *        取一个索引 (每个优先级的队尾 + 位图, 约 4 * ZK_PRIORITY_NUM 字节), 之后插入位置
+ *        由位图直接算出; 队列清空时归还. 池用完时退回按优先级遍历
+ */
+#define ZK_WAIT_INDEX_NUM 		4	// 同时带索引的等待队列数
+#define ZK_WAIT_INDEX_THRESHOLD 4	// 挂接索引的遍历长度
 
 /*----------------------------------------------------------------------------
  *                          任务配置
@@ -30,12 +88,224 @@
 /* 空闲任务栈大小 (字节) */
 #define IDLE_TASK_STACK_SIZE 512
 
+/* 空闲任务每轮检查的栈字数 (ZK_USING_STACK_WATCH), 决定一次刷新关中断之外的最长耗时 */
+#define ZK_STACK_WATCH_CHUNK_WORDS 	32
+
+/**
+ * @brief MPU 栈保护区 (ZK_USING_MPU_STACK_GUARD)
+ * @note  每次任务切换把一个 MPU 区域移到新任务 stack_base 之上第一个按大小对齐的位置,
+ *        设为禁止访问; 每个任务栈底因此预留 2 * ZK_MPU_GUARD_SIZE 字节不计入可用栈.
+ *        大小必须为 2 的幂且不小于 32. STM32F103 中小容量型号没有 MPU, 此时保护不生效
+ */
+#define ZK_MPU_GUARD_SIZE 		32
+#define ZK_MPU_GUARD_REGION 	7	// 使用的 MPU 区域号, 优先级最高的区域
+
+/**
+ * @brief EDF 调度类所在的优先级 (ZK_USING_EDF)
+ * @note  edf_period 非 0 的任务都运行在该优先级, 就绪链表按绝对截止期排序且不做时间片轮转;
+ *        高于它的固定优先级任务仍可抢占 EDF 任务. 该优先级应只留给 EDF 任务
+ */
+#define ZK_EDF_PRIORITY 	8
+
+/**
+ * @brief 预算耗尽的任务降到的后台优先级 (ZK_USING_BUDGET)
+ * @note  降级后任务仍可在没有其他就绪任务时运行, 到下一个补充时刻恢复原优先级
+ */
+#define ZK_BUDGET_BACKGROUND_PRIORITY 	(ZK_MIN_PRIORITY - 1)
+
+/**
+ * @brief 心跳监视的喂狗间隔 (ZK_USING_HEARTBEAT)
+ * @note  登记的任务都没有错过截止期时, SysTick 每隔该 Tick 数调用一次 heartbeat_set_watchdog()
+ *        登记的喂狗函数, Tickless 空闲也不会睡过下一次喂狗. 必须明显短于看门狗超时
+ */
+#define ZK_HEARTBEAT_FEED_TICKS 	100
+
+/*----------------------------------------------------------------------------
+ *                          内存管理配置
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief 堆分配算法 (0=首次适应链表, 1=TLSF 两级分离适配)
+ * @note  TLSF 的 mem_alloc/mem_free 为 O(1)，与空闲块数量无关; 每个堆区域须小于 64 KiB
+ *        (2^MEM_TLSF_FL_INDEX_MAX), 更大的区域 mem_add_region() 返回 ZK_ERR_INVALID_PARAM
+ */
+#define ZK_USING_TLSF 0
+
+/**
+ * @brief 内核对象的内存区域属性 (MEM_CAP_* 组合，见 zk_def.h)
+ * @note  例如将任务栈/TCB 放入 CCM: MEM_CAP_FAST (需先用 mem_add_region() 注册该区域)
+ */
+#define ZK_TASK_MEM_CAPS 	MEM_CAP_DEFAULT	// 任务 TCB 与任务栈
+#define ZK_QUEUE_MEM_CAPS 	MEM_CAP_DEFAULT	// 消息队列与消息/流缓冲区的缓冲区
+
+/*----------------------------------------------------------------------------
+ *                          时间管理配置
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief 时间轮 (0=按唤醒时间排序的链表, 1=哈希时间轮)
+ * @note  时间轮插入为 O(1)，每个 Tick 只检查当前槽; 软件定时器使用同样结构的独立时间轮,
+ *        并缓存最近到期时间, 未到期的 Tick 只做一次比较
+ */
+#define ZK_USING_TIME_WHEEL 0
+
+/* 时间轮槽数 (必须为 2 的幂) */
+#define ZK_TIME_WHEEL_SIZE 32
+
+/**
+ * @brief 软件定时器回调的执行位置 (ZK_USING_TIMER)
+ * @note  ZK_TIMER_MODE_ISR: 在 SysTick 中断中直接执行, 回调必须很短且不能阻塞,
+ *                           回调耗时会推迟 Tick 和所有不高于内核优先级的中断
+ *        ZK_TIMER_MODE_TASK: SysTick 只把到期定时器移入待处理链表并唤醒定时器服务任务,
+ *                            回调在该任务中执行, 可以调用会阻塞的内核接口 (需要 ZK_USING_SEMAPHORE)
+ */
+#define ZK_TIMER_MODE_ISR 	1
+#define ZK_TIMER_MODE_TASK 	2
+#define ZK_TIMER_MODE 		ZK_TIMER_MODE_ISR
+
+#define ZK_TIMER_TASK_PRIO 	1		// 定时器服务任务优先级 (数值越小优先级越高)
+#define ZK_TIMER_TASK_STACK_SIZE 512	// 定时器服务任务栈大小 (字节)
+
+/**
+ * @brief 系统工作队列 (ZK_USING_WORKQUEUE)
+ * @note  work_submit*() 的 queue 参数为 ZK_NULL 时使用; 需要其他优先级的工作任务时
+ *        用 workqueue_create() 另建工作队列. 延迟工作 (delayed_work_*) 每项占用一个软件定时器
+ */
+#define ZK_WORKQUEUE_TASK_PRIO 	2		// 系统工作任务优先级 (数值越小优先级越高)
+#define ZK_WORKQUEUE_TASK_STACK_SIZE 768	// 系统工作任务栈大小 (字节)
+
+/**
+ * @brief 协程调度 (ZK_USING_COROUTINE)
+ * @note  协程等待信号量/队列时轮询非阻塞接口, 宿主任务至多每 ZK_CO_POLL_TICKS 个 Tick 重试一次;
+ *        释放方调用 co_sched_wake() 可立即唤醒宿主
+ */
+#define ZK_CO_POLL_TICKS 	1
+
+/**
+ * @brief 钩子订阅数 (ZK_USING_HOOK)
+ * @note  每个事件一条静态订阅链, 按注册顺序依次调用, 调用点内联展开;
+ *        设为 0 时该事件没有订阅链, 内核中的调用点整体编译掉
+ */
+#define ZK_HOOK_IDLE_MAX 			2	// 空闲任务钩子
+#define ZK_HOOK_TASK_SWITCH_MAX 	2	// 任务切换钩子 (PendSV 中调用)
+#define ZK_HOOK_TICK_MAX 			3	// Tick 钩子 (SysTick 中调用)
+#define ZK_HOOK_STACK_OVERFLOW_MAX 	1	// 栈溢出钩子
+#define ZK_HOOK_MALLOC_FAILED_MAX 	1	// 内存分配失败钩子
+#define ZK_HOOK_HEARTBEAT_MISS_MAX 	1	// 心跳截止期错过钩子 (ZK_USING_HEARTBEAT)
+
+/*----------------------------------------------------------------------------
+ *                          运行时统计配置
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief 任务切换时的运行时统计方式
+ *        0 = 关闭, PendSV 不做任何统计
+ *        1 = Tick 计数, PendSV 调用 task_update_runtime_stats() (含任务切换钩子)
+ *        2 = DWT 周期戳, PendSV 内联累加周期数, 查询时再换算
+ *        3 = DWT 周期统计, PendSV 调用 task_update_runtime_stats(): 64 位周期累计、
+ *            单次运行时长最小/最大/平均值, 扣除 zk_isr_enter()/zk_isr_exit() 间的中断时间
+ * @note  0 和 2 不调用任务切换钩子; 2、3 需要内核支持 DWT (Cortex-M3 及以上)
+ */
+#define ZK_TASK_STATS_MODE 1
+
+/**
+ * @brief 临界区时长直方图 (ZK_USING_CRITICAL_STATS)
+ * @note  第 0 桶为 < 2^ZK_CRITICAL_HIST_SHIFT 个周期, 之后每桶上限翻倍, 最后一桶不封顶
+ */
+#define ZK_CRITICAL_HIST_SHIFT 	5
+#define ZK_CRITICAL_HIST_BUCKETS 8
+
+/* 跟踪缓冲区记录数 (必须为 2 的幂, 每条 12 字节), 写满后覆盖最旧的记录 */
+#define ZK_TRACE_BUFFER_RECORDS 256
+
+/*----------------------------------------------------------------------------
+ *                          低功耗配置
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief Tickless 空闲模式 (0=禁用, 1=启用)
+ * @note  空闲任务根据最近的唤醒时间停止周期 Tick 并进入 WFI
+ */
+#define ZK_USING_TICKLESS 0
+
+/* 进入 Tickless 睡眠的最小空闲 Tick 数 (小于该值时保持周期 Tick) */
+#define ZK_TICKLESS_MIN_IDLE_TICKS 2
+
 /*----------------------------------------------------------------------------
  *                          打印输出配置
  *----------------------------------------------------------------------------*/
 /* zk_printf 缓冲区大小 (字节) */
 #define ZK_PRINTF_BUF_SIZE 128
 
+/**
+ * @brief 延迟日志 (ZK_USING_DEFERRED_LOG)
+ * @note  zk_log() 只把格式串指针和参数拷入日志环形缓冲区 (%s 的字符串会被拷贝),
+ *        格式串必须是常量; 缓冲区满时丢弃整条记录并计数, 日志任务输出时报告丢弃条数
+ */
+#define ZK_LOG_RING_SIZE 	1024	// 日志环形缓冲区 (字节, 2 的幂)
+#define ZK_LOG_RECORD_MAX 	64		// 单条记录参数区上限 (字节)
+#define ZK_LOG_TASK_PRIO 	(ZK_MIN_PRIORITY - 1)	// 日志任务优先级, 仅高于空闲任务
+#define ZK_LOG_TASK_STACK_SIZE 768	// 日志任务栈大小 (字节)
+
+/**
+ * @brief 调试输出通道 (zk_putc 与 zk_trace_dump 的输出)
+ * @note  ZK_CONSOLE_UART: USART1 轮询发送, 115200 波特率下每字节阻塞约 87us
+ *        ZK_CONSOLE_ITM: ITM 激励端口经 SWO 引脚 (PB3) 输出, 速率由 CPU 时钟分频得到,
+ *                        需调试器 (ST-Link/J-Link) 以相同波特率开启 SWO 捕获;
+ *                        调试器未使能 ITM 时输出直接丢弃, 不会阻塞
+ */
+#define ZK_CONSOLE_UART 	1
+#define ZK_CONSOLE_ITM 		2
+#define ZK_CONSOLE_BACKEND 	ZK_CONSOLE_UART
+
+/* SWO 波特率 (ZK_CONSOLE_ITM), ZK_CPU_CLOCK_HZ 需为其整数倍 */
+#define ZK_SWO_BAUD_RATE 	2000000UL
+
+/* ITM 激励端口: zk_printf 文本 / 二进制跟踪流 */
+#define ZK_ITM_CONSOLE_PORT 0
+#define ZK_ITM_TRACE_PORT 	1
+
+/**
+ * @brief 异步串口驱动 (ZK_CONSOLE_UART, 0=轮询发送, 1=DMA 发送 + 中断接收)
+ * @note  需要 ZK_USING_RING 和 ZK_USING_SEMAPHORE; main() 在 zk_kernel_init() 之后调用 UART_StartAsync(),
+ *        之后 zk_putc 写入发送缓冲区即返回, 仅在缓冲区满时等待; 接收见 UART_Read()
+ */
+#define ZK_UART_ASYNC 		0
+#define ZK_UART_TX_BUF_SIZE 256	// 发送缓冲区 (字节, 2 的幂)
+#define ZK_UART_RX_BUF_SIZE 64	// 接收缓冲区 (字节, 2 的幂)
+
+/**
+ * @brief 高精度单次定时器 (0=关闭, 1=TIM2 以 1MHz 自由运行, 比较中断触发回调)
+ * @note  main() 在 zk_kernel_init() 之后调用 HRTimer_Init(); hrtimer_start() 的回调在 TIM2
+ *        中断中执行, task_delay_us() 由该中断经信号量唤醒任务. 中断优先级在内核屏蔽范围内,
+ *        触发抖动上限为最长的内核临界区 (见 ZK_USING_CRITICAL_STATS). 需要 ZK_USING_SEMAPHORE
+ */
+#define ZK_USING_HRTIMER 	0
+#define ZK_HRTIMER_MAX_NUM 	4	// 同时等待的高精度定时器 (含 task_delay_us) 数量
+#define ZK_HRTIMER_SPIN_US 	20	// task_delay_us() 短于该值时忙等, 不切换任务
+
+/**
+ * @brief 内存到内存 DMA 拷贝 (0=关闭, 1=DMA1 通道 7, 见 dma_copy / queue_write_dma)
+ * @note  main() 在 zk_kernel_init() 之后调用 DMACopy_Init(); 调用任务在传输期间阻塞于
+ *        完成中断, CPU 和中断都不被占用. 需要 ZK_USING_MUTEX 和 ZK_USING_SEMAPHORE
+ */
+#define ZK_USING_DMA_COPY 	0
+#define ZK_DMA_COPY_MIN 	256	// 短于该字节数时 CPU 拷贝, 比启动 DMA 加两次任务切换更快
+
+/**
+ * @brief STM32F1 深睡模式 (ZK_USING_PM)
+ * @note  main() 在 zk_kernel_init() 之后调用 PM_Init(); STOP 由 RTC 闹钟 (LSE, 1024Hz) 唤醒,
+ *        醒来后按 setup_hardware() 的配置重新锁定 PLL. STANDBY 掉电后以复位唤醒, RAM 丢失,
+ *        只适合无需保持状态的长时间空闲. 门限为 0 时不使用该模式
+ */
+#define ZK_PM_STOP_MIN_TICKS 	10	// 预计空闲不少于该 Tick 数时进入 STOP
+#define ZK_PM_STANDBY_MIN_TICKS 0	// 预计空闲不少于该 Tick 数时进入 STANDBY
+
+/**
+ * @brief 独立看门狗 (0=关闭, 1=IWDG 由心跳监视喂狗, 见 task_heartbeat_register)
+ * @note  main() 在 zk_kernel_init() 之后调用 Watchdog_Init(); 登记的任务错过心跳截止期后停止喂狗,
+ *        超时即复位, Watchdog_CausedReset() 判断本次启动是否由它引起. LSI 偏差可使实际超时缩短
+ *        1/3, ZK_HEARTBEAT_FEED_TICKS 须小于超时的一半. 调试器暂停内核时计数停止. 需要 ZK_USING_HEARTBEAT
+ */
+#define ZK_USING_IWDG 		0
+#define ZK_IWDG_TIMEOUT_MS 	1000	// 看门狗超时 (毫秒, 1 ~ 6553)
+
 /*----------------------------------------------------------------------------
  *                          硬件配置
  *----------------------------------------------------------------------------*/
@@ -45,18 +315,64 @@
  */
 #define ZK_CPU_CLOCK_HZ 72000000UL
 
+/**
+ * @brief 中断优先级划分 (NVIC 优先级字节, 数值越小优先级越高)
+ * @note  临界区把 BASEPRI 设为 ZK_MAX_SYSCALL_INTERRUPT_PRIORITY: 数值不小于它的中断被内核屏蔽,
+ *        可以调用 _from_isr 接口; 数值小于它的中断 (如 PWM 故障保护) 永不被临界区推迟,
+ *        但不能调用任何内核接口, DEBUG_ASSERT 构建中 _from_isr 接口会检查这一点.
+ *        芯片只实现高 ZK_NVIC_PRIO_BITS 位, 取值须为 ZK_NVIC_PRIORITY(抢占优先级), 不能为 0
+ */
+#define ZK_NVIC_PRIO_BITS 					4		// STM32F1 实现 4 位优先级
+#define ZK_KERNEL_INTERRUPT_PRIORITY 		0xF0	// SysTick 和 PendSV, 最低
+#define ZK_MAX_SYSCALL_INTERRUPT_PRIORITY 	0xB0	// 抢占优先级 11 及更低可调用内核
+
 /**
  * @brief 系统 Tick 频率 (Hz)
- * @note  推荐值: 1000 (1ms一次Tick)
+ * @note  推荐值: 1000 (1ms一次Tick). 以 ZK_MS_TO_TICKS() / *_ms 接口书写等待时长的调用点
+ *        不随 Tick 频率修改, 频率只影响定时分辨率、Tick 中断开销和功耗
  */
 #define ZK_TICK_RATE_HZ 1000
 
+/**
+ * @brief 毫秒/微秒换算为 Tick 的舍入方式 (ZK_MS_TO_TICKS / zk_ms_to_ticks 与 *_ms 接口)
+ * @note  ZK_TIME_ROUND_UP: 向上取整, 换算出的 Tick 数不少于请求的时长
+ *        ZK_TIME_ROUND_NEAREST: 四舍五入, 周期任务的平均周期误差最小
+ *        ZK_TIME_ROUND_DOWN: 向下取整, 不足一个 Tick 的非 0 超时变为 0 (不等待);
+ *        task_delay_ms / task_delay_until_ms 换算为 0 时按 1 个 Tick 延时
+ */
+#define ZK_TIME_ROUND_UP 		0
+#define ZK_TIME_ROUND_NEAREST 	1
+#define ZK_TIME_ROUND_DOWN 		2
+#define ZK_TIME_ROUNDING 		ZK_TIME_ROUND_UP
+
 /**
  * @brief 调试串口波特率
  * @note  用于 zk_printf 输出
  */
 #define ZK_UART_BAUD_RATE 115200
 
+/**
+ * @brief 移植层绑定方式 (0=经 g_cpu_ops 函数指针表调用, 1=编译期绑定)
+ * @note  1 时触发 PendSV、进出临界区、中断上下文判断直接内联为几条指令；
+ *        g_cpu_ops 始终保留，可供运行时替换的移植层使用
+ */
+#define ZK_PORT_STATIC 1
+
+/**
+ * @brief CPU 移植层选择
+ * @note  ZK_ARCH_CM3: Cortex-M3 (arch/cm3)
+ *        ZK_ARCH_CM4F: 带 FPU 的 Cortex-M4F/M7 (arch/cm4f)，惰性压栈保存浮点上下文
+ *        ZK_ARCH_POSIX: Linux 主机模拟器 (arch/posix)，由 sim/CMakeLists.txt 以
+ *                       -DZK_CPU_ARCH=ZK_ARCH_POSIX 选择
+ *        工程中需同时把对应 arch 目录的源文件与头文件路径加入编译
+ */
+#define ZK_ARCH_CM3 	1
+#define ZK_ARCH_CM4F 	2
+#define ZK_ARCH_POSIX 	3
+#ifndef ZK_CPU_ARCH
+#define ZK_CPU_ARCH 	ZK_ARCH_CM3
+#endif
+
 /*----------------------------------------------------------------------------
  *                          调试配置
  *----------------------------------------------------------------------------*/
@@ -65,4 +381,7 @@
 #define ZK_SCH_DEBUG 0 // 调度器调试信息
 #define DEBUG_ASSERT 1 // 运行时断言检查
 
+/* 按 ZK_CONFIG_PROFILE 确定最终的功能开关, 并检查开关之间的依赖 */
+#include "zk_feature.h"
+
 #endif /* ZK_CONFIG_H */
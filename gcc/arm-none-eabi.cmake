@@ -0,0 +1,22 @@
+# ZK-RTOS arm-none-eabi 交叉编译工具链描述
+# 用法: cmake -S gcc -B build -DCMAKE_TOOLCHAIN_FILE=gcc/arm-none-eabi.cmake
+# (gcc/CMakeLists.txt 在未指定时默认使用本文件)
+
+set(CMAKE_SYSTEM_NAME Generic)
+set(CMAKE_SYSTEM_PROCESSOR arm)
+
+set(ZK_TOOLCHAIN_PREFIX "arm-none-eabi-" CACHE STRING "GNU Arm toolchain prefix")
+
+set(CMAKE_C_COMPILER   ${ZK_TOOLCHAIN_PREFIX}gcc)
+set(CMAKE_ASM_COMPILER ${ZK_TOOLCHAIN_PREFIX}gcc)
+set(CMAKE_AR           ${ZK_TOOLCHAIN_PREFIX}gcc-ar)
+set(CMAKE_RANLIB       ${ZK_TOOLCHAIN_PREFIX}gcc-ranlib)
+set(CMAKE_OBJCOPY      ${ZK_TOOLCHAIN_PREFIX}objcopy)
+set(CMAKE_SIZE         ${ZK_TOOLCHAIN_PREFIX}size)
+
+# 裸机目标无法链接主机测试程序
+set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
@@ -3,13 +3,13 @@
  * @brief   ZK-RTOS CPU 抽象接口层定义
  * @version 2.0
  * @note    定义所有 CPU 架构必须实现的抽象接口
- *          移植到新架构时,需要在 libcpu/<arch>/ 目录下实现这些接口
+ *          移植到新架构时,需要在 arch/<arch>/ 目录下实现这些接口
  *
  * 命名规范:
- * - 抽象接口: include/zk_cpu.h (本文件)
- * - Cortex-M3实现: libcpu/cm3/zk_cpu_cm3.h/c
- * - Cortex-M4实现: libcpu/cm4/zk_cpu_cm4.h/c
- * - RISC-V实现: libcpu/riscv/zk_cpu_riscv.h/c
+ * - 抽象接口: include/private/zk_cpu.h (本文件)
+ * - Cortex-M3实现: arch/cm3/zk_cpu_cm3.h/c
+ * - Cortex-M4F/M7实现: arch/cm4f/zk_cpu_cm4f.h/c
+ * - RISC-V实现: arch/riscv/zk_cpu_riscv.h/c
  */
 
 #ifndef ZK_CPU_H
@@ -68,6 +68,15 @@ typedef struct zk_cpu_ops
      */
 	zk_uint8 (*is_in_interrupt)(void);
 
+#if ZK_USING_TICKLESS
+	/**
+     * @brief 停止周期 Tick 并睡眠
+     * @param idle_ticks 预计空闲 Tick 数
+     * @note  唤醒后负责补偿睡眠期间流逝的系统时间
+     */
+	void (*tickless_sleep)(zk_uint32 idle_ticks);
+#endif
+
 } zk_cpu_ops_t;
 
 /**
@@ -79,7 +88,11 @@ extern const zk_cpu_ops_t g_cpu_ops;
 /*============================================================================
  *                      便捷宏定义(内核层使用)
  *============================================================================*/
-
+/*
+ * ZK_PORT_STATIC=1 时由移植层头文件(如 zk_cpu_cm3.h)以内联函数或宏直接提供下列接口,
+ * 编译器可将其内联; 否则经 g_cpu_ops 间接调用, 便于运行时替换移植层
+ */
+#if !ZK_PORT_STATIC
 #define zk_cpu_init_systick() g_cpu_ops.init_systick()
 #define zk_cpu_trigger_pendsv() g_cpu_ops.trigger_context_switch()
 #define zk_cpu_enter_critical() g_cpu_ops.enter_critical()
@@ -87,5 +100,9 @@ extern const zk_cpu_ops_t g_cpu_ops;
 #define zk_cpu_start_scheduler() g_cpu_ops.start_scheduler()
 #define zk_cpu_stack_init(top, entry, param) g_cpu_ops.stack_init(top, entry, param)
 #define zk_cpu_is_in_interrupt() g_cpu_ops.is_in_interrupt()
+#if ZK_USING_TICKLESS
+#define zk_cpu_tickless_sleep(ticks) g_cpu_ops.tickless_sleep(ticks)
+#endif
+#endif /* !ZK_PORT_STATIC */
 
 #endif /* ZK_CPU_H */
@@ -27,7 +27,7 @@ void zk_printf(const char *fmt, ...);
 #define ZK_BYTE_ALIGNMENT 8						// Memory alignment: 8 bytes
 
 /* Task system configuration */
-#define ZK_PRIORITY_NUM 32				 // Number of priority levels: 32
+#define ZK_PRIORITY_NUM 32				 // Number of priority levels: 8 to 256
 #define CONFIG_TASK_NAME_LEN 10			 // Maximum task name length
 #define TIMER_TASK_PRIORITY 0			 // Timer task priority (highest)
 #define TIMER_TASK_STACK_SIZE 1024		 // Timer task stack size
@@ -37,10 +37,9 @@ void zk_printf(const char *fmt, ...);
 /* Semaphore configuration */
 #define SEM_COUNT_MAX 0xFFFE // Maximum semaphore count value
 
-/* Interrupt priority configuration */
-#define ZK_KERNEL_INTERRUPT_PRIORITY 255	  // Kernel interrupt priority (lowest)
-#define ZK_MAX_SYSCALL_INTERRUPT_PRIORITY 191 // Maximum syscall priority
-#define ZK_SYSTICK_CLOCK_HZ ZK_CPU_CLOCK_HZ	  // SysTick clock source
+/* Interrupt priorities are configured in zk_config.h; usable in #if as well */
+#define ZK_NVIC_PRIORITY(preempt) ((preempt) << (8 - ZK_NVIC_PRIO_BITS)) // NVIC_PriorityGroup_4
+#define ZK_SYSTICK_CLOCK_HZ ZK_CPU_CLOCK_HZ // SysTick clock source
 
 /* Derived values (calculated automatically by system) */
 #define ZK_MIN_PRIORITY (ZK_PRIORITY_NUM - 1)
@@ -48,10 +47,26 @@ void zk_printf(const char *fmt, ...);
 #define ZK_BYTE_ALIGNMENT_MASK (ZK_BYTE_ALIGNMENT - 1)
 #define IDLE_TASK_PRIO ZK_MIN_PRIORITY
 
+/* Task statistics kept in DWT cycles (ZK_TASK_STATS_MODE 2 and 3) */
+#define ZK_TASK_STATS_CYCLES ((ZK_TASK_STATS_MODE == 2) || (ZK_TASK_STATS_MODE == 3))
+
+/* All-tasks list, walked by the idle stack watch and the task monitor, and searched to validate
+ * task handles */
+#define ZK_USING_TASK_LIST (ZK_USING_STACK_WATCH || ZK_USING_TASK_MONITOR || ZK_USING_HEARTBEAT)
+
+/* Ready bitmap: one word up to 32 priorities, above that a group word over 32-bit words */
+#define ZK_PRIORITY_WORD_BITS 32
+#if (ZK_PRIORITY_NUM > ZK_PRIORITY_WORD_BITS)
+#define ZK_PRIORITY_TWO_LEVEL 1
+#define ZK_PRIORITY_GROUP_NUM (ZK_PRIORITY_NUM / ZK_PRIORITY_WORD_BITS)
+#else
+#define ZK_PRIORITY_TWO_LEVEL 0
+#endif
+
 /* Compile-time parameter validation */
 #if (ZK_PRIORITY_NUM != 8) && (ZK_PRIORITY_NUM != 16) && (ZK_PRIORITY_NUM != 32) &&                \
-	(ZK_PRIORITY_NUM != 64)
-#error "ZK_PRIORITY_NUM must be 8, 16, 32, or 64"
+	(ZK_PRIORITY_NUM != 64) && (ZK_PRIORITY_NUM != 128) && (ZK_PRIORITY_NUM != 256)
+#error "ZK_PRIORITY_NUM must be 8, 16, 32, 64, 128 or 256"
 #endif
 
 #if (ZK_BYTE_ALIGNMENT != 4) && (ZK_BYTE_ALIGNMENT != 8)
@@ -62,10 +77,25 @@ void zk_printf(const char *fmt, ...);
 #error "CONFIG_TASK_NAME_LEN must be between 4 and 32"
 #endif
 
+#if ZK_USING_EDF && (ZK_EDF_PRIORITY >= ZK_MIN_PRIORITY)
+#error "ZK_EDF_PRIORITY must be above the idle priority"
+#endif
+
+#if ZK_USING_BUDGET && (ZK_BUDGET_BACKGROUND_PRIORITY > ZK_MIN_PRIORITY)
+#error "ZK_BUDGET_BACKGROUND_PRIORITY must be a valid priority"
+#endif
+
+#if ZK_USING_TIME_WHEEL
+#if (ZK_TIME_WHEEL_SIZE < 2) || ((ZK_TIME_WHEEL_SIZE & (ZK_TIME_WHEEL_SIZE - 1)) != 0)
+#error "ZK_TIME_WHEEL_SIZE must be a power of two"
+#endif
+#endif
+
 /* ==================== Basic type definitions ==================== */
 typedef unsigned char zk_uint8;
 typedef unsigned short zk_uint16;
 typedef unsigned int zk_uint32;
+typedef unsigned long long zk_uint64;
 typedef signed char zk_int8;
 typedef signed short zk_int16;
 typedef signed int zk_int32;
@@ -97,6 +127,16 @@ typedef enum
 #define TASK_MAGIC_NUMBER ZK_TASK_MAGIC_NUMBER	   /* Backward compatibility */
 #define TASK_STACK_BOUNDARY ZK_TASK_STACK_BOUNDARY /* Backward compatibility */
 
+/* Bytes at stack_base that may hold the MPU guard band, skipped by stack scans */
+#if ZK_USING_MPU_STACK_GUARD
+#if (ZK_MPU_GUARD_SIZE < 32) || ((ZK_MPU_GUARD_SIZE & (ZK_MPU_GUARD_SIZE - 1)) != 0)
+#error "ZK_MPU_GUARD_SIZE must be a power of two of at least 32"
+#endif
+#define ZK_STACK_GUARD_BYTES (2 * ZK_MPU_GUARD_SIZE)
+#else
+#define ZK_STACK_GUARD_BYTES 0
+#endif
+
 /* Bit operation constants */
 #define ZK_BIT_MASK_0 0x01
 
@@ -115,6 +155,19 @@ typedef struct zk_list_node
 #define ZK_LIST_GET_OWNER(ptr, type, member) ZK_GET_STRUCT(ptr, type, member)
 #define ZK_LIST_GET_FIRST_ENTRY(ptr, type, member) ZK_LIST_GET_OWNER((ptr)->next, type, member)
 #define ZK_LIST_FOR_EACH_NODE(pos, head) for (pos = (head)->next; pos != (head); pos = pos->next)
+#define ZK_LIST_FOR_EACH_NODE_SAFE(pos, n, head)                                                   \
+	for (pos = (head)->next, n = pos->next; pos != (head); pos = n, n = pos->next)
+
+/* ==================== Time wheel structure definition ==================== */
+#if ZK_USING_TIME_WHEEL
+#define ZK_TIME_WHEEL_MASK (ZK_TIME_WHEEL_SIZE - 1)
+
+typedef struct zk_time_wheel
+{
+	zk_list_node_t slots[ZK_TIME_WHEEL_SIZE]; // Hash slots, indexed by (expire time & mask)
+	zk_uint32 processed_time;				  // Latest time whose slot has been processed
+} zk_time_wheel_t;
+#endif
 
 
 /* ==================== Error code definitions ==================== */
@@ -160,6 +213,34 @@ typedef enum
 } zk_error_code_t;
 
 
+/* ==================== Object handle structures ==================== */
+/*
+ * IPC handles carry the pool index in bits 0-15 and the slot generation in bits 16-30; bit 31
+ * stays clear for QUEUE_SET_MEMBER_SEM. Destroying an object bumps the generation of its slot,
+ * so a stale handle no longer matches once the slot is reused.
+ */
+#define ZK_HANDLE_INDEX_BITS 16
+#define ZK_HANDLE_INDEX_MASK 0xFFFFUL
+#define ZK_HANDLE_GEN_MASK 0x7FFFUL
+#define ZK_HANDLE_RESERVED 0x80000000UL // Never set in a handle
+#define ZK_HANDLE_FREE_END 0xFFFF		 // Empty free-index stack, pools hold fewer slots
+#define ZK_HANDLE_INDEX(handle) ((zk_uint32) (handle) & ZK_HANDLE_INDEX_MASK)
+#define ZK_HANDLE_GEN(handle) (((zk_uint32) (handle) >> ZK_HANDLE_INDEX_BITS) & ZK_HANDLE_GEN_MASK)
+
+typedef struct zk_handle_pool
+{
+	zk_uint16 free_top;	   // Index on top of the free stack, ZK_HANDLE_FREE_END when exhausted
+	zk_uint16 capacity;	   // Slots in the pool
+	zk_uint16 *free_next;  // free_next[i]: index below i on the free stack
+	zk_uint16 *generation; // Current generation of each slot
+} zk_handle_pool_t;
+
+/* Storage and descriptor of the handle pool of an object pool with num slots */
+#define ZK_HANDLE_POOL_DEFINE(name, num)                                                           \
+	static zk_uint16 name##_free_next[num];                                                        \
+	static zk_uint16 name##_generation[num];                                                       \
+	static zk_handle_pool_t name = {ZK_HANDLE_FREE_END, (num), name##_free_next, name##_generation}
+
 /* ==================== Task-related structures ==================== */
 typedef void (*task_function_t)(void *private_data);
 
@@ -170,37 +251,274 @@ typedef enum task_state
 	TASK_SUSPEND,
 	TASK_ENDLESS_BLOCKED,
 	TASK_TIMEOUT_BLOCKED,
-	TASK_UNKNOWN
+	TASK_UNKNOWN,
+	TASK_DELETED // Waiting for the idle task to free its memory
 } task_state_t;
 
+#if ZK_USING_TASK_NOTIFY
+typedef enum task_notify_state
+{
+	TASK_NOTIFY_NONE = 0, // No notification pending
+	TASK_NOTIFY_WAITING,  // Task blocked in task_notify_wait()
+	TASK_NOTIFY_PENDING	  // Notification delivered, not consumed yet
+} task_notify_state_t;
+
+typedef enum task_notify_action
+{
+	TASK_NOTIFY_NO_ACTION = 0,	 // Only signal, value unchanged
+	TASK_NOTIFY_SET_BITS,		 // value |= arg
+	TASK_NOTIFY_INCREMENT,		 // value++ (arg ignored)
+	TASK_NOTIFY_OVERWRITE,		 // value = arg
+	TASK_NOTIFY_NO_OVERWRITE	 // value = arg unless a notification is still pending
+} task_notify_action_t;
+#endif
+
 
 typedef struct task_control_block
 {
 	void *stack;
+#if ZK_TASK_STATS_CYCLES
+	/* Mode 2 accumulates these in PendSV assembly, they must stay at offsets 4 and 8 */
+	zk_uint32 switch_in_cycles; /* DWT_CYCCNT when the task was last switched in */
+	zk_uint64 run_cycles;		/* Cycles spent running, before the current burst */
+#endif
+#if (ZK_TASK_STATS_MODE == 3)
+	zk_uint32 switch_in_isr_cycles; /* Low word of the ISR cycle total at switch-in */
+	zk_uint32 burst_count;			/* Completed run bursts */
+	zk_uint32 burst_min;			/* Shortest burst (cycles, ISR time excluded) */
+	zk_uint32 burst_max;			/* Longest burst (cycles, ISR time excluded) */
+#endif
+
+	/* Hot: read or written by every scheduling decision, switch and wakeup */
 	zk_list_node_t state_node;
+	task_state_t state;
+	zk_uint32 wake_up_time;
+	zk_uint32 time_slice_left;	   /* Ticks left of the quantum, kept while preempted */
+	zk_uint32 time_slice;		   /* Round-robin quantum in ticks */
+	zk_uint32 last_switch_in_time; /* Last switch-in timestamp (for delta calculation) */
+#if ZK_USING_TIME64
+	zk_uint64 run_time_ticks; /* Task cumulative runtime (tick), does not wrap */
+#else
+	zk_uint32 run_time_ticks; /* Task cumulative runtime (tick), charged on switch-out */
+#endif
 	zk_uint8 priority;
 	zk_uint8 base_priority;
-	zk_uint8 *task_name[CONFIG_TASK_NAME_LEN];
-	task_state_t state;
-	zk_list_node_t event_sleep_list; // Event wait queue node
 	zk_uint8 event_timeout_wakeup;
-	zk_uint32 wake_up_time;
+	zk_uint8 static_alloc; /* TCB and stack provided by the caller (task_create_static) */
+	zk_list_node_t event_sleep_list; // Event wait queue node
+#if ZK_USING_WAIT_INDEX
+	struct zk_wait_index *wait_index; // Index of the sleep list, ZK_NULL for a plain sorted list
+	zk_uint8 wait_priority;			  // Priority the index files the waiter under
+#endif
+#if ZK_USING_MPU_STACK_GUARD
+	void *stack_base; /* Stack base address, the guard region moves above it on switch-in */
+#endif
 
-	/* P1: Stack overflow detection */
-	void *stack_base;	  /* Stack base address (for overflow detection) */
-	zk_uint32 stack_size; /* Stack size (bytes) */
+#if ZK_USING_EVENT
+	/* Event group wait condition */
+	zk_uint32 event_wait_mask; /* Flags the task waits for */
+	zk_uint32 event_result;	   /* Flags at the time the condition was met */
+	zk_uint8 event_wait_mode;  /* event_wait_mode_t | EVENT_CLEAR_ON_EXIT */
+#endif
 
-	/* P1: Task runtime statistics */
-	zk_uint32 run_time_ticks;	   /* Task cumulative runtime (tick) */
-	zk_uint32 last_switch_in_time; /* Last switch-in timestamp (for delta calculation) */
+#if ZK_USING_TASK_NOTIFY
+	/* Direct-to-task notification */
+	zk_uint32 notify_value; /* Notification word */
+	zk_uint8 notify_state;	/* task_notify_state_t */
+#endif
 
-#ifdef ZK_USING_MUTEX
+#if ZK_USING_MUTEX
 	/* P1: Priority inheritance chain propagation */
 	struct mutex *holding_mutex; /* Currently held mutex (for chain propagation) */
 #endif
+
+#if ZK_USING_QUEUE
+	/* Element offered while blocked on a queue, the peer copies it and clears the pointer */
+	void *queue_transfer;		   /* Reader: destination, writer: source, ZK_NULL if none */
+	zk_uint32 queue_transfer_size; /* Bytes at queue_transfer */
+#endif
+
+#if ZK_USING_EDF
+	/* Earliest-deadline-first class, only used while edf_period != 0 */
+	zk_uint32 edf_period;			 /* Job release period (ticks) */
+	zk_uint32 edf_relative_deadline; /* Deadline of a job relative to its release (ticks) */
+	zk_uint32 edf_release;			 /* Release time of the current job */
+	zk_uint32 edf_deadline;			 /* Absolute deadline of the current job, ready list key */
+	zk_uint32 edf_jobs;				 /* Completed jobs */
+	zk_uint32 edf_misses;			 /* Jobs completed after their deadline */
+#endif
+
+#if ZK_USING_BUDGET
+	/* Execution budget, only enforced while budget != 0 */
+	zk_uint32 budget;				 /* Ticks the task may run per replenishment period */
+	zk_uint32 budget_period;		 /* Replenishment period (ticks) */
+	zk_uint32 budget_left;			 /* Ticks left in the current period */
+	zk_uint32 budget_replenish_time; /* End of the current period */
+	zk_uint32 budget_overruns;		 /* Periods in which the budget ran out */
+	zk_list_node_t budget_node;		 /* Scheduler budget_list node while demoted */
+	zk_uint8 budget_priority;		 /* Base priority to restore on replenishment */
+	zk_uint8 budget_demoted;		 /* Running at ZK_BUDGET_BACKGROUND_PRIORITY */
+#endif
+
+#if ZK_USING_PREEMPT_THRESHOLD
+	/* Only priorities numerically below the threshold preempt the running task */
+	zk_uint8 preempt_threshold;	   /* base_priority when no threshold is set */
+	zk_list_node_t threshold_node; /* Scheduler preempted_list node while preempted */
+#endif
+
+	/* Cold: stack bookkeeping and debug data, off the scheduling paths */
+#if !ZK_USING_MPU_STACK_GUARD
+	void *stack_base; /* Stack base address (for overflow detection) */
+#endif
+	zk_uint32 stack_size;	/* Stack size (bytes) */
+	zk_uint32 stack_unused; /* Bytes above stack_base seen untouched so far, only shrinks */
+#if ZK_USING_TASK_LIST
+	zk_list_node_t task_node; /* All-tasks list node, until task_delete() */
+#endif
+#if ZK_USING_TASK_MONITOR
+	zk_list_node_t *wait_list;	/* Sleep list of the object the task last blocked on */
+	zk_uint64 monitor_run_time; /* Run time at the previous task_monitor_snapshot() */
+#endif
+#if ZK_USING_ARENA
+	struct zk_arena *arena; /* Default arena of task_arena_alloc(), not owned by the task */
+#endif
+#if ZK_USING_HEARTBEAT
+	/* Check-in deadline, only monitored while heartbeat_period != 0 */
+	zk_uint32 heartbeat_period;	   /* Longest allowed time between two check-ins (ticks) */
+	zk_uint32 heartbeat_deadline;  /* Latest time of the next check-in */
+	zk_list_node_t heartbeat_node; /* Monitor list node, sorted by deadline unless missed */
+	zk_uint8 heartbeat_missed;	   /* Deadline passed, the watchdog is starved */
+#endif
+	zk_uint8 task_name[CONFIG_TASK_NAME_LEN];
 } task_control_block_t;
 
 
+#if ZK_TASK_STATS_CYCLES
+typedef struct task_cycle_stats
+{
+	zk_uint64 run_cycles;  // Cycles the task has run, burst in progress included
+	zk_uint32 burst_count; // Completed run bursts (mode 3 only)
+	zk_uint32 burst_min;   // Shortest burst in cycles (mode 3 only)
+	zk_uint32 burst_max;   // Longest burst in cycles (mode 3 only)
+	zk_uint32 burst_avg;   // Average burst in cycles (mode 3 only)
+} task_cycle_stats_t;
+#endif
+
+#if ZK_USING_STACK_WATCH
+typedef struct task_stack_stats
+{
+	zk_uint32 task_handle; // Task the entry belongs to
+	zk_uint32 stack_size;  // Stack size in bytes
+	zk_uint32 stack_peak;  // Deepest stack use seen by the idle watch, in bytes
+} task_stack_stats_t;
+#endif
+
+#if ZK_USING_TASK_MONITOR
+typedef struct task_monitor_info
+{
+	zk_uint32 task_handle;				 // Task the entry belongs to
+	zk_uint8 name[CONFIG_TASK_NAME_LEN]; // Task name
+	zk_uint8 state;						 // task_state_t
+	zk_uint8 priority;					 // Running priority, inheritance included
+	zk_uint8 base_priority;				 // Assigned priority
+	zk_uint16 cpu_usage;				 // CPU share since the previous snapshot (percent * 100)
+	zk_uint32 stack_size;				 // Stack size in bytes
+	zk_uint32 stack_peak;				 // Deepest stack use measured so far, in bytes
+	zk_uint32 wait_object;				 // Sleep list inside the IPC object while blocked, else 0
+} task_monitor_info_t;
+#endif
+
+#if ZK_USING_EDF
+typedef struct task_edf_stats
+{
+	zk_uint32 period;	// Release period in ticks
+	zk_uint32 deadline; // Relative deadline in ticks
+	zk_uint32 jobs;		// Completed jobs
+	zk_uint32 misses;	// Jobs completed after their absolute deadline
+} task_edf_stats_t;
+#endif
+
+#if ZK_USING_CRITICAL_STATS
+/* Subsystem a critical section is charged to (the file that opened the outermost one) */
+typedef enum
+{
+	ZK_CRITICAL_SUBSYS_OTHER = 0, // sem, mutex, event, rwlock, hook, port
+	ZK_CRITICAL_SUBSYS_MEM,		  // zk_mem.c, zk_mem_tlsf.c
+	ZK_CRITICAL_SUBSYS_QUEUE,	  // zk_queue.c, zk_mpmc.c
+	ZK_CRITICAL_SUBSYS_SCHED,	  // zk_scheduler.c, zk_task.c, zk_heartbeat.c (SysTick included)
+	ZK_CRITICAL_SUBSYS_TIMER,	  // zk_timer.c
+	ZK_CRITICAL_SUBSYS_NUM,
+} zk_critical_subsys_t;
+
+typedef struct zk_critical_stats
+{
+	zk_uint32 count;		// Outermost critical sections measured
+	zk_uint32 max_cycles;	// Longest masked duration
+	zk_uint32 max_site;		// Return address of the ZK_ENTER_CRITICAL() that opened it
+	zk_uint64 total_cycles; // Sum of all measured durations
+	zk_uint32 histogram[ZK_CRITICAL_HIST_BUCKETS];
+} zk_critical_stats_t;
+#endif
+
+#if ZK_USING_TRACE
+/* Trace event ids, see docs/二进制跟踪格式.md; 0x80-0xFF are free for the application */
+typedef enum
+{
+	ZK_TRACE_EV_SWITCH = 0x01,		 // object: next TCB, arg: its priority
+	ZK_TRACE_EV_READY = 0x02,		 // object: TCB, arg: state it left
+	ZK_TRACE_EV_BLOCK = 0x03,		 // object: TCB, arg: block_type_t
+	ZK_TRACE_EV_DELAY = 0x04,		 // object: TCB, arg: wake-up tick
+	ZK_TRACE_EV_SUSPEND = 0x05,		 // object: TCB
+	ZK_TRACE_EV_TICK = 0x06,		 // arg: tick count
+	ZK_TRACE_EV_SEM_GET = 0x10,		 // object: handle, arg: timeout
+	ZK_TRACE_EV_SEM_RELEASE = 0x11,	 // object: handle, arg: 1 from ISR
+	ZK_TRACE_EV_QUEUE_WRITE = 0x20,	 // object: handle, arg: size, bit 16 set from ISR
+	ZK_TRACE_EV_QUEUE_READ = 0x21,	 // object: handle, arg: size, bit 16 set from ISR
+	ZK_TRACE_EV_MUTEX_LOCK = 0x30,	 // object: handle, arg: timeout
+	ZK_TRACE_EV_MUTEX_UNLOCK = 0x31, // object: handle
+	ZK_TRACE_EV_ISR_ENTER = 0x40,	 // arg: IRQ number
+	ZK_TRACE_EV_ISR_EXIT = 0x41,	 // arg: IRQ number
+	ZK_TRACE_EV_USER = 0x80,
+} zk_trace_event_t;
+
+/* Argument of the ISR variants of the IPC events */
+#define ZK_TRACE_ARG_FROM_ISR 1
+
+/* 12-byte record, little endian; info = event | (arg << 8), arg keeps its low 24 bits */
+typedef struct zk_trace_record
+{
+	zk_uint32 stamp;  // Cycle counter
+	zk_uint32 info;	  // Event id (bits 0-7) and argument (bits 8-31)
+	zk_uint32 object; // TCB address or IPC handle
+} zk_trace_record_t;
+#endif
+
+#if ZK_USING_PERF_COUNTERS
+#define ZK_PERF_COUNTERS_MAGIC 0x43504B5AUL // "ZKPC" in memory
+#define ZK_PERF_COUNTERS_VERSION 1U
+
+/* Live kernel counters at the symbol g_zk_perf_counters. Every field is a word the kernel
+ * updates with plain stores, so a debugger or telemetry reader needs no lock and never sees a
+ * torn value; new fields are only appended, each append bumps version. The PendSV handlers
+ * address context_switches at offset 8. */
+typedef struct zk_perf_counters
+{
+	zk_uint32 magic;			   // ZK_PERF_COUNTERS_MAGIC
+	zk_uint16 version;			   // ZK_PERF_COUNTERS_VERSION
+	zk_uint16 size;				   // sizeof(zk_perf_counters_t)
+	zk_uint32 context_switches;	   // PendSV runs
+	zk_uint32 ticks;			   // Ticks processed, pended and tickless ones included
+	zk_uint32 wakeups;			   // Tasks made ready from delay or block
+	zk_uint32 ipc_blocks;		   // Tasks blocked on a kernel object
+	zk_uint32 ipc_timeouts;		   // Blocks ended by their timeout
+	zk_uint32 critical_max_cycles; // Longest outermost critical section (ZK_USING_CRITICAL_STATS)
+	zk_uint32 alloc_count;		   // Heap allocation calls
+	zk_uint32 alloc_failures;	   // Heap allocation calls that returned ZK_NULL
+	zk_uint32 alloc_last_cycles;   // Duration of the latest heap allocation
+	zk_uint32 alloc_max_cycles;	   // Longest heap allocation
+} zk_perf_counters_t;
+#endif
+
 typedef struct task_init_parameter
 {
 	task_function_t task_entry;
@@ -208,10 +526,22 @@ typedef struct task_init_parameter
 	zk_uint8 name[CONFIG_TASK_NAME_LEN];
 	zk_uint32 stack_size;
 	void *private_data;
+	zk_uint32 time_slice; // Round-robin quantum in ticks, 0 for SCHEDULE_TIME_SLICE_INIT_VALUE
+#if ZK_USING_EDF
+	zk_uint32 edf_period;	// EDF release period in ticks, non-zero: task runs at ZK_EDF_PRIORITY
+	zk_uint32 edf_deadline; // EDF relative deadline in ticks, 0 for the period
+#endif
+#if ZK_USING_BUDGET
+	zk_uint32 budget;		 // Ticks of execution per budget_period, 0 for no limit
+	zk_uint32 budget_period; // Budget replenishment period in ticks
+#endif
+#if ZK_USING_PREEMPT_THRESHOLD
+	zk_uint8 preempt_threshold; // Preemption threshold, 0 for none (the task priority)
+#endif
 } task_init_parameter_t;
 
 /* ==================== Timer structures ==================== */
-#ifdef ZK_USING_TIMER
+#if ZK_USING_TIMER
 /* Timer callback function type definition */
 typedef void (*timer_handler_t)(void *param);
 
@@ -224,7 +554,9 @@ typedef enum timer_mode
 typedef enum timer_status
 {
 	TIMER_STOP = 0, /* Timer stopped */
-	TIMER_RUNNING	/* Timer running */
+	TIMER_RUNNING,	/* Timer running, linked in the running timers */
+	TIMER_EXPIRED,	/* Timer expired, linked in an expired list until its callback runs */
+	TIMER_FIRING	/* Callback running, the timer is not linked in any list */
 } timer_status_t;
 
 typedef struct timer
@@ -237,17 +569,31 @@ typedef struct timer
 	zk_uint32 wake_up_time;	 /* Next wake-up time */
 	zk_uint8 is_used;		 /* Timer resource usage status */
 	void *param;			 /* Parameter passed to callback function */
+#if ZK_USING_SLACK
+	zk_uint32 slack;	/* Tolerated lateness in ticks, 0 for an exact expiry */
+	zk_uint32 due_time; /* Expiry before the slack was applied, auto-reload counts from it */
+#endif
 } timer_t;
 
 typedef struct timer_manager
 {
+#if ZK_USING_TIME_WHEEL
+	zk_time_wheel_t timers_wheel; /* Running timers hashed by wake-up time (O(1) insert) */
+#else
 	zk_list_node_t
 		timers_list; /* Timer list, sorted by timeout in ascending order (head is nearest timeout) */
+#endif
+	zk_uint32 next_expiry;	   /* Nearest wake-up time of the running timers, never later */
+	zk_bool next_expiry_valid; /* ZK_FALSE while no timer is running */
+#if (ZK_TIMER_MODE == ZK_TIMER_MODE_TASK)
+	zk_list_node_t expired_list; /* Expired timers waiting for the timer service task */
+	zk_uint32 wakeup_sem;		 /* Semaphore the service task sleeps on */
+#endif
 } timer_manager_t;
 #endif
 
 /* ==================== Semaphore structures ==================== */
-#ifdef ZK_USING_SEMAPHORE
+#if ZK_USING_SEMAPHORE
 typedef enum sem_status
 {
 	SEM_UNUSED = 0,
@@ -258,12 +604,39 @@ typedef struct semaphore
 {
 	zk_list_node_t wait_list; // Task list waiting for this semaphore
 	zk_uint32 count;		  // Semaphore count value
-	zk_uint8 is_used;		  // Whether semaphore is in use
+#if ZK_USING_QUEUE_SET
+	zk_uint32 queue_set; // Queue set posted to on every release, QUEUE_SET_NONE if none
+#endif
+	zk_uint8 is_used; // Whether semaphore is in use
 } semaphore_t;
 #endif
 
+/* ==================== Event group structures ==================== */
+#if ZK_USING_EVENT
+typedef enum event_status
+{
+	EVENT_UNUSED = 0,
+	EVENT_USED
+} event_status_t;
+
+typedef enum event_wait_mode
+{
+	EVENT_WAIT_ANY = 0, // Wake when any bit of the mask is set
+	EVENT_WAIT_ALL		// Wake when all bits of the mask are set
+} event_wait_mode_t;
+
+#define EVENT_CLEAR_ON_EXIT 0x80 // Internal flag in tcb->event_wait_mode
+
+typedef struct event_group
+{
+	zk_list_node_t wait_list; // Tasks waiting on this group, priority sorted
+	zk_uint32 flags;		  // Current event flags
+	zk_uint8 is_used;		  // Whether event group is in use
+} event_group_t;
+#endif
+
 /* ==================== Mutex structures ==================== */
-#ifdef ZK_USING_MUTEX
+#if ZK_USING_MUTEX
 typedef enum mutex_status
 {
 	MUTEX_UNUSED = 0,
@@ -272,29 +645,63 @@ typedef enum mutex_status
 
 typedef struct mutex
 {
-	zk_list_node_t sleep_list;	 // Task list blocked on this mutex
-	task_control_block_t *owner; // Task currently holding the mutex
-	zk_uint32 owner_hold_count;	 // Hold count (supports recursive locking)
-	zk_uint8 owner_priority;	 // Owner priority (for priority inheritance)
-	zk_uint8 is_used;			 // Whether mutex is in use
+	zk_list_node_t sleep_list;			  // Task list blocked on this mutex
+	task_control_block_t *volatile owner; // Task currently holding the mutex (claimed by STREX)
+	zk_uint32 owner_hold_count;			  // Hold count, 0 while held through the fast path
+	zk_uint8 owner_priority;			  // Owner priority (for priority inheritance)
+	zk_uint8 is_used;					  // Whether mutex is in use
+#if ZK_USING_MUTEX_CEILING
+	zk_uint8 ceiling_priority; // Immediate ceiling, MUTEX_NO_CEILING for priority inheritance
+#endif
 
 	/* P1: Chain priority inheritance */
 	struct mutex *next_mutex; // Next mutex that owner is waiting for (for chain propagation)
 } mutex_t;
 
-#define MUTEX_HANDLE_TO_POINTER(handle) (&g_mutex_pool[handle])
+#define MUTEX_NO_CEILING 0xFF
+
+#if ZK_USING_MUTEX_CEILING
+#define MUTEX_HAS_CEILING(mutex) ((mutex)->ceiling_priority != MUTEX_NO_CEILING)
+#else
+#define MUTEX_HAS_CEILING(mutex) ZK_FALSE
+#endif
+
+#define MUTEX_HANDLE_TO_POINTER(handle) (&g_mutex_pool[ZK_HANDLE_INDEX(handle)])
 #define CHECK_MUTEX_HANDLE_VALID(handle)                                                           \
-	if (handle >= MUTEX_MAX_NUM)                                                                   \
+	if (!zk_handle_is_valid(&g_mutex_handles, handle))                                             \
 	return ZK_ERR_INVALID_HANDLE
 
 #define CHECK_MUTEX_CREATED(handle)                                                                \
-	if (g_mutex_pool[handle].is_used == MUTEX_UNUSED)                                              \
+	if (MUTEX_HANDLE_TO_POINTER(handle)->is_used == MUTEX_UNUSED)                                  \
 	return ZK_ERR_STATE
 
 #endif
 
+/* ==================== Reader-writer lock structures ==================== */
+#if ZK_USING_RWLOCK
+typedef enum rwlock_status
+{
+	RWLOCK_UNUSED = 0,
+	RWLOCK_USED
+} rwlock_status_t;
+
+/* rwlock_t.state layout, updated with LDREX/STREX by the read fast path */
+#define RWLOCK_STATE_WRITER 0x80000000UL		 // A writer holds the lock
+#define RWLOCK_STATE_WRITER_WAITING 0x40000000UL // A writer is queued, new readers must block
+#define RWLOCK_STATE_READER_MASK 0x3FFFFFFFUL	 // Number of readers holding the lock
+
+typedef struct rwlock
+{
+	zk_list_node_t reader_wait_list; // Readers blocked on this lock, priority sorted
+	zk_list_node_t writer_wait_list; // Writers blocked on this lock, priority sorted
+	task_control_block_t *writer;	 // Task holding the write lock
+	volatile zk_uint32 state;		 // RWLOCK_STATE_* flags | reader count
+	zk_uint8 is_used;				 // Whether rwlock is in use
+} rwlock_t;
+#endif
+
 /* ==================== Message queue structures ==================== */
-#ifdef ZK_USING_QUEUE
+#if ZK_USING_QUEUE
 typedef enum queue_state
 {
 	QUEUE_UNUSED = 0,
@@ -310,31 +717,283 @@ typedef struct queue
 	zk_uint32 write_pos;			  // Current write position index
 	zk_uint32 element_single_size;	  // Size of single element (bytes)
 	zk_uint32 element_num;			  // Number of elements queue can store
+	zk_uint32 element_count;		  // Number of stored elements (including a peeked one)
+	zk_uint8 write_reserved;		  // Slot at write_pos handed out by queue_reserve()
+	zk_uint8 read_reserved;			  // Slot at read_pos handed out by queue_peek()
+	zk_uint8 static_buffer;			  // data_buffer provided by the caller, not freed on destroy
 	zk_uint8 is_used;				  // Queue usage status flag
+#if ZK_USING_QUEUE_SET
+	zk_uint32 queue_set; // Queue set posted to on every write, QUEUE_SET_NONE if none
+#endif
 } queue_t;
 
-#define QUEUE_HANDLE_TO_POINTER(handle) (&g_queue_pool[handle])
+#if ZK_USING_QUEUE_SET
+/* A queue set is a queue of member ids; semaphores are told apart from queues by bit 31 */
+#define QUEUE_SET_NONE 0xFFFFFFFFUL
+#define QUEUE_SET_SEM_FLAG 0x80000000UL
+#define QUEUE_SET_MEMBER_QUEUE(queue_handle) ((zk_uint32) (queue_handle))
+#define QUEUE_SET_MEMBER_SEM(sem_handle) (QUEUE_SET_SEM_FLAG | (zk_uint32) (sem_handle))
+#define QUEUE_SET_MEMBER_IS_SEM(member) (((member) & QUEUE_SET_SEM_FLAG) != 0)
+#define QUEUE_SET_MEMBER_HANDLE(member) ((member) & ~QUEUE_SET_SEM_FLAG)
+#endif
+
+#define QUEUE_HANDLE_TO_POINTER(handle) (&g_queue_pool[ZK_HANDLE_INDEX(handle)])
 #define QUEUE_INDEX_TO_BUFFERADDR(queue_p, index)                                                  \
 	(((zk_uint8 *) queue_p->data_buffer) + (queue_p->element_single_size * index))
 
 #define QUEUE_CHECK_HANDLE_VALID(handle)                                                           \
-	if (handle > QUEUE_MAX_NUM)                                                                    \
+	if (!zk_handle_is_valid(&g_queue_handles, handle))                                             \
 	return ZK_ERR_INVALID_HANDLE
 
 #define QUEUE_CHECK_HANDLE_CREATED(handle)                                                         \
-	if (g_queue_pool[handle].is_used == QUEUE_UNUSED)                                              \
+	if (QUEUE_HANDLE_TO_POINTER(handle)->is_used == QUEUE_UNUSED)                                  \
 	return ZK_ERR_STATE
 
 #endif
 
+/* ==================== Message / stream buffer structures ==================== */
+#if ZK_USING_MSGBUF
+typedef enum msgbuf_status
+{
+	MSGBUF_UNUSED = 0,
+	MSGBUF_USED
+} msgbuf_status_t;
+
+typedef enum msgbuf_mode
+{
+	MSGBUF_MODE_MESSAGE = 0, // Length-prefixed records, read and written whole
+	MSGBUF_MODE_STREAM		 // Raw bytes, reader wakes at trigger_level
+} msgbuf_mode_t;
+
+#define MSGBUF_LENGTH_BYTES 2 // Length prefix of every record in message mode
+
+typedef struct msgbuf
+{
+	zk_uint8 *data_buffer;			  // Byte ring storage
+	zk_list_node_t reader_sleep_list; // Read-blocked task list
+	zk_list_node_t writer_sleep_list; // Write-blocked task list
+	zk_uint32 size;					  // Ring size in bytes
+	zk_uint32 used;					  // Stored bytes, length prefixes included
+	zk_uint32 read_pos;				  // Offset of the oldest byte
+	zk_uint32 write_pos;			  // Offset of the next free byte
+	zk_uint32 trigger_level;		  // Stream mode: bytes needed to wake a reader
+	zk_uint8 mode;					  // msgbuf_mode_t
+	zk_uint8 static_buffer;			  // data_buffer provided by the caller, not freed on destroy
+	zk_uint8 is_used;				  // Whether the object is in use
+} msgbuf_t;
+#endif
+
+/* ==================== SPSC ring buffer structures ==================== */
+#if ZK_USING_RING
+#define ZK_RING_NO_NOTIFY 0xFFFFFFFFUL // No notify semaphore bound
+
+/**
+ * @brief Single-producer/single-consumer byte ring, storage owned by the caller
+ * @note  head is only written by the producer and tail only by the consumer, so the data
+ *        path needs ordering barriers but no critical section
+ */
+typedef struct zk_ring
+{
+	zk_uint8 *buffer;					// Ring storage (capacity bytes)
+	zk_uint32 mask;						// capacity - 1, capacity is a power of two
+	volatile zk_uint32 head;			// Free-running write index (producer owned)
+	volatile zk_uint32 tail;			// Free-running read index (consumer owned)
+	volatile zk_uint8 consumer_waiting; // Consumer is about to block on notify_sem
+	zk_uint32 notify_sem;				// Semaphore posted when data arrives, or ZK_RING_NO_NOTIFY
+} zk_ring_t;
+#endif
+
+/* ==================== MPMC queue structures ==================== */
+#if ZK_USING_MPMC
+/* A slot is the sequence word followed by the element rounded up to whole words */
+#define ZK_MPMC_SLOT_SIZE(element_size)                                                            \
+	(sizeof(zk_uint32) + (((element_size) + sizeof(zk_uint32) - 1) & ~(sizeof(zk_uint32) - 1)))
+/* Bytes of storage mpmc_init() needs for capacity elements */
+#define ZK_MPMC_STORAGE_SIZE(element_size, capacity) ((capacity) * ZK_MPMC_SLOT_SIZE(element_size))
+
+/**
+ * @brief Bounded multi-producer/multi-consumer queue of fixed-size elements, storage owned by
+ *        the caller
+ * @note  The sequence word of a slot tells whose turn it is: position pos is free for a
+ *        writer while it reads pos and holds an element for a reader while it reads pos + 1.
+ *        Positions are claimed with LDREX/STREX, so the data path never masks interrupts; only
+ *        a task about to block, or a writer / reader that finds a task asleep, enters a
+ *        critical section.
+ */
+typedef struct zk_mpmc
+{
+	zk_uint8 *storage;				  // capacity slots of slot_size bytes, word aligned
+	zk_uint32 slot_size;			  // ZK_MPMC_SLOT_SIZE(element_size)
+	zk_uint32 element_size;			  // Bytes copied per element
+	zk_uint32 mask;					  // capacity - 1, capacity is a power of two
+	volatile zk_uint32 write_pos;	  // Free-running position of the next write
+	volatile zk_uint32 read_pos;	  // Free-running position of the next read
+	zk_list_node_t reader_sleep_list; // Tasks blocked on an empty queue
+	zk_list_node_t writer_sleep_list; // Tasks blocked on a full queue
+} zk_mpmc_t;
+#endif
+
+/* ==================== Work queue structures ==================== */
+#if ZK_USING_WORKQUEUE
+typedef void (*zk_work_fn_t)(void *arg);
+
+#define ZK_WORK_IDLE 0UL	// Not queued, may be submitted
+#define ZK_WORK_PENDING 1UL // On a pending stack, runs once
+
+/**
+ * @brief Deferred work item, storage owned by the caller
+ */
+typedef struct zk_work
+{
+	struct zk_work *next;	  // Next older item on the pending stack
+	zk_work_fn_t fn;		  // Function run by the worker task
+	void *arg;				  // Argument of fn
+	volatile zk_uint32 state; // ZK_WORK_IDLE / ZK_WORK_PENDING, claimed with LDREX/STREX
+} zk_work_t;
+
+/**
+ * @brief Work queue: a pending stack drained by one worker task
+ */
+typedef struct zk_workqueue
+{
+	volatile zk_uint32 pending; // Address of the newest submitted item, 0 when empty
+	zk_uint32 wakeup_sem;		// Posted when pending goes from empty to non-empty
+	zk_uint32 task_handle;		// Worker task
+} zk_workqueue_t;
+
+#if ZK_USING_TIMER
+typedef struct zk_delayed_work
+{
+	zk_work_t work;			   // Submitted when the timer fires
+	zk_workqueue_t *queue;	   // Target queue, ZK_NULL for the system work queue
+	zk_uint32 timer_handle;	   // One-shot software timer
+} zk_delayed_work_t;
+#endif
+#endif
+
+/* ==================== Coroutine structures ==================== */
+#if ZK_USING_COROUTINE
+/* Return value of a coroutine body, produced by the ZK_CO_* macros */
+#define ZK_CO_YIELDED 0	 // Run again in the next pass
+#define ZK_CO_WAITING 1	 // Polling a condition, run again every pass or poll period
+#define ZK_CO_SLEEPING 2 // Not run again before wake_up_time
+#define ZK_CO_EXITED 3	 // Finished, removed from its scheduler
+
+typedef struct zk_co zk_co_t;
+typedef zk_uint8 (*zk_co_fn_t)(zk_co_t *co);
+
+/**
+ * @brief Stackless coroutine, storage owned by the caller
+ * @note  Locals of the body do not survive a wait, keep state in the object that embeds it
+ */
+struct zk_co
+{
+	zk_list_node_t node;	// Link in the scheduler's list
+	zk_co_fn_t fn;			// Body, resumed at line
+	void *arg;				// User data
+	zk_uint32 wake_up_time; // ZK_CO_SLEEPING: resume tick; ZK_CO_WAITING: timeout tick
+	zk_uint16 line;			// Resume point (__LINE__ of the last wait), 0 at the start
+	zk_uint8 state;			// Last ZK_CO_* value returned by fn
+	zk_uint8 has_deadline;	// wake_up_time of a ZK_CO_WAITING wait is a timeout
+};
+
+/**
+ * @brief Runs any number of coroutines inside one host task
+ */
+typedef struct zk_co_sched
+{
+	zk_list_node_t co_list;		 // Coroutines owned by the host task
+	zk_list_node_t start_list;	 // Started by other tasks, moved to co_list by the host
+	zk_uint32 wakeup_sem;		 // Posted by co_start() and co_sched_wake()
+	zk_uint32 task_handle;		 // Host task
+} zk_co_sched_t;
+#endif
+
+/* ==================== Power management structures ==================== */
+#if ZK_USING_PM
+/* Idle sleep modes, a deeper mode saves more and takes longer to leave */
+typedef enum zk_pm_mode
+{
+	ZK_PM_MODE_WFI = 0, // Core clock gated, tickless idle of the CPU port
+	ZK_PM_MODE_STOP,	// Clocks stopped, RAM and registers kept, woken by an alarm or interrupt
+	ZK_PM_MODE_STANDBY, // Powered down, RAM lost, the wakeup is a reset
+	ZK_PM_MODE_NUM
+} zk_pm_mode_t;
+
+/* Returned by zk_pm_ops_t.enter() when it backed out without sleeping */
+#define ZK_PM_NOT_ENTERED 0xFFFFFFFFUL
+
+/**
+ * @brief Board hooks for the modes deeper than WFI, registered with pm_register()
+ * @note  enter() sleeps for at most ticks (ZK_TIMEOUT_INFINITE: no alarm) with interrupts
+ *        masked, backs out if an interrupt is already pending, steps the system time by the
+ *        ticks it slept and returns the wake-up latency in microseconds
+ */
+typedef struct zk_pm_ops
+{
+	zk_uint32 (*enter)(zk_pm_mode_t mode, zk_uint32 ticks);
+	zk_uint32 min_ticks[ZK_PM_MODE_NUM]; // Shortest idle worth the mode, 0: not supported
+} zk_pm_ops_t;
+
+typedef struct zk_pm_stats
+{
+	zk_uint32 count;		// Idle periods spent in the mode
+	zk_uint64 sleep_ticks;	// Ticks spent in the mode
+	zk_uint32 wake_us_last; // Wake-up to full clock speed of the last exit (microseconds)
+	zk_uint32 wake_us_max;	// Longest wake-up seen
+} zk_pm_stats_t;
+#endif
+
 /* ==================== Memory management structures ==================== */
+/* Heap region capabilities, mem_alloc_region() picks a region that has all requested bits */
+#define MEM_CAP_DEFAULT (1UL << 0)	// General purpose, used by mem_alloc()
+#define MEM_CAP_FAST (1UL << 1)		// Zero wait-state RAM (CCM/TCM)
+#define MEM_CAP_DMA (1UL << 2)		// Reachable by DMA controllers
+#define MEM_CAP_EXTERNAL (1UL << 3) // Off-chip RAM (FSMC SRAM/SDRAM)
+
+#if ZK_USING_TLSF
+/* TLSF geometry: SL classes per power of two, blocks must stay below 2^MEM_TLSF_FL_INDEX_MAX */
+#define MEM_TLSF_SL_INDEX_COUNT_LOG2 4
+#define MEM_TLSF_SL_INDEX_COUNT (1UL << MEM_TLSF_SL_INDEX_COUNT_LOG2)
+#define MEM_TLSF_ALIGN_LOG2 ((ZK_BYTE_ALIGNMENT == 8) ? 3 : 2)
+#define MEM_TLSF_FL_INDEX_SHIFT (MEM_TLSF_SL_INDEX_COUNT_LOG2 + MEM_TLSF_ALIGN_LOG2)
+#define MEM_TLSF_FL_INDEX_MAX 16
+#define MEM_TLSF_FL_INDEX_COUNT (MEM_TLSF_FL_INDEX_MAX - MEM_TLSF_FL_INDEX_SHIFT + 1)
+#define MEM_TLSF_SMALL_BLOCK_SIZE (1UL << MEM_TLSF_FL_INDEX_SHIFT)
+#define MEM_TLSF_BLOCK_FREE 0x1UL // Low bit of mem_block_t.size
+
+#if (CONFIG_TOTAL_MEM_SIZE >= (1UL << MEM_TLSF_FL_INDEX_MAX))
+#error "CONFIG_TOTAL_MEM_SIZE must be smaller than 2^MEM_TLSF_FL_INDEX_MAX"
+#endif
+
+/**
+ * @brief TLSF block with boundary tag
+ * @note  prev_phys and size form the header; next_free/prev_free are only valid while the
+ *        block is free and overlap the user payload
+ */
+typedef struct mem_block
+{
+	struct mem_block *prev_phys; // Physically previous block, NULL for the first block
+	zk_uint32 size;				 // Block size including header, bit 0 = MEM_TLSF_BLOCK_FREE
+	struct mem_block *next_free; // Next block in the same size class
+	struct mem_block *prev_free; // Previous block in the same size class
+} mem_block_t;
+#endif
+
 typedef struct mem_manager
 {
+#if ZK_USING_TLSF
+	zk_uint32 fl_bitmap;							  // First-level classes with free blocks
+	zk_uint32 sl_bitmap[MEM_TLSF_FL_INDEX_COUNT]; // Second-level classes with free blocks
+	mem_block_t *blocks[MEM_TLSF_FL_INDEX_COUNT][MEM_TLSF_SL_INDEX_COUNT]; // Free list heads
+#else
 	zk_list_node_t free_list;
 	zk_list_node_t used_list;
+#endif
 	zk_uint32 base_address;
 	zk_uint32 total_size;
 	zk_uint32 available_size;
+	zk_uint32 caps; /* MEM_CAP_* flags of this region */
 	zk_bool is_initialized;
 
 	/* P1 statistics information */
@@ -346,29 +1005,147 @@ typedef struct mem_manager
 	zk_uint32 used_block_count; /* Current used block count */
 } mem_manager_t;
 
+#if !ZK_USING_TLSF
+#define MEM_BLOCK_MAGIC_USED 0x5A4B5553UL // "ZKUS": block handed out by mem_alloc()
+#define MEM_BLOCK_MAGIC_FREE 0x5A4B4652UL // "ZKFR": block on the free list
+
 typedef struct mem_block
 {
 	zk_list_node_t list_node;
 	zk_uint32 size;
+	zk_uint32 magic; // MEM_BLOCK_MAGIC_USED / MEM_BLOCK_MAGIC_FREE, O(1) ownership check
 } mem_block_t;
+#endif
 
 /* Global variable declarations (extern), actual definition in zk_mem.c */
 extern const zk_uint32 MEM_BLOCK_ALIGNMENT;
 extern zk_uint8 g_heap[CONFIG_TOTAL_MEM_SIZE];
+extern mem_manager_t g_mem_regions[MEM_REGION_MAX_NUM];
+extern zk_uint32 g_mem_region_count;
 
 #define MEM_BLOCK_MIN_SIZE (MEM_BLOCK_ALIGNMENT << 1)
 
+#if ZK_USING_MEM_POOL
+typedef enum mem_pool_state
+{
+	MEM_POOL_UNUSED = 0,
+	MEM_POOL_USED,
+} mem_pool_state_t;
+
+/**
+ * @brief Fixed-size block pool
+ * @note  Free blocks are chained through their first word, so alloc/free are O(1)
+ */
+typedef struct mem_pool
+{
+	void *free_head;			// First free block, NULL when exhausted
+	zk_uint8 *block_start;		// Address of block 0
+	zk_uint32 block_size;		// Block size rounded up to ZK_BYTE_ALIGNMENT
+	zk_uint32 block_count;		// Number of blocks in the pool
+	zk_uint32 free_count;		// Number of free blocks
+	zk_uint32 peak_used_count;	// Peak number of blocks in use
+	zk_uint32 alloc_count;		// Total allocation count
+	zk_uint32 alloc_fail_count; // Allocation failure count
+	zk_uint8 from_heap;			// Storage carved out of g_heap by mem_pool_create()
+	zk_uint8 is_used;			// Pool usage status flag
+} mem_pool_t;
+#endif
+
+#if ZK_USING_ARENA
+#define ZK_ARENA_PRIVATE 0 // Used by one task only, allocation takes no lock
+#define ZK_ARENA_SHARED 1  // Allocation and reset run in the critical section
+
+/* Where the storage of an arena came from, returned there by arena_destroy() */
+#define ZK_ARENA_FROM_STATIC 0
+#define ZK_ARENA_FROM_HEAP 1
+#define ZK_ARENA_FROM_POOL 2
+
+/**
+ * @brief Bump allocator over one block, the object itself is owned by the caller
+ * @note  Allocations are never freed one by one, arena_reset() drops all of them at once
+ */
+typedef struct zk_arena
+{
+	zk_uint8 *base;		   // Start of the usable storage, ZK_BYTE_ALIGNMENT aligned
+	zk_uint32 size;		   // Usable bytes
+	zk_uint32 offset;	   // Bytes handed out since the last reset
+	zk_uint32 peak;		   // Largest offset seen
+	zk_uint32 fail_count;  // Allocations that did not fit
+	void *storage;		   // Block to give back on destroy
+	zk_uint32 pool_handle; // Pool of storage (ZK_ARENA_FROM_POOL)
+	zk_uint8 source;	   // ZK_ARENA_FROM_*
+	zk_uint8 flags;		   // ZK_ARENA_PRIVATE or ZK_ARENA_SHARED
+} zk_arena_t;
+#endif
+
+/* ==================== System definition table structures ==================== */
+#if ZK_USING_SYSTEM_TABLE
+typedef enum zk_sys_object_type
+{
+	ZK_SYS_OBJ_TASK = 0,
+	ZK_SYS_OBJ_SEM,
+	ZK_SYS_OBJ_MUTEX,
+	ZK_SYS_OBJ_QUEUE,
+	ZK_SYS_OBJ_EVENT,
+	ZK_SYS_OBJ_TIMER
+} zk_sys_object_type_t;
+
+/* zk_sys_object_t.flags */
+#define ZK_SYS_CEILING 0x01U	 // Mutex with the priority ceiling in priority
+#define ZK_SYS_TIMER_START 0x02U // Timer started once created
+
+/**
+ * @brief One kernel object of a system definition table, written with the ZK_SYS_*() macros
+ * @note  The table is const and stays in flash; only the handles, TCBs, stacks and queue
+ *        buffers it points to are RAM
+ */
+typedef struct zk_sys_object
+{
+	zk_uint8 type;				// zk_sys_object_type_t
+	zk_uint8 priority;			// Task priority, mutex ceiling
+	zk_uint8 flags;				// ZK_SYS_*
+	zk_uint8 mode;				// timer_mode_t of a timer
+	zk_uint32 *handle;			// Receives the handle, ZK_NULL to drop it
+	const char *name;			// Task name
+	task_function_t task_entry; // Task entry
+	void *param;				// Task or timer callback parameter
+	zk_uint32 size;				// Stack bytes of a task, element size of a queue
+	zk_uint32 count;			// Initial semaphore count, queue length, timer interval
+	void *storage;				// Task stack, queue buffer
+	task_control_block_t *tcb;	// Task TCB
+#if ZK_USING_TIMER
+	timer_handler_t timer_handler; // Timer callback
+#endif
+} zk_sys_object_t;
+#endif
+
 /* ==================== Scheduler structures ==================== */
 typedef struct task_scheduler
 {
 	zk_list_node_t ready_list[ZK_PRIORITY_NUM]; // Ready queue array
-	zk_list_node_t delay_list;					// Delay queue
-	zk_list_node_t suspend_list;				// Suspend queue
-	zk_list_node_t block_timeout_list;			// Block timeout queue
+#if ZK_USING_TIME_WHEEL
+	zk_time_wheel_t time_wheel; // Shared delay / block timeout wheel
+#else
+	zk_list_node_t delay_list;		   // Delay queue
+	zk_list_node_t block_timeout_list; // Block timeout queue
+#endif
+	zk_list_node_t suspend_list; // Suspend queue
 
-	zk_uint32 priority_active;			 // Priority active bitmap
+#if ZK_PRIORITY_TWO_LEVEL
+	zk_uint32 priority_group;						  // Bit g set while priority_active[g] != 0
+	zk_uint32 priority_active[ZK_PRIORITY_GROUP_NUM]; // Priority active bitmap per 32 levels
+#else
+	zk_uint32 priority_active; // Priority active bitmap
+#endif
 	zk_uint32 scheduler_suspend_nesting; // Scheduler suspend nesting count
 	zk_uint32 re_schedule_pending;		 // Reschedule request flag
+	zk_uint32 pended_ticks;				 // Ticks that arrived while suspended
+#if ZK_USING_BUDGET
+	zk_list_node_t budget_list; // Demoted tasks sorted by replenishment time
+#endif
+#if ZK_USING_PREEMPT_THRESHOLD
+	zk_list_node_t preempted_list; // Tasks preempted above their threshold, innermost first
+#endif
 } task_scheduler_t;
 
 // Block sort type enumeration
@@ -378,6 +1155,26 @@ typedef enum block_sort_type
 	BLOCK_SORT_PRIO		 // Priority sorting
 } block_sort_type_t;
 
+#if ZK_USING_WAIT_INDEX
+/**
+ * @brief Priority index over one BLOCK_SORT_PRIO sleep list
+ * @note  The sleep list stays a single list sorted by priority, FIFO within a priority, so
+ *        its readers are unchanged. The index only remembers the last waiter of every
+ *        priority present, the insertion point is found from the bitmap like the ready list.
+ */
+typedef struct zk_wait_index
+{
+	zk_list_node_t *sleep_head;			   // Indexed sleep list, ZK_NULL while the slot is free
+	zk_list_node_t *tail[ZK_PRIORITY_NUM]; // Last waiter node of each priority present
+#if ZK_PRIORITY_TWO_LEVEL
+	zk_uint32 group;						// Bit g set while active[g] != 0
+	zk_uint32 active[ZK_PRIORITY_GROUP_NUM]; // Priorities with waiters, per 32 levels
+#else
+	zk_uint32 active; // Priorities with waiters
+#endif
+} zk_wait_index_t;
+#endif
+
 // Block type enumeration
 typedef enum block_type
 {
@@ -416,6 +1213,7 @@ typedef enum event_timeout_wakeup
  * @note These macros handle uint32 time overflow correctly using signed arithmetic
  *       They work correctly when time wraps around from 0xFFFFFFFF to 0x00000000
  *       Limitation: Maximum time difference must be < 2^31 (enforced by ZK_TSK_DLY_MAX)
+ *       The difference is taken in 32 bits, so the result does not depend on the width of long
  *
  * @param now    Current time value
  * @param target Target time value to compare against
@@ -424,10 +1222,92 @@ typedef enum event_timeout_wakeup
  *   - zk_time_is_reached(0x00000002, 0xFFFFFFFE) → TRUE  (time has wrapped around)
  *   - zk_time_is_reached(0xFFFFFFFE, 0x00000002) → FALSE (target is in future)
  */
-#define zk_time_is_reached(now, target) (((long) (now) - (long) (target)) >= 0)
-#define zk_time_is_before(now, target) (((long) (now) - (long) (target)) < 0)
-#define zk_time_is_after(now, target) (((long) (now) - (long) (target)) > 0)
-#define zk_time_not_reached(now, target) (((long) (now) - (long) (target)) < 0)
+#define ZK_TIME_DIFF(now, target) ((zk_int32) ((zk_uint32) (now) - (zk_uint32) (target)))
+#define zk_time_is_reached(now, target) (ZK_TIME_DIFF(now, target) >= 0)
+#define zk_time_is_before(now, target) (ZK_TIME_DIFF(now, target) < 0)
+#define zk_time_is_after(now, target) (ZK_TIME_DIFF(now, target) > 0)
+#define zk_time_not_reached(now, target) (ZK_TIME_DIFF(now, target) < 0)
+
+/**
+ * @brief Time unit to tick conversion
+ * @note  Rounded as ZK_TIME_ROUNDING selects and saturated at ZK_TSK_DLY_MAX - 1, the longest
+ *        wait the kernel takes; ZK_TIMEOUT_INFINITE passes through unchanged. The macros fold
+ *        to constants for constant arguments (static tables included), the inline helpers
+ *        avoid the 64-bit division at run time when the tick rate divides the unit rate or is
+ *        a multiple of it. A tick wait ends on a tick boundary and the current tick is partly
+ *        over, so the wait may be up to one tick shorter than the converted time.
+ */
+#if (ZK_TIME_ROUNDING == ZK_TIME_ROUND_UP)
+#define ZK_TIME_ROUND_BIAS(unit_hz) ((unit_hz) - 1U)
+#elif (ZK_TIME_ROUNDING == ZK_TIME_ROUND_NEAREST)
+#define ZK_TIME_ROUND_BIAS(unit_hz) ((unit_hz) / 2U)
+#elif (ZK_TIME_ROUNDING == ZK_TIME_ROUND_DOWN)
+#define ZK_TIME_ROUND_BIAS(unit_hz) 0U
+#else
+#error "ZK_TIME_ROUNDING must be ZK_TIME_ROUND_UP, ZK_TIME_ROUND_NEAREST or ZK_TIME_ROUND_DOWN"
+#endif
+
+#define ZK_TIME_TICKS_EXACT(t, unit_hz)                                                            \
+	(((zk_uint64) (t) * ZK_TICK_RATE_HZ + ZK_TIME_ROUND_BIAS(unit_hz)) / (unit_hz))
+#define ZK_TIME_TO_TICKS(t, unit_hz)                                                               \
+	((zk_uint32) (((zk_uint32) (t) == ZK_TIMEOUT_INFINITE) ? ZK_TIMEOUT_INFINITE                   \
+				  : (ZK_TIME_TICKS_EXACT(t, unit_hz) >= ZK_TSK_DLY_MAX)                            \
+					  ? (ZK_TSK_DLY_MAX - 1U)                                                      \
+					  : ZK_TIME_TICKS_EXACT(t, unit_hz)))
+#define ZK_MS_TO_TICKS(ms) ZK_TIME_TO_TICKS(ms, 1000U)
+#define ZK_US_TO_TICKS(us) ZK_TIME_TO_TICKS(us, 1000000U)
+/* Truncated, for reporting tick counts */
+#define ZK_TICKS_TO_MS(ticks) ((zk_uint32) (((zk_uint64) (ticks) * 1000U) / ZK_TICK_RATE_HZ))
+
+static inline zk_uint32 zk_time_to_ticks(zk_uint32 t, zk_uint32 unit_hz)
+{
+	zk_uint32 units_per_tick = 0;
+	zk_uint32 ticks_per_unit = 0;
+	zk_uint32 ticks = 0;
+
+	if (t == ZK_TIMEOUT_INFINITE)
+	{
+		return ZK_TIMEOUT_INFINITE;
+	}
+	if (unit_hz % ZK_TICK_RATE_HZ == 0)
+	{
+		/* a tick is a whole number of units: one 32-bit division by a constant */
+		units_per_tick = unit_hz / ZK_TICK_RATE_HZ;
+		ticks = t / units_per_tick;
+		if (t % units_per_tick >= units_per_tick - ZK_TIME_ROUND_BIAS(units_per_tick))
+		{
+			ticks++;
+		}
+		return (ticks >= ZK_TSK_DLY_MAX) ? (zk_uint32) (ZK_TSK_DLY_MAX - 1U) : ticks;
+	}
+	if (ZK_TICK_RATE_HZ % unit_hz == 0)
+	{
+		/* a unit is a whole number of ticks, nothing to round */
+		ticks_per_unit = ZK_TICK_RATE_HZ / unit_hz;
+		return (t > (ZK_TSK_DLY_MAX - 1U) / ticks_per_unit) ? (zk_uint32) (ZK_TSK_DLY_MAX - 1U)
+															: t * ticks_per_unit;
+	}
+	return ZK_TIME_TO_TICKS(t, unit_hz);
+}
+
+static inline zk_uint32 zk_ms_to_ticks(zk_uint32 ms)
+{
+	return zk_time_to_ticks(ms, 1000U);
+}
+
+static inline zk_uint32 zk_us_to_ticks(zk_uint32 us)
+{
+	return zk_time_to_ticks(us, 1000000U);
+}
+
+/* For task_delay / task_delay_until, which need 0 < ticks < ZK_TSK_DLY_MAX: a time that
+ * rounds to 0 ticks still waits one tick */
+static inline zk_uint32 zk_ms_to_delay_ticks(zk_uint32 ms)
+{
+	zk_uint32 ticks = zk_ms_to_ticks(ms);
+
+	return (ticks == 0) ? 1U : ticks;
+}
 
 
 static inline zk_uint32 zk_addr_align(zk_uint32 addr, zk_uint32 align, zk_uint32 mask)
@@ -440,6 +1320,13 @@ static inline zk_uint32 zk_addr_align(zk_uint32 addr, zk_uint32 align, zk_uint32
 	return addr;
 }
 
+/* Sizes below this are copied bytewise inline, constant ones unroll at the call site;
+ * larger ones take the word/LDM-STM paths in zk_string.c */
+#define ZK_MEM_INLINE_MAX 8
+
+void zk_memcpy_block(void *dest, const void *src, zk_uint32 size);
+void zk_memset_block(void *addr, zk_uint8 data, zk_uint32 size);
+
 static inline int zk_memcpy(void *dest, const void *src, zk_uint32 size)
 {
 	if (dest == ZK_NULL || src == ZK_NULL)
@@ -447,6 +1334,12 @@ static inline int zk_memcpy(void *dest, const void *src, zk_uint32 size)
 		return 0;
 	}
 
+	if (size >= ZK_MEM_INLINE_MAX)
+	{
+		zk_memcpy_block(dest, src, size);
+		return 1;
+	}
+
 	zk_uint8 *dest_addr = (zk_uint8 *) dest;
 	const zk_uint8 *src_addr = (const zk_uint8 *) src;
 
@@ -459,6 +1352,12 @@ static inline int zk_memcpy(void *dest, const void *src, zk_uint32 size)
 
 static inline void zk_memset(void *addr, zk_uint8 data, zk_uint32 size)
 {
+	if (size >= ZK_MEM_INLINE_MAX)
+	{
+		zk_memset_block(addr, data, size);
+		return;
+	}
+
 	zk_uint8 *base_addr = (zk_uint8 *) addr;
 	while (size-- > 0)
 	{
@@ -503,11 +1402,15 @@ static inline zk_uint8 zk_add_overflow(zk_uint32 a, zk_uint32 b, zk_uint32 *res)
 
 #define ZK_ASSERT_SCHEDULER_RUNNING() ZK_ASSERT(!is_scheduler_suspending())
 
+/* _from_isr entry: an ISR the kernel does not mask would race the kernel data it touches */
+#define ZK_ASSERT_ISR_PRIORITY() ZK_ASSERT(zk_cpu_isr_priority_valid())
+
 #else /* !DEBUG_ASSERT */
 #define ZK_ASSERT(expr) ((void) 0)
 #define ZK_ASSERT_PARAM(expr) ((void) 0)
 #define ZK_ASSERT_NULL_POINTER(ptr) ((void) 0)
 #define ZK_ASSERT_SCHEDULER_RUNNING() ((void) 0)
+#define ZK_ASSERT_ISR_PRIORITY() ((void) 0)
 #endif
 
 /* ==================== List inline functions ==================== */
@@ -618,6 +1521,127 @@ static inline void zk_list_move_to_tail(zk_list_node_t *list, zk_list_node_t *he
 	zk_list_add_before(list, head);
 }
 
+/* ==================== Time wheel inline functions ==================== */
+#if ZK_USING_TIME_WHEEL
+/**
+ * zk_time_wheel_init - Initialize all slots, the first processed slot will be `now`
+ */
+static inline void zk_time_wheel_init(zk_time_wheel_t *wheel, zk_uint32 now)
+{
+	for (zk_uint32 i = 0; i < ZK_TIME_WHEEL_SIZE; i++)
+	{
+		zk_list_init(&wheel->slots[i]);
+	}
+	wheel->processed_time = now - 1;
+}
+
+/**
+ * zk_time_wheel_insert - O(1) insert of a node expiring at expire_time
+ * @note An expire time that was already processed is moved to the next slot to be processed,
+ *       so it can never be skipped for a whole revolution
+ */
+static inline void zk_time_wheel_insert(zk_time_wheel_t *wheel, zk_list_node_t *node,
+										zk_uint32 expire_time)
+{
+	if (zk_time_is_reached(wheel->processed_time, expire_time))
+	{
+		expire_time = wheel->processed_time + 1;
+	}
+	zk_list_add_before(node, &wheel->slots[expire_time & ZK_TIME_WHEEL_MASK]);
+}
+
+/**
+ * zk_time_wheel_advance - Step the wheel towards now, returning the next slot to process
+ * @return Slot list head, ZK_NULL once the wheel has caught up with now
+ * @note Normally one slot per tick; after a long gap (tickless sleep, pended ticks) every
+ *       slot is visited at most once. Owners must still compare each entry against now,
+ *       since a slot also holds entries of later revolutions.
+ */
+static inline zk_list_node_t *zk_time_wheel_advance(zk_time_wheel_t *wheel, zk_uint32 now)
+{
+	if (zk_time_is_reached(wheel->processed_time, now))
+	{
+		return ZK_LIST_NODE_NULL;
+	}
+	if (now - wheel->processed_time > ZK_TIME_WHEEL_SIZE)
+	{
+		wheel->processed_time = now - ZK_TIME_WHEEL_SIZE;
+	}
+	wheel->processed_time++;
+	return &wheel->slots[wheel->processed_time & ZK_TIME_WHEEL_MASK];
+}
+#endif
+
+/* ==================== Object handle inline functions ==================== */
+/**
+ * zk_handle_pool_init - Put every slot on the free stack, index 0 on top
+ */
+static inline void zk_handle_pool_init(zk_handle_pool_t *pool)
+{
+	zk_uint16 i = pool->capacity;
+
+	pool->free_top = ZK_HANDLE_FREE_END;
+	while (i-- > 0)
+	{
+		pool->free_next[i] = pool->free_top;
+		pool->free_top = i;
+		pool->generation[i] = 0;
+	}
+}
+
+/**
+ * zk_handle_at - Current handle of a slot, for objects that only know their own address
+ */
+static inline zk_uint32 zk_handle_at(const zk_handle_pool_t *pool, zk_uint32 index)
+{
+	return ((zk_uint32) pool->generation[index] << ZK_HANDLE_INDEX_BITS) | index;
+}
+
+/**
+ * zk_handle_alloc - Pop a free slot in O(1)
+ * @return ZK_SUCCESS, ZK_ERR_RESOURCE_UNAVAILABLE when every slot is in use
+ * @note called within critical section
+ */
+static inline zk_error_code_t zk_handle_alloc(zk_handle_pool_t *pool, zk_uint32 *handle)
+{
+	zk_uint16 index = pool->free_top;
+
+	if (index == ZK_HANDLE_FREE_END)
+	{
+		return ZK_ERR_RESOURCE_UNAVAILABLE;
+	}
+	pool->free_top = pool->free_next[index];
+	*handle = zk_handle_at(pool, index);
+	return ZK_SUCCESS;
+}
+
+/**
+ * zk_handle_free - Retire a live handle and push its slot in O(1)
+ * @note called within critical section, after zk_handle_is_valid(); the handle and every copy
+ *       of it are rejected from now on
+ */
+static inline void zk_handle_free(zk_handle_pool_t *pool, zk_uint32 handle)
+{
+	zk_uint16 index = (zk_uint16) ZK_HANDLE_INDEX(handle);
+
+	pool->generation[index] = (zk_uint16) ((pool->generation[index] + 1) & ZK_HANDLE_GEN_MASK);
+	pool->free_next[index] = pool->free_top;
+	pool->free_top = index;
+}
+
+/**
+ * zk_handle_is_valid - Whether the handle names a slot of the pool in its current generation
+ * @note A slot that was never created keeps generation 0, the owner's is_used check reports it
+ */
+static inline zk_bool zk_handle_is_valid(const zk_handle_pool_t *pool, zk_uint32 handle)
+{
+	return (ZK_HANDLE_INDEX(handle) < pool->capacity &&
+			(handle & ZK_HANDLE_RESERVED) == 0 &&
+			pool->generation[ZK_HANDLE_INDEX(handle)] == ZK_HANDLE_GEN(handle))
+			   ? ZK_TRUE
+			   : ZK_FALSE;
+}
+
 /* ==================== Critical section forward declaration ==================== */
 #ifndef ZK_ENTER_CRITICAL
 #define ZK_ENTER_CRITICAL() zk_cpu_enter_critical()
@@ -0,0 +1,153 @@
+/**
+ * @file    zk_feature.h
+ * @brief   ZK-RTOS kernel tailoring: build profiles and feature dependency checks
+ * @note    Included at the end of zk_config.h, so every file that sees the configuration sees
+ *          the final switches. ZK_PROFILE_CUSTOM keeps the switches of zk_config.h, the other
+ *          profiles replace all of them. Every switch is tested with #if: a disabled subsystem
+ *          leaves no code, no pool and no work in the SysTick handler.
+ */
+
+#ifndef ZK_FEATURE_H
+#define ZK_FEATURE_H
+
+/* ==================== Build profiles ==================== */
+
+#if (ZK_CONFIG_PROFILE != ZK_PROFILE_CUSTOM)
+
+#if (ZK_CONFIG_PROFILE == ZK_PROFILE_MINIMAL)
+#define ZK_PROFILE_BASE_ON 0
+#define ZK_PROFILE_FULL_ON 0
+#elif (ZK_CONFIG_PROFILE == ZK_PROFILE_STANDARD)
+#define ZK_PROFILE_BASE_ON 1
+#define ZK_PROFILE_FULL_ON 0
+#elif (ZK_CONFIG_PROFILE == ZK_PROFILE_FULL)
+#define ZK_PROFILE_BASE_ON 1
+#define ZK_PROFILE_FULL_ON 1
+#else
+#error "ZK_CONFIG_PROFILE must be ZK_PROFILE_CUSTOM, MINIMAL, STANDARD or FULL"
+#endif
+
+#undef ZK_USING_SEMAPHORE
+#undef ZK_USING_MUTEX
+#undef ZK_USING_QUEUE
+#undef ZK_USING_TIMER
+#undef ZK_USING_HOOK
+#undef ZK_USING_RING
+#undef ZK_USING_MPMC
+#undef ZK_USING_MEM_POOL
+#undef ZK_USING_TASK_NOTIFY
+#undef ZK_USING_EVENT
+#undef ZK_USING_MUTEX_CEILING
+#undef ZK_USING_RWLOCK
+#undef ZK_USING_CRITICAL_STATS
+#undef ZK_USING_TRACE
+#undef ZK_USING_PERF_COUNTERS
+#undef ZK_USING_DEFERRED_LOG
+#undef ZK_USING_SLACK
+#undef ZK_USING_EDF
+#undef ZK_USING_BUDGET
+#undef ZK_USING_STACK_WATCH
+#undef ZK_USING_MPU_STACK_GUARD
+#undef ZK_USING_QUEUE_SET
+#undef ZK_USING_MSGBUF
+#undef ZK_USING_MAILBOX
+#undef ZK_USING_TIME64
+#undef ZK_USING_PREEMPT_THRESHOLD
+#undef ZK_USING_WORKQUEUE
+#undef ZK_USING_COROUTINE
+#undef ZK_USING_TASK_MONITOR
+#undef ZK_USING_PM
+#undef ZK_USING_WAIT_INDEX
+#undef ZK_USING_ARENA
+#undef ZK_USING_SYSTEM_TABLE
+#undef ZK_USING_HEARTBEAT
+#undef ZK_USING_TICKLESS
+
+/* The standard set is what every build got before the switches were honoured */
+#define ZK_USING_SEMAPHORE ZK_PROFILE_BASE_ON
+#define ZK_USING_MUTEX ZK_PROFILE_BASE_ON
+#define ZK_USING_QUEUE ZK_PROFILE_BASE_ON
+#define ZK_USING_TIMER ZK_PROFILE_BASE_ON
+#define ZK_USING_HOOK ZK_PROFILE_BASE_ON
+
+#define ZK_USING_RING ZK_PROFILE_FULL_ON
+#define ZK_USING_MPMC ZK_PROFILE_FULL_ON
+#define ZK_USING_MEM_POOL ZK_PROFILE_FULL_ON
+#define ZK_USING_TASK_NOTIFY ZK_PROFILE_FULL_ON
+#define ZK_USING_EVENT ZK_PROFILE_FULL_ON
+#define ZK_USING_MUTEX_CEILING ZK_PROFILE_FULL_ON
+#define ZK_USING_RWLOCK ZK_PROFILE_FULL_ON
+#define ZK_USING_CRITICAL_STATS ZK_PROFILE_FULL_ON
+#define ZK_USING_TRACE ZK_PROFILE_FULL_ON
+#define ZK_USING_PERF_COUNTERS ZK_PROFILE_FULL_ON
+#define ZK_USING_DEFERRED_LOG ZK_PROFILE_FULL_ON
+#define ZK_USING_SLACK ZK_PROFILE_FULL_ON
+#define ZK_USING_EDF ZK_PROFILE_FULL_ON
+#define ZK_USING_BUDGET ZK_PROFILE_FULL_ON
+#define ZK_USING_STACK_WATCH ZK_PROFILE_FULL_ON
+#define ZK_USING_MPU_STACK_GUARD ZK_PROFILE_FULL_ON
+#define ZK_USING_QUEUE_SET ZK_PROFILE_FULL_ON
+#define ZK_USING_MSGBUF ZK_PROFILE_FULL_ON
+#define ZK_USING_MAILBOX ZK_PROFILE_FULL_ON
+#define ZK_USING_TIME64 ZK_PROFILE_FULL_ON
+#define ZK_USING_PREEMPT_THRESHOLD ZK_PROFILE_FULL_ON
+#define ZK_USING_WORKQUEUE ZK_PROFILE_FULL_ON
+#define ZK_USING_COROUTINE ZK_PROFILE_FULL_ON
+#define ZK_USING_TASK_MONITOR ZK_PROFILE_FULL_ON
+#define ZK_USING_PM ZK_PROFILE_FULL_ON
+#define ZK_USING_WAIT_INDEX ZK_PROFILE_FULL_ON
+#define ZK_USING_ARENA ZK_PROFILE_FULL_ON
+#define ZK_USING_SYSTEM_TABLE ZK_PROFILE_FULL_ON
+#define ZK_USING_HEARTBEAT ZK_PROFILE_FULL_ON
+#define ZK_USING_TICKLESS ZK_PROFILE_FULL_ON
+
+#endif /* ZK_CONFIG_PROFILE != ZK_PROFILE_CUSTOM */
+
+/* ==================== Feature dependencies ==================== */
+
+#if ZK_USING_MUTEX_CEILING && !ZK_USING_MUTEX
+#error "ZK_USING_MUTEX_CEILING needs ZK_USING_MUTEX"
+#endif
+
+#if ZK_USING_QUEUE_SET && !ZK_USING_QUEUE
+#error "ZK_USING_QUEUE_SET needs ZK_USING_QUEUE"
+#endif
+
+#if ZK_USING_MAILBOX && !ZK_USING_QUEUE
+#error "ZK_USING_MAILBOX needs ZK_USING_QUEUE"
+#endif
+
+#if ZK_USING_TIMER && (ZK_TIMER_MODE == ZK_TIMER_MODE_TASK) && !ZK_USING_SEMAPHORE
+#error "ZK_TIMER_MODE_TASK needs ZK_USING_SEMAPHORE"
+#endif
+
+#if ZK_USING_WORKQUEUE && !ZK_USING_SEMAPHORE
+#error "ZK_USING_WORKQUEUE needs ZK_USING_SEMAPHORE"
+#endif
+
+#if ZK_USING_COROUTINE && !ZK_USING_SEMAPHORE
+#error "ZK_USING_COROUTINE needs ZK_USING_SEMAPHORE"
+#endif
+
+#if ZK_USING_DEFERRED_LOG && (!ZK_USING_RING || !ZK_USING_SEMAPHORE)
+#error "ZK_USING_DEFERRED_LOG needs ZK_USING_RING and ZK_USING_SEMAPHORE"
+#endif
+
+#if ZK_USING_PM && !ZK_USING_TICKLESS
+#error "ZK_USING_PM needs ZK_USING_TICKLESS"
+#endif
+
+/* ==================== Interrupt priorities ==================== */
+
+/* BASEPRI 0 masks nothing, and the kernel's own exceptions must be masked by it */
+#if (ZK_MAX_SYSCALL_INTERRUPT_PRIORITY == 0) ||                                                    \
+	(ZK_MAX_SYSCALL_INTERRUPT_PRIORITY > ZK_KERNEL_INTERRUPT_PRIORITY)
+#error "ZK_MAX_SYSCALL_INTERRUPT_PRIORITY must be non-zero and <= ZK_KERNEL_INTERRUPT_PRIORITY"
+#endif
+
+/* unimplemented bits read as zero, the threshold must compare equal to what the NVIC holds */
+#if (ZK_MAX_SYSCALL_INTERRUPT_PRIORITY & ((1 << (8 - ZK_NVIC_PRIO_BITS)) - 1)) != 0
+#error "ZK_MAX_SYSCALL_INTERRUPT_PRIORITY must be a multiple of 1 << (8 - ZK_NVIC_PRIO_BITS)"
+#endif
+
+#endif /* ZK_FEATURE_H */
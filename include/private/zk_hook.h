@@ -1,7 +1,9 @@
 /**
  * @file    zk_hook.h
  * @brief   ZK-RTOS hook function interface
- * @note    Hook functions allow users to insert custom code when critical events occur
+ * @note    Hook functions allow users to insert custom code when critical events occur. Every
+ *          event keeps a small static chain of subscribers, called in registration order; an
+ *          event whose ZK_HOOK_*_MAX is 0 has no chain and its call sites compile to nothing.
  */
 
 #ifndef ZK_HOOK_H
@@ -9,7 +11,7 @@
 
 #include "zk_def.h"
 
-#ifdef ZK_USING_HOOK
+#if ZK_USING_HOOK
 
 /* ==================== Hook function type definitions ==================== */
 
@@ -47,66 +49,173 @@ typedef void (*stack_overflow_hook_t)(task_control_block_t *tcb);
  */
 typedef void (*malloc_failed_hook_t)(zk_uint32 size);
 
-
-/* ==================== Hook function registration interface ==================== */
-
 /**
- * @brief Register idle task hook
- * @param hook Hook function pointer, pass NULL to unregister
+ * @brief Heartbeat miss hook function type
+ * @param tcb TCB of the task that did not check in within its period
+ * @param lateness Ticks past the deadline
+ * @note  Called in SysTick interrupt when the deadline passes (lateness is normally 0), and
+ *        again from task_heartbeat() when the task checks in late (lateness is the overrun)
  */
-void zk_hook_register_idle(idle_hook_t hook);
+typedef void (*heartbeat_miss_hook_t)(task_control_block_t *tcb, zk_uint32 lateness);
 
-/**
- * @brief Register task switch hook
- * @param hook Hook function pointer, pass NULL to unregister
- */
-void zk_hook_register_task_switch(task_switch_hook_t hook);
 
-/**
- * @brief Register tick hook
- * @param hook Hook function pointer, pass NULL to unregister
- */
-void zk_hook_register_tick(tick_hook_t hook);
+/* Common storage type of the chains, converted back to the event type before the call */
+typedef void (*zk_hook_fn_t)(void);
+
+/* ==================== Hook function registration interface ==================== */
 
 /**
- * @brief Register stack overflow hook
- * @param hook Hook function pointer, pass NULL to unregister
+ * @brief Subscribe to an event
+ * @param hook Hook function pointer
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE if already subscribed,
+ *         ZK_ERR_RESOURCE_UNAVAILABLE when the chain is full, ZK_ERR_NOT_SUPPORTED if the
+ *         chain is configured out
  */
-void zk_hook_register_stack_overflow(stack_overflow_hook_t hook);
+zk_error_code_t zk_hook_register_idle(idle_hook_t hook);
+zk_error_code_t zk_hook_register_task_switch(task_switch_hook_t hook);
+zk_error_code_t zk_hook_register_tick(tick_hook_t hook);
+zk_error_code_t zk_hook_register_stack_overflow(stack_overflow_hook_t hook);
+zk_error_code_t zk_hook_register_malloc_failed(malloc_failed_hook_t hook);
+zk_error_code_t zk_hook_register_heartbeat_miss(heartbeat_miss_hook_t hook);
 
 /**
- * @brief Register memory allocation failure hook
- * @param hook Hook function pointer, pass NULL to unregister
+ * @brief Unsubscribe from an event
+ * @param hook Hook function pointer passed to the register call
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE if not subscribed
+ * @note  A dispatch already running in a preempted task (idle, stack overflow, malloc
+ *        failed) may still call the hook once
  */
-void zk_hook_register_malloc_failed(malloc_failed_hook_t hook);
+zk_error_code_t zk_hook_unregister_idle(idle_hook_t hook);
+zk_error_code_t zk_hook_unregister_task_switch(task_switch_hook_t hook);
+zk_error_code_t zk_hook_unregister_tick(tick_hook_t hook);
+zk_error_code_t zk_hook_unregister_stack_overflow(stack_overflow_hook_t hook);
+zk_error_code_t zk_hook_unregister_malloc_failed(malloc_failed_hook_t hook);
+zk_error_code_t zk_hook_unregister_heartbeat_miss(heartbeat_miss_hook_t hook);
 
 
 /* ==================== Internal call interface (users should not call directly) ==================== */
+/* Inlined at the call sites: with no subscriber the cost is one load and compare */
 
-/**
- * @brief Call idle task hook
- */
-void zk_hook_call_idle(void);
-
-/**
- * @brief Call task switch hook
- */
-void zk_hook_call_task_switch(task_control_block_t *from_tcb, task_control_block_t *to_tcb);
+#if ZK_HOOK_IDLE_MAX > 0
+extern zk_hook_fn_t g_idle_hooks[ZK_HOOK_IDLE_MAX];
+extern volatile zk_uint8 g_idle_hook_count;
 
 /**
- * @brief Call tick hook
+ * @brief Call idle task hooks
+ * @note  Called in idle task
  */
-void zk_hook_call_tick(void);
+static inline void zk_hook_call_idle(void)
+{
+	for (zk_uint32 i = 0; i < g_idle_hook_count; i++)
+	{
+		((idle_hook_t) g_idle_hooks[i])();
+	}
+}
+#else
+#define zk_hook_call_idle() ((void) 0)
+#endif
 
-/**
- * @brief Call stack overflow hook
- */
-void zk_hook_call_stack_overflow(task_control_block_t *tcb);
+#if ZK_HOOK_TASK_SWITCH_MAX > 0
+extern zk_hook_fn_t g_task_switch_hooks[ZK_HOOK_TASK_SWITCH_MAX];
+extern volatile zk_uint8 g_task_switch_hook_count;
 
 /**
- * @brief Call memory allocation failure hook
- */
-void zk_hook_call_malloc_failed(zk_uint32 size);
+ * @brief Call task switch hooks
+ * @param from_tcb TCB of the task being switched out
+ * @param to_tcb TCB of the task being switched in
+ * @note  Called in PendSV interrupt
+ */
+static inline void zk_hook_call_task_switch(task_control_block_t *from_tcb,
+											task_control_block_t *to_tcb)
+{
+	for (zk_uint32 i = 0; i < g_task_switch_hook_count; i++)
+	{
+		((task_switch_hook_t) g_task_switch_hooks[i])(from_tcb, to_tcb);
+	}
+}
+#else
+#define zk_hook_call_task_switch(from_tcb, to_tcb) ((void) 0)
+#endif
+
+#if ZK_HOOK_TICK_MAX > 0
+extern zk_hook_fn_t g_tick_hooks[ZK_HOOK_TICK_MAX];
+extern volatile zk_uint8 g_tick_hook_count;
+
+/**
+ * @brief Call tick hooks
+ * @note  Called in SysTick interrupt
+ */
+static inline void zk_hook_call_tick(void)
+{
+	for (zk_uint32 i = 0; i < g_tick_hook_count; i++)
+	{
+		((tick_hook_t) g_tick_hooks[i])();
+	}
+}
+#else
+#define zk_hook_call_tick() ((void) 0)
+#endif
+
+#if ZK_HOOK_STACK_OVERFLOW_MAX > 0
+extern zk_hook_fn_t g_stack_overflow_hooks[ZK_HOOK_STACK_OVERFLOW_MAX];
+extern volatile zk_uint8 g_stack_overflow_hook_count;
+
+/**
+ * @brief Call stack overflow hooks
+ * @param tcb TCB of the task with stack overflow
+ * @note  Called when stack overflow is detected
+ */
+static inline void zk_hook_call_stack_overflow(task_control_block_t *tcb)
+{
+	for (zk_uint32 i = 0; i < g_stack_overflow_hook_count; i++)
+	{
+		((stack_overflow_hook_t) g_stack_overflow_hooks[i])(tcb);
+	}
+}
+#else
+#define zk_hook_call_stack_overflow(tcb) ((void) 0)
+#endif
+
+#if ZK_HOOK_MALLOC_FAILED_MAX > 0
+extern zk_hook_fn_t g_malloc_failed_hooks[ZK_HOOK_MALLOC_FAILED_MAX];
+extern volatile zk_uint8 g_malloc_failed_hook_count;
+
+/**
+ * @brief Call memory allocation failure hooks
+ * @param size Requested memory allocation size
+ * @note  Called when memory allocation fails
+ */
+static inline void zk_hook_call_malloc_failed(zk_uint32 size)
+{
+	for (zk_uint32 i = 0; i < g_malloc_failed_hook_count; i++)
+	{
+		((malloc_failed_hook_t) g_malloc_failed_hooks[i])(size);
+	}
+}
+#else
+#define zk_hook_call_malloc_failed(size) ((void) 0)
+#endif
+
+#if ZK_USING_HEARTBEAT && (ZK_HOOK_HEARTBEAT_MISS_MAX > 0)
+extern zk_hook_fn_t g_heartbeat_miss_hooks[ZK_HOOK_HEARTBEAT_MISS_MAX];
+extern volatile zk_uint8 g_heartbeat_miss_hook_count;
+
+/**
+ * @brief Call heartbeat miss hooks
+ * @param tcb TCB of the late task
+ * @param lateness Ticks past the deadline
+ * @note  Called in SysTick interrupt and in the late task
+ */
+static inline void zk_hook_call_heartbeat_miss(task_control_block_t *tcb, zk_uint32 lateness)
+{
+	for (zk_uint32 i = 0; i < g_heartbeat_miss_hook_count; i++)
+	{
+		((heartbeat_miss_hook_t) g_heartbeat_miss_hooks[i])(tcb, lateness);
+	}
+}
+#else
+#define zk_hook_call_heartbeat_miss(tcb, lateness) ((void) 0)
+#endif
 
 #endif /* ZK_USING_HOOK */
 
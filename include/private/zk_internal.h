@@ -8,27 +8,158 @@
 #define ZK_INTERNAL_H
 
 #include "zk_def.h"
-#include "zk_cpu_cm3.h" /* Include inline critical section functions */
+#include "zk_port.h"     /* Include inline critical section functions */
 #include "zk_cpu.h"     /* Include CPU abstraction layer macro definitions */
 
+/* ==================== Critical section instrumentation ==================== */
+#if ZK_USING_CRITICAL_STATS
+/* Each kernel file defines its subsystem before including this header */
+#ifndef ZK_CRITICAL_SUBSYS
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_OTHER
+#endif
+
+void zk_critical_stats_begin(zk_uint32 subsys);
+void zk_critical_stats_end(void);
+
+/* Only the outermost enter/exit pair is timed, with interrupts already masked */
+#undef ZK_ENTER_CRITICAL
+#undef ZK_EXIT_CRITICAL
+#define ZK_ENTER_CRITICAL()                                                                        \
+	do                                                                                             \
+	{                                                                                              \
+		zk_cpu_enter_critical();                                                                   \
+		if (zk_critical_nesting == 1U)                                                             \
+		{                                                                                          \
+			zk_critical_stats_begin(ZK_CRITICAL_SUBSYS);                                           \
+		}                                                                                          \
+	} while (0)
+#define ZK_EXIT_CRITICAL()                                                                         \
+	do                                                                                             \
+	{                                                                                              \
+		if (zk_critical_nesting == 1U)                                                             \
+		{                                                                                          \
+			zk_critical_stats_end();                                                               \
+		}                                                                                          \
+		zk_cpu_exit_critical();                                                                    \
+	} while (0)
+#endif
+
+
+/* ==================== Trace points ==================== */
+#if ZK_USING_TRACE
+void zk_trace_record(zk_uint32 event, zk_uint32 object, zk_uint32 arg);
+#define ZK_TRACE(event, object, arg)                                                               \
+	zk_trace_record((event), (zk_uint32) (unsigned long) (object), (zk_uint32) (arg))
+#else
+#define ZK_TRACE(event, object, arg)
+#endif
+
+/* ==================== Performance counters ==================== */
+/* Plain read-modify-write, callers are inside a critical section */
+#if ZK_USING_PERF_COUNTERS
+extern volatile zk_perf_counters_t g_zk_perf_counters;
+#define ZK_PERF_ADD(field, n) (g_zk_perf_counters.field += (n))
+#define ZK_PERF_MAX(field, value)                                                                  \
+	do                                                                                             \
+	{                                                                                              \
+		if ((value) > g_zk_perf_counters.field)                                                    \
+		{                                                                                          \
+			g_zk_perf_counters.field = (value);                                                    \
+		}                                                                                          \
+	} while (0)
+#else
+#define ZK_PERF_ADD(field, n) ((void) 0)
+#define ZK_PERF_MAX(field, value) ((void) 0)
+#endif
 
 /* ==================== Time management internal functions ==================== */
 zk_uint32 get_current_time(void);
 void increment_time(void);
 zk_uint32 get_total_run_time(void); /* P1: Get system total runtime */
+void zk_time_step(zk_uint32 ticks);
+#if ZK_USING_TIME64
+zk_uint64 get_current_time64(void);
+zk_uint64 get_total_run_time64(void);
+zk_uint32 zk_timeout_until64(zk_uint64 deadline);
+#endif
 
 /* ==================== Scheduler internal functions ==================== */
 void schedule(void);
-zk_bool is_scheduler_suspending(void);
+zk_uint8 is_scheduler_suspending(void);
 task_control_block_t *get_highest_priority_task(void);
 zk_uint32 scheduler_increment_tick(void);
+#if (ZK_TASK_STATS_MODE == 3)
+void zk_isr_enter(void);
+void zk_isr_exit(void);
+#endif
+#if ZK_USING_TICKLESS
+zk_uint32 scheduler_get_expected_idle_ticks(void);
+#if ZK_USING_PM
+void pm_idle(zk_uint32 idle_ticks);
+#endif
+#endif
 void zk_start_scheduler(void); /* System startup function (implemented in zk_board.c) */
 
+extern task_control_block_t *volatile g_current_tcb;
+
+/**
+ * @brief Record whether a task made ready from an ISR should preempt the interrupted task
+ * @param tcb Task that was just made ready (may be NULL)
+ * @param higher_priority_woken Output flag, only ever set (never cleared) so that several
+ *        _from_isr calls can share one flag and one zk_yield_from_isr()
+ */
+static inline void zk_isr_note_woken(task_control_block_t *tcb, zk_bool *higher_priority_woken)
+{
+	if (tcb != ZK_NULL && higher_priority_woken != ZK_NULL &&
+		tcb->priority < g_current_tcb->priority)
+	{
+		*higher_priority_woken = ZK_TRUE;
+	}
+#if ZK_USING_EDF
+	/* within the EDF band an earlier absolute deadline preempts */
+	if (tcb != ZK_NULL && higher_priority_woken != ZK_NULL &&
+		tcb->priority == ZK_EDF_PRIORITY && g_current_tcb->priority == ZK_EDF_PRIORITY &&
+		tcb->edf_period != 0 && g_current_tcb->edf_period != 0 &&
+		zk_time_is_before(tcb->edf_deadline, g_current_tcb->edf_deadline))
+	{
+		*higher_priority_woken = ZK_TRUE;
+	}
+#endif
+}
+
+#if ZK_USING_SLACK
+/**
+ * @brief Pick the wake-up time inside [deadline, deadline + slack] that is shared by the most
+ *        other wakeups: the one with the most trailing zero bits
+ * @note Every caller rounds onto the same power-of-two boundaries, so unrelated timers and
+ *       delays with slack end up on common ticks without knowing about each other
+ */
+static inline zk_uint32 zk_time_apply_slack(zk_uint32 deadline, zk_uint32 slack)
+{
+	zk_uint32 latest = deadline + slack;
+	zk_uint32 differ = deadline ^ latest;
+
+	if (slack == 0 || differ == 0)
+	{
+		return deadline;
+	}
+	/* keep the highest bit in which the window differs, clear everything below it */
+	return latest & ~((1UL << zk_cpu_fls(differ)) - 1UL);
+}
+#endif
+
 /* ==================== Task management internal functions ==================== */
 void idle_task_create(void);
 zk_error_code_t task_create(task_init_parameter_t *parameter, zk_uint32 *task_handle);
 void add_task_to_ready_list(task_control_block_t *tcb);
 void remove_task_from_ready_list(task_control_block_t *tcb);
+void remove_task_from_delay_list(task_control_block_t *tcb);
+void remove_task_from_blocked_list(task_control_block_t *tcb);
+#if ZK_USING_WAIT_INDEX
+void wait_index_requeue(task_control_block_t *tcb);
+#endif
+void add_task_to_suspend_list(task_control_block_t *tcb);
+void remove_task_from_suspend_list(task_control_block_t *tcb);
 
 /* Task state transition functions */
 void task_ready_to_delay(task_control_block_t *tcb);
@@ -41,18 +172,69 @@ void task_block_to_ready(task_control_block_t *tcb);
 /* Temporary task priority modification (for priority inheritance) */
 void task_change_priority_temp(task_control_block_t *tcb, zk_uint8 new_priority);
 void task_resume_priority(task_control_block_t *tcb);
+#if ZK_USING_STACK_WATCH
+void task_stack_watch_step(void);
+#endif
+#if ZK_USING_TASK_LIST
+zk_bool task_handle_is_valid(zk_uint32 task_handle);
+#endif
+
+#if (ZK_TASK_STATS_MODE == 1) || (ZK_TASK_STATS_MODE == 3)
+/* Run-time accounting, called by the port on every context switch */
+void task_update_runtime_stats(task_control_block_t *old_tcb, task_control_block_t *new_tcb);
+#endif
 
 /* ==================== Memory management internal functions ==================== */
 void *mem_alloc(zk_uint32 size);
 void mem_free(void *addr);
+void *mem_alloc_region(zk_uint32 caps, zk_uint32 size);
+/* Per-region backend (first-fit in zk_mem.c or TLSF in zk_mem_tlsf.c) */
+void mem_heap_init(mem_manager_t *heap, zk_uint32 start, zk_uint32 size);
+void *mem_heap_alloc(mem_manager_t *heap, zk_uint32 request_size);
+void mem_heap_free(mem_manager_t *heap, void *user_addr);
+#if ZK_USING_MEM_POOL
+void mem_pool_init(void);
+#endif
+
+/* ==================== Mutex internal functions ==================== */
+#if ZK_USING_MUTEX
+zk_bool mutex_is_owned_by(const task_control_block_t *tcb);
+zk_uint8 mutex_held_priority(const task_control_block_t *tcb);
+#endif
+#if ZK_USING_RWLOCK
+zk_bool rwlock_is_owned_by(const task_control_block_t *tcb);
+#endif
 
 /* ==================== Timer internal functions ==================== */
-#ifdef ZK_USING_TIMER
+#if ZK_USING_TIMER
 void timer_check(zk_uint32 current_time);
+zk_bool timer_get_next_expiry(zk_uint32 *wake_up_time);
+#endif
+
+/* ==================== Heartbeat internal functions ==================== */
+#if ZK_USING_HEARTBEAT
+void heartbeat_check(void);
+zk_bool heartbeat_get_next_expiry(zk_uint32 *wake_up_time);
+void heartbeat_remove(task_control_block_t *tcb);
+#endif
+
+/* ==================== Queue internal functions ==================== */
+#if ZK_USING_QUEUE
+/* Check a length against the element size, for transfers that fill a slot outside zk_queue.c */
+zk_error_code_t queue_check_size(zk_uint32 queue_handle, zk_uint32 size);
+#endif
+
+#if ZK_USING_QUEUE_SET
+/* Post a member id to its queue set, returns the woken selector (called in critical section) */
+task_control_block_t *queue_set_post(zk_uint32 set_handle, zk_uint32 member);
+zk_error_code_t sem_join_queue_set(zk_uint32 sem_handle, zk_uint32 set_handle);
+zk_error_code_t sem_leave_queue_set(zk_uint32 sem_handle, zk_uint32 set_handle);
 #endif
 
 /* ==================== Architecture-related functions ==================== */
 void *zk_arch_prepare_stack(void *stack_start, void *param);
+/* Drop port state behind tcb->stack of a deleted task, called before its memory is freed */
+void zk_arch_release_stack(void *stack);
 
 /* ==================== Utility macros ==================== */
 #define TASK_HANDLE_TO_TCB(handle) ((task_control_block_t *) handle)
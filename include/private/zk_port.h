@@ -0,0 +1,24 @@
+/**
+ * @file    zk_port.h
+ * @brief   ZK-RTOS 移植层头文件选择
+ * @note    按 zk_config.h 中的 ZK_CPU_ARCH 包含对应架构的实现头文件
+ *
+ * ⚠️  警告: 此文件为内核代码,用户不应修改!
+ */
+
+#ifndef ZK_PORT_H
+#define ZK_PORT_H
+
+#include "zk_config.h"
+
+#if ZK_CPU_ARCH == ZK_ARCH_CM4F
+#include "zk_cpu_cm4f.h"
+#elif ZK_CPU_ARCH == ZK_ARCH_POSIX
+#include "zk_cpu_posix.h"
+#elif ZK_CPU_ARCH == ZK_ARCH_CM3
+#include "zk_cpu_cm3.h"
+#else
+#error "zk_port.h: unsupported ZK_CPU_ARCH"
+#endif
+
+#endif /* ZK_PORT_H */
@@ -30,6 +30,11 @@ void zk_kernel_init(void);
 void zk_start_scheduler(void);
 
 zk_uint32 get_current_time(void);
+/* 64-bit tick base: never wraps, absolute deadlines for the *_until64 waits */
+#if ZK_USING_TIME64
+zk_uint64 get_current_time64(void);
+zk_uint32 zk_timeout_until64(zk_uint64 deadline);
+#endif
 
 /**
  * @brief Simple blocking delay function (busy-wait)
@@ -41,71 +46,511 @@ zk_uint32 get_current_time(void);
 void zk_delay_ms(zk_uint32 ms);
 
 
+/* ==================== System definition table API ==================== */
+#if ZK_USING_SYSTEM_TABLE
+/*
+ * The objects an application starts with, declared at compile time:
+ *
+ *     static zk_uint32 g_rx_sem, g_cmd_queue;
+ *     ZK_SYS_TASK_STORAGE(g_shell, 512);
+ *     ZK_SYS_QUEUE_STORAGE(g_cmd_queue, sizeof(cmd_t), 8);
+ *
+ *     static const zk_sys_object_t g_app_system[] = {
+ *         ZK_SYS_SEM(&g_rx_sem, 0),
+ *         ZK_SYS_QUEUE(&g_cmd_queue, sizeof(cmd_t), 8, g_cmd_queue),
+ *         ZK_SYS_TASK(ZK_NULL, "shell", shell_task, ZK_NULL, 5, g_shell),
+ *     };
+ *
+ *     zk_kernel_init();
+ *     ZK_SYSTEM_CREATE(g_app_system);
+ *
+ * The storage macros are used at file scope, the table entries name the same variable.
+ */
+zk_error_code_t zk_system_create(const zk_sys_object_t *objects, zk_uint32 num);
+
+#define ZK_SYSTEM_CREATE(table) zk_system_create((table), sizeof(table) / sizeof((table)[0]))
+
+/* TCB and stack of a table task, stack_size in bytes */
+#define ZK_SYS_TASK_STORAGE(var, stack_size)                                                       \
+	static task_control_block_t var##_tcb;                                                         \
+	static zk_uint32 var##_stack[((stack_size) + sizeof(zk_uint32) - 1) / sizeof(zk_uint32)]
+
+/* Element buffer of a table queue */
+#define ZK_SYS_QUEUE_STORAGE(var, element_size, element_num)                                       \
+	static zk_uint32                                                                               \
+		var##_buffer[((element_size) * (element_num) + sizeof(zk_uint32) - 1) / sizeof(zk_uint32)]
+
+#define ZK_SYS_TASK(handle_ptr, task_name, entry, arg, prio, var)                                  \
+	{.type = ZK_SYS_OBJ_TASK, .priority = (prio), .handle = (handle_ptr), .name = (task_name),     \
+	 .task_entry = (entry), .param = (arg), .size = sizeof(var##_stack), .storage = var##_stack,   \
+	 .tcb = &var##_tcb}
+
+#define ZK_SYS_SEM(handle_ptr, initial_count)                                                      \
+	{.type = ZK_SYS_OBJ_SEM, .handle = (handle_ptr), .count = (initial_count)}
+
+#define ZK_SYS_MUTEX(handle_ptr) {.type = ZK_SYS_OBJ_MUTEX, .handle = (handle_ptr)}
+
+#define ZK_SYS_MUTEX_CEILING(handle_ptr, ceiling)                                                  \
+	{.type = ZK_SYS_OBJ_MUTEX, .priority = (ceiling), .flags = ZK_SYS_CEILING,                     \
+	 .handle = (handle_ptr)}
+
+#define ZK_SYS_QUEUE(handle_ptr, element_size, element_num, var)                                   \
+	{.type = ZK_SYS_OBJ_QUEUE, .handle = (handle_ptr), .size = (element_size),                     \
+	 .count = (element_num), .storage = var##_buffer}
+
+#define ZK_SYS_EVENT(handle_ptr) {.type = ZK_SYS_OBJ_EVENT, .handle = (handle_ptr)}
+
+/* timer_flags: ZK_SYS_TIMER_START to start the timer once created, 0 otherwise */
+#define ZK_SYS_TIMER(handle_ptr, timer_mode, interval, handler, arg, timer_flags)                  \
+	{.type = ZK_SYS_OBJ_TIMER, .flags = (timer_flags), .mode = (timer_mode),                       \
+	 .handle = (handle_ptr), .param = (arg), .count = (interval), .timer_handler = (handler)}
+#endif
+
+/* ==================== Scheduler lock API ==================== */
+/* Stop preemption without masking interrupts; calls nest, ticks and wakeups are replayed on
+ * the outermost resume. Blocking calls fail with ZK_ERR_STATE while suspended. */
+void scheduler_suspend(void);
+zk_error_code_t scheduler_resume(void);
+
 /* ==================== Task management API ==================== */
 
 zk_error_code_t task_create(task_init_parameter_t *parameter, zk_uint32 *task_handle);
+zk_error_code_t task_create_static(task_init_parameter_t *parameter, task_control_block_t *tcb,
+								   void *stack_buffer, zk_uint32 *task_handle);
+/* Handle 0 names the calling task. A deleted task's heap is freed later by the idle task */
+zk_error_code_t task_suspend(zk_uint32 task_handle);
+zk_error_code_t task_resume(zk_uint32 task_handle);
+zk_error_code_t task_delete(zk_uint32 task_handle);
 zk_bool task_check_stack_overflow(task_control_block_t *tcb);
 zk_uint32 task_get_stack_usage(task_control_block_t *tcb);
+#if ZK_USING_STACK_WATCH
+zk_uint32 task_get_all_stack_stats(task_stack_stats_t *stats, zk_uint32 max_count);
+#endif
 zk_uint32 task_get_runtime(task_control_block_t *tcb);
+#if ZK_USING_TIME64
+zk_uint64 task_get_runtime64(task_control_block_t *tcb);
+#endif
 zk_uint32 task_get_cpu_usage(task_control_block_t *tcb);
+#if ZK_USING_TASK_MONITOR
+/* "top"-style view of every task, CPU share measured between two snapshots */
+zk_uint32 task_monitor_snapshot(task_monitor_info_t *info, zk_uint32 max_count);
+void task_monitor_print(task_monitor_info_t *info, zk_uint32 max_count);
+#endif
+#if ZK_TASK_STATS_CYCLES
+zk_error_code_t task_get_cycle_stats(task_control_block_t *tcb, task_cycle_stats_t *stats);
+#endif
+/* Preemption threshold: cooperating tasks up to the threshold do not preempt each other */
+#if ZK_USING_PREEMPT_THRESHOLD
+zk_error_code_t task_set_preempt_threshold(zk_uint32 task_handle, zk_uint8 threshold,
+										   zk_uint8 *old_threshold);
+#endif
+/* Heartbeat monitor: registered tasks check in once per period, the watchdog registered by the
+ * BSP is fed only while all of them are on time */
+#if ZK_USING_HEARTBEAT
+zk_error_code_t task_heartbeat_register(zk_uint32 task_handle, zk_uint32 period);
+zk_error_code_t task_heartbeat(void);
+void heartbeat_set_watchdog(void (*feed)(void));
+#endif
+/* Earliest-deadline-first class: end of job, and per-task deadline statistics */
+#if ZK_USING_EDF
+zk_error_code_t task_edf_next_period(void);
+zk_error_code_t task_get_edf_stats(task_control_block_t *tcb, task_edf_stats_t *stats);
+#endif
+/* Bracket ISR bodies so their time is not charged to the interrupted task (no-op unless
+ * ZK_TASK_STATS_MODE is 3) */
+#if (ZK_TASK_STATS_MODE == 3)
+void zk_isr_enter(void);
+void zk_isr_exit(void);
+zk_uint64 zk_get_isr_cycles(void);
+#else
+#define zk_isr_enter()
+#define zk_isr_exit()
+#endif
+/* Interrupt-masked time per subsystem, measured on the outermost ZK_ENTER_CRITICAL()/EXIT */
+#if ZK_USING_CRITICAL_STATS
+zk_error_code_t zk_critical_get_stats(zk_uint32 subsys, zk_critical_stats_t *stats);
+void zk_critical_reset_stats(void);
+#endif
+/* Binary trace ring (events in zk_def.h, stream format in docs/二进制跟踪格式.md) */
+#if ZK_USING_TRACE
+void zk_trace_record(zk_uint32 event, zk_uint32 object, zk_uint32 arg);
+zk_uint32 zk_trace_read(zk_trace_record_t *records, zk_uint32 max_records);
+void zk_trace_dump(void);
+/* Byte sink of zk_trace_dump(), defaults to zk_putc; the BSP may override it */
+void zk_trace_output(const zk_uint8 *data, zk_uint32 len);
+#define ZK_TRACE_ISR_ENTER(irq) zk_trace_record(ZK_TRACE_EV_ISR_ENTER, 0, (irq))
+#define ZK_TRACE_ISR_EXIT(irq) zk_trace_record(ZK_TRACE_EV_ISR_EXIT, 0, (irq))
+#else
+#define ZK_TRACE_ISR_ENTER(irq)
+#define ZK_TRACE_ISR_EXIT(irq)
+#endif
+/* Kernel counters, read them directly (a debugger can watch the symbol live) */
+#if ZK_USING_PERF_COUNTERS
+extern volatile zk_perf_counters_t g_zk_perf_counters;
+#endif
 zk_error_code_t task_delay(zk_uint32 delay_time);
+zk_error_code_t task_delay_until(zk_uint32 *last_wake_time, zk_uint32 period);
+/* Millisecond variants of the timed calls, converted with zk_ms_to_ticks() (see
+ * ZK_TIME_ROUNDING). The *_timeout_ms variants pass ZK_TIMEOUT_NONE and ZK_TIMEOUT_INFINITE
+ * through; the delay variants use zk_ms_to_delay_ticks(), which waits at least one tick and
+ * does not accept ZK_TIMEOUT_INFINITE */
+#define task_delay_ms(ms) task_delay(zk_ms_to_delay_ticks(ms))
+#define task_delay_until_ms(last_wake_time, period_ms)                                             \
+	task_delay_until((last_wake_time), zk_ms_to_delay_ticks(period_ms))
+#if ZK_USING_TIME64
+zk_error_code_t task_delay_until64(zk_uint64 deadline);
+#endif
+#if ZK_USING_SLACK
+zk_error_code_t task_delay_slack(zk_uint32 delay_time, zk_uint32 slack);
+#endif
+
+/* Direct-to-task notification */
+#if ZK_USING_TASK_NOTIFY
+zk_error_code_t task_notify(zk_uint32 task_handle, zk_uint32 value, task_notify_action_t action);
+zk_error_code_t task_notify_from_isr(zk_uint32 task_handle, zk_uint32 value,
+									 task_notify_action_t action, zk_bool *higher_priority_woken);
+zk_error_code_t task_notify_wait(zk_uint32 clear_on_entry, zk_uint32 clear_on_exit,
+								 zk_uint32 *value, zk_uint32 timeout);
+#endif
 
 /* ==================== Scheduler API ==================== */
 void scheduler_init(void);
 void start_scheduler(void);
 
+/**
+ * @brief Trigger the deferred context switch at the end of an ISR
+ * @param higher_priority_woken Flag collected from the *_from_isr calls of this ISR
+ */
+void zk_yield_from_isr(zk_bool higher_priority_woken);
+
 /* ==================== Timer API ==================== */
-#ifdef ZK_USING_TIMER
+#if ZK_USING_TIMER
 void timer_init(void);
 zk_error_code_t timer_create(zk_uint32 *timer_handle, timer_mode_t mode, zk_uint32 interval,
 							 timer_handler_t handler, void *param);
+#define timer_create_ms(timer_handle, mode, interval_ms, handler, param)                           \
+	timer_create((timer_handle), (mode), zk_ms_to_ticks(interval_ms), (handler), (param))
 zk_error_code_t timer_start(zk_uint32 timer_handle);
 zk_error_code_t timer_stop(zk_uint32 timer_handle);
 zk_error_code_t timer_delete(zk_uint32 timer_handle);
 zk_error_code_t timer_reset(zk_uint32 timer_handle, zk_uint32 new_interval);
 zk_error_code_t timer_get_remaining(zk_uint32 timer_handle, zk_uint32 *remaining);
+#if ZK_USING_SLACK
+zk_error_code_t timer_set_slack(zk_uint32 timer_handle, zk_uint32 slack);
+#endif
 #endif
 
 /* ==================== Semaphore API ==================== */
-#ifdef ZK_USING_SEMAPHORE
+#if ZK_USING_SEMAPHORE
 void sem_init(void);
 zk_error_code_t sem_create(zk_uint32 *sem_handle, zk_uint32 initial_count);
 zk_error_code_t sem_get(zk_uint32 sem_handle);
 zk_error_code_t sem_try_get(zk_uint32 sem_handle);
 zk_error_code_t sem_get_timeout(zk_uint32 sem_handle, zk_uint32 timeout);
+#define sem_get_timeout_ms(sem_handle, timeout_ms)                                                 \
+	sem_get_timeout((sem_handle), zk_ms_to_ticks(timeout_ms))
+#if ZK_USING_TIME64
+zk_error_code_t sem_get_until64(zk_uint32 sem_handle, zk_uint64 deadline);
+#endif
 zk_error_code_t sem_release(zk_uint32 sem_handle);
+/* Fan-out: several waiters woken in one critical section with a single schedule() */
+zk_error_code_t sem_release_n(zk_uint32 sem_handle, zk_uint32 n);
+zk_error_code_t sem_flush(zk_uint32 sem_handle);
 zk_error_code_t sem_destroy(zk_uint32 sem_handle);
+/* ISR-safe interface (never blocks, finish the ISR with zk_yield_from_isr) */
+zk_error_code_t sem_release_from_isr(zk_uint32 sem_handle, zk_bool *higher_priority_woken);
+zk_error_code_t sem_try_get_from_isr(zk_uint32 sem_handle);
+#endif
+
+/* ==================== Event group API ==================== */
+#if ZK_USING_EVENT
+void event_init(void);
+zk_error_code_t event_create(zk_uint32 *event_handle);
+zk_error_code_t event_destroy(zk_uint32 event_handle);
+zk_error_code_t event_set(zk_uint32 event_handle, zk_uint32 flags);
+zk_error_code_t event_clear(zk_uint32 event_handle, zk_uint32 flags);
+zk_error_code_t event_get(zk_uint32 event_handle, zk_uint32 *flags);
+zk_error_code_t event_wait(zk_uint32 event_handle, zk_uint32 mask, event_wait_mode_t mode,
+						   zk_bool clear_on_exit, zk_uint32 *received, zk_uint32 timeout);
+/* ISR-safe interface (never blocks, finish the ISR with zk_yield_from_isr) */
+zk_error_code_t event_set_from_isr(zk_uint32 event_handle, zk_uint32 flags,
+								   zk_bool *higher_priority_woken);
 #endif
 
 /* ==================== Mutex API ==================== */
-#ifdef ZK_USING_MUTEX
+#if ZK_USING_MUTEX
 void mutex_init(void);
 zk_error_code_t mutex_create(zk_uint32 *MutexHandle);
+#if ZK_USING_MUTEX_CEILING
+zk_error_code_t mutex_create_ceiling(zk_uint32 *MutexHandle, zk_uint8 CeilingPriority);
+#endif
 zk_error_code_t mutex_lock(zk_uint32 MutexHandle);
 zk_error_code_t mutex_lock_timeout(zk_uint32 MutexHandle, zk_uint32 Timeout);
+#define mutex_lock_timeout_ms(mutex_handle, timeout_ms)                                            \
+	mutex_lock_timeout((mutex_handle), zk_ms_to_ticks(timeout_ms))
+#if ZK_USING_TIME64
+zk_error_code_t mutex_lock_until64(zk_uint32 MutexHandle, zk_uint64 Deadline);
+#endif
 zk_error_code_t mutex_try_lock(zk_uint32 MutexHandle);
 zk_error_code_t mutex_unlock(zk_uint32 MutexHandle);
 zk_error_code_t mutex_destroy(zk_uint32 MutexHandle);
 #endif
 
 
+/* ==================== Reader-writer lock API ==================== */
+#if ZK_USING_RWLOCK
+void rwlock_init(void);
+zk_error_code_t rwlock_create(zk_uint32 *rwlock_handle);
+zk_error_code_t rwlock_destroy(zk_uint32 rwlock_handle);
+zk_error_code_t rwlock_read_lock(zk_uint32 rwlock_handle, zk_uint32 timeout);
+zk_error_code_t rwlock_read_unlock(zk_uint32 rwlock_handle);
+zk_error_code_t rwlock_write_lock(zk_uint32 rwlock_handle, zk_uint32 timeout);
+zk_error_code_t rwlock_write_unlock(zk_uint32 rwlock_handle);
+#endif
+
+/* ==================== Message / stream buffer API ==================== */
+#if ZK_USING_MSGBUF
+void msgbuf_init(void);
+zk_error_code_t msgbuf_create(zk_uint32 *msgbuf_handle, msgbuf_mode_t mode, zk_uint32 size,
+							  zk_uint32 trigger_level);
+zk_error_code_t msgbuf_create_static(zk_uint32 *msgbuf_handle, msgbuf_mode_t mode,
+									 zk_uint32 size, zk_uint32 trigger_level, void *buffer);
+zk_error_code_t msgbuf_destroy(zk_uint32 msgbuf_handle);
+zk_error_code_t msgbuf_send(zk_uint32 msgbuf_handle, const void *data, zk_uint32 len,
+							zk_uint32 *sent, zk_uint32 timeout);
+zk_error_code_t msgbuf_receive(zk_uint32 msgbuf_handle, void *buffer, zk_uint32 size,
+							   zk_uint32 *received, zk_uint32 timeout);
+zk_error_code_t msgbuf_next_length(zk_uint32 msgbuf_handle, zk_uint32 *length);
+/* ISR-safe interface (never blocks, finish the ISR with zk_yield_from_isr) */
+zk_error_code_t msgbuf_send_from_isr(zk_uint32 msgbuf_handle, const void *data, zk_uint32 len,
+									 zk_uint32 *sent, zk_bool *higher_priority_woken);
+zk_error_code_t msgbuf_receive_from_isr(zk_uint32 msgbuf_handle, void *buffer, zk_uint32 size,
+										zk_uint32 *received, zk_bool *higher_priority_woken);
+#endif
+
+/* ==================== SPSC ring buffer API ==================== */
+#if ZK_USING_RING
+zk_error_code_t ring_init(zk_ring_t *ring, zk_uint8 *buffer, zk_uint32 capacity);
+zk_error_code_t ring_bind_notify(zk_ring_t *ring, zk_uint32 sem_handle);
+zk_uint32 ring_used(const zk_ring_t *ring);
+zk_uint32 ring_free(const zk_ring_t *ring);
+/* Producer side (exactly one task or ISR) */
+zk_uint32 ring_write(zk_ring_t *ring, const zk_uint8 *data, zk_uint32 len);
+zk_uint32 ring_write_from_isr(zk_ring_t *ring, const zk_uint8 *data, zk_uint32 len,
+							  zk_bool *higher_priority_woken);
+/* Consumer side (exactly one task; ring_read() is also ISR-safe) */
+zk_uint32 ring_read(zk_ring_t *ring, zk_uint8 *data, zk_uint32 len);
+zk_error_code_t ring_read_timeout(zk_ring_t *ring, zk_uint8 *data, zk_uint32 len,
+								  zk_uint32 *read, zk_uint32 timeout);
+/* Zero-copy consumer side, e.g. a DMA engine reading straight out of the ring */
+zk_uint32 ring_read_span(const zk_ring_t *ring, const zk_uint8 **span);
+void ring_consume(zk_ring_t *ring, zk_uint32 len);
+#endif
+
+/* ==================== MPMC queue API ==================== */
+#if ZK_USING_MPMC
+/* Any number of writer and reader tasks; ZK_TIMEOUT_NONE never blocks */
+zk_error_code_t mpmc_init(zk_mpmc_t *mpmc, void *storage, zk_uint32 element_size,
+						  zk_uint32 capacity);
+zk_error_code_t mpmc_write(zk_mpmc_t *mpmc, const void *data, zk_uint32 timeout);
+zk_error_code_t mpmc_read(zk_mpmc_t *mpmc, void *data, zk_uint32 timeout);
+zk_uint32 mpmc_count(const zk_mpmc_t *mpmc);
+#endif
+
+/* ==================== Work queue API ==================== */
+#if ZK_USING_WORKQUEUE
+/* queue ZK_NULL selects the system work queue (ZK_WORKQUEUE_TASK_PRIO) */
+void workqueue_init(void);
+zk_error_code_t workqueue_create(zk_workqueue_t *queue, zk_uint8 priority,
+								 zk_uint32 stack_size);
+void work_init(zk_work_t *work, zk_work_fn_t fn, void *arg);
+zk_error_code_t work_submit(zk_workqueue_t *queue, zk_work_t *work);
+zk_error_code_t work_submit_from_isr(zk_workqueue_t *queue, zk_work_t *work,
+									 zk_bool *higher_priority_woken);
+zk_bool work_is_pending(const zk_work_t *work);
+#if ZK_USING_TIMER
+/* Delayed work, each item owns one software timer */
+zk_error_code_t delayed_work_init(zk_delayed_work_t *dwork, zk_work_fn_t fn, void *arg);
+zk_error_code_t delayed_work_submit(zk_workqueue_t *queue, zk_delayed_work_t *dwork,
+									zk_uint32 ticks);
+zk_error_code_t delayed_work_cancel(zk_delayed_work_t *dwork);
+#endif
+#endif
+
+/* ==================== Coroutine API ==================== */
+#if ZK_USING_COROUTINE
+/*
+ * Stackless coroutines: a body is a function zk_uint8 fn(zk_co_t *co) whose code sits between
+ * ZK_CO_BEGIN(co) and ZK_CO_END(co). Every wait macro returns from fn and resumes at the same
+ * place on the next call, so a body must not keep locals across a wait and must not use a
+ * switch statement around one. Waits on IPC objects poll the non-blocking calls.
+ */
+zk_error_code_t co_sched_create(zk_co_sched_t *sched, zk_uint8 priority, zk_uint32 stack_size);
+zk_error_code_t co_start(zk_co_sched_t *sched, zk_co_t *co, zk_co_fn_t fn, void *arg);
+zk_error_code_t co_sched_wake(zk_co_sched_t *sched);
+zk_error_code_t co_sched_wake_from_isr(zk_co_sched_t *sched, zk_bool *higher_priority_woken);
+void co_set_timeout(zk_co_t *co, zk_uint32 timeout);
+zk_bool co_timed_out(const zk_co_t *co);
+
+#define ZK_CO_BEGIN(co)                                                                            \
+	switch ((co)->line)                                                                            \
+	{                                                                                              \
+	case 0:
+
+#define ZK_CO_END(co)                                                                              \
+	}                                                                                              \
+	(co)->line = 0;                                                                                \
+	return ZK_CO_EXITED
+
+#define ZK_CO_EXIT(co)                                                                             \
+	do                                                                                             \
+	{                                                                                              \
+		(co)->line = 0;                                                                            \
+		return ZK_CO_EXITED;                                                                       \
+	} while (0)
+
+/* Let the other coroutines of the scheduler run */
+#define ZK_CO_YIELD(co)                                                                            \
+	do                                                                                             \
+	{                                                                                              \
+		(co)->line = __LINE__;                                                                     \
+		return ZK_CO_YIELDED;                                                                      \
+	case __LINE__:;                                                                                \
+	} while (0)
+
+/* Wait for a condition, cond is evaluated again on every pass */
+#define ZK_CO_WAIT_UNTIL(co, cond)                                                                 \
+	do                                                                                             \
+	{                                                                                              \
+		(co)->line = __LINE__;                                                                     \
+	case __LINE__:                                                                                 \
+		if (!(cond))                                                                               \
+		{                                                                                          \
+			return ZK_CO_WAITING;                                                                  \
+		}                                                                                          \
+	} while (0)
+
+/* Sleep for ticks, the host task blocks while every coroutine sleeps */
+#define ZK_CO_DELAY(co, ticks)                                                                     \
+	do                                                                                             \
+	{                                                                                              \
+		(co)->wake_up_time = get_current_time() + (ticks);                                         \
+		(co)->line = __LINE__;                                                                     \
+		return ZK_CO_SLEEPING;                                                                     \
+	case __LINE__:;                                                                                \
+	} while (0)
+
+/*
+ * Retry a non-blocking call until it stops returning ZK_ERR_FAILED ("would block") or
+ * timeout ticks pass; result is then its return value, or ZK_ERR_TIMEOUT
+ */
+#define ZK_CO_AWAIT(co, call, timeout, result)                                                     \
+	do                                                                                             \
+	{                                                                                              \
+		co_set_timeout((co), (timeout));                                                           \
+		(co)->line = __LINE__;                                                                     \
+	case __LINE__:                                                                                 \
+		(result) = (call);                                                                         \
+		if ((result) == ZK_ERR_FAILED)                                                             \
+		{                                                                                          \
+			if (!co_timed_out(co))                                                                 \
+			{                                                                                      \
+				return ZK_CO_WAITING;                                                              \
+			}                                                                                      \
+			(result) = ZK_ERR_TIMEOUT;                                                             \
+		}                                                                                          \
+	} while (0)
+
+#define ZK_CO_SEM_GET(co, sem_handle, timeout, result)                                             \
+	ZK_CO_AWAIT(co, sem_try_get(sem_handle), timeout, result)
+#define ZK_CO_QUEUE_READ(co, queue_handle, buffer, size, timeout, result)                          \
+	ZK_CO_AWAIT(co, queue_try_read(queue_handle, buffer, size), timeout, result)
+#define ZK_CO_QUEUE_WRITE(co, queue_handle, buffer, size, timeout, result)                         \
+	ZK_CO_AWAIT(co, queue_try_write(queue_handle, buffer, size), timeout, result)
+#endif
+
+/* ==================== Power management API ==================== */
+#if ZK_USING_PM
+/*
+ * The idle task picks the deepest mode whose min_ticks fits the expected idle time and that no
+ * constraint forbids. A driver whose clock or wakeup source does not survive a mode holds a
+ * constraint on it while it is busy; a constraint forbids the mode and every deeper one.
+ */
+void pm_register(const zk_pm_ops_t *ops);
+zk_error_code_t pm_constraint_get(zk_pm_mode_t mode);
+zk_error_code_t pm_constraint_put(zk_pm_mode_t mode);
+zk_error_code_t pm_get_stats(zk_pm_mode_t mode, zk_pm_stats_t *stats);
+#endif
+
 /* ==================== Message queue API ==================== */
-#ifdef ZK_USING_QUEUE
+#if ZK_USING_QUEUE
 /* Queue management interface */
 void queue_init(void);
 zk_error_code_t queue_create(zk_uint32 *queue_handle, zk_uint32 element_single_size,
 							 zk_uint32 element_num);
+zk_error_code_t queue_create_static(zk_uint32 *queue_handle, zk_uint32 element_single_size,
+									zk_uint32 element_num, void *buffer);
+zk_error_code_t queue_create_rendezvous(zk_uint32 *queue_handle, zk_uint32 element_single_size);
 zk_error_code_t queue_destroy(zk_uint32 queue_handle);
 /* Queue write interface */
 zk_error_code_t queue_write(zk_uint32 queue_handle, const void *buffer, zk_uint32 size);
 zk_error_code_t queue_try_write(zk_uint32 queue_handle, const void *buffer, zk_uint32 size);
 zk_error_code_t queue_write_timeout(zk_uint32 queue_handle, const void *buffer, zk_uint32 size,
 									zk_uint32 timeout);
+#define queue_write_timeout_ms(queue_handle, buffer, size, timeout_ms)                             \
+	queue_write_timeout((queue_handle), (buffer), (size), zk_ms_to_ticks(timeout_ms))
 /* Queue read interface */
 zk_error_code_t queue_read(zk_uint32 queue_handle, void *buffer, zk_uint32 size);
 zk_error_code_t queue_try_read(zk_uint32 queue_handle, void *buffer, zk_uint32 size);
 zk_error_code_t queue_read_timeout(zk_uint32 queue_handle, void *buffer, zk_uint32 size,
 								   zk_uint32 timeout);
+#define queue_read_timeout_ms(queue_handle, buffer, size, timeout_ms)                              \
+	queue_read_timeout((queue_handle), (buffer), (size), zk_ms_to_ticks(timeout_ms))
+#if ZK_USING_TIME64
+zk_error_code_t queue_write_until64(zk_uint32 queue_handle, const void *buffer, zk_uint32 size,
+									zk_uint64 deadline);
+zk_error_code_t queue_read_until64(zk_uint32 queue_handle, void *buffer, zk_uint32 size,
+								   zk_uint64 deadline);
+#endif
+/* Batch interface (up to count elements, one wakeup pass and one schedule per call) */
+zk_error_code_t queue_write_n(zk_uint32 queue_handle, const void *buffer, zk_uint32 count,
+							  zk_uint32 *written, zk_uint32 timeout);
+zk_error_code_t queue_read_n(zk_uint32 queue_handle, void *buffer, zk_uint32 count,
+							 zk_uint32 *read, zk_uint32 timeout);
+/* Zero-copy interface (slot stays inside the queue buffer) */
+zk_error_code_t queue_reserve(zk_uint32 queue_handle, void **slot, zk_uint32 timeout);
+zk_error_code_t queue_commit(zk_uint32 queue_handle);
+zk_error_code_t queue_peek(zk_uint32 queue_handle, void **slot, zk_uint32 timeout);
+zk_error_code_t queue_release(zk_uint32 queue_handle);
+/* ISR-safe interface (never blocks, finish the ISR with zk_yield_from_isr) */
+zk_error_code_t queue_write_from_isr(zk_uint32 queue_handle, const void *buffer, zk_uint32 size,
+									 zk_bool *higher_priority_woken);
+zk_error_code_t queue_read_from_isr(zk_uint32 queue_handle, void *buffer, zk_uint32 size,
+									zk_bool *higher_priority_woken);
+/* Queue set: one wait over several queues and semaphores, members are
+ * QUEUE_SET_MEMBER_QUEUE(handle) / QUEUE_SET_MEMBER_SEM(handle) */
+#if ZK_USING_QUEUE_SET
+zk_error_code_t queue_set_create(zk_uint32 *set_handle, zk_uint32 length);
+zk_error_code_t queue_set_add(zk_uint32 set_handle, zk_uint32 member);
+zk_error_code_t queue_set_remove(zk_uint32 set_handle, zk_uint32 member);
+zk_error_code_t queue_set_select(zk_uint32 set_handle, zk_uint32 *member, zk_uint32 timeout);
+#endif
+/* Mailbox: a queue of single pointers, destroyed with queue_destroy() */
+#if ZK_USING_MAILBOX
+zk_error_code_t mbox_create(zk_uint32 *mbox_handle, zk_uint32 length);
+zk_error_code_t mbox_post(zk_uint32 mbox_handle, void *msg, zk_uint32 timeout);
+zk_error_code_t mbox_fetch(zk_uint32 mbox_handle, void **msg, zk_uint32 timeout);
+zk_error_code_t mbox_post_from_isr(zk_uint32 mbox_handle, void *msg,
+								   zk_bool *higher_priority_woken);
+zk_error_code_t mbox_fetch_from_isr(zk_uint32 mbox_handle, void **msg,
+									zk_bool *higher_priority_woken);
+#if ZK_USING_MEM_POOL
+/* Ownership transfer of fixed-size pool blocks */
+zk_error_code_t mbox_send_block(zk_uint32 mbox_handle, zk_uint32 pool_handle, void *block,
+								zk_uint32 timeout);
+zk_error_code_t mbox_free_block(zk_uint32 pool_handle, void *block);
+#endif
+#endif
 #endif
 
 /* ==================== Memory management API ==================== */
@@ -113,14 +558,55 @@ void mem_init(void);
 void *mem_alloc(zk_uint32 size);
 void mem_free(void *addr);
 
+/* Multiple heap regions (CCM/SRAM/external), MEM_CAP_* flags */
+zk_error_code_t mem_add_region(void *start, zk_uint32 size, zk_uint32 caps);
+void *mem_alloc_region(zk_uint32 caps, zk_uint32 size);
+zk_error_code_t mem_get_region_stats(zk_uint32 region_index, zk_uint32 *caps,
+									 zk_uint32 *total_size, zk_uint32 *used_size,
+									 zk_uint32 *peak_used);
+
 /* P1: Memory statistics API */
 void mem_get_stats(zk_uint32 *total_size, zk_uint32 *used_size, zk_uint32 *peak_used,
 				   zk_uint32 *free_blocks, zk_uint32 *alloc_count, zk_uint32 *alloc_fail_count);
 zk_uint32 mem_get_fragmentation(void);
 
+/* Fixed-size block pool API (O(1) alloc/free) */
+#if ZK_USING_MEM_POOL
+zk_error_code_t mem_pool_create(zk_uint32 *pool_handle, zk_uint32 block_size,
+								zk_uint32 block_count);
+zk_error_code_t mem_pool_create_static(zk_uint32 *pool_handle, zk_uint32 block_size,
+									   void *buffer, zk_uint32 buffer_size);
+zk_error_code_t mem_pool_destroy(zk_uint32 pool_handle);
+void *mem_pool_alloc(zk_uint32 pool_handle);
+zk_error_code_t mem_pool_free(zk_uint32 pool_handle, void *block);
+zk_error_code_t mem_pool_get_stats(zk_uint32 pool_handle, zk_uint32 *block_size,
+								   zk_uint32 *total_blocks, zk_uint32 *free_blocks,
+								   zk_uint32 *peak_used, zk_uint32 *alloc_count,
+								   zk_uint32 *alloc_fail_count);
+#endif
+
+/* Arena (bump) allocator: request-scoped memory released in one arena_reset() */
+#if ZK_USING_ARENA
+zk_error_code_t arena_create(zk_arena_t *arena, zk_uint32 size, zk_uint8 flags);
+zk_error_code_t arena_create_static(zk_arena_t *arena, void *buffer, zk_uint32 size,
+									zk_uint8 flags);
+#if ZK_USING_MEM_POOL
+zk_error_code_t arena_create_from_pool(zk_arena_t *arena, zk_uint32 pool_handle, zk_uint8 flags);
+#endif
+zk_error_code_t arena_destroy(zk_arena_t *arena);
+void *arena_alloc(zk_arena_t *arena, zk_uint32 size);
+void arena_reset(zk_arena_t *arena);
+zk_error_code_t arena_get_stats(zk_arena_t *arena, zk_uint32 *size, zk_uint32 *used,
+								zk_uint32 *peak, zk_uint32 *fail_count);
+/* Default arena of a task, handle 0 names the calling task */
+zk_error_code_t task_set_arena(zk_uint32 task_handle, zk_arena_t *arena);
+zk_arena_t *task_get_arena(void);
+void *task_arena_alloc(zk_uint32 size);
+#endif
+
 
 /* ==================== Hook function API ==================== */
-#ifdef ZK_USING_HOOK
+#if ZK_USING_HOOK
 #include "zk_hook.h"
 #endif
 
@@ -129,10 +615,19 @@ zk_uint32 mem_get_fragmentation(void);
 /**
  * @brief Lightweight printf implementation
  * @param fmt Format string
- * @note Supported format specifiers: %d (signed) %u (unsigned) %x (hexadecimal) %s (string) %c (character)
+ * @note Supported: %d %u %x %X %p %s %c %%, flags - and 0, width and precision (also *),
+ *       l and ll (64-bit) length modifiers; precision only bounds %s, as in %.*s
  */
 void zk_printf(const char *fmt, ...);
 
+#if ZK_USING_DEFERRED_LOG
+/* Deferred logging: the caller only captures the arguments, the log task formats them */
+void zk_log_init(void);
+void zk_log(const char *fmt, ...);
+void zk_log_puts(const char *str);
+zk_uint32 zk_log_get_dropped(void);
+#endif
+
 /**
  * @brief Character output hook (user can override)
  * @param c Character to output
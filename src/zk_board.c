@@ -1,14 +1,12 @@
 /**
  * @file    zk_board.c
- * @brief   Board initialization and kernel startup functions
- * @note    Separated BSP layer and kernel layer initialization
+ * @brief   Kernel initialization and startup functions
+ * @note    Board initialization (board_init, zk_delay_ms) lives in the BSP, see
+ *          bsp/<board>/core/src/board.c
  */
 
 #include "zk_rtos.h"
 #include "zk_internal.h"
-#include "stm32f10x_it.h"
-
-extern void UART_Init(unsigned long ulWantedBaud);
 
 /**
  * @brief Initialize ZK-RTOS kernel (platform-independent)
@@ -18,102 +16,168 @@ extern void UART_Init(unsigned long ulWantedBaud);
 void zk_kernel_init(void)
 {
 	mem_init();
+#if ZK_USING_MEM_POOL
+	mem_pool_init();
+#endif
 	scheduler_init();
-#ifdef ZK_USING_MUTEX
+#if ZK_USING_MUTEX
 	mutex_init();
 #endif
-#ifdef ZK_USING_QUEUE
+#if ZK_USING_QUEUE
 	queue_init();
 #endif
-#ifdef ZK_USING_SEMAPHORE
+#if ZK_USING_SEMAPHORE
 	sem_init();
 #endif
-#ifdef ZK_USING_TIMER
+#if ZK_USING_TIMER
 	timer_init();
 #endif
+#if ZK_USING_EVENT
+	event_init();
+#endif
+#if ZK_USING_RWLOCK
+	rwlock_init();
+#endif
+#if ZK_USING_MSGBUF
+	msgbuf_init();
+#endif
+#if ZK_USING_DEFERRED_LOG
+	zk_log_init();
+#endif
+#if ZK_USING_WORKQUEUE
+	workqueue_init();
+#endif
+#if ZK_USING_CRITICAL_STATS || ZK_USING_TRACE || ZK_USING_PERF_COUNTERS
+	/* critical sections, trace records and allocations are timed by the cycle counter */
+	zk_cpu_cycle_counter_init();
+#endif
 }
 
+#if ZK_USING_SYSTEM_TABLE
 /**
- * @brief Start ZK-RTOS scheduler
- * @note  This function creates idle task and starts the first task
- *        Never returns
+ * @brief Create a task of a system definition table over its ZK_SYS_TASK_STORAGE()
  */
-void zk_start_scheduler(void)
+static zk_error_code_t zk_system_create_task(const zk_sys_object_t *object, zk_uint32 *handle)
 {
-	idle_task_create();
-	start_scheduler();  // 调用 scheduler 的 start_scheduler，会设置 g_current_tcb
+	task_init_parameter_t parameter;
+	zk_uint32 i = 0;
 
-	for (;;)
-		;
+	zk_memclear(&parameter, sizeof(parameter));
+	for (i = 0; object->name[i] != '\0' && i < CONFIG_TASK_NAME_LEN - 1; i++)
+	{
+		parameter.name[i] = (zk_uint8) object->name[i];
+	}
+	parameter.task_entry = object->task_entry;
+	parameter.priority = object->priority;
+	parameter.stack_size = object->size;
+	parameter.private_data = object->param;
+
+	return task_create_static(&parameter, object->tcb, object->storage, handle);
 }
+
 /**
- * @brief setup hardware clock and peripherals
+ * @brief Create one entry of a system definition table
+ * @return zk_error_code_t ZK_ERR_NOT_SUPPORTED for a type whose subsystem is switched off
  */
-static void setup_hardware(void)
+static zk_error_code_t zk_system_create_object(const zk_sys_object_t *object)
 {
-	RCC_DeInit();
-	/* Enable HSE (high speed external clock). */
-	RCC_HSEConfig(RCC_HSE_ON);
-	/* Wait till HSE is ready. */
-	while (RCC_GetFlagStatus(RCC_FLAG_HSERDY) == RESET)
+	zk_error_code_t ret = ZK_ERR_NOT_SUPPORTED;
+	zk_uint32 handle = 0;
+
+	switch (object->type)
 	{
+	case ZK_SYS_OBJ_TASK:
+		ret = zk_system_create_task(object, &handle);
+		break;
+#if ZK_USING_SEMAPHORE
+	case ZK_SYS_OBJ_SEM:
+		ret = sem_create(&handle, object->count);
+		break;
+#endif
+#if ZK_USING_MUTEX
+	case ZK_SYS_OBJ_MUTEX:
+		if (object->flags & ZK_SYS_CEILING)
+		{
+#if ZK_USING_MUTEX_CEILING
+			ret = mutex_create_ceiling(&handle, object->priority);
+#endif
+			break;
+		}
+		ret = mutex_create(&handle);
+		break;
+#endif
+#if ZK_USING_QUEUE
+	case ZK_SYS_OBJ_QUEUE:
+		ret = queue_create_static(&handle, object->size, object->count, object->storage);
+		break;
+#endif
+#if ZK_USING_EVENT
+	case ZK_SYS_OBJ_EVENT:
+		ret = event_create(&handle);
+		break;
+#endif
+#if ZK_USING_TIMER
+	case ZK_SYS_OBJ_TIMER:
+		ret = timer_create(&handle, (timer_mode_t) object->mode, object->count,
+						   object->timer_handler, object->param);
+		break;
+#endif
+	default:
+		break;
 	}
-	/* 2 wait states required on the flash. */
-	*((unsigned long *) 0x40022000) = 0x02;
 
-	/* HCLK = SYSCLK */
-	RCC_HCLKConfig(RCC_SYSCLK_Div1);
-	/* PCLK2 = HCLK */
-	RCC_PCLK2Config(RCC_HCLK_Div1);
-	/* PCLK1 = HCLK/2 */
-	RCC_PCLK1Config(RCC_HCLK_Div2);
-	/* PLLCLK = 8MHz * 9 = 72 MHz. */
-	RCC_PLLConfig(RCC_PLLSource_HSE_Div1, RCC_PLLMul_9);
-	/* Enable PLL. */
-	RCC_PLLCmd(ENABLE);
-	/* Wait till PLL is ready. */
-	while (RCC_GetFlagStatus(RCC_FLAG_PLLRDY) == RESET)
+	if (ret != ZK_SUCCESS)
 	{
+		return ret;
 	}
-	/* Select PLL as system clock source. */
-	RCC_SYSCLKConfig(RCC_SYSCLKSource_PLLCLK);
-	/* Wait till PLL is used as system clock source. */
-	while (RCC_GetSYSCLKSource() != 0x08)
+	if (object->handle != ZK_NULL)
 	{
+		*object->handle = handle;
 	}
-	/* Enable GPIOA, GPIOB, GPIOC, GPIOD, GPIOE and AFIO clocks */
-	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOB | RCC_APB2Periph_GPIOC |
-							   RCC_APB2Periph_GPIOD | RCC_APB2Periph_GPIOE | RCC_APB2Periph_AFIO,
-						   ENABLE);
-	/* SPI2 Periph clock enable */
-	RCC_APB1PeriphClockCmd(RCC_APB1Periph_SPI2, ENABLE);
-	/* Set the Vector Table base address at 0x08000000 */
-	NVIC_SetVectorTable(NVIC_VectTab_FLASH, 0x0);
-	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
-	/* Configure HCLK clock as SysTick clock source. */
-	SysTick_CLKSourceConfig(SysTick_CLKSource_HCLK);
+#if ZK_USING_TIMER
+	if (object->type == ZK_SYS_OBJ_TIMER && (object->flags & ZK_SYS_TIMER_START))
+	{
+		ret = timer_start(handle);
+	}
+#endif
+	return ret;
 }
 
-void board_init(void)
+/**
+ * @brief Create every object of a system definition table, in table order
+ * @param objects Table written with the ZK_SYS_*() macros, normally const in flash
+ * @param num Number of entries
+ * @return zk_error_code_t ZK_SUCCESS, otherwise the error of the first entry that failed;
+ *         the entries before it stay created
+ * @note  Call after zk_kernel_init() and before zk_start_scheduler(), so no table task runs
+ *        before every handle is set. Tasks and queues use the storage the table points to and
+ *        the other objects come from the static pools: nothing is taken from the heap.
+ */
+zk_error_code_t zk_system_create(const zk_sys_object_t *objects, zk_uint32 num)
 {
-	setup_hardware();
-	UART_Init(115200);
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 i = 0;
+
+	ZK_CHECK_PARAM_NOT_NULL(objects);
+
+	for (i = 0; i < num && ret == ZK_SUCCESS; i++)
+	{
+		ret = zk_system_create_object(&objects[i]);
+	}
+	return ret;
 }
+#endif
 
 /**
- * @brief Simple blocking delay function (busy-wait)
- * @param ms Delay time in milliseconds
- * @note  This is a simple busy-wait delay, does NOT use scheduler
- *        Use this in initialization code or when scheduler is not running
- *        For tasks, use task_delay() instead
+ * @brief Start ZK-RTOS scheduler
+ * @note  This function creates idle task and starts the first task
+ *        Never returns
  */
-void zk_delay_ms(zk_uint32 ms)
+void zk_start_scheduler(void)
 {
-	/* At 72MHz, approximately 72000 cycles per millisecond */
-	/* Divided by loop overhead (~3 cycles per iteration) = ~24000 iterations/ms */
-	volatile zk_uint32 count = ms * 24000;
-	while (count--)
-	{
-		/* Busy wait */
-	}
+	idle_task_create();
+	start_scheduler();  // 调用 scheduler 的 start_scheduler，会设置 g_current_tcb
+
+	for (;;)
+		;
 }
@@ -0,0 +1,216 @@
+/**
+ * @file    zk_coroutine.c
+ * @brief   stackless cooperative coroutines run by one host task
+ * @note    A coroutine is a zk_co_t (about 24 bytes) plus the state its body keeps in the
+ *          object that embeds it; it has no stack of its own. The host task calls every body
+ *          in turn, each runs until its next ZK_CO_* wait and returns. When no body can make
+ *          progress the host blocks on its semaphore until the nearest ZK_CO_DELAY wakeup,
+ *          the next poll of the IPC waits, co_start() or co_sched_wake().
+ */
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_COROUTINE
+
+/**
+ * @brief Lower the host wait to the ticks left until tick
+ */
+static zk_uint32 co_shorten_timeout(zk_uint32 timeout, zk_uint32 tick, zk_uint32 now)
+{
+	zk_int32 left = ZK_TIME_DIFF(tick, now);
+
+	if (left <= 0)
+	{
+		return 0;
+	}
+	return ((zk_uint32) left < timeout) ? (zk_uint32) left : timeout;
+}
+
+/**
+ * @brief Run every coroutine once
+ * @return zk_uint32 ticks the host may block, ZK_TIMEOUT_INFINITE when nothing is waiting
+ */
+static zk_uint32 co_sched_pass(zk_co_sched_t *sched)
+{
+	zk_list_node_t *node = ZK_NULL;
+	zk_list_node_t *next = ZK_NULL;
+	zk_co_t *co = ZK_NULL;
+	zk_uint32 timeout = ZK_TIMEOUT_INFINITE;
+	zk_uint32 now = 0;
+
+	ZK_LIST_FOR_EACH_NODE_SAFE(node, next, &sched->co_list)
+	{
+		co = ZK_LIST_GET_OWNER(node, zk_co_t, node);
+		now = get_current_time();
+
+		/* a sleeping body is not called until its tick */
+		if (co->state == ZK_CO_SLEEPING && zk_time_is_before(now, co->wake_up_time))
+		{
+			timeout = co_shorten_timeout(timeout, co->wake_up_time, now);
+			continue;
+		}
+
+		co->state = co->fn(co);
+		switch (co->state)
+		{
+		case ZK_CO_EXITED:
+			zk_list_delete(node);
+			break;
+		case ZK_CO_SLEEPING:
+			timeout = co_shorten_timeout(timeout, co->wake_up_time, now);
+			break;
+		case ZK_CO_WAITING:
+			if (timeout > ZK_CO_POLL_TICKS)
+			{
+				timeout = ZK_CO_POLL_TICKS;
+			}
+			if (co->has_deadline)
+			{
+				timeout = co_shorten_timeout(timeout, co->wake_up_time, now);
+			}
+			break;
+		default:
+			timeout = 0;
+			break;
+		}
+	}
+	return timeout;
+}
+
+static void co_sched_task(void *parameter)
+{
+	zk_co_sched_t *sched = (zk_co_sched_t *) parameter;
+	zk_uint32 timeout = 0;
+
+	for (;;)
+	{
+		ZK_ENTER_CRITICAL();
+		while (!zk_list_is_empty(&sched->start_list))
+		{
+			zk_list_move_to_tail(zk_list_get_first(&sched->start_list), &sched->co_list);
+		}
+		ZK_EXIT_CRITICAL();
+
+		timeout = co_sched_pass(sched);
+		if (timeout == ZK_TIMEOUT_INFINITE)
+		{
+			sem_get(sched->wakeup_sem);
+		}
+		else if (timeout != ZK_TIMEOUT_NONE)
+		{
+			sem_get_timeout(sched->wakeup_sem, timeout);
+		}
+	}
+}
+
+/**
+ * @brief Create a coroutine scheduler and its host task
+ * @param sched scheduler object, owned by the caller
+ * @param priority host task priority, shared by all its coroutines
+ * @param stack_size host task stack in bytes, sized for the deepest coroutine body
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t co_sched_create(zk_co_sched_t *sched, zk_uint8 priority, zk_uint32 stack_size)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_init_parameter_t parameter;
+
+	ZK_CHECK_PARAM_NOT_NULL(sched);
+
+	zk_list_init(&sched->co_list);
+	zk_list_init(&sched->start_list);
+	ret = sem_create(&sched->wakeup_sem, 0);
+	if (ret != ZK_SUCCESS)
+	{
+		return ret;
+	}
+
+	zk_memclear(&parameter, sizeof(task_init_parameter_t));
+	parameter.name[0] = 'C';
+	parameter.name[1] = 'O';
+	parameter.name[2] = ZK_STRING_TERMINATOR;
+	parameter.priority = priority;
+	parameter.private_data = sched;
+	parameter.stack_size = stack_size;
+	parameter.task_entry = co_sched_task;
+	ret = task_create(&parameter, &sched->task_handle);
+	if (ret != ZK_SUCCESS)
+	{
+		sem_destroy(sched->wakeup_sem);
+	}
+	return ret;
+}
+
+/**
+ * @brief Start a coroutine on a scheduler
+ * @param sched scheduler from co_sched_create()
+ * @param co coroutine object, owned by the caller and not running
+ * @param fn body, written with ZK_CO_BEGIN() / ZK_CO_END()
+ * @param arg user data, available as co->arg
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Callable from any task and from the scheduler's own coroutines; the object is free
+ *       again once the body has returned ZK_CO_EXITED
+ */
+zk_error_code_t co_start(zk_co_sched_t *sched, zk_co_t *co, zk_co_fn_t fn, void *arg)
+{
+	ZK_CHECK_PARAM_NOT_NULL(sched);
+	ZK_CHECK_PARAM_NOT_NULL(co);
+	ZK_CHECK_PARAM_NOT_NULL(fn);
+
+	co->fn = fn;
+	co->arg = arg;
+	co->line = 0;
+	co->state = ZK_CO_YIELDED;
+	co->has_deadline = 0;
+	co->wake_up_time = 0;
+
+	ZK_ENTER_CRITICAL();
+	zk_list_add_before(&co->node, &sched->start_list);
+	ZK_EXIT_CRITICAL();
+
+	return sem_release(sched->wakeup_sem);
+}
+
+/**
+ * @brief Make the host re-check its waiting coroutines now instead of at the next poll
+ * @note Call after releasing a semaphore or writing a queue a coroutine waits on
+ */
+zk_error_code_t co_sched_wake(zk_co_sched_t *sched)
+{
+	ZK_CHECK_PARAM_NOT_NULL(sched);
+
+	return sem_release(sched->wakeup_sem);
+}
+
+/**
+ * @brief co_sched_wake() for interrupt handlers, finish the ISR with zk_yield_from_isr()
+ */
+zk_error_code_t co_sched_wake_from_isr(zk_co_sched_t *sched, zk_bool *higher_priority_woken)
+{
+	ZK_ASSERT_ISR_PRIORITY();
+
+	ZK_CHECK_PARAM_NOT_NULL(sched);
+
+	return sem_release_from_isr(sched->wakeup_sem, higher_priority_woken);
+}
+
+/**
+ * @brief Arm the timeout of the next ZK_CO_AWAIT()
+ * @param timeout ticks, ZK_TIMEOUT_INFINITE waits forever, ZK_TIMEOUT_NONE tries once
+ */
+void co_set_timeout(zk_co_t *co, zk_uint32 timeout)
+{
+	co->has_deadline = (timeout != ZK_TIMEOUT_INFINITE);
+	co->wake_up_time = get_current_time() + timeout;
+}
+
+/**
+ * @brief Whether the timeout armed by co_set_timeout() has passed
+ */
+zk_bool co_timed_out(const zk_co_t *co)
+{
+	return co->has_deadline && !zk_time_is_before(get_current_time(), co->wake_up_time);
+}
+
+#endif /* ZK_USING_COROUTINE */
@@ -0,0 +1,98 @@
+/**
+ * @file    zk_critical.c
+ * @brief   critical section length instrumentation
+ * @note    ZK_ENTER_CRITICAL()/ZK_EXIT_CRITICAL() call in here on the outermost level only
+ *          (see zk_internal.h), so the masked duration is stamped with the cycle counter
+ *          while interrupts are already masked. Each sample is charged to the subsystem of
+ *          the file that opened the critical section.
+ */
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_CRITICAL_STATS
+
+#if defined(__CC_ARM)
+#define ZK_CRITICAL_CALL_SITE() ((zk_uint32) __return_address())
+#else
+#define ZK_CRITICAL_CALL_SITE() ((zk_uint32) (unsigned long) __builtin_return_address(0))
+#endif
+
+static zk_critical_stats_t g_critical_stats[ZK_CRITICAL_SUBSYS_NUM];
+
+/* state of the critical section in progress, only touched with interrupts masked */
+static zk_uint32 g_critical_start;
+static zk_uint32 g_critical_site;
+static zk_uint32 g_critical_subsys;
+
+/**
+ * @brief Stamp the start of an outermost critical section
+ * @param subsys Subsystem the section is charged to (zk_critical_subsys_t)
+ * @note  Never inlined: its return address is the ZK_ENTER_CRITICAL() call site
+ */
+__attribute__((noinline)) void zk_critical_stats_begin(zk_uint32 subsys)
+{
+	g_critical_site = ZK_CRITICAL_CALL_SITE();
+	g_critical_subsys = subsys;
+	g_critical_start = zk_cpu_cycle_count();
+}
+
+/**
+ * @brief Account the outermost critical section that is about to be left
+ */
+void zk_critical_stats_end(void)
+{
+	zk_uint32 cycles = zk_cpu_cycle_count() - g_critical_start;
+	zk_critical_stats_t *stats = &g_critical_stats[g_critical_subsys];
+	zk_uint32 scaled = cycles >> ZK_CRITICAL_HIST_SHIFT;
+	zk_uint32 bucket = (scaled == 0) ? 0 : (zk_uint32) zk_cpu_fls(scaled) + 1;
+
+	if (bucket >= ZK_CRITICAL_HIST_BUCKETS)
+	{
+		bucket = ZK_CRITICAL_HIST_BUCKETS - 1;
+	}
+	stats->histogram[bucket]++;
+	stats->count++;
+	stats->total_cycles += cycles;
+	if (cycles > stats->max_cycles)
+	{
+		stats->max_cycles = cycles;
+		stats->max_site = g_critical_site;
+	}
+	ZK_PERF_MAX(critical_max_cycles, cycles);
+}
+
+/**
+ * @brief Get the critical section statistics of one subsystem
+ * @param subsys Subsystem (zk_critical_subsys_t)
+ * @param stats Output copy
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note  Durations are in cycle counter units; max_site can be looked up in the map file
+ */
+zk_error_code_t zk_critical_get_stats(zk_uint32 subsys, zk_critical_stats_t *stats)
+{
+	ZK_CHECK_PARAM_NOT_NULL(stats);
+	if (subsys >= ZK_CRITICAL_SUBSYS_NUM)
+	{
+		return ZK_ERR_OUT_OF_RANGE;
+	}
+
+	/* the copy itself is not measured */
+	zk_cpu_enter_critical();
+	*stats = g_critical_stats[subsys];
+	zk_cpu_exit_critical();
+
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Clear the statistics of all subsystems
+ */
+void zk_critical_reset_stats(void)
+{
+	zk_cpu_enter_critical();
+	zk_memclear(g_critical_stats, sizeof(g_critical_stats));
+	zk_cpu_exit_critical();
+}
+
+#endif
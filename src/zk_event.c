@@ -0,0 +1,329 @@
+/**
+ * @file    zk_event.c
+ * @brief	event flag group module
+ */
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_EVENT
+
+static event_group_t g_event_pool[EVENT_MAX_NUM];
+ZK_HANDLE_POOL_DEFINE(g_event_handles, EVENT_MAX_NUM);
+extern task_control_block_t *volatile g_current_tcb;
+
+#define EVENT_HANDLE_TO_POINTER(handle) (&g_event_pool[ZK_HANDLE_INDEX(handle)])
+
+#define CHECK_EVENT_HANDLE_VALID(handle)                                                           \
+	if (!zk_handle_is_valid(&g_event_handles, handle))                                             \
+	return ZK_ERR_INVALID_HANDLE
+
+#define CHECK_EVENT_CREATED(handle)                                                                \
+	if (EVENT_HANDLE_TO_POINTER(handle)->is_used == EVENT_UNUSED)                                  \
+	return ZK_ERR_STATE
+
+void event_init(void)
+{
+	for (zk_uint32 i = 0; i < EVENT_MAX_NUM; i++)
+	{
+		g_event_pool[i].flags = 0;
+		g_event_pool[i].is_used = EVENT_UNUSED;
+		zk_list_init(&g_event_pool[i].wait_list);
+	}
+	zk_handle_pool_init(&g_event_handles);
+}
+
+/**
+ * @brief check whether flags satisfy a wait condition
+ */
+static inline zk_bool event_condition_met(zk_uint32 flags, zk_uint32 mask, zk_uint8 mode)
+{
+	if ((mode & ~EVENT_CLEAR_ON_EXIT) == EVENT_WAIT_ALL)
+	{
+		return (flags & mask) == mask;
+	}
+	return (flags & mask) != 0;
+}
+
+/**
+ * @brief Create an event flag group with every flag cleared
+ * @param event_handle Receives the new event group handle
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_RESOURCE_UNAVAILABLE if every event
+ *         group is in use
+ */
+zk_error_code_t event_create(zk_uint32 *event_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	ZK_ASSERT_NULL_POINTER(event_handle);
+
+	ZK_ENTER_CRITICAL();
+
+	ret = zk_handle_alloc(&g_event_handles, event_handle);
+	if (ret != ZK_SUCCESS)
+	{
+		goto event_create_exit;
+	}
+
+	EVENT_HANDLE_TO_POINTER(*event_handle)->flags = 0;
+	EVENT_HANDLE_TO_POINTER(*event_handle)->is_used = EVENT_USED;
+	zk_list_init(&EVENT_HANDLE_TO_POINTER(*event_handle)->wait_list);
+
+event_create_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief set flags and ready every waiter whose condition is now met
+ * @param event event group
+ * @param flags flags to set
+ * @param higher_priority_woken ISR path: set if a task above the current one was woken,
+ *        ZK_NULL for the task path
+ * @return zk_bool ZK_TRUE if any task was woken
+ * @note called within critical section; all waiters are evaluated against the same
+ *       flags, clear-on-exit bits are removed after the pass
+ */
+static zk_bool event_set_internal(event_group_t *event, zk_uint32 flags,
+								  zk_bool *higher_priority_woken)
+{
+	zk_list_node_t *pos = ZK_NULL;
+	zk_list_node_t *n = ZK_NULL;
+	task_control_block_t *tcb = ZK_NULL;
+	zk_uint32 clear_mask = 0;
+	zk_bool woken = ZK_FALSE;
+
+	event->flags |= flags;
+
+	ZK_LIST_FOR_EACH_NODE_SAFE(pos, n, &event->wait_list)
+	{
+		tcb = ZK_LIST_GET_OWNER(pos, task_control_block_t, event_sleep_list);
+		if (!event_condition_met(event->flags, tcb->event_wait_mask, tcb->event_wait_mode))
+		{
+			continue;
+		}
+
+		tcb->event_result = event->flags;
+		if (tcb->event_wait_mode & EVENT_CLEAR_ON_EXIT)
+		{
+			clear_mask |= tcb->event_wait_mask;
+		}
+
+		task_block_to_ready(tcb);
+		woken = ZK_TRUE;
+		if (higher_priority_woken != ZK_NULL)
+		{
+			zk_isr_note_woken(tcb, higher_priority_woken);
+		}
+	}
+
+	event->flags &= ~clear_mask;
+	return woken;
+}
+
+/**
+ * @brief Set event flags and wake the tasks whose wait condition is now met
+ * @param event_handle Event group handle
+ * @param flags Flags to set
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t event_set(zk_uint32 event_handle, zk_uint32 flags)
+{
+	CHECK_EVENT_HANDLE_VALID(event_handle);
+	CHECK_EVENT_CREATED(event_handle);
+
+	ZK_ENTER_CRITICAL();
+
+	if (event_set_internal(EVENT_HANDLE_TO_POINTER(event_handle), flags, ZK_NULL))
+	{
+		schedule();
+	}
+
+	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Set event flags from interrupt context (never blocks, never schedules)
+ * @param event_handle Event group handle
+ * @param flags Flags to set
+ * @param higher_priority_woken Set to ZK_TRUE if a task above the interrupted one was woken
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Finish the ISR with zk_yield_from_isr(higher_priority_woken)
+ */
+zk_error_code_t event_set_from_isr(zk_uint32 event_handle, zk_uint32 flags,
+								   zk_bool *higher_priority_woken)
+{
+	zk_bool ignored = ZK_FALSE;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	CHECK_EVENT_HANDLE_VALID(event_handle);
+	CHECK_EVENT_CREATED(event_handle);
+
+	ZK_ENTER_CRITICAL();
+
+	event_set_internal(EVENT_HANDLE_TO_POINTER(event_handle), flags,
+					   (higher_priority_woken != ZK_NULL) ? higher_priority_woken : &ignored);
+
+	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Clear event flags (never wakes a task)
+ * @param event_handle Event group handle
+ * @param flags Flags to clear
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t event_clear(zk_uint32 event_handle, zk_uint32 flags)
+{
+	CHECK_EVENT_HANDLE_VALID(event_handle);
+	CHECK_EVENT_CREATED(event_handle);
+
+	ZK_ENTER_CRITICAL();
+	EVENT_HANDLE_TO_POINTER(event_handle)->flags &= ~flags;
+	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Read the current event flags without waiting or clearing them
+ * @param event_handle Event group handle
+ * @param flags Receives the current flags
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t event_get(zk_uint32 event_handle, zk_uint32 *flags)
+{
+	ZK_CHECK_PARAM_NOT_NULL(flags);
+	CHECK_EVENT_HANDLE_VALID(event_handle);
+	CHECK_EVENT_CREATED(event_handle);
+
+	*flags = EVENT_HANDLE_TO_POINTER(event_handle)->flags;
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Wait until any/all bits of mask are set
+ * @param event_handle Event group handle
+ * @param mask Flags to wait for
+ * @param mode EVENT_WAIT_ANY or EVENT_WAIT_ALL
+ * @param clear_on_exit ZK_TRUE to clear the mask bits once the condition is met
+ * @param received Flags at the time the condition was met (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if the condition was met, otherwise error code
+ */
+zk_error_code_t event_wait(zk_uint32 event_handle, zk_uint32 mask, event_wait_mode_t mode,
+						   zk_bool clear_on_exit, zk_uint32 *received, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	event_group_t *event = ZK_NULL;
+	task_control_block_t *current_task = g_current_tcb;
+	zk_uint32 result = 0;
+
+	CHECK_EVENT_HANDLE_VALID(event_handle);
+	CHECK_EVENT_CREATED(event_handle);
+
+	if (mask == 0 || (mode != EVENT_WAIT_ANY && mode != EVENT_WAIT_ALL))
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	ZK_ENTER_CRITICAL();
+	event = EVENT_HANDLE_TO_POINTER(event_handle);
+
+	if (event_condition_met(event->flags, mask, (zk_uint8) mode))
+	{
+		result = event->flags;
+		if (clear_on_exit)
+		{
+			event->flags &= ~mask;
+		}
+		goto event_wait_exit;
+	}
+
+	if (timeout == ZK_TIMEOUT_NONE)
+	{
+		ret = ZK_ERR_FAILED;
+		goto event_wait_exit;
+	}
+
+	if (is_scheduler_suspending())
+	{
+		ret = ZK_ERR_STATE;
+		goto event_wait_exit;
+	}
+
+	current_task->event_wait_mask = mask;
+	current_task->event_wait_mode = (zk_uint8) mode | (clear_on_exit ? EVENT_CLEAR_ON_EXIT : 0);
+	current_task->event_result = 0;
+	current_task->event_timeout_wakeup = EVENT_NO_TIMEOUT;
+	current_task->wake_up_time = get_current_time() + timeout;
+	task_ready_to_block(current_task, &event->wait_list,
+						(timeout == ZK_TIMEOUT_INFINITE) ? BLOCK_TYPE_ENDLESS : BLOCK_TYPE_TIMEOUT,
+						BLOCK_SORT_PRIO);
+	schedule();
+	ZK_EXIT_CRITICAL();
+
+	ZK_ENTER_CRITICAL();
+	result = current_task->event_result;
+	if (current_task->event_timeout_wakeup == EVENT_WAIT_TIMEOUT)
+	{
+		ret = ZK_ERR_TIMEOUT;
+	}
+	else if (!event_condition_met(result, mask, (zk_uint8) mode))
+	{
+		/* woken by event_destroy() */
+		ret = ZK_ERR_STATE;
+	}
+
+event_wait_exit:
+	ZK_EXIT_CRITICAL();
+	if (received != ZK_NULL)
+	{
+		*received = result;
+	}
+	return ret;
+}
+
+/**
+ * @brief Destroy an event group and release its handle
+ * @param event_handle Event group handle
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Waiting tasks are woken and their event_wait() returns ZK_ERR_STATE
+ */
+zk_error_code_t event_destroy(zk_uint32 event_handle)
+{
+	event_group_t *event = ZK_NULL;
+	task_control_block_t *wakeup_task = ZK_NULL;
+
+	CHECK_EVENT_HANDLE_VALID(event_handle);
+	CHECK_EVENT_CREATED(event_handle);
+
+	ZK_ENTER_CRITICAL();
+	event = EVENT_HANDLE_TO_POINTER(event_handle);
+
+	/* a concurrent destroy may have retired the handle since the unlocked check */
+	if (!zk_handle_is_valid(&g_event_handles, event_handle) || event->is_used == EVENT_UNUSED)
+	{
+		ZK_EXIT_CRITICAL();
+		return ZK_ERR_STATE;
+	}
+
+	while (!zk_list_is_empty(&event->wait_list))
+	{
+		wakeup_task =
+			ZK_LIST_GET_FIRST_ENTRY(&event->wait_list, task_control_block_t, event_sleep_list);
+		wakeup_task->event_result = 0;
+		task_block_to_ready(wakeup_task);
+	}
+
+	event->flags = 0;
+	event->is_used = EVENT_UNUSED;
+	zk_handle_free(&g_event_handles, event_handle);
+
+	schedule();
+	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
+}
+
+#endif /* ZK_USING_EVENT */
@@ -0,0 +1,229 @@
+/**
+ * @file    zk_heartbeat.c
+ * @brief   ZK-RTOS task heartbeat monitor feeding the hardware watchdog
+ * @note    A registered task must call task_heartbeat() at least once per period. The monitor
+ *          list is sorted by deadline, so the SysTick check only compares the head; the
+ *          insertion walk is paid by the checking-in task. A task whose deadline passed moves
+ *          to the missed list, and the watchdog is fed only while that list is empty.
+ */
+
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_SCHED
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+#if ZK_USING_HOOK
+#include "zk_hook.h"
+#endif
+
+#if ZK_USING_HEARTBEAT
+extern task_control_block_t *volatile g_current_tcb;
+
+/* On-time tasks by deadline, and tasks that missed theirs in the order they did */
+static zk_list_node_t g_heartbeat_list = {&g_heartbeat_list, &g_heartbeat_list};
+static zk_list_node_t g_heartbeat_missed_list = {&g_heartbeat_missed_list,
+												 &g_heartbeat_missed_list};
+static void (*g_heartbeat_feed)(void) = ZK_NULL;
+static zk_uint32 g_heartbeat_next_feed = 0;
+
+/**
+ * @brief Give a task a new deadline and file it in the monitor list
+ * @note  called within critical section
+ */
+static void heartbeat_arm(task_control_block_t *tcb, zk_uint32 now)
+{
+	zk_list_node_t *iterator = ZK_NULL;
+	task_control_block_t *other = ZK_NULL;
+
+	zk_list_delete(&tcb->heartbeat_node);
+	tcb->heartbeat_deadline = now + tcb->heartbeat_period;
+	tcb->heartbeat_missed = 0;
+
+	/* equal deadlines stay in check-in order */
+	for (iterator = g_heartbeat_list.pre; iterator != &g_heartbeat_list; iterator = iterator->pre)
+	{
+		other = ZK_LIST_GET_OWNER(iterator, task_control_block_t, heartbeat_node);
+		if (ZK_TIME_DIFF(other->heartbeat_deadline, tcb->heartbeat_deadline) <= 0)
+		{
+			break;
+		}
+	}
+	zk_list_add_after(&tcb->heartbeat_node, iterator);
+}
+
+/**
+ * @brief Start, change or stop monitoring a task
+ * @param task_handle Task handle, 0 for the calling task
+ * @param period Longest time between two check-ins in ticks, 0 to stop monitoring
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_INVALID_HANDLE if task_handle is not a
+ *         live task
+ * @note  The first deadline is period ticks from now, a missed deadline is forgiven
+ */
+zk_error_code_t task_heartbeat_register(zk_uint32 task_handle, zk_uint32 period)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *tcb = ZK_NULL;
+
+	ZK_ENTER_CRITICAL();
+	if (task_handle != 0 && !task_handle_is_valid(task_handle))
+	{
+		ret = ZK_ERR_INVALID_HANDLE;
+		goto task_heartbeat_register_exit;
+	}
+	tcb = (task_handle == 0) ? g_current_tcb : TASK_HANDLE_TO_TCB(task_handle);
+
+	tcb->heartbeat_period = period;
+	if (period == 0)
+	{
+		heartbeat_remove(tcb);
+	}
+	else
+	{
+		heartbeat_arm(tcb, get_current_time());
+	}
+
+task_heartbeat_register_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Check in: the calling task is alive, its next deadline is one period from now
+ * @return zk_error_code_t ZK_SUCCESS if on time, ZK_ERR_TIMEOUT if the deadline had passed,
+ *         ZK_ERR_STATE if the task is not monitored
+ * @note  A late check-in reports the whole overrun to the heartbeat miss hooks
+ */
+zk_error_code_t task_heartbeat(void)
+{
+	task_control_block_t *tcb = g_current_tcb;
+	zk_uint32 now = 0;
+	zk_uint32 lateness = 0;
+	zk_bool late = ZK_FALSE;
+
+	ZK_ENTER_CRITICAL();
+	if (tcb->heartbeat_period == 0)
+	{
+		ZK_EXIT_CRITICAL();
+		return ZK_ERR_STATE;
+	}
+	now = get_current_time();
+	if (tcb->heartbeat_missed)
+	{
+		late = ZK_TRUE;
+		lateness = now - tcb->heartbeat_deadline;
+	}
+	heartbeat_arm(tcb, now);
+	ZK_EXIT_CRITICAL();
+
+	if (!late)
+	{
+		return ZK_SUCCESS;
+	}
+#if ZK_USING_HOOK
+	zk_hook_call_heartbeat_miss(tcb, lateness);
+#else
+	(void) lateness;
+#endif
+	return ZK_ERR_TIMEOUT;
+}
+
+/**
+ * @brief Register the watchdog feed function
+ * @param feed Reloads the hardware watchdog, called in SysTick interrupt; ZK_NULL to stop
+ * @note  Called once right away, then every ZK_HEARTBEAT_FEED_TICKS while no task is late
+ */
+void heartbeat_set_watchdog(void (*feed)(void))
+{
+	ZK_ENTER_CRITICAL();
+	g_heartbeat_feed = feed;
+	g_heartbeat_next_feed = get_current_time() + ZK_HEARTBEAT_FEED_TICKS;
+	ZK_EXIT_CRITICAL();
+
+	if (feed != ZK_NULL)
+	{
+		feed();
+	}
+}
+
+/**
+ * @brief Stop monitoring a task
+ * @note  called within critical section, also by task_delete()
+ */
+void heartbeat_remove(task_control_block_t *tcb)
+{
+	zk_list_delete(&tcb->heartbeat_node);
+	zk_list_init(&tcb->heartbeat_node);
+	tcb->heartbeat_missed = 0;
+}
+
+/**
+ * @brief Tick check: report the tasks whose deadline passed, feed the watchdog if none did
+ * @note  called in SysTick interrupt outside the critical section
+ */
+void heartbeat_check(void)
+{
+	task_control_block_t *tcb = ZK_NULL;
+	void (*feed)(void) = ZK_NULL;
+	zk_uint32 now = 0;
+
+	ZK_ENTER_CRITICAL();
+	now = get_current_time();
+	while (!zk_list_is_empty(&g_heartbeat_list))
+	{
+		tcb = ZK_LIST_GET_FIRST_ENTRY(&g_heartbeat_list, task_control_block_t, heartbeat_node);
+		if (!zk_time_is_reached(now, tcb->heartbeat_deadline))
+		{
+			break;
+		}
+		zk_list_move_before(&tcb->heartbeat_node, &g_heartbeat_missed_list);
+		tcb->heartbeat_missed = 1;
+		/* only a task deletes a task, the TCB outlives the call */
+		ZK_EXIT_CRITICAL();
+#if ZK_USING_HOOK
+		zk_hook_call_heartbeat_miss(tcb, now - tcb->heartbeat_deadline);
+#endif
+		ZK_ENTER_CRITICAL();
+	}
+
+	if (g_heartbeat_feed != ZK_NULL && zk_list_is_empty(&g_heartbeat_missed_list) &&
+		zk_time_is_reached(now, g_heartbeat_next_feed))
+	{
+		feed = g_heartbeat_feed;
+		g_heartbeat_next_feed = now + ZK_HEARTBEAT_FEED_TICKS;
+	}
+	ZK_EXIT_CRITICAL();
+
+	if (feed != ZK_NULL)
+	{
+		feed();
+	}
+}
+
+/**
+ * @brief Time the tick check must run next: the earliest deadline or the next feed
+ * @param wake_up_time Output time
+ * @return zk_bool ZK_FALSE if nothing is due
+ * @note  Lets tickless idle wake up in time. A starved watchdog has no feed due
+ */
+zk_bool heartbeat_get_next_expiry(zk_uint32 *wake_up_time)
+{
+	zk_bool found = ZK_FALSE;
+	task_control_block_t *tcb = ZK_NULL;
+
+	ZK_ENTER_CRITICAL();
+	if (!zk_list_is_empty(&g_heartbeat_list))
+	{
+		tcb = ZK_LIST_GET_FIRST_ENTRY(&g_heartbeat_list, task_control_block_t, heartbeat_node);
+		*wake_up_time = tcb->heartbeat_deadline;
+		found = ZK_TRUE;
+	}
+	if (g_heartbeat_feed != ZK_NULL && zk_list_is_empty(&g_heartbeat_missed_list) &&
+		(!found || ZK_TIME_DIFF(g_heartbeat_next_feed, *wake_up_time) < 0))
+	{
+		*wake_up_time = g_heartbeat_next_feed;
+		found = ZK_TRUE;
+	}
+	ZK_EXIT_CRITICAL();
+	return found;
+}
+
+#endif /* ZK_USING_HEARTBEAT */
@@ -1,144 +1,262 @@
 /**
  * @file    zk_hook.c
  * @brief   ZK-RTOS hook function implementation
+ * @note    Subscribers are appended to a static chain per event and removed by compacting it.
+ *          The dispatch in zk_hook.h re-reads the count before every call, so a chain shrinking
+ *          under a running dispatch never makes it read past the live entries.
  */
 
 #include "zk_internal.h"
 #include "zk_hook.h"
 
-#ifdef ZK_USING_HOOK
+#if ZK_USING_HOOK
 
-/* ==================== 全局钩子函数指针 ==================== */
+/* ==================== 全局钩子链 ==================== */
 
-static idle_hook_t g_idle_hook = ZK_NULL;
-static task_switch_hook_t g_task_switch_hook = ZK_NULL;
-static tick_hook_t g_tick_hook = ZK_NULL;
-static stack_overflow_hook_t g_stack_overflow_hook = ZK_NULL;
-static malloc_failed_hook_t g_malloc_failed_hook = ZK_NULL;
-
-
-/* ==================== 钩子函数注册接口 ==================== */
+#if ZK_HOOK_IDLE_MAX > 0
+zk_hook_fn_t g_idle_hooks[ZK_HOOK_IDLE_MAX];
+volatile zk_uint8 g_idle_hook_count = 0;
+#endif
+#if ZK_HOOK_TASK_SWITCH_MAX > 0
+zk_hook_fn_t g_task_switch_hooks[ZK_HOOK_TASK_SWITCH_MAX];
+volatile zk_uint8 g_task_switch_hook_count = 0;
+#endif
+#if ZK_HOOK_TICK_MAX > 0
+zk_hook_fn_t g_tick_hooks[ZK_HOOK_TICK_MAX];
+volatile zk_uint8 g_tick_hook_count = 0;
+#endif
+#if ZK_HOOK_STACK_OVERFLOW_MAX > 0
+zk_hook_fn_t g_stack_overflow_hooks[ZK_HOOK_STACK_OVERFLOW_MAX];
+volatile zk_uint8 g_stack_overflow_hook_count = 0;
+#endif
+#if ZK_HOOK_MALLOC_FAILED_MAX > 0
+zk_hook_fn_t g_malloc_failed_hooks[ZK_HOOK_MALLOC_FAILED_MAX];
+volatile zk_uint8 g_malloc_failed_hook_count = 0;
+#endif
+#if ZK_USING_HEARTBEAT && (ZK_HOOK_HEARTBEAT_MISS_MAX > 0)
+zk_hook_fn_t g_heartbeat_miss_hooks[ZK_HOOK_HEARTBEAT_MISS_MAX];
+volatile zk_uint8 g_heartbeat_miss_hook_count = 0;
+#endif
 
 /**
- * @brief Register idle task hook
- * @param hook Hook function pointer, pass NULL to unregister
+ * @brief Append a hook to a chain
+ * @param hooks Chain storage
+ * @param count Number of live entries
+ * @param max Chain capacity
+ * @param hook Hook to append
  */
-void zk_hook_register_idle(idle_hook_t hook)
+static zk_error_code_t zk_hook_chain_add(zk_hook_fn_t *hooks, volatile zk_uint8 *count,
+										 zk_uint32 max, zk_hook_fn_t hook)
 {
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 i = 0;
+
+	ZK_CHECK_PARAM_NOT_NULL(hook);
+
 	ZK_ENTER_CRITICAL();
-	g_idle_hook = hook;
+	for (i = 0; i < *count; i++)
+	{
+		if (hooks[i] == hook)
+		{
+			ret = ZK_ERR_STATE;
+			goto zk_hook_chain_add_exit;
+		}
+	}
+	if (*count >= max)
+	{
+		ret = ZK_ERR_RESOURCE_UNAVAILABLE;
+		goto zk_hook_chain_add_exit;
+	}
+	/* the entry is written before the count makes it visible to the dispatch */
+	hooks[*count] = hook;
+	(*count)++;
+
+zk_hook_chain_add_exit:
 	ZK_EXIT_CRITICAL();
+	return ret;
 }
 
 /**
- * @brief Register task switch hook
- * @param hook Hook function pointer, pass NULL to unregister
+ * @brief Remove a hook from a chain, keeping the order of the others
+ * @note  The slot freed at the end is left as it was, a preempted dispatch that already
+ *        passed the count check still finds a valid function there
  */
-void zk_hook_register_task_switch(task_switch_hook_t hook)
+static zk_error_code_t zk_hook_chain_remove(zk_hook_fn_t *hooks, volatile zk_uint8 *count,
+											zk_hook_fn_t hook)
 {
+	zk_error_code_t ret = ZK_ERR_STATE;
+	zk_uint32 i = 0;
+
 	ZK_ENTER_CRITICAL();
-	g_task_switch_hook = hook;
+	for (i = 0; i < *count; i++)
+	{
+		if (hooks[i] == hook)
+		{
+			ret = ZK_SUCCESS;
+			break;
+		}
+	}
+	if (ret == ZK_SUCCESS)
+	{
+		for (; i + 1 < *count; i++)
+		{
+			hooks[i] = hooks[i + 1];
+		}
+		(*count)--;
+	}
 	ZK_EXIT_CRITICAL();
+	return ret;
 }
 
+
+/* ==================== 钩子函数注册接口 ==================== */
+
 /**
- * @brief Register tick hook
- * @param hook Hook function pointer, pass NULL to unregister
+ * @brief Subscribe to the idle task event
  */
-void zk_hook_register_tick(tick_hook_t hook)
+zk_error_code_t zk_hook_register_idle(idle_hook_t hook)
 {
-	ZK_ENTER_CRITICAL();
-	g_tick_hook = hook;
-	ZK_EXIT_CRITICAL();
+#if ZK_HOOK_IDLE_MAX > 0
+	return zk_hook_chain_add(g_idle_hooks, &g_idle_hook_count, ZK_HOOK_IDLE_MAX,
+							 (zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_NOT_SUPPORTED;
+#endif
 }
 
-/**
- * @brief Register stack overflow hook
- * @param hook Hook function pointer, pass NULL to unregister
- */
-void zk_hook_register_stack_overflow(stack_overflow_hook_t hook)
+zk_error_code_t zk_hook_unregister_idle(idle_hook_t hook)
 {
-	ZK_ENTER_CRITICAL();
-	g_stack_overflow_hook = hook;
-	ZK_EXIT_CRITICAL();
+#if ZK_HOOK_IDLE_MAX > 0
+	return zk_hook_chain_remove(g_idle_hooks, &g_idle_hook_count, (zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_STATE;
+#endif
 }
 
 /**
- * @brief Register memory allocation failure hook
- * @param hook Hook function pointer, pass NULL to unregister
+ * @brief Subscribe to the task switch event
  */
-void zk_hook_register_malloc_failed(malloc_failed_hook_t hook)
+zk_error_code_t zk_hook_register_task_switch(task_switch_hook_t hook)
 {
-	ZK_ENTER_CRITICAL();
-	g_malloc_failed_hook = hook;
-	ZK_EXIT_CRITICAL();
+#if ZK_HOOK_TASK_SWITCH_MAX > 0
+	return zk_hook_chain_add(g_task_switch_hooks, &g_task_switch_hook_count,
+							 ZK_HOOK_TASK_SWITCH_MAX, (zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_NOT_SUPPORTED;
+#endif
 }
 
-
-/* ==================== 内部调用接口 ==================== */
+zk_error_code_t zk_hook_unregister_task_switch(task_switch_hook_t hook)
+{
+#if ZK_HOOK_TASK_SWITCH_MAX > 0
+	return zk_hook_chain_remove(g_task_switch_hooks, &g_task_switch_hook_count,
+								(zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_STATE;
+#endif
+}
 
 /**
- * @brief Call idle task hook
- * @note  Called in idle task
+ * @brief Subscribe to the tick event
  */
-void zk_hook_call_idle(void)
+zk_error_code_t zk_hook_register_tick(tick_hook_t hook)
 {
-	if (g_idle_hook != ZK_NULL)
-	{
-		g_idle_hook();
-	}
+#if ZK_HOOK_TICK_MAX > 0
+	return zk_hook_chain_add(g_tick_hooks, &g_tick_hook_count, ZK_HOOK_TICK_MAX,
+							 (zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_NOT_SUPPORTED;
+#endif
 }
 
-/**
- * @brief Call task switch hook
- * @param from_tcb TCB of the task being switched out
- * @param to_tcb TCB of the task being switched in
- * @note  Called in PendSV interrupt
- */
-void zk_hook_call_task_switch(task_control_block_t *from_tcb, task_control_block_t *to_tcb)
+zk_error_code_t zk_hook_unregister_tick(tick_hook_t hook)
 {
-	if (g_task_switch_hook != ZK_NULL)
-	{
-		g_task_switch_hook(from_tcb, to_tcb);
-	}
+#if ZK_HOOK_TICK_MAX > 0
+	return zk_hook_chain_remove(g_tick_hooks, &g_tick_hook_count, (zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_STATE;
+#endif
 }
 
 /**
- * @brief Call tick hook
- * @note  Called in SysTick interrupt
+ * @brief Subscribe to the stack overflow event
  */
-void zk_hook_call_tick(void)
+zk_error_code_t zk_hook_register_stack_overflow(stack_overflow_hook_t hook)
 {
-	if (g_tick_hook != ZK_NULL)
-	{
-		g_tick_hook();
-	}
+#if ZK_HOOK_STACK_OVERFLOW_MAX > 0
+	return zk_hook_chain_add(g_stack_overflow_hooks, &g_stack_overflow_hook_count,
+							 ZK_HOOK_STACK_OVERFLOW_MAX, (zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_NOT_SUPPORTED;
+#endif
+}
+
+zk_error_code_t zk_hook_unregister_stack_overflow(stack_overflow_hook_t hook)
+{
+#if ZK_HOOK_STACK_OVERFLOW_MAX > 0
+	return zk_hook_chain_remove(g_stack_overflow_hooks, &g_stack_overflow_hook_count,
+								(zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_STATE;
+#endif
 }
 
 /**
- * @brief Call stack overflow hook
- * @param tcb TCB of the task with stack overflow
- * @note  Called when stack overflow is detected
+ * @brief Subscribe to the memory allocation failure event
  */
-void zk_hook_call_stack_overflow(task_control_block_t *tcb)
+zk_error_code_t zk_hook_register_malloc_failed(malloc_failed_hook_t hook)
 {
-	if (g_stack_overflow_hook != ZK_NULL)
-	{
-		g_stack_overflow_hook(tcb);
-	}
+#if ZK_HOOK_MALLOC_FAILED_MAX > 0
+	return zk_hook_chain_add(g_malloc_failed_hooks, &g_malloc_failed_hook_count,
+							 ZK_HOOK_MALLOC_FAILED_MAX, (zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_NOT_SUPPORTED;
+#endif
+}
+
+zk_error_code_t zk_hook_unregister_malloc_failed(malloc_failed_hook_t hook)
+{
+#if ZK_HOOK_MALLOC_FAILED_MAX > 0
+	return zk_hook_chain_remove(g_malloc_failed_hooks, &g_malloc_failed_hook_count,
+								(zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_STATE;
+#endif
 }
 
 /**
- * @brief Call memory allocation failure hook
- * @param size Requested memory allocation size
- * @note  Called when memory allocation fails
+ * @brief Subscribe to the heartbeat miss event
  */
-void zk_hook_call_malloc_failed(zk_uint32 size)
+zk_error_code_t zk_hook_register_heartbeat_miss(heartbeat_miss_hook_t hook)
 {
-	if (g_malloc_failed_hook != ZK_NULL)
-	{
-		g_malloc_failed_hook(size);
-	}
+#if ZK_USING_HEARTBEAT && (ZK_HOOK_HEARTBEAT_MISS_MAX > 0)
+	return zk_hook_chain_add(g_heartbeat_miss_hooks, &g_heartbeat_miss_hook_count,
+							 ZK_HOOK_HEARTBEAT_MISS_MAX, (zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_NOT_SUPPORTED;
+#endif
+}
+
+zk_error_code_t zk_hook_unregister_heartbeat_miss(heartbeat_miss_hook_t hook)
+{
+#if ZK_USING_HEARTBEAT && (ZK_HOOK_HEARTBEAT_MISS_MAX > 0)
+	return zk_hook_chain_remove(g_heartbeat_miss_hooks, &g_heartbeat_miss_hook_count,
+								(zk_hook_fn_t) hook);
+#else
+	(void) hook;
+	return ZK_ERR_STATE;
+#endif
 }
 
 #endif /* ZK_USING_HOOK */
@@ -3,60 +3,249 @@
  * @brief   Memory manager function
  */
 
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_MEM
+
 #include "zk_internal.h"
-#ifdef ZK_USING_HOOK
+#if ZK_USING_HOOK
 #include "zk_hook.h"
 #endif
 
+#if ZK_USING_TLSF
+/* Only prev_phys and size are header, the free-list links overlap the payload */
+const zk_uint32 MEM_BLOCK_ALIGNMENT =
+	(sizeof(mem_block_t *) + sizeof(zk_uint32) + (zk_uint32) (ZK_BYTE_ALIGNMENT - 1)) &
+	(~((zk_uint32) (ZK_BYTE_ALIGNMENT - 1)));
+#else
 const zk_uint32 MEM_BLOCK_ALIGNMENT = (sizeof(mem_block_t) + (zk_uint32) (ZK_BYTE_ALIGNMENT - 1)) &
 									  (~((zk_uint32) (ZK_BYTE_ALIGNMENT - 1)));
+#endif
 zk_uint8 g_heap[CONFIG_TOTAL_MEM_SIZE];
 
-mem_manager_t g_mem_manager;
+/* Region 0 is always g_heap, further regions are added with mem_add_region() */
+mem_manager_t g_mem_regions[MEM_REGION_MAX_NUM];
+zk_uint32 g_mem_region_count;
 
 /**
- * @brief   Initialize memory manager
+ * @brief   Initialize memory manager with the internal heap as region 0
  */
 void mem_init(void)
+{
+	for (zk_uint32 i = 0; i < MEM_REGION_MAX_NUM; i++)
+	{
+		zk_memclear(&g_mem_regions[i], sizeof(mem_manager_t));
+	}
+
+	mem_heap_init(&g_mem_regions[0], (zk_uint32) g_heap, CONFIG_TOTAL_MEM_SIZE);
+	g_mem_regions[0].caps = MEM_CAP_DEFAULT | MEM_CAP_DMA;
+	g_mem_region_count = 1;
+}
+
+/**
+ * @brief   Register an additional heap region (CCM, external SRAM, ...)
+ * @param   start Region start address
+ * @param   size Region size in bytes
+ * @param   caps MEM_CAP_* flags describing the region
+ * @return  ZK_SUCCESS if success, ZK_ERR_INVALID_PARAM if the region is too small, or with
+ *          ZK_USING_TLSF not smaller than 2^MEM_TLSF_FL_INDEX_MAX bytes
+ * @note    Call right after zk_kernel_init(), before anything allocates from the region.
+ *          Regions are searched in registration order.
+ */
+zk_error_code_t mem_add_region(void *start, zk_uint32 size, zk_uint32 caps)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	mem_manager_t *heap = ZK_NULL;
+
+	ZK_CHECK_PARAM_NOT_NULL(start);
+
+	if (caps == 0 || size < (MEM_BLOCK_MIN_SIZE << 1) + ZK_BYTE_ALIGNMENT)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+#if ZK_USING_TLSF
+	/* the size classes end below 2^MEM_TLSF_FL_INDEX_MAX, the rest would be lost silently */
+	if (size >= (1UL << MEM_TLSF_FL_INDEX_MAX))
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+#endif
+
+	ZK_ENTER_CRITICAL();
+
+	if (g_mem_region_count >= MEM_REGION_MAX_NUM)
+	{
+		ret = ZK_ERR_RESOURCE_UNAVAILABLE;
+		goto mem_add_region_exit;
+	}
+
+	heap = &g_mem_regions[g_mem_region_count];
+	mem_heap_init(heap, (zk_uint32) start, size);
+	heap->caps = caps;
+	g_mem_region_count++;
+
+mem_add_region_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief   Find the region that owns an address
+ * @return  Region manager, NULL if the address is outside every region
+ */
+static mem_manager_t *mem_find_region(const void *addr)
+{
+	for (zk_uint32 i = 0; i < g_mem_region_count; i++)
+	{
+		if ((zk_uint32) addr >= g_mem_regions[i].base_address &&
+			(zk_uint32) addr < g_mem_regions[i].base_address + g_mem_regions[i].total_size)
+		{
+			return &g_mem_regions[i];
+		}
+	}
+	return ZK_NULL;
+}
+
+/**
+ * @brief   Allocate memory from the first region that has all requested capabilities
+ * @param   caps MEM_CAP_* flags the region must provide
+ * @param   request_size Size of memory to allocate
+ * @return  Pointer to allocated memory block, NULL on failure
+ */
+void *mem_alloc_region(zk_uint32 caps, zk_uint32 request_size)
+{
+	void *allocated_ptr = ZK_NULL;
+	mem_manager_t *preferred = ZK_NULL;
+#if ZK_USING_PERF_COUNTERS
+	zk_uint32 start = zk_cpu_cycle_count();
+	zk_uint32 cycles = 0;
+#endif
+
+	if (request_size == 0)
+	{
+		return ZK_NULL;
+	}
+
+	for (zk_uint32 i = 0; i < g_mem_region_count && allocated_ptr == ZK_NULL; i++)
+	{
+		if ((g_mem_regions[i].caps & caps) != caps)
+		{
+			continue;
+		}
+		if (preferred == ZK_NULL)
+		{
+			preferred = &g_mem_regions[i];
+		}
+		allocated_ptr = mem_heap_alloc(&g_mem_regions[i], request_size);
+	}
+
+#if ZK_USING_PERF_COUNTERS
+	cycles = zk_cpu_cycle_count() - start;
+	ZK_ENTER_CRITICAL();
+	ZK_PERF_ADD(alloc_count, 1);
+	ZK_PERF_ADD(alloc_failures, (allocated_ptr == ZK_NULL) ? 1 : 0);
+	g_zk_perf_counters.alloc_last_cycles = cycles;
+	ZK_PERF_MAX(alloc_max_cycles, cycles);
+	ZK_EXIT_CRITICAL();
+#endif
+
+	if (allocated_ptr == ZK_NULL)
+	{
+		ZK_ENTER_CRITICAL();
+		if (preferred != ZK_NULL)
+		{
+			preferred->alloc_fail_count++;
+		}
+#if ZK_USING_HOOK
+		zk_hook_call_malloc_failed(request_size);
+#endif
+		ZK_EXIT_CRITICAL();
+	}
+
+	return allocated_ptr;
+}
+
+/**
+ * @brief   Allocate general purpose memory
+ * @param   request_size Size of memory to allocate
+ * @return  Pointer to allocated memory block
+ */
+void *mem_alloc(zk_uint32 request_size)
+{
+	return mem_alloc_region(MEM_CAP_DEFAULT, request_size);
+}
+
+/**
+ * @brief   Free memory allocated from any region
+ * @param   user_addr Pointer to memory block to free
+ */
+void mem_free(void *user_addr)
+{
+	mem_manager_t *heap = ZK_NULL;
+
+	/* Handle NULL pointer: return silently instead of asserting */
+	if (user_addr == ZK_NULL)
+	{
+		return;
+	}
+
+	heap = mem_find_region(user_addr);
+	ZK_ASSERT(heap != ZK_NULL);
+	if (heap == ZK_NULL)
+	{
+		return;
+	}
+
+	mem_heap_free(heap, user_addr);
+}
+
+#if !ZK_USING_TLSF
+
+/**
+ * @brief   Initialize one heap region
+ * @param   heap Region manager
+ * @param   start Region start address
+ * @param   size Region size in bytes
+ */
+void mem_heap_init(mem_manager_t *heap, zk_uint32 start, zk_uint32 size)
 {
 	mem_block_t *initial_free_block = ZK_NULL;
 
-	g_mem_manager.base_address =
-		zk_addr_align((zk_uint32) g_heap, ZK_BYTE_ALIGNMENT, ZK_BYTE_ALIGNMENT_MASK);
-	g_mem_manager.total_size =
-		CONFIG_TOTAL_MEM_SIZE - (g_mem_manager.base_address - (zk_uint32) g_heap);
-	g_mem_manager.available_size = g_mem_manager.total_size;
-	g_mem_manager.is_initialized = ZK_TRUE;
+	heap->base_address = zk_addr_align(start, ZK_BYTE_ALIGNMENT, ZK_BYTE_ALIGNMENT_MASK);
+	heap->total_size =
+		(size - (heap->base_address - start)) & ~((zk_uint32) ZK_BYTE_ALIGNMENT_MASK);
+	heap->available_size = heap->total_size;
+	heap->is_initialized = ZK_TRUE;
 
 	/* 初始化统计信息 */
-	g_mem_manager.peak_used_size = 0;
-	g_mem_manager.alloc_count = 0;
-	g_mem_manager.free_count = 0;
-	g_mem_manager.alloc_fail_count = 0;
-	g_mem_manager.free_block_count = 1;
-	g_mem_manager.used_block_count = 0;
+	heap->peak_used_size = 0;
+	heap->alloc_count = 0;
+	heap->free_count = 0;
+	heap->alloc_fail_count = 0;
+	heap->free_block_count = 1;
+	heap->used_block_count = 0;
 
-	zk_list_init(&g_mem_manager.free_list);
-	zk_list_init(&g_mem_manager.used_list);
+	zk_list_init(&heap->free_list);
+	zk_list_init(&heap->used_list);
 
-	initial_free_block = (mem_block_t *) g_mem_manager.base_address;
-	initial_free_block->size = g_mem_manager.available_size;
+	initial_free_block = (mem_block_t *) heap->base_address;
+	initial_free_block->size = heap->available_size;
+	initial_free_block->magic = MEM_BLOCK_MAGIC_FREE;
 
-	zk_list_add_after(&initial_free_block->list_node, &(g_mem_manager.free_list));
+	zk_list_add_after(&initial_free_block->list_node, &(heap->free_list));
 }
 
 /**
  * @brief   Insert free block to free list by address
+ * @param   heap Region manager
  * @param   block_to_insert Free block to insert
  */
-static void mem_free_list_insert_by_addr(mem_block_t *block_to_insert)
+static void mem_free_list_insert_by_addr(mem_manager_t *heap, mem_block_t *block_to_insert)
 {
 	ZK_ASSERT_NULL_POINTER(block_to_insert);
 
 	zk_list_node_t *current_node;
 	mem_block_t *iterator;
 
-	ZK_LIST_FOR_EACH_NODE(current_node, &g_mem_manager.free_list)
+	ZK_LIST_FOR_EACH_NODE(current_node, &heap->free_list)
 	{
 		iterator = (mem_block_t *) current_node;
 		if (iterator > block_to_insert)
@@ -69,13 +258,15 @@ static void mem_free_list_insert_by_addr(mem_block_t *block_to_insert)
 }
 
 /**
- * @brief   Allocate memory
+ * @brief   Allocate memory from one heap region
+ * @param   heap Region manager
  * @param   request_size Size of memory to allocate
- * @return  Pointer to allocated memory block
+ * @return  Pointer to allocated memory block, NULL if the region cannot satisfy it
+ * @note    Failure accounting and the malloc-failed hook are left to mem_alloc_region()
  */
-void *mem_alloc(zk_uint32 request_size)
+void *mem_heap_alloc(mem_manager_t *heap, zk_uint32 request_size)
 {
-	ZK_ASSERT(g_mem_manager.is_initialized);
+	ZK_ASSERT(heap->is_initialized);
 
 	/* Handle zero-size allocation: return NULL instead of asserting */
 	if (request_size == 0)
@@ -107,58 +298,48 @@ void *mem_alloc(zk_uint32 request_size)
 
 	ZK_ENTER_CRITICAL();
 
-	if (final_size > g_mem_manager.available_size)
+	if (final_size > heap->available_size)
 	{
-		g_mem_manager.alloc_fail_count++;
-#ifdef ZK_USING_HOOK
-		zk_hook_call_malloc_failed(request_size);
-#endif
 		ZK_EXIT_CRITICAL();
 		return ZK_NULL;
 	}
 
-	ZK_LIST_FOR_EACH_NODE(current_node, &g_mem_manager.free_list)
+	ZK_LIST_FOR_EACH_NODE(current_node, &heap->free_list)
 	{
-		allocated_block = (mem_block_t *) current_node;
-		if (allocated_block->size >= final_size)
+		if (((mem_block_t *) current_node)->size >= final_size)
 		{
+			allocated_block = (mem_block_t *) current_node;
 			zk_list_delete(&allocated_block->list_node);
-			zk_list_add_after(&allocated_block->list_node, &g_mem_manager.used_list);
+			zk_list_add_after(&allocated_block->list_node, &heap->used_list);
 
 			if (allocated_block->size - final_size >= MEM_BLOCK_MIN_SIZE)
 			{
 				new_free_block = (mem_block_t *) ((zk_uint8 *) allocated_block + final_size);
 				new_free_block->size = allocated_block->size - final_size;
+				new_free_block->magic = MEM_BLOCK_MAGIC_FREE;
 				allocated_block->size = final_size;
-				mem_free_list_insert_by_addr(new_free_block);
+				mem_free_list_insert_by_addr(heap, new_free_block);
 			}
 			else
 			{
-				g_mem_manager.free_block_count--;
+				heap->free_block_count--;
 			}
 
-			g_mem_manager.available_size -= final_size;
-			g_mem_manager.used_block_count++;
+			allocated_block->magic = MEM_BLOCK_MAGIC_USED;
+			heap->available_size -= final_size;
+			heap->used_block_count++;
 
-			zk_uint32 current_used = g_mem_manager.total_size - g_mem_manager.available_size;
-			if (current_used > g_mem_manager.peak_used_size)
+			zk_uint32 current_used = heap->total_size - heap->available_size;
+			if (current_used > heap->peak_used_size)
 			{
-				g_mem_manager.peak_used_size = current_used;
+				heap->peak_used_size = current_used;
 			}
 
-			g_mem_manager.alloc_count++;
+			heap->alloc_count++;
 			break;
 		}
 	}
 
-	if (allocated_block == ZK_NULL)
-	{
-		g_mem_manager.alloc_fail_count++;
-#ifdef ZK_USING_HOOK
-		zk_hook_call_malloc_failed(request_size);
-#endif
-	}
-
 	ZK_EXIT_CRITICAL();
 
 	if (allocated_block != ZK_NULL)
@@ -169,6 +350,7 @@ void *mem_alloc(zk_uint32 request_size)
 	return allocated_ptr;
 }
 
+#if ZK_MEM_DEBUG
 /**
  * @brief   Check memory list integrity
  * @param   head Head node of memory list
@@ -187,27 +369,33 @@ static void mem_check_list_integrity(zk_list_node_t *head)
 		node = node->next;
 	}
 }
+#endif
 
 /**
  * @brief   Merge free blocks in free list
+ * @param   heap Region manager
  * @param   block_to_merge Free block to merge
+ * @note    Keeps heap->free_block_count up to date for every list insert/delete
  */
-static void mem_merge_free_blocks(mem_block_t *block_to_merge)
+static void mem_merge_free_blocks(mem_manager_t *heap, mem_block_t *block_to_merge)
 {
 	ZK_ASSERT_NULL_POINTER(block_to_merge);
 
-	if (zk_list_is_empty(&g_mem_manager.free_list))
+	block_to_merge->magic = MEM_BLOCK_MAGIC_FREE;
+
+	if (zk_list_is_empty(&heap->free_list))
 	{
-		zk_list_add_after(&block_to_merge->list_node, &g_mem_manager.free_list);
+		zk_list_add_after(&block_to_merge->list_node, &heap->free_list);
+		heap->free_block_count++;
 		return;
 	}
 
-	zk_list_node_t *insert_pos = &g_mem_manager.free_list;
+	zk_list_node_t *insert_pos = &heap->free_list;
 	mem_block_t *prev_block = ZK_NULL;
 	mem_block_t *next_block = ZK_NULL;
 
 	zk_list_node_t *current_node;
-	ZK_LIST_FOR_EACH_NODE(current_node, &g_mem_manager.free_list)
+	ZK_LIST_FOR_EACH_NODE(current_node, &heap->free_list)
 	{
 		if ((mem_block_t *) current_node > block_to_merge)
 		{
@@ -217,7 +405,7 @@ static void mem_merge_free_blocks(mem_block_t *block_to_merge)
 		}
 	}
 
-	if (insert_pos != &g_mem_manager.free_list && insert_pos->pre != &g_mem_manager.free_list)
+	if (insert_pos != &heap->free_list && insert_pos->pre != &heap->free_list)
 	{
 		prev_block = (mem_block_t *) insert_pos->pre;
 	}
@@ -227,6 +415,7 @@ static void mem_merge_free_blocks(mem_block_t *block_to_merge)
 		zk_list_add_before(&block_to_merge->list_node, &next_block->list_node);
 		block_to_merge->size += next_block->size;
 		zk_list_delete(&next_block->list_node);
+		next_block->magic = 0;
 	}
 
 	if (prev_block && (zk_uint8 *) prev_block + prev_block->size == (zk_uint8 *) block_to_merge)
@@ -236,46 +425,54 @@ static void mem_merge_free_blocks(mem_block_t *block_to_merge)
 		if (block_to_merge->list_node.next != ZK_NULL)
 		{
 			zk_list_delete(&block_to_merge->list_node);
+			heap->free_block_count--;
 		}
+		block_to_merge->magic = 0;
 		return;
 	}
 
 	if (block_to_merge->list_node.next == ZK_NULL)
 	{
 		zk_list_add_before(&block_to_merge->list_node, insert_pos);
+		heap->free_block_count++;
 	}
 }
 
 
 /**
- * @brief   Free memory
+ * @brief   Free memory back to the heap region that owns it
+ * @param   heap Region manager
  * @param   user_addr Pointer to memory block to free
  */
-void mem_free(void *user_addr)
+void mem_heap_free(mem_manager_t *heap, void *user_addr)
 {
-	/* Handle NULL pointer: return silently instead of asserting */
-	if (user_addr == ZK_NULL)
-	{
-		return;
-	}
-
-	ZK_ASSERT(g_mem_manager.is_initialized);
+	ZK_ASSERT(heap->is_initialized);
 
 	mem_block_t *mem_block = (mem_block_t *) ((zk_uint8 *) user_addr - MEM_BLOCK_ALIGNMENT);
 
-	ZK_ASSERT((zk_uint32) mem_block >= g_mem_manager.base_address);
-	ZK_ASSERT((zk_uint32) mem_block < (g_mem_manager.base_address + g_mem_manager.total_size));
+	ZK_ASSERT((zk_uint32) mem_block >= heap->base_address);
+	ZK_ASSERT((zk_uint32) mem_block < (heap->base_address + heap->total_size));
 
 	ZK_ASSERT(mem_block->size >= MEM_BLOCK_MIN_SIZE);
-	ZK_ASSERT(mem_block->size <= g_mem_manager.total_size);
+	ZK_ASSERT(mem_block->size <= heap->total_size);
 
+#if ZK_MEM_DEBUG
 	zk_list_node_t *list_pos = ZK_NULL;
 	zk_uint8 block_found = ZK_FALSE;
-	zk_uint32 free_block_count_before = 0;
+#endif
 
 	ZK_ENTER_CRITICAL();
 
-	ZK_LIST_FOR_EACH_NODE(list_pos, &g_mem_manager.used_list)
+	/* O(1) ownership check: rejects foreign pointers and double free */
+	if (mem_block->magic != MEM_BLOCK_MAGIC_USED)
+	{
+		ZK_EXIT_CRITICAL();
+		ZK_ASSERT(0);
+		return;
+	}
+
+#if ZK_MEM_DEBUG
+	ZK_LIST_FOR_EACH_NODE(list_pos, &heap->used_list)
 	{
 		if (list_pos == &(mem_block->list_node))
 		{
@@ -285,28 +482,21 @@ void mem_free(void *user_addr)
 	}
 
 	ZK_ASSERT(block_found);
+#endif
 
-	zk_list_node_t *node;
-	ZK_LIST_FOR_EACH_NODE(node, &g_mem_manager.free_list)
-	{
-		free_block_count_before++;
-	}
-
-	g_mem_manager.available_size += mem_block->size;
-	g_mem_manager.used_block_count--;
+	heap->available_size += mem_block->size;
+	heap->used_block_count--;
 	zk_list_delete(&(mem_block->list_node));
 
-	mem_check_list_integrity(&g_mem_manager.free_list);
-	mem_merge_free_blocks(mem_block);
-	mem_check_list_integrity(&g_mem_manager.free_list);
-
-	g_mem_manager.free_block_count = 0;
-	ZK_LIST_FOR_EACH_NODE(node, &g_mem_manager.free_list)
-	{
-		g_mem_manager.free_block_count++;
-	}
+#if ZK_MEM_DEBUG
+	mem_check_list_integrity(&heap->free_list);
+#endif
+	mem_merge_free_blocks(heap, mem_block);
+#if ZK_MEM_DEBUG
+	mem_check_list_integrity(&heap->free_list);
+#endif
 
-	g_mem_manager.free_count++;
+	heap->free_count++;
 
 	ZK_EXIT_CRITICAL();
 }
@@ -319,15 +509,19 @@ void mem_validate_free_list(void)
 	zk_list_node_t *node;
 	mem_block_t *prev = ZK_NULL;
 
-	ZK_LIST_FOR_EACH_NODE(node, &g_mem_manager.free_list)
+	for (zk_uint32 i = 0; i < g_mem_region_count; i++)
 	{
-		mem_block_t *current = (mem_block_t *) node;
-		if (prev != ZK_NULL && (zk_uint8 *) prev + prev->size > (zk_uint8 *) current)
+		prev = ZK_NULL;
+		ZK_LIST_FOR_EACH_NODE(node, &g_mem_regions[i].free_list)
 		{
-			zk_printf("[MEM] Free list order violation!");
-			ZK_ASSERT(0);
+			mem_block_t *current = (mem_block_t *) node;
+			if (prev != ZK_NULL && (zk_uint8 *) prev + prev->size > (zk_uint8 *) current)
+			{
+				zk_printf("[MEM] Free list order violation!");
+				ZK_ASSERT(0);
+			}
+			prev = current;
 		}
-		prev = current;
 	}
 }
 
@@ -340,13 +534,16 @@ void mem_print_stats(void)
 	zk_uint32 used_blocks = 0;
 
 	zk_list_node_t *node;
-	ZK_LIST_FOR_EACH_NODE(node, &g_mem_manager.free_list)
+	for (zk_uint32 i = 0; i < g_mem_region_count; i++)
 	{
-		free_blocks++;
-	}
-	ZK_LIST_FOR_EACH_NODE(node, &g_mem_manager.used_list)
-	{
-		used_blocks++;
+		ZK_LIST_FOR_EACH_NODE(node, &g_mem_regions[i].free_list)
+		{
+			free_blocks++;
+		}
+		ZK_LIST_FOR_EACH_NODE(node, &g_mem_regions[i].used_list)
+		{
+			used_blocks++;
+		}
 	}
 }
 
@@ -356,8 +553,32 @@ void mem_print_stats(void)
 void mem_print_free_blocks(void)
 {
 	zk_list_node_t *node;
-	ZK_LIST_FOR_EACH_NODE(node, &g_mem_manager.free_list)
+	for (zk_uint32 i = 0; i < g_mem_region_count; i++)
 	{
+		ZK_LIST_FOR_EACH_NODE(node, &g_mem_regions[i].free_list)
+		{
+		}
+	}
+}
+
+#endif /* !ZK_USING_TLSF */
+
+/**
+ * @brief   Sum the statistics of all regions
+ * @param   total Accumulator, must be zeroed by the caller
+ * @note    Called within critical section. The summed peak is an upper bound, region peaks
+ *          may not have occurred at the same time.
+ */
+static void mem_sum_regions(mem_manager_t *total)
+{
+	for (zk_uint32 i = 0; i < g_mem_region_count; i++)
+	{
+		total->total_size += g_mem_regions[i].total_size;
+		total->available_size += g_mem_regions[i].available_size;
+		total->peak_used_size += g_mem_regions[i].peak_used_size;
+		total->free_block_count += g_mem_regions[i].free_block_count;
+		total->alloc_count += g_mem_regions[i].alloc_count;
+		total->alloc_fail_count += g_mem_regions[i].alloc_fail_count;
 	}
 }
 
@@ -374,43 +595,698 @@ void mem_print_free_blocks(void)
 void mem_get_stats(zk_uint32 *total_size, zk_uint32 *used_size, zk_uint32 *peak_used,
 				   zk_uint32 *free_blocks, zk_uint32 *alloc_count, zk_uint32 *alloc_fail_count)
 {
+	mem_manager_t total;
+
+	zk_memclear(&total, sizeof(mem_manager_t));
+
 	ZK_ENTER_CRITICAL();
 
+	mem_sum_regions(&total);
+
+	ZK_EXIT_CRITICAL();
+
 	if (total_size)
-		*total_size = g_mem_manager.total_size;
+		*total_size = total.total_size;
 	if (used_size)
-		*used_size = g_mem_manager.total_size - g_mem_manager.available_size;
+		*used_size = total.total_size - total.available_size;
 	if (peak_used)
-		*peak_used = g_mem_manager.peak_used_size;
+		*peak_used = total.peak_used_size;
 	if (free_blocks)
-		*free_blocks = g_mem_manager.free_block_count;
+		*free_blocks = total.free_block_count;
 	if (alloc_count)
-		*alloc_count = g_mem_manager.alloc_count;
+		*alloc_count = total.alloc_count;
 	if (alloc_fail_count)
-		*alloc_fail_count = g_mem_manager.alloc_fail_count;
+		*alloc_fail_count = total.alloc_fail_count;
+}
+
+/**
+ * @brief   Get statistics of a single heap region
+ * @param   region_index Region index in registration order (0 = internal heap)
+ * @param   caps Region capabilities (output parameter)
+ * @param   total_size Region size (output parameter)
+ * @param   used_size Current used size (output parameter)
+ * @param   peak_used Peak used size (output parameter)
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mem_get_region_stats(zk_uint32 region_index, zk_uint32 *caps,
+									 zk_uint32 *total_size, zk_uint32 *used_size,
+									 zk_uint32 *peak_used)
+{
+	mem_manager_t *heap = ZK_NULL;
+
+	if (region_index >= g_mem_region_count)
+	{
+		return ZK_ERR_OUT_OF_RANGE;
+	}
+
+	ZK_ENTER_CRITICAL();
+	heap = &g_mem_regions[region_index];
+
+	if (caps)
+		*caps = heap->caps;
+	if (total_size)
+		*total_size = heap->total_size;
+	if (used_size)
+		*used_size = heap->total_size - heap->available_size;
+	if (peak_used)
+		*peak_used = heap->peak_used_size;
 
 	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
 }
 
 /**
  * @brief   Calculate memory fragmentation rate
  * @return  Fragmentation rate (percentage, 0-100)
- * @note    P1: Fragmentation rate = (free block count - 1) / free block count * 100
+ * @note    P1: Fragmentation rate = (free block count - region count) / free block count * 100
  *          Ideal case is 1 large block (0% fragmentation), multiple small blocks indicate severe fragmentation
  */
 zk_uint32 mem_get_fragmentation(void)
 {
 	zk_uint32 fragmentation = 0;
+	zk_uint32 free_block_count = 0;
 
 	ZK_ENTER_CRITICAL();
 
-	if (g_mem_manager.free_block_count > 1)
+	/* Each region contributes at least one free block when it is not fragmented */
+	for (zk_uint32 i = 0; i < g_mem_region_count; i++)
+	{
+		free_block_count += g_mem_regions[i].free_block_count;
+	}
+	if (free_block_count > g_mem_region_count)
 	{
-		fragmentation =
-			((g_mem_manager.free_block_count - 1) * 100) / g_mem_manager.free_block_count;
+		fragmentation = ((free_block_count - g_mem_region_count) * 100) / free_block_count;
 	}
 
 	ZK_EXIT_CRITICAL();
 
 	return fragmentation;
 }
+
+#if ZK_USING_MEM_POOL
+static mem_pool_t g_mem_pool_pool[MEM_POOL_MAX_NUM];
+ZK_HANDLE_POOL_DEFINE(g_mem_pool_handles, MEM_POOL_MAX_NUM);
+
+#define MEM_POOL_HANDLE_TO_POINTER(handle) (&g_mem_pool_pool[ZK_HANDLE_INDEX(handle)])
+
+/* The pool itself is checked under the critical section, a stale handle reports ZK_ERR_STATE */
+#define CHECK_MEM_POOL_HANDLE_VALID(handle)                                                        \
+	if (ZK_HANDLE_INDEX(handle) >= MEM_POOL_MAX_NUM)                                               \
+	return ZK_ERR_INVALID_HANDLE
+
+#define MEM_POOL_IS_LIVE(pool, handle)                                                             \
+	((pool)->is_used != MEM_POOL_UNUSED && zk_handle_is_valid(&g_mem_pool_handles, handle))
+
+/**
+ * @brief   Initialize fixed-size block pool table
+ */
+void mem_pool_init(void)
+{
+	for (zk_uint32 i = 0; i < MEM_POOL_MAX_NUM; i++)
+	{
+		zk_memclear(&g_mem_pool_pool[i], sizeof(mem_pool_t));
+		g_mem_pool_pool[i].is_used = MEM_POOL_UNUSED;
+	}
+	zk_handle_pool_init(&g_mem_pool_handles);
+}
+
+/**
+ * @brief   Round a requested block size up to the pool block size
+ * @return  Aligned block size, 0 on overflow
+ */
+static zk_uint32 mem_pool_block_size(zk_uint32 block_size)
+{
+	if (block_size < sizeof(void *))
+	{
+		block_size = sizeof(void *);
+	}
+	if (block_size > ZK_UINT32_MAX - ZK_BYTE_ALIGNMENT_MASK)
+	{
+		return 0;
+	}
+	return zk_addr_align(block_size, ZK_BYTE_ALIGNMENT, ZK_BYTE_ALIGNMENT_MASK);
+}
+
+/**
+ * @brief   Thread all blocks of a pool into its free list
+ * @note    Called within critical section
+ */
+static void mem_pool_setup(mem_pool_t *pool, zk_uint8 *start, zk_uint32 block_size,
+						   zk_uint32 block_count, zk_uint8 from_heap)
+{
+	zk_uint8 *block = start;
+
+	for (zk_uint32 i = 0; i + 1 < block_count; i++)
+	{
+		*(void **) block = block + block_size;
+		block += block_size;
+	}
+	*(void **) block = ZK_NULL;
+
+	pool->free_head = start;
+	pool->block_start = start;
+	pool->block_size = block_size;
+	pool->block_count = block_count;
+	pool->free_count = block_count;
+	pool->peak_used_count = 0;
+	pool->alloc_count = 0;
+	pool->alloc_fail_count = 0;
+	pool->from_heap = from_heap;
+	pool->is_used = MEM_POOL_USED;
+}
+
+/**
+ * @brief   Create a fixed-size block pool carved out of the heap
+ * @param   pool_handle Pool handle (output parameter)
+ * @param   block_size Size of one block in bytes
+ * @param   block_count Number of blocks
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mem_pool_create(zk_uint32 *pool_handle, zk_uint32 block_size,
+								zk_uint32 block_count)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 total_size = 0;
+	zk_uint8 *storage = ZK_NULL;
+
+	ZK_CHECK_PARAM_NOT_NULL(pool_handle);
+
+	block_size = mem_pool_block_size(block_size);
+	if (block_size == 0 || block_count == 0 || block_count > ZK_UINT32_MAX / block_size)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+	total_size = block_size * block_count;
+
+	storage = (zk_uint8 *) mem_alloc(total_size);
+	if (storage == ZK_NULL)
+	{
+		return ZK_ERR_NOT_ENOUGH_MEMORY;
+	}
+
+	ZK_ENTER_CRITICAL();
+
+	ret = zk_handle_alloc(&g_mem_pool_handles, pool_handle);
+	if (ret != ZK_SUCCESS)
+	{
+		goto mem_pool_create_exit;
+	}
+
+	mem_pool_setup(MEM_POOL_HANDLE_TO_POINTER(*pool_handle), storage, block_size, block_count,
+				   ZK_TRUE);
+
+mem_pool_create_exit:
+	ZK_EXIT_CRITICAL();
+	if (ret != ZK_SUCCESS)
+	{
+		mem_free(storage);
+	}
+	return ret;
+}
+
+/**
+ * @brief   Create a fixed-size block pool over a caller-provided buffer
+ * @param   pool_handle Pool handle (output parameter)
+ * @param   block_size Size of one block in bytes
+ * @param   buffer Pool storage
+ * @param   buffer_size Storage size in bytes, as many blocks as fit are used
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mem_pool_create_static(zk_uint32 *pool_handle, zk_uint32 block_size,
+									   void *buffer, zk_uint32 buffer_size)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 start = 0;
+	zk_uint32 block_count = 0;
+
+	ZK_CHECK_PARAM_NOT_NULL(pool_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+
+	block_size = mem_pool_block_size(block_size);
+	start = zk_addr_align((zk_uint32) buffer, ZK_BYTE_ALIGNMENT, ZK_BYTE_ALIGNMENT_MASK);
+	if (block_size == 0 || start - (zk_uint32) buffer >= buffer_size)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	block_count = (buffer_size - (start - (zk_uint32) buffer)) / block_size;
+	if (block_count == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	ZK_ENTER_CRITICAL();
+
+	ret = zk_handle_alloc(&g_mem_pool_handles, pool_handle);
+	if (ret != ZK_SUCCESS)
+	{
+		goto mem_pool_create_static_exit;
+	}
+
+	mem_pool_setup(MEM_POOL_HANDLE_TO_POINTER(*pool_handle), (zk_uint8 *) start, block_size,
+				   block_count, ZK_FALSE);
+
+mem_pool_create_static_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief   Destroy a pool, all blocks must have been returned
+ * @param   pool_handle Pool handle
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mem_pool_destroy(zk_uint32 pool_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	mem_pool_t *pool = ZK_NULL;
+	void *storage = ZK_NULL;
+
+	CHECK_MEM_POOL_HANDLE_VALID(pool_handle);
+
+	ZK_ENTER_CRITICAL();
+	pool = MEM_POOL_HANDLE_TO_POINTER(pool_handle);
+
+	if (!MEM_POOL_IS_LIVE(pool, pool_handle))
+	{
+		ret = ZK_ERR_STATE;
+		goto mem_pool_destroy_exit;
+	}
+
+	if (pool->free_count != pool->block_count)
+	{
+		ret = ZK_ERR_RESOURCE_UNAVAILABLE;
+		goto mem_pool_destroy_exit;
+	}
+
+	if (pool->from_heap)
+	{
+		storage = pool->block_start;
+	}
+	pool->is_used = MEM_POOL_UNUSED;
+	pool->free_head = ZK_NULL;
+	zk_handle_free(&g_mem_pool_handles, pool_handle);
+
+mem_pool_destroy_exit:
+	ZK_EXIT_CRITICAL();
+	mem_free(storage);
+	return ret;
+}
+
+/**
+ * @brief   Allocate one block from a pool
+ * @param   pool_handle Pool handle
+ * @return  Pointer to the block, NULL if the pool is exhausted or invalid
+ */
+void *mem_pool_alloc(zk_uint32 pool_handle)
+{
+	mem_pool_t *pool = ZK_NULL;
+	void *block = ZK_NULL;
+	zk_uint32 used = 0;
+
+	if (ZK_HANDLE_INDEX(pool_handle) >= MEM_POOL_MAX_NUM)
+	{
+		return ZK_NULL;
+	}
+
+	ZK_ENTER_CRITICAL();
+	pool = MEM_POOL_HANDLE_TO_POINTER(pool_handle);
+
+	if (!MEM_POOL_IS_LIVE(pool, pool_handle))
+	{
+		goto mem_pool_alloc_exit;
+	}
+
+	block = pool->free_head;
+	if (block == ZK_NULL)
+	{
+		pool->alloc_fail_count++;
+#if ZK_USING_HOOK
+		zk_hook_call_malloc_failed(pool->block_size);
+#endif
+		goto mem_pool_alloc_exit;
+	}
+
+	pool->free_head = *(void **) block;
+	pool->free_count--;
+	pool->alloc_count++;
+
+	used = pool->block_count - pool->free_count;
+	if (used > pool->peak_used_count)
+	{
+		pool->peak_used_count = used;
+	}
+
+mem_pool_alloc_exit:
+	ZK_EXIT_CRITICAL();
+	return block;
+}
+
+/**
+ * @brief   Return a block to its pool
+ * @param   pool_handle Pool handle
+ * @param   block Block returned by mem_pool_alloc()
+ * @return  ZK_SUCCESS if success, otherwise error code
+ * @note    Range and block-boundary checks are O(1); double free is not detected
+ */
+zk_error_code_t mem_pool_free(zk_uint32 pool_handle, void *block)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	mem_pool_t *pool = ZK_NULL;
+	zk_uint32 offset = 0;
+
+	CHECK_MEM_POOL_HANDLE_VALID(pool_handle);
+	ZK_CHECK_PARAM_NOT_NULL(block);
+
+	ZK_ENTER_CRITICAL();
+	pool = MEM_POOL_HANDLE_TO_POINTER(pool_handle);
+
+	if (!MEM_POOL_IS_LIVE(pool, pool_handle))
+	{
+		ret = ZK_ERR_STATE;
+		goto mem_pool_free_exit;
+	}
+
+	offset = (zk_uint32) ((zk_uint8 *) block - pool->block_start);
+	if ((zk_uint8 *) block < pool->block_start ||
+		offset >= pool->block_size * pool->block_count || offset % pool->block_size != 0 ||
+		pool->free_count >= pool->block_count)
+	{
+		ret = ZK_ERR_INVALID_PARAM;
+		goto mem_pool_free_exit;
+	}
+
+	*(void **) block = pool->free_head;
+	pool->free_head = block;
+	pool->free_count++;
+
+mem_pool_free_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief   Get pool statistics
+ * @param   pool_handle Pool handle
+ * @param   block_size Aligned block size (output parameter)
+ * @param   total_blocks Number of blocks in the pool (output parameter)
+ * @param   free_blocks Number of free blocks (output parameter)
+ * @param   peak_used Peak number of blocks in use (output parameter)
+ * @param   alloc_count Total allocation count (output parameter)
+ * @param   alloc_fail_count Allocation failure count (output parameter)
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mem_pool_get_stats(zk_uint32 pool_handle, zk_uint32 *block_size,
+								   zk_uint32 *total_blocks, zk_uint32 *free_blocks,
+								   zk_uint32 *peak_used, zk_uint32 *alloc_count,
+								   zk_uint32 *alloc_fail_count)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	mem_pool_t *pool = ZK_NULL;
+
+	CHECK_MEM_POOL_HANDLE_VALID(pool_handle);
+
+	ZK_ENTER_CRITICAL();
+	pool = MEM_POOL_HANDLE_TO_POINTER(pool_handle);
+
+	if (!MEM_POOL_IS_LIVE(pool, pool_handle))
+	{
+		ret = ZK_ERR_STATE;
+		goto mem_pool_get_stats_exit;
+	}
+
+	if (block_size)
+		*block_size = pool->block_size;
+	if (total_blocks)
+		*total_blocks = pool->block_count;
+	if (free_blocks)
+		*free_blocks = pool->free_count;
+	if (peak_used)
+		*peak_used = pool->peak_used_count;
+	if (alloc_count)
+		*alloc_count = pool->alloc_count;
+	if (alloc_fail_count)
+		*alloc_fail_count = pool->alloc_fail_count;
+
+mem_pool_get_stats_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+#endif /* ZK_USING_MEM_POOL */
+
+#if ZK_USING_ARENA
+/**
+ * @brief   Point an arena at its storage and empty it
+ */
+static zk_error_code_t arena_setup(zk_arena_t *arena, void *storage, zk_uint32 size,
+								   zk_uint8 source, zk_uint8 flags)
+{
+	zk_uint32 start = 0;
+
+	start = zk_addr_align((zk_uint32) storage, ZK_BYTE_ALIGNMENT, ZK_BYTE_ALIGNMENT_MASK);
+	if (start - (zk_uint32) storage >= size)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	arena->base = (zk_uint8 *) start;
+	arena->size = (size - (start - (zk_uint32) storage)) & ~((zk_uint32) ZK_BYTE_ALIGNMENT_MASK);
+	arena->offset = 0;
+	arena->peak = 0;
+	arena->fail_count = 0;
+	arena->storage = storage;
+	arena->pool_handle = 0;
+	arena->source = source;
+	arena->flags = flags;
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief   Create an arena carved out of the heap
+ * @param   arena Arena object, owned by the caller
+ * @param   size Storage size in bytes
+ * @param   flags ZK_ARENA_PRIVATE, or ZK_ARENA_SHARED if several tasks or ISRs allocate from it
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t arena_create(zk_arena_t *arena, zk_uint32 size, zk_uint8 flags)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	void *storage = ZK_NULL;
+
+	ZK_CHECK_PARAM_NOT_NULL(arena);
+	if (size == 0 || flags > ZK_ARENA_SHARED)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	storage = mem_alloc(size);
+	if (storage == ZK_NULL)
+	{
+		return ZK_ERR_NOT_ENOUGH_MEMORY;
+	}
+
+	ret = arena_setup(arena, storage, size, ZK_ARENA_FROM_HEAP, flags);
+	if (ret != ZK_SUCCESS)
+	{
+		mem_free(storage);
+	}
+	return ret;
+}
+
+/**
+ * @brief   Create an arena over a caller-provided buffer
+ * @param   arena Arena object, owned by the caller
+ * @param   buffer Arena storage
+ * @param   size Storage size in bytes
+ * @param   flags ZK_ARENA_PRIVATE or ZK_ARENA_SHARED
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t arena_create_static(zk_arena_t *arena, void *buffer, zk_uint32 size,
+									zk_uint8 flags)
+{
+	ZK_CHECK_PARAM_NOT_NULL(arena);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+	if (flags > ZK_ARENA_SHARED)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	return arena_setup(arena, buffer, size, ZK_ARENA_FROM_STATIC, flags);
+}
+
+#if ZK_USING_MEM_POOL
+/**
+ * @brief   Create an arena over one block of a fixed-size pool
+ * @param   arena Arena object, owned by the caller
+ * @param   pool_handle Pool handle, the arena is one block large
+ * @param   flags ZK_ARENA_PRIVATE or ZK_ARENA_SHARED
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t arena_create_from_pool(zk_arena_t *arena, zk_uint32 pool_handle, zk_uint8 flags)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	void *block = ZK_NULL;
+
+	ZK_CHECK_PARAM_NOT_NULL(arena);
+	if (flags > ZK_ARENA_SHARED)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	block = mem_pool_alloc(pool_handle);
+	if (block == ZK_NULL)
+	{
+		return ZK_ERR_NOT_ENOUGH_MEMORY;
+	}
+
+	/* the block just taken keeps the pool from being destroyed */
+	ret = arena_setup(arena, block, MEM_POOL_HANDLE_TO_POINTER(pool_handle)->block_size,
+					  ZK_ARENA_FROM_POOL, flags);
+	if (ret != ZK_SUCCESS)
+	{
+		mem_pool_free(pool_handle, block);
+		return ret;
+	}
+	arena->pool_handle = pool_handle;
+	return ZK_SUCCESS;
+}
+#endif
+
+/**
+ * @brief   Destroy an arena and give its storage back
+ * @param   arena Arena object
+ * @return  ZK_SUCCESS if success, otherwise error code
+ * @note    Every allocation of the arena dies with it, clear task defaults pointing at it first
+ */
+zk_error_code_t arena_destroy(zk_arena_t *arena)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	ZK_CHECK_PARAM_NOT_NULL(arena);
+
+	if (arena->source == ZK_ARENA_FROM_HEAP)
+	{
+		mem_free(arena->storage);
+	}
+#if ZK_USING_MEM_POOL
+	else if (arena->source == ZK_ARENA_FROM_POOL)
+	{
+		ret = mem_pool_free(arena->pool_handle, arena->storage);
+	}
+#endif
+	zk_memclear(arena, sizeof(zk_arena_t));
+	return ret;
+}
+
+/**
+ * @brief   Take size bytes off the top of an arena
+ * @return  Allocated memory, NULL if it does not fit
+ */
+static inline void *arena_bump(zk_arena_t *arena, zk_uint32 size)
+{
+	void *block = ZK_NULL;
+
+	if (size <= arena->size - arena->offset)
+	{
+		block = arena->base + arena->offset;
+		arena->offset += size;
+		if (arena->offset > arena->peak)
+		{
+			arena->peak = arena->offset;
+		}
+	}
+	else
+	{
+		arena->fail_count++;
+	}
+	return block;
+}
+
+/**
+ * @brief   Allocate from an arena
+ * @param   arena Arena object
+ * @param   size Requested size in bytes, rounded up to ZK_BYTE_ALIGNMENT
+ * @return  Allocated memory, NULL if the arena is full
+ * @note    A private arena is a pointer bump with no lock and must stay with one task
+ */
+void *arena_alloc(zk_arena_t *arena, zk_uint32 size)
+{
+	void *block = ZK_NULL;
+
+	if (arena == ZK_NULL || size == 0 || size > ZK_UINT32_MAX - ZK_BYTE_ALIGNMENT_MASK)
+	{
+		return ZK_NULL;
+	}
+	size = zk_addr_align(size, ZK_BYTE_ALIGNMENT, ZK_BYTE_ALIGNMENT_MASK);
+
+	if (arena->flags == ZK_ARENA_SHARED)
+	{
+		ZK_ENTER_CRITICAL();
+		block = arena_bump(arena, size);
+		ZK_EXIT_CRITICAL();
+	}
+	else
+	{
+		block = arena_bump(arena, size);
+	}
+
+#if ZK_USING_HOOK
+	if (block == ZK_NULL)
+	{
+		zk_hook_call_malloc_failed(size);
+	}
+#endif
+	return block;
+}
+
+/**
+ * @brief   Release every allocation of an arena at once
+ * @param   arena Arena object
+ */
+void arena_reset(zk_arena_t *arena)
+{
+	if (arena == ZK_NULL)
+	{
+		return;
+	}
+
+	if (arena->flags == ZK_ARENA_SHARED)
+	{
+		ZK_ENTER_CRITICAL();
+		arena->offset = 0;
+		ZK_EXIT_CRITICAL();
+	}
+	else
+	{
+		arena->offset = 0;
+	}
+}
+
+/**
+ * @brief   Get arena statistics
+ * @param   arena Arena object
+ * @param   size Usable bytes (output parameter, may be NULL)
+ * @param   used Bytes allocated since the last reset (output parameter, may be NULL)
+ * @param   peak Largest use since creation (output parameter, may be NULL)
+ * @param   fail_count Allocations that did not fit (output parameter, may be NULL)
+ * @return  ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t arena_get_stats(zk_arena_t *arena, zk_uint32 *size, zk_uint32 *used,
+								zk_uint32 *peak, zk_uint32 *fail_count)
+{
+	ZK_CHECK_PARAM_NOT_NULL(arena);
+
+	ZK_ENTER_CRITICAL();
+	if (size)
+		*size = arena->size;
+	if (used)
+		*used = arena->offset;
+	if (peak)
+		*peak = arena->peak;
+	if (fail_count)
+		*fail_count = arena->fail_count;
+	ZK_EXIT_CRITICAL();
+
+	return ZK_SUCCESS;
+}
+#endif /* ZK_USING_ARENA */
@@ -0,0 +1,295 @@
+/**
+ * @file    zk_mem_tlsf.c
+ * @brief   Two-Level Segregated Fit heap backend
+ * @note    Selected with ZK_USING_TLSF. Free blocks are kept in size classes indexed by a
+ *          first-level (power of two) and second-level (linear subdivision) bitmap, and every
+ *          block carries a boundary tag (prev_phys) so neighbours coalesce without a walk.
+ *          mem_alloc() and mem_free() are O(1).
+ */
+
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_MEM
+
+#include "zk_internal.h"
+
+#if ZK_USING_TLSF
+
+#define MEM_TLSF_BLOCK_SIZE(block) ((block)->size & ~MEM_TLSF_BLOCK_FREE)
+#define MEM_TLSF_BLOCK_IS_FREE(block) (((block)->size & MEM_TLSF_BLOCK_FREE) != 0)
+#define MEM_TLSF_NEXT_PHYS(block)                                                                  \
+	((mem_block_t *) ((zk_uint8 *) (block) + MEM_TLSF_BLOCK_SIZE(block)))
+
+/**
+ * @brief   Map a block size to the class it is stored in
+ */
+static inline void mem_tlsf_mapping_insert(zk_uint32 size, zk_uint32 *fl, zk_uint32 *sl)
+{
+	zk_uint32 fls = 0;
+
+	if (size < MEM_TLSF_SMALL_BLOCK_SIZE)
+	{
+		*fl = 0;
+		*sl = size >> MEM_TLSF_ALIGN_LOG2;
+	}
+	else
+	{
+		fls = zk_cpu_fls(size);
+		*sl = (size >> (fls - MEM_TLSF_SL_INDEX_COUNT_LOG2)) ^ MEM_TLSF_SL_INDEX_COUNT;
+		*fl = fls - (MEM_TLSF_FL_INDEX_SHIFT - 1);
+	}
+}
+
+/**
+ * @brief   Map a request to the first class whose blocks are all large enough
+ */
+static inline void mem_tlsf_mapping_search(zk_uint32 size, zk_uint32 *fl, zk_uint32 *sl)
+{
+	if (size >= MEM_TLSF_SMALL_BLOCK_SIZE)
+	{
+		size += (1UL << (zk_cpu_fls(size) - MEM_TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+	}
+	mem_tlsf_mapping_insert(size, fl, sl);
+}
+
+/**
+ * @brief   Insert a free block into its size class
+ */
+static void mem_tlsf_insert_free_block(mem_manager_t *heap, mem_block_t *block)
+{
+	zk_uint32 fl = 0;
+	zk_uint32 sl = 0;
+	mem_block_t *head = ZK_NULL;
+
+	mem_tlsf_mapping_insert(MEM_TLSF_BLOCK_SIZE(block), &fl, &sl);
+	head = heap->blocks[fl][sl];
+
+	block->prev_free = ZK_NULL;
+	block->next_free = head;
+	if (head != ZK_NULL)
+	{
+		head->prev_free = block;
+	}
+	heap->blocks[fl][sl] = block;
+
+	heap->fl_bitmap |= (1UL << fl);
+	heap->sl_bitmap[fl] |= (1UL << sl);
+	heap->free_block_count++;
+}
+
+/**
+ * @brief   Remove a free block from its size class
+ */
+static void mem_tlsf_remove_free_block(mem_manager_t *heap, mem_block_t *block)
+{
+	zk_uint32 fl = 0;
+	zk_uint32 sl = 0;
+
+	mem_tlsf_mapping_insert(MEM_TLSF_BLOCK_SIZE(block), &fl, &sl);
+
+	if (block->next_free != ZK_NULL)
+	{
+		block->next_free->prev_free = block->prev_free;
+	}
+	if (block->prev_free != ZK_NULL)
+	{
+		block->prev_free->next_free = block->next_free;
+	}
+	else
+	{
+		heap->blocks[fl][sl] = block->next_free;
+		if (block->next_free == ZK_NULL)
+		{
+			heap->sl_bitmap[fl] &= ~(1UL << sl);
+			if (heap->sl_bitmap[fl] == 0)
+			{
+				heap->fl_bitmap &= ~(1UL << fl);
+			}
+		}
+	}
+	heap->free_block_count--;
+}
+
+/**
+ * @brief   Find a free block of at least the class (fl, sl)
+ * @return  Head of the first non-empty suitable class, NULL if none
+ */
+static mem_block_t *mem_tlsf_find_suitable(mem_manager_t *heap, zk_uint32 fl, zk_uint32 sl)
+{
+	zk_uint32 sl_map = 0;
+	zk_uint32 fl_map = 0;
+
+	if (fl >= MEM_TLSF_FL_INDEX_COUNT)
+	{
+		return ZK_NULL;
+	}
+
+	sl_map = heap->sl_bitmap[fl] & (~0UL << sl);
+	if (sl_map == 0)
+	{
+		fl_map = heap->fl_bitmap & (~0UL << (fl + 1));
+		if (fl_map == 0)
+		{
+			return ZK_NULL;
+		}
+		fl = zk_cpu_clz(fl_map);
+		sl_map = heap->sl_bitmap[fl];
+	}
+	sl = zk_cpu_clz(sl_map);
+
+	return heap->blocks[fl][sl];
+}
+
+/**
+ * @brief   Initialize one heap region
+ * @param   heap Region manager
+ * @param   start Region start address
+ * @param   size Region size in bytes, must be smaller than 2^MEM_TLSF_FL_INDEX_MAX
+ * @note    The region ends with a zero-size used sentinel so the last block also has a
+ *          physical successor
+ */
+void mem_heap_init(mem_manager_t *heap, zk_uint32 start, zk_uint32 size)
+{
+	mem_block_t *initial_free_block = ZK_NULL;
+	mem_block_t *sentinel = ZK_NULL;
+	zk_uint32 heap_size = 0;
+
+	zk_memclear(heap, sizeof(mem_manager_t));
+
+	heap->base_address = zk_addr_align(start, ZK_BYTE_ALIGNMENT, ZK_BYTE_ALIGNMENT_MASK);
+	heap_size = (size - (heap->base_address - start)) & ~((zk_uint32) ZK_BYTE_ALIGNMENT_MASK);
+	if (heap_size >= (1UL << MEM_TLSF_FL_INDEX_MAX))
+	{
+		heap_size = (1UL << MEM_TLSF_FL_INDEX_MAX) - ZK_BYTE_ALIGNMENT;
+	}
+
+	heap->total_size = heap_size - MEM_BLOCK_ALIGNMENT;
+	heap->available_size = heap->total_size;
+	heap->is_initialized = ZK_TRUE;
+
+	initial_free_block = (mem_block_t *) heap->base_address;
+	initial_free_block->prev_phys = ZK_NULL;
+	initial_free_block->size = heap->total_size | MEM_TLSF_BLOCK_FREE;
+
+	sentinel = MEM_TLSF_NEXT_PHYS(initial_free_block);
+	sentinel->prev_phys = initial_free_block;
+	sentinel->size = 0;
+
+	mem_tlsf_insert_free_block(heap, initial_free_block);
+}
+
+/**
+ * @brief   Allocate memory from one heap region
+ * @param   heap Region manager
+ * @param   request_size Size of memory to allocate
+ * @return  Pointer to allocated memory block, NULL if the region cannot satisfy it
+ * @note    Failure accounting and the malloc-failed hook are left to mem_alloc_region()
+ */
+void *mem_heap_alloc(mem_manager_t *heap, zk_uint32 request_size)
+{
+	ZK_ASSERT(heap->is_initialized);
+
+	if (request_size == 0 || request_size > (heap->total_size - MEM_BLOCK_ALIGNMENT))
+	{
+		return ZK_NULL;
+	}
+
+	zk_uint32 final_size = zk_addr_align(request_size + MEM_BLOCK_ALIGNMENT, ZK_BYTE_ALIGNMENT,
+										 ZK_BYTE_ALIGNMENT_MASK);
+	if (final_size < MEM_BLOCK_MIN_SIZE)
+	{
+		final_size = MEM_BLOCK_MIN_SIZE;
+	}
+
+	zk_uint32 fl = 0;
+	zk_uint32 sl = 0;
+	zk_uint32 block_size = 0;
+	zk_uint32 current_used = 0;
+	mem_block_t *block = ZK_NULL;
+	mem_block_t *remainder = ZK_NULL;
+
+	ZK_ENTER_CRITICAL();
+
+	mem_tlsf_mapping_search(final_size, &fl, &sl);
+	block = mem_tlsf_find_suitable(heap, fl, sl);
+	if (block == ZK_NULL)
+	{
+		ZK_EXIT_CRITICAL();
+		return ZK_NULL;
+	}
+
+	mem_tlsf_remove_free_block(heap, block);
+	block_size = MEM_TLSF_BLOCK_SIZE(block);
+
+	if (block_size - final_size >= MEM_BLOCK_MIN_SIZE)
+	{
+		remainder = (mem_block_t *) ((zk_uint8 *) block + final_size);
+		remainder->prev_phys = block;
+		remainder->size = (block_size - final_size) | MEM_TLSF_BLOCK_FREE;
+		MEM_TLSF_NEXT_PHYS(remainder)->prev_phys = remainder;
+		mem_tlsf_insert_free_block(heap, remainder);
+		block_size = final_size;
+	}
+	block->size = block_size;
+
+	heap->available_size -= block_size;
+	heap->used_block_count++;
+	heap->alloc_count++;
+
+	current_used = heap->total_size - heap->available_size;
+	if (current_used > heap->peak_used_size)
+	{
+		heap->peak_used_size = current_used;
+	}
+
+	ZK_EXIT_CRITICAL();
+
+	return (void *) ((zk_uint8 *) block + MEM_BLOCK_ALIGNMENT);
+}
+
+/**
+ * @brief   Free memory back to the heap region that owns it
+ * @param   heap Region manager
+ * @param   user_addr Pointer to memory block to free
+ */
+void mem_heap_free(mem_manager_t *heap, void *user_addr)
+{
+	ZK_ASSERT(heap->is_initialized);
+
+	mem_block_t *block = (mem_block_t *) ((zk_uint8 *) user_addr - MEM_BLOCK_ALIGNMENT);
+	mem_block_t *neighbour = ZK_NULL;
+
+	ZK_ASSERT((zk_uint32) block >= heap->base_address);
+	ZK_ASSERT((zk_uint32) block < (heap->base_address + heap->total_size));
+	ZK_ASSERT(!MEM_TLSF_BLOCK_IS_FREE(block));
+	ZK_ASSERT(block->size >= MEM_BLOCK_MIN_SIZE);
+
+	ZK_ENTER_CRITICAL();
+
+	heap->available_size += block->size;
+	heap->used_block_count--;
+	heap->free_count++;
+
+	/* Coalesce with the physically previous block */
+	neighbour = block->prev_phys;
+	if (neighbour != ZK_NULL && MEM_TLSF_BLOCK_IS_FREE(neighbour))
+	{
+		mem_tlsf_remove_free_block(heap, neighbour);
+		neighbour->size += block->size;
+		block = neighbour;
+	}
+
+	/* Coalesce with the physically next block (the sentinel is never free) */
+	neighbour = MEM_TLSF_NEXT_PHYS(block);
+	if (MEM_TLSF_BLOCK_IS_FREE(neighbour))
+	{
+		mem_tlsf_remove_free_block(heap, neighbour);
+		block->size += MEM_TLSF_BLOCK_SIZE(neighbour);
+	}
+
+	block->size |= MEM_TLSF_BLOCK_FREE;
+	MEM_TLSF_NEXT_PHYS(block)->prev_phys = block;
+	mem_tlsf_insert_free_block(heap, block);
+
+	ZK_EXIT_CRITICAL();
+}
+
+#endif /* ZK_USING_TLSF */
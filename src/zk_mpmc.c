@@ -0,0 +1,332 @@
+/**
+ * @file    zk_mpmc.c
+ * @brief   lock-free bounded multi-producer/multi-consumer queue
+ * @note    Writers and readers claim a position by moving write_pos / read_pos on with
+ *          LDREX/STREX, then copy the element and hand the slot over by storing its sequence
+ *          word. Exception entry and return clear the exclusive monitor, so a claim interrupted
+ *          by another task simply retries. A task enters a critical section only to block on a
+ *          full or empty queue, and a writer / reader only to wake such a task.
+ */
+
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_QUEUE
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_MPMC
+extern task_control_block_t *volatile g_current_tcb;
+
+/**
+ * @brief sequence word of the slot of a position, the element follows it
+ */
+static inline volatile zk_uint32 *mpmc_slot(const zk_mpmc_t *mpmc, zk_uint32 pos)
+{
+	return (volatile zk_uint32 *) (mpmc->storage + (pos & mpmc->mask) * mpmc->slot_size);
+}
+
+/**
+ * @brief move a position counter from pos to pos + 1 unless another task moved it first
+ */
+static zk_bool mpmc_claim(volatile zk_uint32 *counter, zk_uint32 pos)
+{
+	if (zk_cpu_ldrex(counter) != pos)
+	{
+		zk_cpu_clrex();
+		return ZK_FALSE;
+	}
+	return zk_cpu_strex(pos + 1, counter) == 0;
+}
+
+/**
+ * @brief whether the next write position is free
+ * @note  a reader that claimed the slot one lap ago and has not released it yet keeps it full
+ */
+static inline zk_bool mpmc_writable(const zk_mpmc_t *mpmc)
+{
+	zk_uint32 pos = mpmc->write_pos;
+
+	return (zk_int32) (*mpmc_slot(mpmc, pos) - pos) >= 0;
+}
+
+/**
+ * @brief whether the next read position holds an element
+ * @note  a writer that claimed the slot and has not published it yet keeps it empty
+ */
+static inline zk_bool mpmc_readable(const zk_mpmc_t *mpmc)
+{
+	zk_uint32 pos = mpmc->read_pos;
+
+	return (zk_int32) (*mpmc_slot(mpmc, pos) - (pos + 1)) >= 0;
+}
+
+/**
+ * @brief claim a free slot, copy the element in and publish it
+ * @return zk_bool ZK_FALSE if the queue is full
+ */
+static zk_bool mpmc_push(zk_mpmc_t *mpmc, const void *data)
+{
+	volatile zk_uint32 *slot = ZK_NULL;
+	zk_uint32 pos = 0;
+	zk_int32 diff = 0;
+
+	for (;;)
+	{
+		pos = mpmc->write_pos;
+		slot = mpmc_slot(mpmc, pos);
+		diff = (zk_int32) (*slot - pos);
+		if (diff < 0)
+		{
+			return ZK_FALSE;
+		}
+		/* diff > 0: another writer took pos after we read it */
+		if (diff == 0 && mpmc_claim(&mpmc->write_pos, pos))
+		{
+			break;
+		}
+	}
+
+	zk_memcpy((void *) (slot + 1), data, mpmc->element_size);
+	/* the element must be visible before the slot is handed to a reader */
+	ZK_MEMORY_BARRIER();
+	*slot = pos + 1;
+	/* publish before the sleep list is sampled */
+	ZK_MEMORY_BARRIER();
+	return ZK_TRUE;
+}
+
+/**
+ * @brief claim a full slot, copy the element out and free the slot for the next lap
+ * @return zk_bool ZK_FALSE if the queue is empty
+ */
+static zk_bool mpmc_pop(zk_mpmc_t *mpmc, void *data)
+{
+	volatile zk_uint32 *slot = ZK_NULL;
+	zk_uint32 pos = 0;
+	zk_int32 diff = 0;
+
+	for (;;)
+	{
+		pos = mpmc->read_pos;
+		slot = mpmc_slot(mpmc, pos);
+		diff = (zk_int32) (*slot - (pos + 1));
+		if (diff < 0)
+		{
+			return ZK_FALSE;
+		}
+		/* diff > 0: another reader took pos after we read it */
+		if (diff == 0 && mpmc_claim(&mpmc->read_pos, pos))
+		{
+			break;
+		}
+	}
+
+	/* do not read an element older than the sequence we just checked */
+	ZK_MEMORY_BARRIER();
+	zk_memcpy(data, (const void *) (slot + 1), mpmc->element_size);
+	ZK_MEMORY_BARRIER();
+	*slot = pos + mpmc->mask + 1;
+	ZK_MEMORY_BARRIER();
+	return ZK_TRUE;
+}
+
+/**
+ * @brief wake the first task of a sleep list
+ * @note  the list is sampled outside the critical section: a task only joins it inside one,
+ *        after finding the queue still full / empty, so it cannot miss the slot just handed over
+ */
+static void mpmc_wake_one(zk_list_node_t *sleep_list)
+{
+	task_control_block_t *wakeup_task = ZK_NULL;
+
+	if (zk_list_is_empty(sleep_list))
+	{
+		return;
+	}
+
+	ZK_ENTER_CRITICAL();
+	if (!zk_list_is_empty(sleep_list))
+	{
+		wakeup_task =
+			ZK_LIST_GET_FIRST_ENTRY(sleep_list, task_control_block_t, event_sleep_list);
+		task_block_to_ready(wakeup_task);
+		schedule();
+	}
+	ZK_EXIT_CRITICAL();
+}
+
+/**
+ * @brief block the current task on a sleep list until woken or timed out
+ * @return zk_error_code_t ZK_SUCCESS if woken by the queue, otherwise error code
+ * @note  called within critical section, returns within critical section
+ */
+static zk_error_code_t mpmc_wait(zk_list_node_t *sleep_list, zk_uint32 timeout,
+								 zk_uint32 deadline)
+{
+	task_control_block_t *current_tcb = g_current_tcb;
+	zk_uint32 now = get_current_time();
+
+	if (is_scheduler_suspending())
+	{
+		return ZK_ERR_STATE;
+	}
+	if (timeout != ZK_TIMEOUT_INFINITE && zk_time_is_reached(now, deadline))
+	{
+		return ZK_ERR_TIMEOUT;
+	}
+
+	current_tcb->event_timeout_wakeup = EVENT_NO_TIMEOUT;
+	current_tcb->wake_up_time = deadline;
+	task_ready_to_block(current_tcb, sleep_list,
+						(timeout == ZK_TIMEOUT_INFINITE) ? BLOCK_TYPE_ENDLESS : BLOCK_TYPE_TIMEOUT,
+						BLOCK_SORT_PRIO);
+	schedule();
+	ZK_EXIT_CRITICAL();
+
+	ZK_ENTER_CRITICAL();
+	if (current_tcb->event_timeout_wakeup == EVENT_WAIT_TIMEOUT)
+	{
+		return ZK_ERR_TIMEOUT;
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief init a queue over caller-owned storage
+ * @param mpmc queue object
+ * @param storage ZK_MPMC_STORAGE_SIZE(element_size, capacity) bytes, word aligned
+ * @param element_size bytes per element
+ * @param capacity number of elements, a power of two of at least 2
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mpmc_init(zk_mpmc_t *mpmc, void *storage, zk_uint32 element_size,
+						  zk_uint32 capacity)
+{
+	zk_uint32 i = 0;
+
+	ZK_CHECK_PARAM_NOT_NULL(mpmc);
+	ZK_CHECK_PARAM_NOT_NULL(storage);
+
+	if (element_size == 0 || capacity < 2 || (capacity & (capacity - 1)) != 0 ||
+		((zk_uint32) storage & (sizeof(zk_uint32) - 1)) != 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	mpmc->storage = (zk_uint8 *) storage;
+	mpmc->slot_size = ZK_MPMC_SLOT_SIZE(element_size);
+	mpmc->element_size = element_size;
+	mpmc->mask = capacity - 1;
+	mpmc->write_pos = 0;
+	mpmc->read_pos = 0;
+	zk_list_init(&mpmc->reader_sleep_list);
+	zk_list_init(&mpmc->writer_sleep_list);
+	for (i = 0; i < capacity; i++)
+	{
+		*mpmc_slot(mpmc, i) = i;
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief write one element, blocking while the queue is full
+ * @param mpmc queue object
+ * @param data element_size bytes
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if written, ZK_ERR_FAILED if full and timeout is
+ *         ZK_TIMEOUT_NONE, otherwise error code
+ * @note  a writer woken for a slot may find it taken by another writer and waits again
+ */
+zk_error_code_t mpmc_write(zk_mpmc_t *mpmc, const void *data, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 deadline = get_current_time() + timeout;
+
+	ZK_CHECK_PARAM_NOT_NULL(mpmc);
+	ZK_CHECK_PARAM_NOT_NULL(data);
+
+	while (!mpmc_push(mpmc, data))
+	{
+		if (timeout == ZK_TIMEOUT_NONE)
+		{
+			return ZK_ERR_FAILED;
+		}
+
+		ZK_ENTER_CRITICAL();
+		if (!mpmc_writable(mpmc))
+		{
+			ret = mpmc_wait(&mpmc->writer_sleep_list, timeout, deadline);
+		}
+		ZK_EXIT_CRITICAL();
+		if (ret != ZK_SUCCESS)
+		{
+			return ret;
+		}
+	}
+
+	mpmc_wake_one(&mpmc->reader_sleep_list);
+	/* the wakeup for a slot freed while no writer was asleep is passed along here */
+	if (mpmc_writable(mpmc))
+	{
+		mpmc_wake_one(&mpmc->writer_sleep_list);
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief read one element, blocking while the queue is empty
+ * @param mpmc queue object
+ * @param data element_size bytes of room
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if read, ZK_ERR_FAILED if empty and timeout is
+ *         ZK_TIMEOUT_NONE, otherwise error code
+ * @note  elements are read in position order; one whose writer was preempted before
+ *        publishing it holds back the ones behind it until the writer resumes
+ */
+zk_error_code_t mpmc_read(zk_mpmc_t *mpmc, void *data, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 deadline = get_current_time() + timeout;
+
+	ZK_CHECK_PARAM_NOT_NULL(mpmc);
+	ZK_CHECK_PARAM_NOT_NULL(data);
+
+	while (!mpmc_pop(mpmc, data))
+	{
+		if (timeout == ZK_TIMEOUT_NONE)
+		{
+			return ZK_ERR_FAILED;
+		}
+
+		ZK_ENTER_CRITICAL();
+		if (!mpmc_readable(mpmc))
+		{
+			ret = mpmc_wait(&mpmc->reader_sleep_list, timeout, deadline);
+		}
+		ZK_EXIT_CRITICAL();
+		if (ret != ZK_SUCCESS)
+		{
+			return ret;
+		}
+	}
+
+	mpmc_wake_one(&mpmc->writer_sleep_list);
+	/* the wakeup for an element published while no reader was asleep is passed along here */
+	if (mpmc_readable(mpmc))
+	{
+		mpmc_wake_one(&mpmc->reader_sleep_list);
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief number of claimed write positions not yet claimed by a reader
+ * @note  a snapshot; elements being copied in or out are counted as stored
+ */
+zk_uint32 mpmc_count(const zk_mpmc_t *mpmc)
+{
+	zk_uint32 read_pos = mpmc->read_pos;
+
+	return mpmc->write_pos - read_pos;
+}
+
+#endif /* ZK_USING_MPMC */
@@ -0,0 +1,637 @@
+/**
+ * @file    zk_msgbuf.c
+ * @brief   message buffer / stream buffer module
+ * @note    Variable-length data in one byte ring. A message buffer stores every record as a
+ *          MSGBUF_LENGTH_BYTES length prefix followed by the payload and hands out whole
+ *          records; a stream buffer stores raw bytes and wakes the reader once trigger_level
+ *          bytes are available. Blocking follows zk_queue.c: priority-sorted sleep lists,
+ *          ZK_TIMEOUT_NONE / ticks / ZK_TIMEOUT_INFINITE, and callers re-check after waking.
+ */
+
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_QUEUE
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_MSGBUF
+
+static msgbuf_t g_msgbuf_pool[MSGBUF_MAX_NUM];
+ZK_HANDLE_POOL_DEFINE(g_msgbuf_handles, MSGBUF_MAX_NUM);
+extern task_control_block_t *volatile g_current_tcb;
+
+#define MSGBUF_HANDLE_TO_POINTER(handle) (&g_msgbuf_pool[ZK_HANDLE_INDEX(handle)])
+
+#define CHECK_MSGBUF_HANDLE_VALID(handle)                                                          \
+	if (!zk_handle_is_valid(&g_msgbuf_handles, handle))                                            \
+	return ZK_ERR_INVALID_HANDLE
+
+#define CHECK_MSGBUF_CREATED(handle)                                                               \
+	if (MSGBUF_HANDLE_TO_POINTER(handle)->is_used == MSGBUF_UNUSED)                                \
+	return ZK_ERR_STATE
+
+void msgbuf_init(void)
+{
+	for (zk_uint32 i = 0; i < MSGBUF_MAX_NUM; i++)
+	{
+		g_msgbuf_pool[i].data_buffer = ZK_NULL;
+		g_msgbuf_pool[i].size = 0;
+		g_msgbuf_pool[i].used = 0;
+		g_msgbuf_pool[i].read_pos = 0;
+		g_msgbuf_pool[i].write_pos = 0;
+		g_msgbuf_pool[i].trigger_level = 1;
+		g_msgbuf_pool[i].mode = MSGBUF_MODE_MESSAGE;
+		g_msgbuf_pool[i].static_buffer = ZK_FALSE;
+		g_msgbuf_pool[i].is_used = MSGBUF_UNUSED;
+		zk_list_init(&g_msgbuf_pool[i].reader_sleep_list);
+		zk_list_init(&g_msgbuf_pool[i].writer_sleep_list);
+	}
+	zk_handle_pool_init(&g_msgbuf_handles);
+}
+
+/**
+ * @brief take a buffer object from the pool and attach its storage
+ * @note trigger_level is clamped to [1, size] and ignored in message mode
+ */
+static zk_error_code_t msgbuf_setup(zk_uint32 *msgbuf_handle, msgbuf_mode_t mode,
+									zk_uint32 size, zk_uint32 trigger_level, void *buffer,
+									zk_uint8 static_buffer)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	msgbuf_t *mb = ZK_NULL;
+
+	ZK_ENTER_CRITICAL();
+
+	ret = zk_handle_alloc(&g_msgbuf_handles, msgbuf_handle);
+	if (ret != ZK_SUCCESS)
+	{
+		goto msgbuf_setup_exit;
+	}
+
+	mb = MSGBUF_HANDLE_TO_POINTER(*msgbuf_handle);
+	mb->data_buffer = (zk_uint8 *) buffer;
+	mb->size = size;
+	mb->used = 0;
+	mb->read_pos = 0;
+	mb->write_pos = 0;
+	mb->trigger_level = (trigger_level == 0) ? 1 : (trigger_level > size ? size : trigger_level);
+	mb->mode = (zk_uint8) mode;
+	mb->static_buffer = static_buffer;
+	mb->is_used = MSGBUF_USED;
+
+msgbuf_setup_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+static inline zk_bool msgbuf_mode_valid(msgbuf_mode_t mode, zk_uint32 size)
+{
+	if (mode == MSGBUF_MODE_MESSAGE)
+	{
+		return size > MSGBUF_LENGTH_BYTES;
+	}
+	return mode == MSGBUF_MODE_STREAM && size > 0;
+}
+
+/**
+ * @brief create a message or stream buffer
+ * @param msgbuf_handle handle (output parameter)
+ * @param mode MSGBUF_MODE_MESSAGE or MSGBUF_MODE_STREAM
+ * @param size ring size in bytes; in message mode every record also costs
+ *        MSGBUF_LENGTH_BYTES for its length prefix
+ * @param trigger_level stream mode: bytes that must be buffered before a blocked reader
+ *        wakes (0 is taken as 1), ignored in message mode
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t msgbuf_create(zk_uint32 *msgbuf_handle, msgbuf_mode_t mode, zk_uint32 size,
+							  zk_uint32 trigger_level)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	void *buffer = ZK_NULL;
+
+	ZK_CHECK_PARAM_NOT_NULL(msgbuf_handle);
+
+	if (!msgbuf_mode_valid(mode, size))
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	buffer = mem_alloc_region(ZK_QUEUE_MEM_CAPS, size);
+	if (buffer == ZK_NULL)
+	{
+		return ZK_ERR_NOT_ENOUGH_MEMORY;
+	}
+
+	ret = msgbuf_setup(msgbuf_handle, mode, size, trigger_level, buffer, ZK_FALSE);
+	if (ret != ZK_SUCCESS)
+	{
+		mem_free(buffer);
+	}
+	return ret;
+}
+
+/**
+ * @brief create a message or stream buffer over caller-provided storage
+ * @param buffer storage of size bytes, not freed by msgbuf_destroy()
+ * @note see msgbuf_create() for the other parameters
+ */
+zk_error_code_t msgbuf_create_static(zk_uint32 *msgbuf_handle, msgbuf_mode_t mode,
+									 zk_uint32 size, zk_uint32 trigger_level, void *buffer)
+{
+	ZK_CHECK_PARAM_NOT_NULL(msgbuf_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+
+	if (!msgbuf_mode_valid(mode, size))
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	return msgbuf_setup(msgbuf_handle, mode, size, trigger_level, buffer, ZK_TRUE);
+}
+
+/**
+ * @brief copy len bytes starting at ring offset pos, wrap-around as at most two copies
+ */
+static void msgbuf_copy_from(const msgbuf_t *mb, zk_uint32 pos, zk_uint8 *dest, zk_uint32 len)
+{
+	zk_uint32 first = mb->size - pos;
+
+	if (first > len)
+	{
+		first = len;
+	}
+	zk_memcpy(dest, mb->data_buffer + pos, first);
+	if (len > first)
+	{
+		zk_memcpy(dest + first, mb->data_buffer, len - first);
+	}
+}
+
+static inline zk_uint32 msgbuf_pos_advance(const msgbuf_t *mb, zk_uint32 pos, zk_uint32 len)
+{
+	pos += len;
+	if (pos >= mb->size)
+	{
+		pos -= mb->size;
+	}
+	return pos;
+}
+
+/**
+ * @brief append len bytes at write_pos
+ * @note called within critical section, caller guarantees enough free bytes
+ */
+static void msgbuf_copy_in(msgbuf_t *mb, const zk_uint8 *src, zk_uint32 len)
+{
+	zk_uint32 first = mb->size - mb->write_pos;
+
+	if (first > len)
+	{
+		first = len;
+	}
+	zk_memcpy(mb->data_buffer + mb->write_pos, src, first);
+	if (len > first)
+	{
+		zk_memcpy(mb->data_buffer, src + first, len - first);
+	}
+	mb->write_pos = msgbuf_pos_advance(mb, mb->write_pos, len);
+	mb->used += len;
+}
+
+/**
+ * @brief payload length of the oldest record (message mode, buffer not empty)
+ */
+static inline zk_uint32 msgbuf_head_length(const msgbuf_t *mb)
+{
+	zk_uint16 length = 0;
+
+	msgbuf_copy_from(mb, mb->read_pos, (zk_uint8 *) &length, MSGBUF_LENGTH_BYTES);
+	return length;
+}
+
+/**
+ * @brief whether a blocked reader may proceed
+ */
+static inline zk_bool msgbuf_readable(const msgbuf_t *mb)
+{
+	if (mb->mode == MSGBUF_MODE_MESSAGE)
+	{
+		return mb->used != 0;
+	}
+	return mb->used >= mb->trigger_level;
+}
+
+/**
+ * @brief bytes of a len-byte write that fit right now
+ * @return zk_uint32 message mode: len or 0 (records are never split); stream mode: up to len
+ */
+static inline zk_uint32 msgbuf_send_room(const msgbuf_t *mb, zk_uint32 len)
+{
+	zk_uint32 room = mb->size - mb->used;
+
+	if (mb->mode == MSGBUF_MODE_MESSAGE)
+	{
+		return (room >= len + MSGBUF_LENGTH_BYTES) ? len : 0;
+	}
+	return (room < len) ? room : len;
+}
+
+/**
+ * @brief ready every task on a sleep list, they re-check the buffer in priority order
+ * @param higher_priority_woken ISR path: set if a task above the current one was woken,
+ *        ZK_NULL for the task path
+ * @return zk_bool ZK_TRUE if any task was woken
+ * @note called within critical section
+ */
+static zk_bool msgbuf_wakeup_all(zk_list_node_t *sleep_list_head, zk_bool *higher_priority_woken)
+{
+	task_control_block_t *tcb = ZK_NULL;
+	zk_bool woken = ZK_FALSE;
+
+	while (!zk_list_is_empty(sleep_list_head))
+	{
+		tcb = ZK_LIST_GET_FIRST_ENTRY(sleep_list_head, task_control_block_t, event_sleep_list);
+		task_block_to_ready(tcb);
+		zk_isr_note_woken(tcb, higher_priority_woken);
+		woken = ZK_TRUE;
+	}
+	return woken;
+}
+
+/**
+ * @brief store len bytes (one record in message mode) and wake readers if they can proceed
+ * @return zk_bool ZK_TRUE if any reader was woken
+ * @note called within critical section, len comes from msgbuf_send_room()
+ */
+static zk_bool msgbuf_put(msgbuf_t *mb, const zk_uint8 *data, zk_uint32 len,
+						  zk_bool *higher_priority_woken)
+{
+	zk_uint16 length = (zk_uint16) len;
+
+	if (mb->mode == MSGBUF_MODE_MESSAGE)
+	{
+		msgbuf_copy_in(mb, (const zk_uint8 *) &length, MSGBUF_LENGTH_BYTES);
+	}
+	msgbuf_copy_in(mb, data, len);
+
+	if (!msgbuf_readable(mb))
+	{
+		return ZK_FALSE;
+	}
+	return msgbuf_wakeup_all(&mb->reader_sleep_list, higher_priority_woken);
+}
+
+/**
+ * @brief take the oldest record, or up to size stream bytes, and wake the blocked writers
+ * @param received output, payload bytes copied
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_QUEUE_SIZE_MISMATCH if the oldest record does
+ *         not fit in size (it stays in the buffer)
+ * @note called within critical section, buffer not empty
+ */
+static zk_error_code_t msgbuf_get(msgbuf_t *mb, zk_uint8 *buffer, zk_uint32 size,
+								  zk_uint32 *received, zk_bool *higher_priority_woken,
+								  zk_bool *woken)
+{
+	zk_uint32 len = mb->used;
+	zk_uint32 consumed = 0;
+
+	if (mb->mode == MSGBUF_MODE_MESSAGE)
+	{
+		len = msgbuf_head_length(mb);
+		if (len > size)
+		{
+			return ZK_ERR_QUEUE_SIZE_MISMATCH;
+		}
+		consumed = MSGBUF_LENGTH_BYTES;
+	}
+	else if (len > size)
+	{
+		len = size;
+	}
+
+	msgbuf_copy_from(mb, msgbuf_pos_advance(mb, mb->read_pos, consumed), buffer, len);
+	consumed += len;
+	mb->read_pos = msgbuf_pos_advance(mb, mb->read_pos, consumed);
+	mb->used -= consumed;
+	*received = len;
+
+	*woken = msgbuf_wakeup_all(&mb->writer_sleep_list, higher_priority_woken);
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief block current task on a sleep list until woken or timed out
+ * @return zk_error_code_t ZK_SUCCESS if woken by the buffer, otherwise error code
+ * @note called within critical section, returns within critical section
+ */
+static zk_error_code_t msgbuf_wait(zk_list_node_t *sleep_list_head, zk_uint32 timeout)
+{
+	task_control_block_t *current_tcb = g_current_tcb;
+
+	if (timeout == ZK_TIMEOUT_NONE)
+	{
+		return ZK_ERR_FAILED;
+	}
+
+	if (is_scheduler_suspending())
+	{
+		return ZK_ERR_STATE;
+	}
+
+	current_tcb->event_timeout_wakeup = EVENT_NO_TIMEOUT;
+	current_tcb->wake_up_time = get_current_time() + timeout;
+	task_ready_to_block(current_tcb, sleep_list_head,
+						(timeout == ZK_TIMEOUT_INFINITE) ? BLOCK_TYPE_ENDLESS : BLOCK_TYPE_TIMEOUT,
+						BLOCK_SORT_PRIO);
+	schedule();
+	ZK_EXIT_CRITICAL();
+
+	ZK_ENTER_CRITICAL();
+	if (current_tcb->event_timeout_wakeup == EVENT_WAIT_TIMEOUT)
+	{
+		return ZK_ERR_TIMEOUT;
+	}
+	return ZK_SUCCESS;
+}
+
+static inline zk_bool msgbuf_length_valid(const msgbuf_t *mb, zk_uint32 len)
+{
+	if (len == 0)
+	{
+		return ZK_FALSE;
+	}
+	return mb->mode != MSGBUF_MODE_MESSAGE ||
+		   (len <= 0xFFFFUL && len + MSGBUF_LENGTH_BYTES <= mb->size);
+}
+
+/**
+ * @brief write a record (message mode) or bytes (stream mode)
+ * @param msgbuf_handle handle
+ * @param data source
+ * @param len payload bytes
+ * @param sent output, bytes stored (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if anything was stored, otherwise error code
+ * @note message mode blocks until the whole record fits and stores it or nothing; stream
+ *       mode blocks only while the ring is full, then stores as many bytes as fit
+ */
+zk_error_code_t msgbuf_send(zk_uint32 msgbuf_handle, const void *data, zk_uint32 len,
+							zk_uint32 *sent, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	msgbuf_t *mb = ZK_NULL;
+	zk_uint32 batch = 0;
+
+	CHECK_MSGBUF_HANDLE_VALID(msgbuf_handle);
+	CHECK_MSGBUF_CREATED(msgbuf_handle);
+	ZK_CHECK_PARAM_NOT_NULL(data);
+
+	ZK_ENTER_CRITICAL();
+	mb = MSGBUF_HANDLE_TO_POINTER(msgbuf_handle);
+
+	if (!msgbuf_length_valid(mb, len))
+	{
+		ret = ZK_ERR_INVALID_PARAM;
+		goto msgbuf_send_exit;
+	}
+
+	while ((batch = msgbuf_send_room(mb, len)) == 0)
+	{
+		ret = msgbuf_wait(&mb->writer_sleep_list, timeout);
+		if (ret != ZK_SUCCESS)
+		{
+			goto msgbuf_send_exit;
+		}
+	}
+
+	if (msgbuf_put(mb, (const zk_uint8 *) data, batch, ZK_NULL))
+	{
+		schedule();
+	}
+
+msgbuf_send_exit:
+	ZK_EXIT_CRITICAL();
+	if (sent != ZK_NULL)
+	{
+		*sent = batch;
+	}
+	return ret;
+}
+
+/**
+ * @brief read the oldest record (message mode) or up to size bytes (stream mode)
+ * @param msgbuf_handle handle
+ * @param buffer destination
+ * @param size room in buffer
+ * @param received output, payload bytes copied (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if data was copied, ZK_ERR_QUEUE_SIZE_MISMATCH if the
+ *         oldest record is longer than size, otherwise error code
+ * @note stream mode waits for trigger_level bytes; when the wait ends without them the
+ *       bytes already buffered are returned instead of an error
+ */
+zk_error_code_t msgbuf_receive(zk_uint32 msgbuf_handle, void *buffer, zk_uint32 size,
+							   zk_uint32 *received, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	msgbuf_t *mb = ZK_NULL;
+	zk_uint32 len = 0;
+	zk_bool woken = ZK_FALSE;
+
+	CHECK_MSGBUF_HANDLE_VALID(msgbuf_handle);
+	CHECK_MSGBUF_CREATED(msgbuf_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+
+	if (size == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	ZK_ENTER_CRITICAL();
+	mb = MSGBUF_HANDLE_TO_POINTER(msgbuf_handle);
+
+	while (!msgbuf_readable(mb))
+	{
+		ret = msgbuf_wait(&mb->reader_sleep_list, timeout);
+		if (ret == ZK_SUCCESS)
+		{
+			continue;
+		}
+		if (mb->used == 0)
+		{
+			goto msgbuf_receive_exit;
+		}
+		ret = ZK_SUCCESS;
+		break;
+	}
+
+	ret = msgbuf_get(mb, (zk_uint8 *) buffer, size, &len, ZK_NULL, &woken);
+	if (woken)
+	{
+		schedule();
+	}
+
+msgbuf_receive_exit:
+	ZK_EXIT_CRITICAL();
+	if (received != ZK_NULL)
+	{
+		*received = len;
+	}
+	return ret;
+}
+
+/**
+ * @brief msgbuf_send() from interrupt context (never blocks, never schedules)
+ * @param higher_priority_woken set to ZK_TRUE if a reader above the interrupted task was woken
+ * @return zk_error_code_t ZK_SUCCESS if anything was stored, ZK_ERR_FAILED if it did not fit
+ * @note finish the ISR with zk_yield_from_isr(higher_priority_woken)
+ */
+zk_error_code_t msgbuf_send_from_isr(zk_uint32 msgbuf_handle, const void *data, zk_uint32 len,
+									 zk_uint32 *sent, zk_bool *higher_priority_woken)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	msgbuf_t *mb = ZK_NULL;
+	zk_uint32 batch = 0;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	CHECK_MSGBUF_HANDLE_VALID(msgbuf_handle);
+	CHECK_MSGBUF_CREATED(msgbuf_handle);
+	ZK_CHECK_PARAM_NOT_NULL(data);
+
+	ZK_ENTER_CRITICAL();
+	mb = MSGBUF_HANDLE_TO_POINTER(msgbuf_handle);
+
+	if (!msgbuf_length_valid(mb, len))
+	{
+		ret = ZK_ERR_INVALID_PARAM;
+		goto msgbuf_send_from_isr_exit;
+	}
+
+	batch = msgbuf_send_room(mb, len);
+	if (batch == 0)
+	{
+		ret = ZK_ERR_FAILED;
+		goto msgbuf_send_from_isr_exit;
+	}
+
+	msgbuf_put(mb, (const zk_uint8 *) data, batch, higher_priority_woken);
+
+msgbuf_send_from_isr_exit:
+	ZK_EXIT_CRITICAL();
+	if (sent != ZK_NULL)
+	{
+		*sent = batch;
+	}
+	return ret;
+}
+
+/**
+ * @brief msgbuf_receive() from interrupt context (never blocks, never schedules)
+ * @param higher_priority_woken set to ZK_TRUE if a writer above the interrupted task was woken
+ * @return zk_error_code_t ZK_SUCCESS if data was copied, ZK_ERR_FAILED if empty
+ * @note any buffered stream bytes are returned, the trigger level only applies to waiting
+ */
+zk_error_code_t msgbuf_receive_from_isr(zk_uint32 msgbuf_handle, void *buffer, zk_uint32 size,
+										zk_uint32 *received, zk_bool *higher_priority_woken)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	msgbuf_t *mb = ZK_NULL;
+	zk_uint32 len = 0;
+	zk_bool woken = ZK_FALSE;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	CHECK_MSGBUF_HANDLE_VALID(msgbuf_handle);
+	CHECK_MSGBUF_CREATED(msgbuf_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+
+	if (size == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	ZK_ENTER_CRITICAL();
+	mb = MSGBUF_HANDLE_TO_POINTER(msgbuf_handle);
+
+	if (mb->used == 0)
+	{
+		ret = ZK_ERR_FAILED;
+		goto msgbuf_receive_from_isr_exit;
+	}
+
+	ret = msgbuf_get(mb, (zk_uint8 *) buffer, size, &len, higher_priority_woken, &woken);
+
+msgbuf_receive_from_isr_exit:
+	ZK_EXIT_CRITICAL();
+	if (received != ZK_NULL)
+	{
+		*received = len;
+	}
+	return ret;
+}
+
+/**
+ * @brief size of the next read
+ * @param length output, payload length of the oldest record (message mode) or buffered
+ *        bytes (stream mode), 0 when empty
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t msgbuf_next_length(zk_uint32 msgbuf_handle, zk_uint32 *length)
+{
+	msgbuf_t *mb = ZK_NULL;
+
+	CHECK_MSGBUF_HANDLE_VALID(msgbuf_handle);
+	CHECK_MSGBUF_CREATED(msgbuf_handle);
+	ZK_CHECK_PARAM_NOT_NULL(length);
+
+	ZK_ENTER_CRITICAL();
+	mb = MSGBUF_HANDLE_TO_POINTER(msgbuf_handle);
+	if (mb->mode == MSGBUF_MODE_MESSAGE && mb->used != 0)
+	{
+		*length = msgbuf_head_length(mb);
+	}
+	else
+	{
+		*length = mb->used;
+	}
+	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief return a buffer object to the pool
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE while tasks are blocked on it
+ * @note buffered data is discarded
+ */
+zk_error_code_t msgbuf_destroy(zk_uint32 msgbuf_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	msgbuf_t *mb = ZK_NULL;
+
+	CHECK_MSGBUF_HANDLE_VALID(msgbuf_handle);
+	CHECK_MSGBUF_CREATED(msgbuf_handle);
+
+	ZK_ENTER_CRITICAL();
+	mb = MSGBUF_HANDLE_TO_POINTER(msgbuf_handle);
+
+	/* a concurrent destroy may have retired the handle since the unlocked check */
+	if (!zk_handle_is_valid(&g_msgbuf_handles, msgbuf_handle) || mb->is_used == MSGBUF_UNUSED ||
+		!zk_list_is_empty(&mb->reader_sleep_list) || !zk_list_is_empty(&mb->writer_sleep_list))
+	{
+		ret = ZK_ERR_STATE;
+		goto msgbuf_destroy_exit;
+	}
+
+	if (!mb->static_buffer)
+	{
+		mem_free(mb->data_buffer);
+	}
+	mb->data_buffer = ZK_NULL;
+	mb->used = 0;
+	mb->is_used = MSGBUF_UNUSED;
+	zk_handle_free(&g_msgbuf_handles, msgbuf_handle);
+
+msgbuf_destroy_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+#endif /* ZK_USING_MSGBUF */
@@ -1,12 +1,17 @@
 /**
  * @file    zk_mutex.c
  * @brief   mutex management module
- * @note    support priority inheritance mechanism
+ * @note    support priority inheritance, or immediate priority ceiling per mutex
+ *          (ZK_USING_MUTEX_CEILING). An uncontended lock/unlock only swaps the
+ *          owner word with LDREX/STREX; the critical section is entered on contention.
  */
 
 #include "zk_internal.h"
 
+#if ZK_USING_MUTEX
+
 static mutex_t g_mutex_pool[MUTEX_MAX_NUM];
+ZK_HANDLE_POOL_DEFINE(g_mutex_handles, MUTEX_MAX_NUM);
 extern task_control_block_t *volatile g_current_tcb;
 
 /**
@@ -21,58 +26,93 @@ void mutex_init(void)
 		g_mutex_pool[i].owner_priority = ZK_MIN_PRIORITY;
 		g_mutex_pool[i].is_used = MUTEX_UNUSED;
 		g_mutex_pool[i].next_mutex = ZK_NULL;
+#if ZK_USING_MUTEX_CEILING
+		g_mutex_pool[i].ceiling_priority = MUTEX_NO_CEILING;
+#endif
 		zk_list_init(&g_mutex_pool[i].sleep_list);
 	}
-}
-
-/**
- * @brief Get available mutex resource
- * @param mutex_handle Pointer to store mutex handle
- * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
- */
-static zk_error_code_t get_mutex_resource(zk_uint32 *mutex_handle)
-{
-	for (zk_uint32 i = 0; i < MUTEX_MAX_NUM; i++)
-	{
-		if (g_mutex_pool[i].is_used == MUTEX_UNUSED)
-		{
-			*mutex_handle = i;
-			return ZK_SUCCESS;
-		}
-	}
-	return ZK_ERR_RESOURCE_UNAVAILABLE;
+	zk_handle_pool_init(&g_mutex_handles);
 }
 
 /**
  * @brief Create a mutex
  * @param mutex_handle Pointer to store mutex handle
+ * @param ceiling_priority Immediate ceiling priority, MUTEX_NO_CEILING for priority inheritance
  * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
  */
-zk_error_code_t mutex_create(zk_uint32 *mutex_handle)
+static zk_error_code_t mutex_create_internal(zk_uint32 *mutex_handle, zk_uint8 ceiling_priority)
 {
 	zk_error_code_t ret = ZK_SUCCESS;
 
 	ZK_ASSERT_NULL_POINTER(mutex_handle);
 
 	ZK_ENTER_CRITICAL();
-	ret = get_mutex_resource(mutex_handle);
+	ret = zk_handle_alloc(&g_mutex_handles, mutex_handle);
 	if (ret != ZK_SUCCESS)
 	{
 		goto mutex_create_exit;
 	}
 
-	g_mutex_pool[*mutex_handle].owner_hold_count = 0;
-	g_mutex_pool[*mutex_handle].owner = ZK_NULL;
-	g_mutex_pool[*mutex_handle].owner_priority = ZK_MIN_PRIORITY;
-	g_mutex_pool[*mutex_handle].next_mutex = ZK_NULL;
-	zk_list_init(&g_mutex_pool[*mutex_handle].sleep_list);
-	g_mutex_pool[*mutex_handle].is_used = MUTEX_USED;
+	MUTEX_HANDLE_TO_POINTER(*mutex_handle)->owner_hold_count = 0;
+	MUTEX_HANDLE_TO_POINTER(*mutex_handle)->owner = ZK_NULL;
+	MUTEX_HANDLE_TO_POINTER(*mutex_handle)->owner_priority = ZK_MIN_PRIORITY;
+	MUTEX_HANDLE_TO_POINTER(*mutex_handle)->next_mutex = ZK_NULL;
+#if ZK_USING_MUTEX_CEILING
+	MUTEX_HANDLE_TO_POINTER(*mutex_handle)->ceiling_priority = ceiling_priority;
+#else
+	(void) ceiling_priority;
+#endif
+	zk_list_init(&MUTEX_HANDLE_TO_POINTER(*mutex_handle)->sleep_list);
+	MUTEX_HANDLE_TO_POINTER(*mutex_handle)->is_used = MUTEX_USED;
 
 mutex_create_exit:
 	ZK_EXIT_CRITICAL();
 	return ret;
 }
 
+/**
+ * @brief Create a priority inheritance mutex
+ * @param mutex_handle Pointer to store mutex handle
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mutex_create(zk_uint32 *mutex_handle)
+{
+	return mutex_create_internal(mutex_handle, MUTEX_NO_CEILING);
+}
+
+#if ZK_USING_MUTEX_CEILING
+/**
+ * @brief Create an immediate priority ceiling mutex
+ * @param mutex_handle Pointer to store mutex handle
+ * @param ceiling_priority Highest (numerically lowest) priority of any task that locks it
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note The holder runs at the ceiling for as long as it holds the mutex, so locking costs
+ *       O(1) with no inheritance chain walk, and mutexes that share a ceiling cannot
+ *       deadlock each other. Locking from a task above the ceiling fails with
+ *       ZK_ERR_TASK_PRIORITY_CONFLICT.
+ */
+zk_error_code_t mutex_create_ceiling(zk_uint32 *mutex_handle, zk_uint8 ceiling_priority)
+{
+	if (ceiling_priority >= ZK_PRIORITY_NUM || ceiling_priority == MUTEX_NO_CEILING)
+	{
+		return ZK_ERR_OUT_OF_RANGE;
+	}
+	return mutex_create_internal(mutex_handle, ceiling_priority);
+}
+
+/**
+ * @brief Raise the new owner of a ceiling mutex to the ceiling
+ * @note called within critical section
+ */
+static inline void mutex_raise_to_ceiling(task_control_block_t *task, mutex_t *mutex)
+{
+	if (task->priority > mutex->ceiling_priority)
+	{
+		task_change_priority_temp(task, mutex->ceiling_priority);
+	}
+}
+#endif
+
 /**
  * @brief Recursively propagate priority inheritance (chain propagation)
  * @param task High priority task requesting the mutex
@@ -120,7 +160,8 @@ static void mutex_sleep(task_control_block_t *task, mutex_t *mutex, block_type_t
 {
 	task->holding_mutex = mutex;
 
-	if (task->priority < mutex->owner_priority)
+	/* the owner of a ceiling mutex already runs above every task that can lock it */
+	if (!MUTEX_HAS_CEILING(mutex) && task->priority < mutex->owner_priority)
 	{
 		mutex_priority_inheritance_chain(task, mutex);
 	}
@@ -128,6 +169,72 @@ static void mutex_sleep(task_control_block_t *task, mutex_t *mutex, block_type_t
 	task_ready_to_block(task, &mutex->sleep_list, block_type, BLOCK_SORT_PRIO);
 }
 
+/**
+ * @brief Claim an unowned mutex without entering the critical section
+ * @param mutex Mutex to claim
+ * @param task Current task
+ * @return zk_bool ZK_TRUE if the mutex is now owned by task
+ * @note Only the owner word is written. The hold count stays 0 and the priority
+ *       inheritance bookkeeping is filled in by mutex_adopt_fast_owner() once another
+ *       task contends. A context switch between LDREX and STREX makes the claim fail.
+ */
+static ZK_FORCE_INLINE zk_bool mutex_lock_fast(mutex_t *mutex, task_control_block_t *task)
+{
+	volatile zk_uint32 *owner = (volatile zk_uint32 *) &mutex->owner;
+
+	if (zk_cpu_ldrex(owner) != (zk_uint32) ZK_NULL)
+	{
+		zk_cpu_clrex();
+		return ZK_FALSE;
+	}
+	return zk_cpu_strex((zk_uint32) task, owner) == 0;
+}
+
+/**
+ * @brief Release a mutex taken by mutex_lock_fast() when nobody is waiting on it
+ * @param mutex Mutex to release
+ * @param task Current task
+ * @return zk_bool ZK_TRUE if the mutex has been released
+ * @note A contender adopts the owner (hold count becomes non-zero) before it sleeps,
+ *       and that switch breaks the exclusive access, so the checks below cannot go stale.
+ */
+static ZK_FORCE_INLINE zk_bool mutex_unlock_fast(mutex_t *mutex, task_control_block_t *task)
+{
+	volatile zk_uint32 *owner = (volatile zk_uint32 *) &mutex->owner;
+
+	if (zk_cpu_ldrex(owner) != (zk_uint32) task || mutex->owner_hold_count != 0 ||
+		!zk_list_is_empty(&mutex->sleep_list))
+	{
+		zk_cpu_clrex();
+		return ZK_FALSE;
+	}
+	return zk_cpu_strex((zk_uint32) ZK_NULL, owner) == 0;
+}
+
+/**
+ * @brief Fill in the bookkeeping of an owner that took the mutex through the fast path
+ * @param mutex Mutex
+ * @note Called within critical section before the slow path looks at the hold count
+ */
+static void mutex_adopt_fast_owner(mutex_t *mutex)
+{
+	task_control_block_t *owner = mutex->owner;
+
+	if (owner == ZK_NULL || mutex->owner_hold_count != 0)
+	{
+		return;
+	}
+
+	mutex->owner_hold_count = 1;
+	mutex->owner_priority = owner->priority;
+	mutex->next_mutex = owner->holding_mutex;
+	if (owner->state != TASK_ENDLESS_BLOCKED && owner->state != TASK_TIMEOUT_BLOCKED)
+	{
+		/* a blocked owner's holding_mutex names the mutex it waits for, keep it */
+		owner->holding_mutex = mutex;
+	}
+}
+
 /**
  * @brief Lock mutex
  * @param mutex_handle Mutex handle
@@ -144,6 +251,15 @@ static zk_error_code_t mutex_lock_internal(zk_uint32 mutex_handle, block_type_t
 
 	CHECK_MUTEX_HANDLE_VALID(mutex_handle);
 	CHECK_MUTEX_CREATED(mutex_handle);
+	ZK_TRACE(ZK_TRACE_EV_MUTEX_LOCK, mutex_handle, timeout);
+
+	mutex = MUTEX_HANDLE_TO_POINTER(mutex_handle);
+	/* with the scheduler suspended the slow path reports ZK_ERR_STATE, as it always has */
+	if (!MUTEX_HAS_CEILING(mutex) && !is_scheduler_suspending() &&
+		mutex_lock_fast(mutex, current_task))
+	{
+		return ZK_SUCCESS;
+	}
 
 	ZK_ENTER_CRITICAL();
 
@@ -153,10 +269,24 @@ static zk_error_code_t mutex_lock_internal(zk_uint32 mutex_handle, block_type_t
 		goto mutex_lock_exit;
 	}
 
-	mutex = MUTEX_HANDLE_TO_POINTER(mutex_handle);
+#if ZK_USING_MUTEX_CEILING
+	if (MUTEX_HAS_CEILING(mutex) && current_task->base_priority < mutex->ceiling_priority)
+	{
+		ret = ZK_ERR_TASK_PRIORITY_CONFLICT;
+		goto mutex_lock_exit;
+	}
+#endif
+
+	mutex_adopt_fast_owner(mutex);
 
-	if (mutex->owner_hold_count == 0)
+	if (mutex->owner == ZK_NULL)
 	{
+#if ZK_USING_MUTEX_CEILING
+		if (MUTEX_HAS_CEILING(mutex))
+		{
+			mutex_raise_to_ceiling(current_task, mutex);
+		}
+#endif
 		mutex->owner = current_task;
 		mutex->owner_hold_count = 1;
 		mutex->owner_priority = current_task->priority;
@@ -221,6 +351,28 @@ zk_error_code_t mutex_lock_timeout(zk_uint32 mutex_handle, zk_uint32 timeout)
 	return mutex_lock_internal(mutex_handle, BLOCK_TYPE_TIMEOUT, timeout);
 }
 
+#if ZK_USING_TIME64
+/**
+ * @brief Lock mutex, waiting at most until an absolute 64-bit tick
+ * @param mutex_handle Mutex handle
+ * @param deadline Tick from get_current_time64()
+ * @return zk_error_code_t ZK_SUCCESS if locked, ZK_ERR_TIMEOUT once the deadline is reached
+ */
+zk_error_code_t mutex_lock_until64(zk_uint32 mutex_handle, zk_uint64 deadline)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 timeout = 0;
+
+	do
+	{
+		timeout = zk_timeout_until64(deadline);
+		ret = mutex_lock_internal(mutex_handle, BLOCK_TYPE_TIMEOUT, timeout);
+	} while (ret == ZK_ERR_TIMEOUT);
+
+	return (ret == ZK_ERR_FAILED && timeout == ZK_TIMEOUT_NONE) ? ZK_ERR_TIMEOUT : ret;
+}
+#endif
+
 /**
  * @brief Try to lock mutex without blocking
  * @param mutex_handle Mutex handle
@@ -274,6 +426,12 @@ static zk_uint8 mutex_wakeup(task_control_block_t *task, mutex_t *mutex)
 		wakeup_task->holding_mutex = ZK_NULL;
 
 		task_block_to_ready(wakeup_task);
+#if ZK_USING_MUTEX_CEILING
+		if (MUTEX_HAS_CEILING(mutex))
+		{
+			mutex_raise_to_ceiling(wakeup_task, mutex);
+		}
+#endif
 
 		mutex->owner = wakeup_task;
 		mutex->owner_priority = wakeup_task->priority;
@@ -305,20 +463,19 @@ zk_error_code_t mutex_unlock(zk_uint32 mutex_handle)
 
 	CHECK_MUTEX_HANDLE_VALID(mutex_handle);
 	CHECK_MUTEX_CREATED(mutex_handle);
+	ZK_TRACE(ZK_TRACE_EV_MUTEX_UNLOCK, mutex_handle, 0);
 
-	ZK_ENTER_CRITICAL();
-
-	if (is_scheduler_suspending())
+	mutex = MUTEX_HANDLE_TO_POINTER(mutex_handle);
+	if (!is_scheduler_suspending() && mutex_unlock_fast(mutex, current_task))
 	{
-		ret = ZK_ERR_STATE;
-		goto mutex_unlock_exit;
+		return ZK_SUCCESS;
 	}
 
-	mutex = MUTEX_HANDLE_TO_POINTER(mutex_handle);
+	ZK_ENTER_CRITICAL();
 
-	if (mutex->owner_hold_count == 0)
+	if (is_scheduler_suspending())
 	{
-		ret = ZK_ERR_SYNC_NOT_OWNER;
+		ret = ZK_ERR_STATE;
 		goto mutex_unlock_exit;
 	}
 
@@ -328,6 +485,7 @@ zk_error_code_t mutex_unlock(zk_uint32 mutex_handle)
 		goto mutex_unlock_exit;
 	}
 
+	mutex_adopt_fast_owner(mutex);
 	mutex->owner_hold_count--;
 
 	if (mutex->owner_hold_count != 0)
@@ -345,6 +503,59 @@ mutex_unlock_exit:
 	return ret;
 }
 
+/**
+ * @brief Whether a task owns any mutex
+ * @param tcb Task
+ * @return zk_bool ZK_TRUE if the task owns at least one mutex
+ * @note called within critical section. A mutex taken by mutex_lock_fast() is not linked
+ *       into the owner's holding_mutex chain, so the pool is searched for the owner word.
+ */
+zk_bool mutex_is_owned_by(const task_control_block_t *tcb)
+{
+	for (zk_uint32 i = 0; i < MUTEX_MAX_NUM; i++)
+	{
+		if (g_mutex_pool[i].is_used == MUTEX_USED && g_mutex_pool[i].owner == tcb)
+		{
+			return ZK_TRUE;
+		}
+	}
+	return ZK_FALSE;
+}
+
+/**
+ * @brief Priority a task needs for the mutexes it holds
+ * @param tcb Running task
+ * @return zk_uint8 Base priority, raised to the first waiter and the ceiling of each held mutex
+ * @note called within critical section. Mutexes taken on the fast path have no waiters
+ *       and are not in the chain, they need no boost.
+ */
+zk_uint8 mutex_held_priority(const task_control_block_t *tcb)
+{
+	zk_uint8 priority = tcb->base_priority;
+	mutex_t *mutex = tcb->holding_mutex;
+	const task_control_block_t *waiter = ZK_NULL;
+
+	for (; mutex != ZK_NULL; mutex = mutex->next_mutex)
+	{
+#if ZK_USING_MUTEX_CEILING
+		if (MUTEX_HAS_CEILING(mutex) && mutex->ceiling_priority < priority)
+		{
+			priority = mutex->ceiling_priority;
+		}
+#endif
+		if (!zk_list_is_empty(&mutex->sleep_list))
+		{
+			waiter = ZK_LIST_GET_FIRST_ENTRY(&mutex->sleep_list, task_control_block_t,
+											 event_sleep_list);
+			if (waiter->priority < priority)
+			{
+				priority = waiter->priority;
+			}
+		}
+	}
+	return priority;
+}
+
 /**
  * @brief Destroy mutex
  * @param mutex_handle Mutex handle
@@ -361,13 +572,15 @@ zk_error_code_t mutex_destroy(zk_uint32 mutex_handle)
 	ZK_ENTER_CRITICAL();
 	mutex = MUTEX_HANDLE_TO_POINTER(mutex_handle);
 
-	if (!zk_list_is_empty(&mutex->sleep_list))
+	/* a concurrent destroy may have retired the handle since the unlocked check */
+	if (!zk_handle_is_valid(&g_mutex_handles, mutex_handle) || mutex->is_used == MUTEX_UNUSED ||
+		!zk_list_is_empty(&mutex->sleep_list))
 	{
 		ret = ZK_ERR_STATE;
 		goto mutex_destroy_exit;
 	}
 
-	if (mutex->owner_hold_count > 0)
+	if (mutex->owner != ZK_NULL)
 	{
 		ret = ZK_ERR_STATE;
 		goto mutex_destroy_exit;
@@ -377,8 +590,11 @@ zk_error_code_t mutex_destroy(zk_uint32 mutex_handle)
 	mutex->is_used = MUTEX_UNUSED;
 	mutex->owner_priority = ZK_MIN_PRIORITY;
 	mutex->next_mutex = ZK_NULL;
+	zk_handle_free(&g_mutex_handles, mutex_handle);
 
 mutex_destroy_exit:
 	ZK_EXIT_CRITICAL();
 	return ret;
 }
+
+#endif /* ZK_USING_MUTEX */
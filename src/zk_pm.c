@@ -0,0 +1,174 @@
+/**
+ * @file    zk_pm.c
+ * @brief   idle-time power management: sleep mode selection and driver constraints
+ * @note    The idle task hands the expected idle time of the tickless computation to pm_idle(),
+ *          which takes the deepest allowed mode whose break-even time fits. WFI is the tickless
+ *          sleep of the CPU port; deeper modes are entered by the board hooks, which also
+ *          restore the clocks and report how long the wake-up took.
+ */
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_PM
+
+static const zk_pm_ops_t *g_pm_ops = ZK_NULL;
+/* Holders of each mode, a held mode and every deeper one are skipped */
+static zk_uint32 g_pm_constraints[ZK_PM_MODE_NUM];
+static zk_pm_stats_t g_pm_stats[ZK_PM_MODE_NUM];
+
+/**
+ * @brief Deepest mode allowed for idle_ticks
+ * @return zk_pm_mode_t ZK_PM_MODE_NUM to stay awake
+ */
+static zk_pm_mode_t pm_select_mode(zk_uint32 idle_ticks)
+{
+	zk_pm_mode_t mode = ZK_PM_MODE_NUM;
+	zk_uint32 min_ticks = 0;
+	zk_uint32 i = 0;
+
+	ZK_ENTER_CRITICAL();
+	for (i = 0; i < ZK_PM_MODE_NUM && g_pm_constraints[i] == 0; i++)
+	{
+		if (i == ZK_PM_MODE_WFI)
+		{
+			min_ticks = ZK_TICKLESS_MIN_IDLE_TICKS;
+		}
+		else
+		{
+			min_ticks = (g_pm_ops != ZK_NULL) ? g_pm_ops->min_ticks[i] : 0;
+		}
+		if (min_ticks != 0 && idle_ticks >= min_ticks)
+		{
+			mode = (zk_pm_mode_t) i;
+		}
+	}
+	ZK_EXIT_CRITICAL();
+
+	return mode;
+}
+
+/**
+ * @brief Sleep through an idle period
+ * @param idle_ticks Expected idle ticks (from scheduler_get_expected_idle_ticks)
+ * @note  Called by the idle task only
+ */
+void pm_idle(zk_uint32 idle_ticks)
+{
+	zk_pm_mode_t mode = pm_select_mode(idle_ticks);
+	zk_pm_stats_t *stats = ZK_NULL;
+	zk_uint32 start = 0;
+	zk_uint32 wake_us = 0;
+
+	if (mode == ZK_PM_MODE_NUM)
+	{
+		return;
+	}
+
+	start = get_current_time();
+	if (mode == ZK_PM_MODE_WFI)
+	{
+		zk_cpu_tickless_sleep(idle_ticks);
+	}
+	else
+	{
+		wake_us = g_pm_ops->enter(mode, idle_ticks);
+		if (wake_us == ZK_PM_NOT_ENTERED)
+		{
+			return;
+		}
+	}
+
+	stats = &g_pm_stats[mode];
+	ZK_ENTER_CRITICAL();
+	stats->count++;
+	stats->sleep_ticks += get_current_time() - start;
+	stats->wake_us_last = wake_us;
+	if (wake_us > stats->wake_us_max)
+	{
+		stats->wake_us_max = wake_us;
+	}
+	ZK_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Register the board hooks of the modes deeper than WFI
+ * @param ops Board hooks, kept by reference; ZK_NULL leaves only WFI
+ */
+void pm_register(const zk_pm_ops_t *ops)
+{
+	ZK_ENTER_CRITICAL();
+	g_pm_ops = ops;
+	ZK_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Forbid a mode and every deeper one until the matching pm_constraint_put()
+ * @param mode Shallowest mode the caller cannot survive
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note  Counted, callable from tasks and ISRs
+ */
+zk_error_code_t pm_constraint_get(zk_pm_mode_t mode)
+{
+	if (mode >= ZK_PM_MODE_NUM)
+	{
+		return ZK_ERR_OUT_OF_RANGE;
+	}
+
+	ZK_ENTER_CRITICAL();
+	g_pm_constraints[mode]++;
+	ZK_EXIT_CRITICAL();
+
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Drop a constraint taken with pm_constraint_get()
+ * @param mode Mode passed to pm_constraint_get()
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE if the mode is not held
+ */
+zk_error_code_t pm_constraint_put(zk_pm_mode_t mode)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	if (mode >= ZK_PM_MODE_NUM)
+	{
+		return ZK_ERR_OUT_OF_RANGE;
+	}
+
+	ZK_ENTER_CRITICAL();
+	if (g_pm_constraints[mode] == 0)
+	{
+		ret = ZK_ERR_STATE;
+	}
+	else
+	{
+		g_pm_constraints[mode]--;
+	}
+	ZK_EXIT_CRITICAL();
+
+	return ret;
+}
+
+/**
+ * @brief Read the residency and wake-up latency of a mode
+ * @param mode Sleep mode
+ * @param stats Output
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t pm_get_stats(zk_pm_mode_t mode, zk_pm_stats_t *stats)
+{
+	ZK_CHECK_PARAM_NOT_NULL(stats);
+	if (mode >= ZK_PM_MODE_NUM)
+	{
+		return ZK_ERR_OUT_OF_RANGE;
+	}
+
+	ZK_ENTER_CRITICAL();
+	*stats = g_pm_stats[mode];
+	ZK_EXIT_CRITICAL();
+
+	return ZK_SUCCESS;
+}
+
+#endif /* ZK_USING_PM */
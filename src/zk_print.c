@@ -1,11 +1,50 @@
 /**
  * @file    zk_print.c
  * @brief   ZK-RTOS lightweight print output module
+ * @note    With ZK_USING_DEFERRED_LOG, zk_log() only copies the format pointer and the raw
+ *          arguments into a ring; a low-priority task formats and outputs them later.
  */
 
-#include "zk_def.h"
+#include "zk_rtos.h"
+#include "zk_internal.h"
 #include <stdarg.h>
 
+/* Argument source of the formatter: the caller's va_list, or the data of a deferred record */
+typedef struct zk_print_args
+{
+	va_list *list;
+	const zk_uint8 *record;
+	const zk_uint8 *record_end;
+} zk_print_args_t;
+
+/* Length modifier of a conversion */
+#define ZK_PRINT_LEN_INT 0	 // none: int
+#define ZK_PRINT_LEN_LONG 1	 // l: long, also used for %p
+#define ZK_PRINT_LEN_LLONG 2 // ll: long long (64-bit cycle counts)
+
+/* One parsed conversion: %[-0][width|*][.precision|*][l|ll]conv */
+typedef struct zk_print_spec
+{
+	zk_uint8 left;			// '-': pad on the right
+	zk_uint8 zero;			// '0': pad numbers with zeros
+	zk_uint8 width_arg;		// width is '*'
+	zk_uint8 precision_arg; // precision is '*'
+	zk_uint8 length;		// ZK_PRINT_LEN_*
+	char conv;				// conversion character, '\0' if the format ended
+	int width;
+	int precision; // -1 if absent, only used by %s
+} zk_print_spec_t;
+
+/* "00" .. "99": two digits per lookup halve the number of divisions */
+static const char g_print_digits2[200] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+static const char g_print_hex_lower[] = "0123456789abcdef";
+static const char g_print_hex_upper[] = "0123456789ABCDEF";
+
 /**
  * @brief Weak symbol putc hook (users can override to implement UART/SWO output)
  * @param c Character to output
@@ -17,101 +56,338 @@ __attribute__((weak)) void zk_putc(char c)
 }
 
 /**
- * @brief Lightweight vsnprintf implementation (supports only %d %u %x %s %c)
+ * @brief Parse flags, width, precision and length modifier of one conversion
+ * @param fmt Character after the '%'
+ * @param spec Output
+ * @return const char* Position of the conversion character
+ */
+static const char *zk_print_parse_spec(const char *fmt, zk_print_spec_t *spec)
+{
+	spec->left = 0;
+	spec->zero = 0;
+	spec->width_arg = 0;
+	spec->precision_arg = 0;
+	spec->length = ZK_PRINT_LEN_INT;
+	spec->width = 0;
+	spec->precision = -1;
+
+	for (;; fmt++)
+	{
+		if (*fmt == '-')
+			spec->left = 1;
+		else if (*fmt == '0')
+			spec->zero = 1;
+		else
+			break;
+	}
+
+	if (*fmt == '*')
+	{
+		spec->width_arg = 1;
+		fmt++;
+	}
+	while (*fmt >= '0' && *fmt <= '9')
+		spec->width = spec->width * 10 + (*fmt++ - '0');
+
+	if (*fmt == '.')
+	{
+		fmt++;
+		spec->precision = 0;
+		if (*fmt == '*')
+		{
+			spec->precision_arg = 1;
+			fmt++;
+		}
+		while (*fmt >= '0' && *fmt <= '9')
+			spec->precision = spec->precision * 10 + (*fmt++ - '0');
+	}
+
+	if (*fmt == 'l')
+	{
+		fmt++;
+		spec->length = ZK_PRINT_LEN_LONG;
+		if (*fmt == 'l')
+		{
+			fmt++;
+			spec->length = ZK_PRINT_LEN_LLONG;
+		}
+	}
+
+	spec->conv = *fmt;
+	if (spec->conv == 'p')
+		spec->length = ZK_PRINT_LEN_LONG;
+	return fmt;
+}
+
+/**
+ * @brief Bytes an integer argument of this length occupies in a deferred record
+ */
+static inline zk_uint32 zk_print_arg_size(zk_uint8 length)
+{
+	if (length == ZK_PRINT_LEN_LLONG)
+		return sizeof(zk_uint64);
+	if (length == ZK_PRINT_LEN_LONG)
+		return sizeof(long);
+	return sizeof(zk_uint32);
+}
+
+/**
+ * @brief Fetch the next integer argument, sign- or zero-extended to 64 bits
+ * @param args Argument source
+ * @param length ZK_PRINT_LEN_*
+ * @param conv Conversion character ('d' is signed, 'p' is a pointer)
+ * @note  A record that ran out of space yields 0 for the missing arguments
+ */
+static zk_uint64 zk_print_next_integer(zk_print_args_t *args, zk_uint8 length, char conv)
+{
+	zk_uint32 size = zk_print_arg_size(length);
+	zk_uint32 value32 = 0;
+	zk_uint64 value = 0;
+
+	if (args->list != ZK_NULL)
+	{
+		if (conv == 'p')
+			return (zk_uint64) (unsigned long) va_arg(*args->list, const void *);
+		if (length == ZK_PRINT_LEN_LLONG)
+			return va_arg(*args->list, zk_uint64);
+		if (length == ZK_PRINT_LEN_LONG)
+			return (conv == 'd') ? (zk_uint64) va_arg(*args->list, long)
+								 : (zk_uint64) va_arg(*args->list, unsigned long);
+		return (conv == 'd') ? (zk_uint64) va_arg(*args->list, int)
+							 : (zk_uint64) va_arg(*args->list, unsigned int);
+	}
+
+	if (args->record + size > args->record_end)
+		return 0;
+	if (size == sizeof(zk_uint32))
+	{
+		zk_memcpy(&value32, args->record, sizeof(value32));
+		value = (conv == 'd') ? (zk_uint64) (zk_int32) value32 : value32;
+	}
+	else
+	{
+		zk_memcpy(&value, args->record, sizeof(value));
+	}
+	args->record += size;
+	return value;
+}
+
+/**
+ * @brief Fetch the next string argument (%s), records carry a NUL-terminated copy
+ */
+static const char *zk_print_next_str(zk_print_args_t *args)
+{
+	const char *str = ZK_NULL;
+
+	if (args->list != ZK_NULL)
+	{
+		return va_arg(*args->list, const char *);
+	}
+	if (args->record >= args->record_end)
+	{
+		return "";
+	}
+	str = (const char *) args->record;
+	while (args->record < args->record_end && *args->record++ != '\0')
+	{
+	}
+	return str;
+}
+
+/**
+ * @brief Write the decimal digits of value backwards, ending right before pos
+ * @return char* First digit
+ * @note  Two digits per step; the quotient by 100 is a multiply by the reciprocal
+ *        (exact for every 32-bit value), so no divide instruction or library call is needed
+ */
+static char *zk_print_u32_dec(char *pos, zk_uint32 value)
+{
+	zk_uint32 quotient = 0;
+	zk_uint32 pair = 0;
+
+	while (value >= 100)
+	{
+		quotient = (zk_uint32) (((zk_uint64) value * 0x51EB851FULL) >> 37);
+		pair = (value - quotient * 100) * 2;
+		*--pos = g_print_digits2[pair + 1];
+		*--pos = g_print_digits2[pair];
+		value = quotient;
+	}
+	if (value >= 10)
+	{
+		*--pos = g_print_digits2[value * 2 + 1];
+		*--pos = g_print_digits2[value * 2];
+	}
+	else
+	{
+		*--pos = (char) ('0' + value);
+	}
+	return pos;
+}
+
+/**
+ * @brief Write the digits of value backwards, ending right before pos
+ * @return char* First digit
+ * @note  64-bit decimals are split into 9-digit chunks, values that fit in 32 bits
+ *        never touch 64-bit division
+ */
+static char *zk_print_u64(char *pos, zk_uint64 value, char conv)
+{
+	const char *hex = (conv == 'X') ? g_print_hex_upper : g_print_hex_lower;
+	zk_uint64 quotient = 0;
+	char *chunk = ZK_NULL;
+
+	if (conv == 'x' || conv == 'X' || conv == 'p')
+	{
+		do
+		{
+			*--pos = hex[value & 0xF];
+			value >>= 4;
+		} while (value != 0);
+		return pos;
+	}
+
+	while ((value >> 32) != 0)
+	{
+		quotient = value / 1000000000ULL;
+		chunk = pos - 9;
+		pos = zk_print_u32_dec(pos, (zk_uint32) (value - quotient * 1000000000ULL));
+		while (pos > chunk)
+			*--pos = '0';
+		value = quotient;
+	}
+	return zk_print_u32_dec(pos, (zk_uint32) value);
+}
+
+/**
+ * @brief Emit count copies of c
+ */
+static char *zk_print_pad(char *ptr, const char *end, char c, int count)
+{
+	while (count-- > 0 && ptr < end)
+		*ptr++ = c;
+	return ptr;
+}
+
+/**
+ * @brief Lightweight vsnprintf implementation
  * @param buffer Output buffer
  * @param size Buffer size (including null terminator)
  * @param fmt Format string
- * @param args Variable argument list
+ * @param args Argument source
  * @return Number of characters written (excluding null terminator)
+ * @note  %[-0][width][.precision][l|ll] with d u x X p s c and %%; width and precision may be
+ *        '*'. Precision only bounds %s (%.*s). Unknown conversions are copied verbatim.
  */
-static int zk_vsnprintf(char *buffer, zk_uint32 size, const char *fmt, va_list args)
+static int zk_vsnprintf(char *buffer, zk_uint32 size, const char *fmt, zk_print_args_t *args)
 {
 	char *ptr = buffer;
 	const char *end = buffer + size - 1;
+	const char *start = ZK_NULL;
+	const char *str = ZK_NULL;
+	const char *prefix = ZK_NULL;
+	zk_print_spec_t spec;
+	char temp[20]; /* 20 digits of a 64-bit decimal */
+	char *digits = ZK_NULL;
+	zk_uint64 value = 0;
+	int prefix_len = 0;
+	int pad = 0;
+	int len = 0;
 
 	while (*fmt && ptr < end)
 	{
-		if (*fmt == '%')
+		if (*fmt != '%')
 		{
-			fmt++;
-			if (*fmt == 'd') /* 有符号十进制 */
-			{
-				int value = va_arg(args, int);
-				char temp[12];
-				int len = 0;
-
-				if (value < 0)
-				{
-					if (ptr < end)
-						*ptr++ = '-';
-					value = -value;
-				}
-				do
-				{
-					temp[len++] = (char) ('0' + (value % 10));
-					value /= 10;
-				} while (value && len < (int) sizeof(temp));
-
-				while (len-- && ptr < end)
-					*ptr++ = temp[len];
-			}
-			else if (*fmt == 'u') /* 无符号十进制 */
-			{
-				unsigned int value = va_arg(args, unsigned int);
-				char temp[12];
-				int len = 0;
-
-				do
-				{
-					temp[len++] = (char) ('0' + (value % 10));
-					value /= 10;
-				} while (value && len < (int) sizeof(temp));
-
-				while (len-- && ptr < end)
-					*ptr++ = temp[len];
-			}
-			else if (*fmt == 'x') /* 十六进制（小写） */
-			{
-				unsigned int value = va_arg(args, unsigned int);
-				char temp[10];
-				int len = 0;
-
-				do
-				{
-					int digit = value % 16;
-					temp[len++] = (char) (digit < 10 ? ('0' + digit) : ('a' + digit - 10));
-					value /= 16;
-				} while (value && len < (int) sizeof(temp));
-
-				while (len-- && ptr < end)
-					*ptr++ = temp[len];
-			}
-			else if (*fmt == 's') /* 字符串 */
+			*ptr++ = *fmt++;
+			continue;
+		}
+
+		start = fmt;
+		fmt = zk_print_parse_spec(fmt + 1, &spec);
+		if (spec.width_arg)
+		{
+			spec.width = (int) zk_print_next_integer(args, ZK_PRINT_LEN_INT, 'd');
+			if (spec.width < 0)
 			{
-				const char *str = va_arg(args, const char *);
-				if (str == ZK_NULL)
-					str = "(null)";
-				while (*str && ptr < end)
-					*ptr++ = *str++;
+				spec.left = 1;
+				spec.width = -spec.width;
 			}
-			else if (*fmt == 'c') /* 字符 */
+		}
+		if (spec.precision_arg)
+			spec.precision = (int) zk_print_next_integer(args, ZK_PRINT_LEN_INT, 'd');
+
+		switch (spec.conv)
+		{
+		case 'd':
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'p':
+			value = zk_print_next_integer(args, spec.length, spec.conv);
+			prefix = (spec.conv == 'p') ? "0x" : "";
+			/* %d arguments arrive sign-extended to 64 bits */
+			if (spec.conv == 'd' && (value >> 63) != 0)
 			{
-				char c = (char) va_arg(args, int);
-				if (ptr < end)
-					*ptr++ = c;
+				value = 0 - value;
+				prefix = "-";
 			}
-			else /* 未识别的格式符，原样输出 */
+			prefix_len = (prefix[0] == '\0') ? 0 : (prefix[1] == '\0') ? 1 : 2;
+			digits = zk_print_u64(temp + sizeof(temp), value, spec.conv);
+			len = (int) (temp + sizeof(temp) - digits);
+			pad = spec.width - prefix_len - len;
+
+			if (!spec.left && !spec.zero)
+				ptr = zk_print_pad(ptr, end, ' ', pad);
+			while (*prefix && ptr < end)
+				*ptr++ = *prefix++;
+			if (!spec.left && spec.zero)
+				ptr = zk_print_pad(ptr, end, '0', pad);
+			while (len-- > 0 && ptr < end)
+				*ptr++ = *digits++;
+			if (spec.left)
+				ptr = zk_print_pad(ptr, end, ' ', pad);
+			break;
+
+		case 's':
+			str = zk_print_next_str(args);
+			if (str == ZK_NULL)
+				str = "(null)";
+			for (len = 0; str[len] != '\0' && (spec.precision < 0 || len < spec.precision); len++)
 			{
-				if (ptr < end)
-					*ptr++ = '%';
-				if (ptr < end)
-					*ptr++ = *fmt;
 			}
-		}
-		else
-		{
+			pad = spec.width - len;
+			if (!spec.left)
+				ptr = zk_print_pad(ptr, end, ' ', pad);
+			while (len-- > 0 && ptr < end)
+				*ptr++ = *str++;
+			if (spec.left)
+				ptr = zk_print_pad(ptr, end, ' ', pad);
+			break;
+
+		case 'c':
+			pad = spec.width - 1;
+			if (!spec.left)
+				ptr = zk_print_pad(ptr, end, ' ', pad);
 			if (ptr < end)
-				*ptr++ = *fmt;
+				*ptr++ = (char) zk_print_next_integer(args, ZK_PRINT_LEN_INT, 'c');
+			if (spec.left)
+				ptr = zk_print_pad(ptr, end, ' ', pad);
+			break;
+
+		case '%':
+			*ptr++ = '%';
+			break;
+
+		case '\0': /* format ended inside a conversion */
+			while (*start && ptr < end)
+				*ptr++ = *start++;
+			fmt--;
+			break;
+
+		default: /* 未识别的格式符，原样输出 */
+			while (start <= fmt && ptr < end)
+				*ptr++ = *start++;
+			break;
 		}
 		fmt++;
 	}
@@ -123,18 +399,290 @@ static int zk_vsnprintf(char *buffer, zk_uint32 size, const char *fmt, va_list a
 /**
  * @brief Lightweight printf implementation
  * @param fmt Format string
- * @note Supports format specifiers: %d (signed) %u (unsigned) %x (hexadecimal) %s (string) %c (character)
+ * @note Supports %d %u %x %X %p %s %c %% with -/0 flags, width, %s precision and l/ll
  */
 void zk_printf(const char *fmt, ...)
 {
 	char buffer[ZK_PRINTF_BUF_SIZE];
-	va_list args;
+	va_list list;
+	zk_print_args_t args = {ZK_NULL, ZK_NULL, ZK_NULL};
 	int length;
 
-	va_start(args, fmt);
-	length = zk_vsnprintf(buffer, sizeof(buffer), fmt, args);
-	va_end(args);
+	va_start(list, fmt);
+	args.list = &list;
+	length = zk_vsnprintf(buffer, sizeof(buffer), fmt, &args);
+	va_end(list);
 
 	for (int i = 0; i < length; i++)
 		zk_putc(buffer[i]);
 }
+
+#if ZK_USING_DEFERRED_LOG
+
+/* One log entry: the ring stores the header plus size bytes of data */
+typedef struct zk_log_record
+{
+	const char *fmt; // Format string, ZK_NULL for a pre-formatted fragment
+	zk_uint32 size;	 // Bytes of data in use
+	zk_uint8 data[ZK_LOG_RECORD_MAX];
+} zk_log_record_t;
+
+#define ZK_LOG_HEADER_SIZE ((zk_uint32) offsetof(zk_log_record_t, data))
+
+static zk_uint8 g_log_storage[ZK_LOG_RING_SIZE];
+static zk_ring_t g_log_ring;
+static zk_uint32 g_log_sem;
+static zk_uint8 g_log_ready = 0;
+static volatile zk_uint32 g_log_dropped = 0;
+
+static task_control_block_t g_log_task_tcb;
+static zk_uint32 g_log_task_stack[ZK_LOG_TASK_STACK_SIZE / sizeof(zk_uint32)];
+static zk_uint32 g_log_task_handle;
+
+/**
+ * @brief Format and output one record
+ */
+static void zk_log_output(const zk_log_record_t *record)
+{
+	char buffer[ZK_PRINTF_BUF_SIZE];
+	zk_print_args_t args = {ZK_NULL, ZK_NULL, ZK_NULL};
+	int length = 0;
+
+	if (record->fmt == ZK_NULL)
+	{
+		for (zk_uint32 i = 0; i < record->size; i++)
+			zk_putc((char) record->data[i]);
+		return;
+	}
+
+	args.record = record->data;
+	args.record_end = record->data + record->size;
+	length = zk_vsnprintf(buffer, sizeof(buffer), record->fmt, &args);
+	for (int i = 0; i < length; i++)
+		zk_putc(buffer[i]);
+}
+
+/**
+ * @brief Queue a record for the log task, or count it as dropped if the ring is full
+ * @note  The ring has a single producer, so loggers serialize on a short critical section
+ *        that covers only the copy of the record
+ */
+static void zk_log_commit(const zk_log_record_t *record)
+{
+	zk_uint32 length = ZK_LOG_HEADER_SIZE + record->size;
+	zk_bool woken = ZK_FALSE;
+
+	if (!g_log_ready)
+	{
+		/* before zk_kernel_init() there is no task to defer to */
+		zk_log_output(record);
+		return;
+	}
+
+	ZK_ENTER_CRITICAL();
+	if (ring_free(&g_log_ring) < length)
+	{
+		g_log_dropped++;
+	}
+	else if (zk_cpu_is_in_interrupt())
+	{
+		ring_write_from_isr(&g_log_ring, (const zk_uint8 *) record, length, &woken);
+	}
+	else
+	{
+		ring_write(&g_log_ring, (const zk_uint8 *) record, length);
+	}
+	ZK_EXIT_CRITICAL();
+
+	if (woken)
+	{
+		zk_yield_from_isr(woken);
+	}
+}
+
+/**
+ * @brief Append one integer argument to a record in the layout zk_print_next_integer() reads
+ */
+static void zk_log_store_integer(zk_log_record_t *record, zk_uint64 value, zk_uint8 length)
+{
+	zk_uint32 size = zk_print_arg_size(length);
+	zk_uint32 value32 = (zk_uint32) value;
+
+	if (record->size + size > ZK_LOG_RECORD_MAX)
+	{
+		return;
+	}
+	if (size == sizeof(zk_uint32))
+	{
+		zk_memcpy(&record->data[record->size], &value32, sizeof(value32));
+	}
+	else
+	{
+		zk_memcpy(&record->data[record->size], &value, sizeof(value));
+	}
+	record->size += size;
+}
+
+/**
+ * @brief Deferred printf: capture the arguments, format later in the log task
+ * @param fmt Format string, must stay valid until output (a string literal)
+ * @note Safe from tasks and ISRs. %s strings are copied (bounded by their precision);
+ *       arguments that do not fit in ZK_LOG_RECORD_MAX bytes are printed as 0 or truncated.
+ */
+void zk_log(const char *fmt, ...)
+{
+	zk_log_record_t record;
+	zk_print_args_t args = {ZK_NULL, ZK_NULL, ZK_NULL};
+	zk_print_spec_t spec;
+	const char *scan = fmt;
+	const char *str = ZK_NULL;
+	zk_uint64 value = 0;
+	va_list list;
+
+	record.fmt = fmt;
+	record.size = 0;
+
+	va_start(list, fmt);
+	args.list = &list;
+	while (*scan != '\0')
+	{
+		if (*scan++ != '%')
+		{
+			continue;
+		}
+		scan = zk_print_parse_spec(scan, &spec);
+		if (spec.width_arg)
+		{
+			zk_log_store_integer(&record, zk_print_next_integer(&args, ZK_PRINT_LEN_INT, 'd'),
+								 ZK_PRINT_LEN_INT);
+		}
+		if (spec.precision_arg)
+		{
+			value = zk_print_next_integer(&args, ZK_PRINT_LEN_INT, 'd');
+			spec.precision = (int) value;
+			zk_log_store_integer(&record, value, ZK_PRINT_LEN_INT);
+		}
+
+		if (spec.conv == 'd' || spec.conv == 'u' || spec.conv == 'x' || spec.conv == 'X' ||
+			spec.conv == 'p')
+		{
+			zk_log_store_integer(&record, zk_print_next_integer(&args, spec.length, spec.conv),
+								 spec.length);
+		}
+		else if (spec.conv == 'c')
+		{
+			zk_log_store_integer(&record, zk_print_next_integer(&args, ZK_PRINT_LEN_INT, 'c'),
+								 ZK_PRINT_LEN_INT);
+		}
+		else if (spec.conv == 's')
+		{
+			str = zk_print_next_str(&args);
+			if (str == ZK_NULL)
+			{
+				str = "(null)";
+			}
+			while (*str != '\0' && record.size < ZK_LOG_RECORD_MAX - 1 && spec.precision != 0)
+			{
+				record.data[record.size++] = (zk_uint8) *str++;
+				spec.precision--;
+			}
+			if (record.size < ZK_LOG_RECORD_MAX)
+			{
+				record.data[record.size++] = '\0';
+			}
+		}
+		else if (spec.conv == '\0')
+		{
+			break;
+		}
+		scan++;
+	}
+	va_end(list);
+
+	zk_log_commit(&record);
+}
+
+/**
+ * @brief Deferred output of an already formatted string
+ * @param str Text, copied (at most ZK_LOG_RECORD_MAX bytes)
+ */
+void zk_log_puts(const char *str)
+{
+	zk_log_record_t record;
+
+	record.fmt = ZK_NULL;
+	record.size = 0;
+	while (*str != '\0' && record.size < ZK_LOG_RECORD_MAX)
+	{
+		record.data[record.size++] = (zk_uint8) *str++;
+	}
+	zk_log_commit(&record);
+}
+
+/**
+ * @brief Total number of records dropped because the log ring was full
+ */
+zk_uint32 zk_log_get_dropped(void)
+{
+	return g_log_dropped;
+}
+
+static void zk_log_task(void *parameter)
+{
+	zk_log_record_t record;
+	zk_uint32 reported = 0;
+	zk_uint32 dropped = 0;
+
+	(void) parameter;
+	for (;;)
+	{
+		/* records are written whole, so the rest is there once the header is */
+		if (ring_read_timeout(&g_log_ring, (zk_uint8 *) &record, ZK_LOG_HEADER_SIZE, ZK_NULL,
+							  ZK_TIMEOUT_INFINITE) != ZK_SUCCESS)
+		{
+			continue;
+		}
+		ring_read(&g_log_ring, record.data, record.size);
+		zk_log_output(&record);
+
+		dropped = g_log_dropped;
+		if (dropped != reported)
+		{
+			zk_printf("[log] %u records dropped\r\n", dropped - reported);
+			reported = dropped;
+		}
+	}
+}
+
+/**
+ * @brief Create the log ring and the log task
+ * @note  Called by zk_kernel_init() after the semaphore pool is ready
+ */
+void zk_log_init(void)
+{
+	task_init_parameter_t parameter;
+
+	ring_init(&g_log_ring, g_log_storage, sizeof(g_log_storage));
+	if (sem_create(&g_log_sem, 0) != ZK_SUCCESS)
+	{
+		return;
+	}
+	ring_bind_notify(&g_log_ring, g_log_sem);
+
+	zk_memclear(&parameter, sizeof(task_init_parameter_t));
+	parameter.name[0] = 'L';
+	parameter.name[1] = 'O';
+	parameter.name[2] = 'G';
+	parameter.name[3] = ZK_STRING_TERMINATOR;
+	parameter.priority = ZK_LOG_TASK_PRIO;
+	parameter.private_data = ZK_NULL;
+	parameter.stack_size = sizeof(g_log_task_stack);
+	parameter.task_entry = zk_log_task;
+	if (task_create_static(&parameter, &g_log_task_tcb, g_log_task_stack, &g_log_task_handle) ==
+		ZK_SUCCESS)
+	{
+		g_log_ready = 1;
+	}
+}
+
+#endif /* ZK_USING_DEFERRED_LOG */
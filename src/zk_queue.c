@@ -3,10 +3,16 @@
  * @brief   queue management module
  */
 
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_QUEUE
+
+#include "zk_rtos.h"
 #include "zk_internal.h"
+
+#if ZK_USING_QUEUE
 extern task_control_block_t *volatile g_current_tcb;
 
 static queue_t g_queue_pool[QUEUE_MAX_NUM];
+ZK_HANDLE_POOL_DEFINE(g_queue_handles, QUEUE_MAX_NUM);
 static zk_uint32 queue_remaining_space(zk_uint32 queue_handle);
 
 /**
@@ -22,26 +28,64 @@ void queue_init(void)
 		g_queue_pool[i].is_used = QUEUE_UNUSED;
 		g_queue_pool[i].read_pos = 0;
 		g_queue_pool[i].write_pos = 0;
+		g_queue_pool[i].element_count = 0;
+		g_queue_pool[i].write_reserved = 0;
+		g_queue_pool[i].read_reserved = 0;
+		g_queue_pool[i].static_buffer = ZK_FALSE;
+#if ZK_USING_QUEUE_SET
+		g_queue_pool[i].queue_set = QUEUE_SET_NONE;
+#endif
 		zk_list_init(&g_queue_pool[i].reader_sleep_list);
 		zk_list_init(&g_queue_pool[i].writer_sleep_list);
 	}
+	zk_handle_pool_init(&g_queue_handles);
 }
+
 /**
- * @brief get queue resource
- * @param queue_handle queue handle
- * @return zk_uint32 ZK_SUCCESS if success, otherwise error code
+ * @brief take a queue from the pool and attach its buffer
+ * @param queue_handle queue handle (output parameter)
+ * @param element_single_size element size
+ * @param element_num element number
+ * @param data_buffer buffer of element_num * element_single_size bytes
+ * @param static_buffer ZK_TRUE if data_buffer belongs to the caller
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
  */
-static zk_error_code_t get_queue_resource(zk_uint32 *queue_handle)
+static zk_error_code_t queue_setup(zk_uint32 *queue_handle, zk_uint32 element_single_size,
+								   zk_uint32 element_num, void *data_buffer,
+								   zk_uint8 static_buffer)
 {
-	for (zk_uint32 i = 0; i < QUEUE_MAX_NUM; i++)
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 temp_handle = 0;
+	queue_t *queue = ZK_NULL;
+
+	ZK_ENTER_CRITICAL();
+
+	ret = zk_handle_alloc(&g_queue_handles, &temp_handle);
+	if (ret != ZK_SUCCESS)
 	{
-		if (g_queue_pool[i].is_used == QUEUE_UNUSED)
-		{
-			*queue_handle = i;
-			return ZK_SUCCESS;
-		}
+		ZK_EXIT_CRITICAL();
+		return ret;
 	}
-	return ZK_ERR_RESOURCE_UNAVAILABLE;
+
+	queue = QUEUE_HANDLE_TO_POINTER(temp_handle);
+	queue->data_buffer = data_buffer;
+	queue->element_num = element_num;
+	queue->element_single_size = element_single_size;
+	queue->read_pos = 0;
+	queue->write_pos = 0;
+	queue->element_count = 0;
+	queue->write_reserved = 0;
+	queue->read_reserved = 0;
+	queue->static_buffer = static_buffer;
+#if ZK_USING_QUEUE_SET
+	queue->queue_set = QUEUE_SET_NONE;
+#endif
+	queue->is_used = QUEUE_USED;
+
+	*queue_handle = temp_handle;
+
+	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
 }
 
 /**
@@ -49,14 +93,13 @@ static zk_error_code_t get_queue_resource(zk_uint32 *queue_handle)
  * @param queue_handle queue handle
  * @param element_single_size element single size
  * @param element_num element number
- * @return zk_uint32 ZK_SUCCESS if success, otherwise error code
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
  */
 zk_error_code_t queue_create(zk_uint32 *queue_handle, zk_uint32 element_single_size,
 							 zk_uint32 element_num)
 {
 	zk_error_code_t ret = ZK_SUCCESS;
 	void *data_buffer = ZK_NULL;
-	zk_uint32 temp_handle = 0;
 
 	ZK_ASSERT_NULL_POINTER(queue_handle);
 
@@ -65,33 +108,62 @@ zk_error_code_t queue_create(zk_uint32 *queue_handle, zk_uint32 element_single_s
 		return ZK_ERR_INVALID_PARAM;
 	}
 
-	data_buffer = mem_alloc(element_num * element_single_size);
+	data_buffer = mem_alloc_region(ZK_QUEUE_MEM_CAPS, element_num * element_single_size);
 	if (data_buffer == ZK_NULL)
 	{
 		return ZK_ERR_NOT_ENOUGH_MEMORY;
 	}
 
-	ZK_ENTER_CRITICAL();
-
-	ret = get_queue_resource(&temp_handle);
+	ret = queue_setup(queue_handle, element_single_size, element_num, data_buffer, ZK_FALSE);
 	if (ret != ZK_SUCCESS)
 	{
-		ZK_EXIT_CRITICAL();
 		mem_free(data_buffer);
-		return ret;
+	}
+	return ret;
+}
+
+/**
+ * @brief create a queue over a caller-provided buffer
+ * @param queue_handle queue handle (output parameter)
+ * @param element_single_size element size
+ * @param element_num element number
+ * @param buffer storage of element_num * element_single_size bytes
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note no heap work is done; the buffer is not freed by queue_destroy()
+ */
+zk_error_code_t queue_create_static(zk_uint32 *queue_handle, zk_uint32 element_single_size,
+									zk_uint32 element_num, void *buffer)
+{
+	ZK_CHECK_PARAM_NOT_NULL(queue_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+
+	if (element_single_size == 0 || element_num == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
 	}
 
-	g_queue_pool[temp_handle].data_buffer = data_buffer;
-	g_queue_pool[temp_handle].element_num = element_num;
-	g_queue_pool[temp_handle].element_single_size = element_single_size;
-	g_queue_pool[temp_handle].read_pos = 0;
-	g_queue_pool[temp_handle].write_pos = 0;
-	g_queue_pool[temp_handle].is_used = QUEUE_USED;
+	return queue_setup(queue_handle, element_single_size, element_num, buffer, ZK_TRUE);
+}
 
-	*queue_handle = temp_handle;
+/**
+ * @brief create a queue without storage: every element passes from writer to reader directly
+ * @param queue_handle queue handle (output parameter)
+ * @param element_single_size element size
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note a write blocks until a reader takes the element and a read until a writer brings one,
+ *       so both sides meet; queue_write_n(), queue_read_n(), queue_reserve(), queue_peek() and
+ *       queue sets need storage and are refused with ZK_ERR_NOT_SUPPORTED / ZK_ERR_INVALID_PARAM
+ */
+zk_error_code_t queue_create_rendezvous(zk_uint32 *queue_handle, zk_uint32 element_single_size)
+{
+	ZK_CHECK_PARAM_NOT_NULL(queue_handle);
 
-	ZK_EXIT_CRITICAL();
-	return ZK_SUCCESS;
+	if (element_single_size == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	return queue_setup(queue_handle, element_single_size, 0, ZK_NULL, ZK_TRUE);
 }
 
 /**
@@ -109,12 +181,117 @@ static void queue_sleep(task_control_block_t *tcb, zk_list_node_t *sleep_list_he
 /**
  * @brief queue wakeup
  * @param sleep_list_head sleep list head
+ * @return task_control_block_t* woken task
  */
-static void queue_wakeup(zk_list_node_t *sleep_list_head)
+static task_control_block_t *queue_wakeup(zk_list_node_t *sleep_list_head)
 {
 	task_control_block_t *wake_up_tcb =
 		ZK_LIST_GET_FIRST_ENTRY(sleep_list_head, task_control_block_t, event_sleep_list);
 	task_block_to_ready(wake_up_tcb);
+	return wake_up_tcb;
+}
+
+/**
+ * @brief block current task on a queue sleep list until woken or timed out
+ * @param sleep_list_head sleep list head
+ * @param block_type block type
+ * @param timeout timeout
+ * @return zk_error_code_t ZK_SUCCESS if woken by the queue, otherwise error code
+ * @note called within critical section, returns within critical section;
+ *       callers re-check the queue state in a loop after ZK_SUCCESS
+ */
+static zk_error_code_t queue_wait(zk_list_node_t *sleep_list_head, block_type_t block_type,
+								  zk_uint32 timeout)
+{
+	task_control_block_t *current_tcb = g_current_tcb;
+
+	if (timeout == 0)
+	{
+		return ZK_ERR_FAILED;
+	}
+
+	if (is_scheduler_suspending())
+	{
+		return ZK_ERR_STATE;
+	}
+
+	current_tcb->event_timeout_wakeup = EVENT_NO_TIMEOUT;
+	current_tcb->wake_up_time = get_current_time() + timeout;
+	queue_sleep(current_tcb, sleep_list_head, block_type);
+	schedule();
+	ZK_EXIT_CRITICAL();
+
+	ZK_ENTER_CRITICAL();
+	if (current_tcb->event_timeout_wakeup == EVENT_WAIT_TIMEOUT)
+	{
+		return ZK_ERR_TIMEOUT;
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief queue_wait() offering buffer to the peer, which may finish the transfer meanwhile
+ * @param buffer reader: destination, writer: source
+ * @param size bytes at buffer
+ * @param done set to ZK_TRUE if the peer copied the element, the caller is finished then
+ * @note called within critical section, returns within critical section
+ */
+static zk_error_code_t queue_wait_transfer(zk_list_node_t *sleep_list_head,
+										   block_type_t block_type, zk_uint32 timeout,
+										   void *buffer, zk_uint32 size, zk_bool *done)
+{
+	task_control_block_t *current_tcb = g_current_tcb;
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	current_tcb->queue_transfer = buffer;
+	current_tcb->queue_transfer_size = size;
+	ret = queue_wait(sleep_list_head, block_type, timeout);
+	*done = (current_tcb->queue_transfer == ZK_NULL);
+	current_tcb->queue_transfer = ZK_NULL;
+	return ret;
+}
+
+/**
+ * @brief first task of a sleep list if it offered a buffer with queue_wait_transfer()
+ */
+static task_control_block_t *queue_offering_peer(zk_list_node_t *sleep_list_head)
+{
+	task_control_block_t *peer = ZK_NULL;
+
+	if (zk_list_is_empty(sleep_list_head))
+	{
+		return ZK_NULL;
+	}
+	peer = ZK_LIST_GET_FIRST_ENTRY(sleep_list_head, task_control_block_t, event_sleep_list);
+	return (peer->queue_transfer != ZK_NULL) ? peer : ZK_NULL;
+}
+
+/**
+ * @brief offering peer an element can be passed to or taken from without the ring
+ * @note stored elements go first, and a set member must keep one id per stored element
+ */
+static task_control_block_t *queue_direct_peer(queue_t *queue, zk_list_node_t *sleep_list_head)
+{
+	if (queue->element_count != 0)
+	{
+		return ZK_NULL;
+	}
+#if ZK_USING_QUEUE_SET
+	if (queue->queue_set != QUEUE_SET_NONE)
+	{
+		return ZK_NULL;
+	}
+#endif
+	return queue_offering_peer(sleep_list_head);
+}
+
+/**
+ * @brief wake a peer whose element was copied, its blocked call returns ZK_SUCCESS at once
+ */
+static inline void queue_transfer_done(task_control_block_t *peer)
+{
+	peer->queue_transfer = ZK_NULL;
+	task_block_to_ready(peer);
 }
 
 /**
@@ -137,7 +314,85 @@ static inline void queue_write_pos_increase(queue_t *queue)
  */
 zk_uint8 queue_full(zk_uint32 queue_handle)
 {
-	return queue_remaining_space(queue_handle) == 0;
+	/* 写槽被 queue_reserve() 占用时，其他写者视为队列满 */
+	return QUEUE_HANDLE_TO_POINTER(queue_handle)->write_reserved ||
+		   queue_remaining_space(queue_handle) == 0;
+}
+
+#if ZK_USING_QUEUE_SET
+/**
+ * @brief of two woken tasks, the one an ISR has to compare against the interrupted task
+ */
+static inline task_control_block_t *queue_higher_woken(task_control_block_t *a,
+													   task_control_block_t *b)
+{
+	if (a == ZK_NULL || (b != ZK_NULL && b->priority < a->priority))
+	{
+		return b;
+	}
+	return a;
+}
+
+/**
+ * @brief post one id per new element of a member queue to its set
+ * @param queue member queue
+ * @param count number of elements just added
+ * @return task_control_block_t* woken selector, ZK_NULL if none
+ * @note called within critical section
+ */
+static task_control_block_t *queue_notify_set(queue_t *queue, zk_uint32 count)
+{
+	task_control_block_t *woken = ZK_NULL;
+	zk_uint32 member =
+		QUEUE_SET_MEMBER_QUEUE(zk_handle_at(&g_queue_handles, (zk_uint32) (queue - g_queue_pool)));
+
+	if (queue->queue_set == QUEUE_SET_NONE)
+	{
+		return ZK_NULL;
+	}
+	while (count-- > 0)
+	{
+		woken = queue_higher_woken(woken, queue_set_post(queue->queue_set, member));
+	}
+	return woken;
+}
+#endif
+
+/**
+ * @brief copy one element into the queue and wake the first blocked reader
+ * @param queue queue (must not be full unless queue_direct_peer() has a reader)
+ * @param buffer source buffer
+ * @param size size
+ * @return task_control_block_t* woken reader (or set selector), ZK_NULL if none was waiting
+ * @note called within critical section; a reader blocked in queue_read() on an empty queue
+ *       gets the element copied into its buffer and does not touch the queue again
+ */
+static task_control_block_t *queue_push(queue_t *queue, const void *buffer, zk_uint32 size)
+{
+	zk_uint8 *buffer_addr = QUEUE_INDEX_TO_BUFFERADDR(queue, queue->write_pos);
+	task_control_block_t *woken = queue_direct_peer(queue, &queue->reader_sleep_list);
+
+	if (woken != ZK_NULL)
+	{
+		/* a reader waits on an empty queue: the element goes straight into its buffer */
+		zk_memcpy(woken->queue_transfer, buffer,
+				  (size < woken->queue_transfer_size) ? size : woken->queue_transfer_size);
+		queue_transfer_done(woken);
+		return woken;
+	}
+
+	zk_memcpy(buffer_addr, buffer, size);
+	queue_write_pos_increase(queue);
+	queue->element_count++;
+
+	if (!zk_list_is_empty(&queue->reader_sleep_list))
+	{
+		woken = queue_wakeup(&queue->reader_sleep_list);
+	}
+#if ZK_USING_QUEUE_SET
+	woken = queue_higher_woken(woken, queue_notify_set(queue, 1));
+#endif
+	return woken;
 }
 
 /**
@@ -155,13 +410,12 @@ static zk_error_code_t queue_write_internal(zk_uint32 queue_handle, const void *
 {
 	zk_error_code_t ret = ZK_SUCCESS;
 	queue_t *queue = ZK_NULL;
-	task_control_block_t *current_tcb = g_current_tcb;
-	zk_uint32 index = 0;
-	zk_uint8 *buffer_addr = ZK_NULL;
+	zk_bool done = ZK_FALSE;
 
 	ZK_ASSERT_NULL_POINTER(buffer);
 	QUEUE_CHECK_HANDLE_VALID(queue_handle);
 	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+	ZK_TRACE(ZK_TRACE_EV_QUEUE_WRITE, queue_handle, size);
 
 	ZK_ENTER_CRITICAL();
 	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
@@ -172,41 +426,19 @@ static zk_error_code_t queue_write_internal(zk_uint32 queue_handle, const void *
 		goto queue_write_exit;
 	}
 
-	while (queue_full(queue_handle))
+	while (queue_full(queue_handle) &&
+		   queue_direct_peer(queue, &queue->reader_sleep_list) == ZK_NULL)
 	{
-		if (timeout == 0)
-		{
-			ret = ZK_ERR_FAILED;
-			goto queue_write_exit;
-		}
-		if (is_scheduler_suspending())
-		{
-			ret = ZK_ERR_STATE;
-			goto queue_write_exit;
-		}
-
-		current_tcb->wake_up_time = get_current_time() + timeout;
-		current_tcb->event_timeout_wakeup = EVENT_NO_TIMEOUT;
-		queue_sleep(current_tcb, &queue->writer_sleep_list, block_type);
-		schedule();
-		ZK_EXIT_CRITICAL();
-
-		ZK_ENTER_CRITICAL();
-		if (current_tcb->event_timeout_wakeup == EVENT_WAIT_TIMEOUT)
+		ret = queue_wait_transfer(&queue->writer_sleep_list, block_type, timeout,
+								  (void *) buffer, size, &done);
+		if (ret != ZK_SUCCESS || done)
 		{
-			ret = ZK_ERR_TIMEOUT;
 			goto queue_write_exit;
 		}
 	}
 
-	index = queue->write_pos;
-	buffer_addr = QUEUE_INDEX_TO_BUFFERADDR(queue, index);
-	zk_memcpy(buffer_addr, buffer, size);
-	queue_write_pos_increase(queue);
-
-	if (!zk_list_is_empty(&queue->reader_sleep_list))
+	if (queue_push(queue, buffer, size) != ZK_NULL)
 	{
-		queue_wakeup(&queue->reader_sleep_list);
 		schedule();
 	}
 
@@ -224,7 +456,7 @@ queue_write_exit:
  */
 zk_error_code_t queue_write(zk_uint32 queue_handle, const void *buffer, zk_uint32 size)
 {
-	ZK_CHECK_HANDLE_VALID(queue_handle, QUEUE_MAX_NUM);
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
 	ZK_CHECK_PARAM_NOT_NULL(buffer);
 
 	if (size == 0)
@@ -266,22 +498,13 @@ zk_error_code_t queue_write_timeout(zk_uint32 queue_handle, const void *buffer,
  * @brief queue remaining space
  * @param queue_handle queue handle
  * @return zk_uint32 remaining space
+ * @note a slot handed out by queue_reserve() counts as used until it is committed
  */
 zk_uint32 queue_remaining_space(zk_uint32 queue_handle)
 {
 	queue_t *queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
-	zk_uint32 used_size = 0;
-
-	if (queue->read_pos > queue->write_pos)
-	{
-		used_size = queue->element_num - (queue->read_pos - queue->write_pos);
-	}
-	else
-	{
-		used_size = queue->write_pos - queue->read_pos;
-	}
 
-	return queue->element_num - used_size;
+	return queue->element_num - queue->element_count - queue->write_reserved;
 }
 /**
  * @brief queue empty
@@ -291,7 +514,8 @@ zk_uint32 queue_remaining_space(zk_uint32 queue_handle)
 zk_uint8 queue_empty(zk_uint32 queue_handle)
 {
 	queue_t *queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
-	return queue->read_pos == queue->write_pos;
+	/* 读槽被 queue_peek() 占用时，其他读者视为队列空 */
+	return queue->read_reserved || queue->element_count == 0;
 }
 
 /**
@@ -310,6 +534,57 @@ static inline void queue_read_pos_increase(queue_t *queue)
 	}
 }
 
+/**
+ * @brief copy one element out of the queue and wake the first blocked writer
+ * @param queue queue (must not be empty unless queue_direct_peer() has a writer)
+ * @param buffer destination buffer
+ * @param size size
+ * @return task_control_block_t* woken writer (or set selector), ZK_NULL if none was waiting
+ * @note called within critical section; a writer blocked in queue_write() has its element
+ *       stored in the freed slot, or copied straight out on an empty queue, and returns
+ */
+static task_control_block_t *queue_pop(queue_t *queue, void *buffer, zk_uint32 size)
+{
+	zk_uint8 *buffer_addr = QUEUE_INDEX_TO_BUFFERADDR(queue, queue->read_pos);
+	task_control_block_t *writer = ZK_NULL;
+
+	if (queue->element_count == 0)
+	{
+		/* nothing stored: take the element straight from the blocked writer */
+		writer = queue_direct_peer(queue, &queue->writer_sleep_list);
+		zk_memcpy(buffer, writer->queue_transfer,
+				  (size < writer->queue_transfer_size) ? size : writer->queue_transfer_size);
+		queue_transfer_done(writer);
+		return writer;
+	}
+
+	zk_memcpy(buffer, buffer_addr, size);
+	queue_read_pos_increase(queue);
+	queue->element_count--;
+
+	writer = queue_offering_peer(&queue->writer_sleep_list);
+	if (writer != ZK_NULL && !queue->write_reserved)
+	{
+		/* the freed slot takes the blocked writer's element, the writer does not retry */
+		zk_memcpy(QUEUE_INDEX_TO_BUFFERADDR(queue, queue->write_pos), writer->queue_transfer,
+				  writer->queue_transfer_size);
+		queue_write_pos_increase(queue);
+		queue->element_count++;
+		queue_transfer_done(writer);
+#if ZK_USING_QUEUE_SET
+		return queue_higher_woken(writer, queue_notify_set(queue, 1));
+#else
+		return writer;
+#endif
+	}
+
+	if (!zk_list_is_empty(&queue->writer_sleep_list))
+	{
+		return queue_wakeup(&queue->writer_sleep_list);
+	}
+	return ZK_NULL;
+}
+
 /**
  * @brief queue read internal
  * @param queue_handle queue handle
@@ -324,13 +599,12 @@ static zk_error_code_t queue_read_internal(zk_uint32 queue_handle, void *buffer,
 {
 	zk_error_code_t ret = ZK_SUCCESS;
 	queue_t *queue = ZK_NULL;
-	task_control_block_t *current_tcb = g_current_tcb;
-	zk_uint32 index = 0;
-	zk_uint8 *buffer_addr = ZK_NULL;
+	zk_bool done = ZK_FALSE;
 
 	ZK_ASSERT_NULL_POINTER(buffer);
 	QUEUE_CHECK_HANDLE_VALID(queue_handle);
 	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+	ZK_TRACE(ZK_TRACE_EV_QUEUE_READ, queue_handle, size);
 
 	ZK_ENTER_CRITICAL();
 	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
@@ -341,42 +615,19 @@ static zk_error_code_t queue_read_internal(zk_uint32 queue_handle, void *buffer,
 		goto queue_read_exit;
 	}
 
-	while (queue_empty(queue_handle))
+	while (queue_empty(queue_handle) &&
+		   queue_direct_peer(queue, &queue->writer_sleep_list) == ZK_NULL)
 	{
-		if (timeout == 0)
-		{
-			ret = ZK_ERR_FAILED;
-			goto queue_read_exit;
-		}
-
-		if (is_scheduler_suspending())
+		ret = queue_wait_transfer(&queue->reader_sleep_list, block_type, timeout, buffer, size,
+								  &done);
+		if (ret != ZK_SUCCESS || done)
 		{
-			ret = ZK_ERR_STATE;
-			goto queue_read_exit;
-		}
-
-		current_tcb->event_timeout_wakeup = EVENT_NO_TIMEOUT;
-		current_tcb->wake_up_time = get_current_time() + timeout;
-		queue_sleep(current_tcb, &queue->reader_sleep_list, block_type);
-		schedule();
-		ZK_EXIT_CRITICAL();
-
-		ZK_ENTER_CRITICAL();
-		if (current_tcb->event_timeout_wakeup == EVENT_WAIT_TIMEOUT)
-		{
-			ret = ZK_ERR_TIMEOUT;
 			goto queue_read_exit;
 		}
 	}
 
-	index = queue->read_pos;
-	buffer_addr = QUEUE_INDEX_TO_BUFFERADDR(queue, index);
-	zk_memcpy(buffer, buffer_addr, size);
-	queue_read_pos_increase(queue);
-
-	if (!zk_list_is_empty(&queue->writer_sleep_list))
+	if (queue_pop(queue, buffer, size) != ZK_NULL)
 	{
-		queue_wakeup(&queue->writer_sleep_list);
 		schedule();
 	}
 
@@ -421,43 +672,987 @@ zk_error_code_t queue_read_timeout(zk_uint32 queue_handle, void *buffer, zk_uint
 	return queue_read_internal(queue_handle, buffer, size, BLOCK_TYPE_TIMEOUT, timeout);
 }
 /**
- * @brief queue destroy
- * @param queue_handle queue handle
- * @return zk_uint32 ZK_SUCCESS if success, otherwise error code
+ * @brief timeout to block type for the timeout-argument interfaces
  */
-zk_error_code_t queue_destroy(zk_uint32 queue_handle)
+static inline block_type_t queue_timeout_block_type(zk_uint32 timeout)
+{
+	return (timeout == ZK_TIMEOUT_INFINITE) ? BLOCK_TYPE_ENDLESS : BLOCK_TYPE_TIMEOUT;
+}
+
+#if ZK_USING_TIME64
+/**
+ * @brief queue write, waiting at most until an absolute 64-bit tick
+ * @param deadline tick from get_current_time64()
+ * @return zk_error_code_t ZK_SUCCESS if written, ZK_ERR_TIMEOUT once the deadline is reached
+ */
+zk_error_code_t queue_write_until64(zk_uint32 queue_handle, const void *buffer, zk_uint32 size,
+									zk_uint64 deadline)
 {
-	queue_t *queue = ZK_NULL;
 	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 timeout = 0;
 
-	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
-	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	do
+	{
+		timeout = zk_timeout_until64(deadline);
+		ret = queue_write_internal(queue_handle, buffer, size, BLOCK_TYPE_TIMEOUT, timeout);
+	} while (ret == ZK_ERR_TIMEOUT);
 
-	ZK_ENTER_CRITICAL();
-	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+	return (ret == ZK_ERR_FAILED && timeout == ZK_TIMEOUT_NONE) ? ZK_ERR_TIMEOUT : ret;
+}
 
-	if (!zk_list_is_empty(&queue->reader_sleep_list))
+/**
+ * @brief queue read, waiting at most until an absolute 64-bit tick
+ * @param deadline tick from get_current_time64()
+ * @return zk_error_code_t ZK_SUCCESS if read, ZK_ERR_TIMEOUT once the deadline is reached
+ */
+zk_error_code_t queue_read_until64(zk_uint32 queue_handle, void *buffer, zk_uint32 size,
+								   zk_uint64 deadline)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 timeout = 0;
+
+	do
 	{
-		ret = ZK_ERR_STATE;
-		goto queue_destroy_exit;
-	}
+		timeout = zk_timeout_until64(deadline);
+		ret = queue_read_internal(queue_handle, buffer, size, BLOCK_TYPE_TIMEOUT, timeout);
+	} while (ret == ZK_ERR_TIMEOUT);
 
-	if (!zk_list_is_empty(&queue->writer_sleep_list))
+	return (ret == ZK_ERR_FAILED && timeout == ZK_TIMEOUT_NONE) ? ZK_ERR_TIMEOUT : ret;
+}
+#endif
+
+/**
+ * @brief wake up to n tasks from a queue sleep list in one pass
+ * @param sleep_list_head sleep list head
+ * @param n maximum number of tasks to wake
+ * @return zk_uint8 1 if any task was woken, otherwise 0
+ */
+static zk_uint8 queue_wakeup_n(zk_list_node_t *sleep_list_head, zk_uint32 n)
+{
+	zk_uint8 woken = 0;
+
+	while (n-- > 0 && !zk_list_is_empty(sleep_list_head))
 	{
-		ret = ZK_ERR_STATE;
-		goto queue_destroy_exit;
+		queue_wakeup(sleep_list_head);
+		woken = 1;
 	}
+	return woken;
+}
 
-	if (!queue_empty(queue_handle))
+/**
+ * @brief copy count elements into the ring, wrap-around as at most two contiguous copies
+ * @note called within critical section, caller guarantees enough free slots
+ */
+static void queue_copy_in(queue_t *queue, const zk_uint8 *src, zk_uint32 count)
+{
+	zk_uint32 first = queue->element_num - queue->write_pos;
+
+	if (first > count)
 	{
-		ret = ZK_ERR_STATE;
-		goto queue_destroy_exit;
+		first = count;
 	}
 
-	mem_free(queue->data_buffer);
-	queue->is_used = QUEUE_UNUSED;
+	zk_memcpy(QUEUE_INDEX_TO_BUFFERADDR(queue, queue->write_pos), src,
+			  first * queue->element_single_size);
+	if (count > first)
+	{
+		zk_memcpy(queue->data_buffer, src + first * queue->element_single_size,
+				  (count - first) * queue->element_single_size);
+	}
 
-queue_destroy_exit:
-	ZK_EXIT_CRITICAL();
-	return ret;
+	queue->write_pos += count;
+	if (queue->write_pos >= queue->element_num)
+	{
+		queue->write_pos -= queue->element_num;
+	}
+	queue->element_count += count;
 }
+
+/**
+ * @brief copy count elements out of the ring, wrap-around as at most two contiguous copies
+ * @note called within critical section, caller guarantees enough stored elements
+ */
+static void queue_copy_out(queue_t *queue, zk_uint8 *dest, zk_uint32 count)
+{
+	zk_uint32 first = queue->element_num - queue->read_pos;
+
+	if (first > count)
+	{
+		first = count;
+	}
+
+	zk_memcpy(dest, QUEUE_INDEX_TO_BUFFERADDR(queue, queue->read_pos),
+			  first * queue->element_single_size);
+	if (count > first)
+	{
+		zk_memcpy(dest + first * queue->element_single_size, queue->data_buffer,
+				  (count - first) * queue->element_single_size);
+	}
+
+	queue->read_pos += count;
+	if (queue->read_pos >= queue->element_num)
+	{
+		queue->read_pos -= queue->element_num;
+	}
+	queue->element_count -= count;
+}
+
+/**
+ * @brief write up to count elements in one call
+ * @param queue_handle queue handle
+ * @param buffer array of count elements, element_single_size bytes each
+ * @param count number of elements to write
+ * @param written output, number of elements actually written (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if at least one element was written, otherwise error code
+ * @note blocks only while the queue is full; after that writes as many elements as fit,
+ *       wakes the blocked readers in one pass and schedules once
+ */
+zk_error_code_t queue_write_n(zk_uint32 queue_handle, const void *buffer, zk_uint32 count,
+							  zk_uint32 *written, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+	zk_uint32 batch = 0;
+
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+
+	if (count == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+	/* a rendezvous queue has no slots to batch or to hand out */
+	if (QUEUE_HANDLE_TO_POINTER(queue_handle)->element_num == 0)
+	{
+		return ZK_ERR_NOT_SUPPORTED;
+	}
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	while (queue_full(queue_handle))
+	{
+		ret = queue_wait(&queue->writer_sleep_list, queue_timeout_block_type(timeout), timeout);
+		if (ret != ZK_SUCCESS)
+		{
+			goto queue_write_n_exit;
+		}
+	}
+
+	batch = queue_remaining_space(queue_handle);
+	if (batch > count)
+	{
+		batch = count;
+	}
+
+	queue_copy_in(queue, (const zk_uint8 *) buffer, batch);
+
+	if (queue_wakeup_n(&queue->reader_sleep_list, batch))
+	{
+		schedule();
+	}
+#if ZK_USING_QUEUE_SET
+	if (queue_notify_set(queue, batch) != ZK_NULL)
+	{
+		schedule();
+	}
+#endif
+
+queue_write_n_exit:
+	ZK_EXIT_CRITICAL();
+	if (written != ZK_NULL)
+	{
+		*written = batch;
+	}
+	return ret;
+}
+
+/**
+ * @brief read up to count elements in one call
+ * @param queue_handle queue handle
+ * @param buffer destination array with room for count elements
+ * @param count maximum number of elements to read
+ * @param read output, number of elements actually read (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if at least one element was read, otherwise error code
+ * @note blocks only while the queue is empty; after that drains as many elements as are
+ *       available, wakes the blocked writers in one pass and schedules once
+ */
+zk_error_code_t queue_read_n(zk_uint32 queue_handle, void *buffer, zk_uint32 count,
+							 zk_uint32 *read, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+	zk_uint32 batch = 0;
+
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+
+	if (count == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+	/* a rendezvous queue has no slots to batch or to hand out */
+	if (QUEUE_HANDLE_TO_POINTER(queue_handle)->element_num == 0)
+	{
+		return ZK_ERR_NOT_SUPPORTED;
+	}
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	while (queue_empty(queue_handle))
+	{
+		ret = queue_wait(&queue->reader_sleep_list, queue_timeout_block_type(timeout), timeout);
+		if (ret != ZK_SUCCESS)
+		{
+			goto queue_read_n_exit;
+		}
+	}
+
+	batch = queue->element_count;
+	if (batch > count)
+	{
+		batch = count;
+	}
+
+	queue_copy_out(queue, (zk_uint8 *) buffer, batch);
+
+	if (queue_wakeup_n(&queue->writer_sleep_list, batch))
+	{
+		schedule();
+	}
+
+queue_read_n_exit:
+	ZK_EXIT_CRITICAL();
+	if (read != ZK_NULL)
+	{
+		*read = batch;
+	}
+	return ret;
+}
+
+/**
+ * @brief check that size bytes fit into one element of a queue
+ * @param queue_handle queue handle
+ * @param size transfer length in bytes
+ * @return zk_error_code_t ZK_SUCCESS if they fit, ZK_ERR_QUEUE_SIZE_MISMATCH if they do not,
+ *         otherwise the handle error
+ * @note the element size never changes after creation, no critical section is needed
+ */
+zk_error_code_t queue_check_size(zk_uint32 queue_handle, zk_uint32 size)
+{
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+
+	if (size > QUEUE_HANDLE_TO_POINTER(queue_handle)->element_single_size)
+	{
+		return ZK_ERR_QUEUE_SIZE_MISMATCH;
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief reserve the next write slot for in-place filling (zero-copy write)
+ * @param queue_handle queue handle
+ * @param slot output, address of the slot inside data_buffer (element_single_size bytes)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note only one write reservation can be outstanding; other writers block as if the queue
+ *       were full until queue_commit() publishes the slot
+ */
+zk_error_code_t queue_reserve(zk_uint32 queue_handle, void **slot, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	ZK_CHECK_PARAM_NOT_NULL(slot);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+	/* a rendezvous queue has no slots to batch or to hand out */
+	if (QUEUE_HANDLE_TO_POINTER(queue_handle)->element_num == 0)
+	{
+		return ZK_ERR_NOT_SUPPORTED;
+	}
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	while (queue_full(queue_handle))
+	{
+		ret = queue_wait(&queue->writer_sleep_list, queue_timeout_block_type(timeout), timeout);
+		if (ret != ZK_SUCCESS)
+		{
+			goto queue_reserve_exit;
+		}
+	}
+
+	queue->write_reserved = 1;
+	*slot = QUEUE_INDEX_TO_BUFFERADDR(queue, queue->write_pos);
+
+queue_reserve_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief publish the slot obtained by queue_reserve()
+ * @param queue_handle queue handle
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t queue_commit(zk_uint32 queue_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+	zk_uint8 need_schedule = 0;
+
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	if (!queue->write_reserved)
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_commit_exit;
+	}
+
+	queue->write_reserved = 0;
+	queue_write_pos_increase(queue);
+	queue->element_count++;
+
+	if (!zk_list_is_empty(&queue->reader_sleep_list))
+	{
+		queue_wakeup(&queue->reader_sleep_list);
+		need_schedule = 1;
+	}
+#if ZK_USING_QUEUE_SET
+	if (queue_notify_set(queue, 1) != ZK_NULL)
+	{
+		need_schedule = 1;
+	}
+#endif
+
+	/* 释放写预留后，因预留而阻塞的写者可以继续 */
+	if (!queue_full(queue_handle) && !zk_list_is_empty(&queue->writer_sleep_list))
+	{
+		queue_wakeup(&queue->writer_sleep_list);
+		need_schedule = 1;
+	}
+
+	if (need_schedule)
+	{
+		schedule();
+	}
+
+queue_commit_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief get the oldest element in place without copying (zero-copy read)
+ * @param queue_handle queue handle
+ * @param slot output, address of the element inside data_buffer
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note the slot stays valid until queue_release(); other readers block as if the queue
+ *       were empty meanwhile
+ */
+zk_error_code_t queue_peek(zk_uint32 queue_handle, void **slot, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	ZK_CHECK_PARAM_NOT_NULL(slot);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+	/* a rendezvous queue has no slots to batch or to hand out */
+	if (QUEUE_HANDLE_TO_POINTER(queue_handle)->element_num == 0)
+	{
+		return ZK_ERR_NOT_SUPPORTED;
+	}
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	while (queue_empty(queue_handle))
+	{
+		ret = queue_wait(&queue->reader_sleep_list, queue_timeout_block_type(timeout), timeout);
+		if (ret != ZK_SUCCESS)
+		{
+			goto queue_peek_exit;
+		}
+	}
+
+	queue->read_reserved = 1;
+	*slot = QUEUE_INDEX_TO_BUFFERADDR(queue, queue->read_pos);
+
+queue_peek_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief return the slot obtained by queue_peek() to the writers
+ * @param queue_handle queue handle
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t queue_release(zk_uint32 queue_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+	zk_uint8 need_schedule = 0;
+
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	if (!queue->read_reserved)
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_release_exit;
+	}
+
+	queue->read_reserved = 0;
+	queue_read_pos_increase(queue);
+	queue->element_count--;
+
+	if (!zk_list_is_empty(&queue->writer_sleep_list))
+	{
+		queue_wakeup(&queue->writer_sleep_list);
+		need_schedule = 1;
+	}
+
+	/* 释放读预留后，因预留而阻塞的读者可以继续 */
+	if (!queue_empty(queue_handle) && !zk_list_is_empty(&queue->reader_sleep_list))
+	{
+		queue_wakeup(&queue->reader_sleep_list);
+		need_schedule = 1;
+	}
+
+	if (need_schedule)
+	{
+		schedule();
+	}
+
+queue_release_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief queue write from interrupt context (never blocks, never schedules)
+ * @param queue_handle queue handle
+ * @param buffer buffer
+ * @param size size
+ * @param higher_priority_woken set to ZK_TRUE if a reader above the interrupted task was woken
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_FAILED if queue is full
+ * @note finish the ISR with zk_yield_from_isr(higher_priority_woken)
+ */
+zk_error_code_t queue_write_from_isr(zk_uint32 queue_handle, const void *buffer, zk_uint32 size,
+									 zk_bool *higher_priority_woken)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+	ZK_TRACE(ZK_TRACE_EV_QUEUE_WRITE, queue_handle, size | (ZK_TRACE_ARG_FROM_ISR << 16));
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	if (size == 0 || size > queue->element_single_size)
+	{
+		ret = ZK_ERR_QUEUE_SIZE_MISMATCH;
+		goto queue_write_from_isr_exit;
+	}
+
+	if (queue_full(queue_handle) &&
+		queue_direct_peer(queue, &queue->reader_sleep_list) == ZK_NULL)
+	{
+		ret = ZK_ERR_FAILED;
+		goto queue_write_from_isr_exit;
+	}
+
+	zk_isr_note_woken(queue_push(queue, buffer, size), higher_priority_woken);
+
+queue_write_from_isr_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief queue read from interrupt context (never blocks, never schedules)
+ * @param queue_handle queue handle
+ * @param buffer buffer
+ * @param size size
+ * @param higher_priority_woken set to ZK_TRUE if a writer above the interrupted task was woken
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_FAILED if queue is empty
+ * @note finish the ISR with zk_yield_from_isr(higher_priority_woken)
+ */
+zk_error_code_t queue_read_from_isr(zk_uint32 queue_handle, void *buffer, zk_uint32 size,
+									zk_bool *higher_priority_woken)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+	ZK_TRACE(ZK_TRACE_EV_QUEUE_READ, queue_handle, size | (ZK_TRACE_ARG_FROM_ISR << 16));
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	if (size > queue->element_single_size)
+	{
+		ret = ZK_ERR_QUEUE_SIZE_MISMATCH;
+		goto queue_read_from_isr_exit;
+	}
+
+	if (queue_empty(queue_handle) &&
+		queue_direct_peer(queue, &queue->writer_sleep_list) == ZK_NULL)
+	{
+		ret = ZK_ERR_FAILED;
+		goto queue_read_from_isr_exit;
+	}
+
+	zk_isr_note_woken(queue_pop(queue, buffer, size), higher_priority_woken);
+
+queue_read_from_isr_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief queue destroy
+ * @param queue_handle queue handle
+ * @return zk_uint32 ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t queue_destroy(zk_uint32 queue_handle)
+{
+	queue_t *queue = ZK_NULL;
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	QUEUE_CHECK_HANDLE_VALID(queue_handle);
+	QUEUE_CHECK_HANDLE_CREATED(queue_handle);
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(queue_handle);
+
+	/* a concurrent destroy may have retired the handle since the unlocked check */
+	if (!zk_handle_is_valid(&g_queue_handles, queue_handle) || queue->is_used == QUEUE_UNUSED)
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_destroy_exit;
+	}
+
+	if (!zk_list_is_empty(&queue->reader_sleep_list))
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_destroy_exit;
+	}
+
+	if (!zk_list_is_empty(&queue->writer_sleep_list))
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_destroy_exit;
+	}
+
+	if (queue->write_reserved || queue->read_reserved)
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_destroy_exit;
+	}
+
+	if (!queue_empty(queue_handle))
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_destroy_exit;
+	}
+
+	if (!queue->static_buffer)
+	{
+		mem_free(queue->data_buffer);
+	}
+#if ZK_USING_QUEUE_SET
+	queue->queue_set = QUEUE_SET_NONE;
+#endif
+	queue->is_used = QUEUE_UNUSED;
+	zk_handle_free(&g_queue_handles, queue_handle);
+
+queue_destroy_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+#if ZK_USING_QUEUE_SET
+/**
+ * @brief create a queue set
+ * @param set_handle queue set handle (output parameter), a queue of member ids
+ * @param length room for ids, at least the sum of the member queue lengths and the
+ *        semaphore counts that can be outstanding at once
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t queue_set_create(zk_uint32 *set_handle, zk_uint32 length)
+{
+	return queue_create(set_handle, sizeof(zk_uint32), length);
+}
+
+/**
+ * @brief post a member id to a queue set
+ * @param set_handle queue set handle
+ * @param member QUEUE_SET_MEMBER_QUEUE() / QUEUE_SET_MEMBER_SEM() id
+ * @return task_control_block_t* woken selector, ZK_NULL if none
+ * @note called within critical section; an id that does not fit is dropped, which only
+ *       happens when the set was created shorter than its members
+ */
+task_control_block_t *queue_set_post(zk_uint32 set_handle, zk_uint32 member)
+{
+	if (queue_full(set_handle))
+	{
+		return ZK_NULL;
+	}
+	return queue_push(QUEUE_HANDLE_TO_POINTER(set_handle), &member, sizeof(member));
+}
+
+/**
+ * @brief add a queue or a semaphore to a queue set
+ * @param set_handle queue set handle
+ * @param member QUEUE_SET_MEMBER_QUEUE(queue_handle) or QUEUE_SET_MEMBER_SEM(sem_handle)
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_STATE if the member is not empty or
+ *         already belongs to a set
+ * @note once added, read the member only after queue_set_select() returned it, with the
+ *       non-blocking queue_try_read() / sem_try_get()
+ */
+zk_error_code_t queue_set_add(zk_uint32 set_handle, zk_uint32 member)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 handle = QUEUE_SET_MEMBER_HANDLE(member);
+	queue_t *queue = ZK_NULL;
+
+	QUEUE_CHECK_HANDLE_VALID(set_handle);
+	QUEUE_CHECK_HANDLE_CREATED(set_handle);
+
+	if (QUEUE_SET_MEMBER_IS_SEM(member))
+	{
+		return sem_join_queue_set(handle, set_handle);
+	}
+
+	QUEUE_CHECK_HANDLE_VALID(handle);
+	QUEUE_CHECK_HANDLE_CREATED(handle);
+	if (handle == set_handle || QUEUE_HANDLE_TO_POINTER(handle)->element_num == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(handle);
+	if (queue->element_count != 0 || queue->queue_set != QUEUE_SET_NONE)
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_set_add_exit;
+	}
+	queue->queue_set = set_handle;
+
+queue_set_add_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief remove an empty queue or a zero-count semaphore from its queue set
+ * @param set_handle queue set handle
+ * @param member member id passed to queue_set_add()
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_STATE if the member is not empty or
+ *         not in this set
+ */
+zk_error_code_t queue_set_remove(zk_uint32 set_handle, zk_uint32 member)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 handle = QUEUE_SET_MEMBER_HANDLE(member);
+	queue_t *queue = ZK_NULL;
+
+	QUEUE_CHECK_HANDLE_VALID(set_handle);
+	QUEUE_CHECK_HANDLE_CREATED(set_handle);
+
+	if (QUEUE_SET_MEMBER_IS_SEM(member))
+	{
+		return sem_leave_queue_set(handle, set_handle);
+	}
+
+	QUEUE_CHECK_HANDLE_VALID(handle);
+	QUEUE_CHECK_HANDLE_CREATED(handle);
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(handle);
+	if (queue->element_count != 0 || queue->queue_set != set_handle)
+	{
+		ret = ZK_ERR_STATE;
+		goto queue_set_remove_exit;
+	}
+	queue->queue_set = QUEUE_SET_NONE;
+
+queue_set_remove_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief wait until any member of a queue set has data
+ * @param set_handle queue set handle
+ * @param member output, id of the member that became ready (oldest first)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if a member is ready, otherwise error code
+ * @note every returned id stands for one element or token: take it with queue_try_read()
+ *       or sem_try_get() on QUEUE_SET_MEMBER_HANDLE(*member)
+ */
+zk_error_code_t queue_set_select(zk_uint32 set_handle, zk_uint32 *member, zk_uint32 timeout)
+{
+	QUEUE_CHECK_HANDLE_VALID(set_handle);
+	ZK_CHECK_PARAM_NOT_NULL(member);
+
+	return queue_read_internal(set_handle, member, sizeof(zk_uint32),
+							   queue_timeout_block_type(timeout), timeout);
+}
+#endif
+
+#if ZK_USING_MAILBOX
+/**
+ * @brief create a mailbox, a queue whose elements are single pointers
+ * @param mbox_handle mailbox handle (output parameter), also a valid queue handle
+ * @param length number of pointers the mailbox holds
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note destroy with queue_destroy()
+ */
+zk_error_code_t mbox_create(zk_uint32 *mbox_handle, zk_uint32 length)
+{
+	return queue_create(mbox_handle, sizeof(void *), length);
+}
+
+/**
+ * @brief store one pointer at write_pos and wake the first blocked reader
+ * @note called within critical section, mailbox not full; the single-word
+ *       counterpart of queue_push()
+ */
+static task_control_block_t *mbox_push(queue_t *queue, void *msg)
+{
+	task_control_block_t *woken = ZK_NULL;
+
+	((void **) queue->data_buffer)[queue->write_pos] = msg;
+	queue_write_pos_increase(queue);
+	queue->element_count++;
+
+	if (!zk_list_is_empty(&queue->reader_sleep_list))
+	{
+		woken = queue_wakeup(&queue->reader_sleep_list);
+	}
+#if ZK_USING_QUEUE_SET
+	woken = queue_higher_woken(woken, queue_notify_set(queue, 1));
+#endif
+	return woken;
+}
+
+/**
+ * @brief take the pointer at read_pos and wake the first blocked writer
+ * @note called within critical section, mailbox not empty
+ */
+static task_control_block_t *mbox_pop(queue_t *queue, void **msg)
+{
+	*msg = ((void **) queue->data_buffer)[queue->read_pos];
+	queue_read_pos_increase(queue);
+	queue->element_count--;
+
+	if (!zk_list_is_empty(&queue->writer_sleep_list))
+	{
+		return queue_wakeup(&queue->writer_sleep_list);
+	}
+	return ZK_NULL;
+}
+
+#define MBOX_CHECK_HANDLE(handle)                                                                  \
+	QUEUE_CHECK_HANDLE_VALID(handle);                                                              \
+	QUEUE_CHECK_HANDLE_CREATED(handle);                                                            \
+	if (QUEUE_HANDLE_TO_POINTER(handle)->element_single_size != sizeof(void *))                    \
+	return ZK_ERR_QUEUE_SIZE_MISMATCH
+
+/**
+ * @brief post a pointer, ownership of what it points to passes to the receiver
+ * @param mbox_handle mailbox handle
+ * @param msg pointer to post (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mbox_post(zk_uint32 mbox_handle, void *msg, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+
+	MBOX_CHECK_HANDLE(mbox_handle);
+	ZK_TRACE(ZK_TRACE_EV_QUEUE_WRITE, mbox_handle, sizeof(void *));
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(mbox_handle);
+
+	while (queue_full(mbox_handle))
+	{
+		ret = queue_wait(&queue->writer_sleep_list, queue_timeout_block_type(timeout), timeout);
+		if (ret != ZK_SUCCESS)
+		{
+			goto mbox_post_exit;
+		}
+	}
+
+	if (mbox_push(queue, msg) != ZK_NULL)
+	{
+		schedule();
+	}
+
+mbox_post_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief receive the oldest pointer
+ * @param mbox_handle mailbox handle
+ * @param msg output, the posted pointer
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t mbox_fetch(zk_uint32 mbox_handle, void **msg, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	queue_t *queue = ZK_NULL;
+
+	ZK_CHECK_PARAM_NOT_NULL(msg);
+	MBOX_CHECK_HANDLE(mbox_handle);
+	ZK_TRACE(ZK_TRACE_EV_QUEUE_READ, mbox_handle, sizeof(void *));
+
+	ZK_ENTER_CRITICAL();
+	queue = QUEUE_HANDLE_TO_POINTER(mbox_handle);
+
+	while (queue_empty(mbox_handle))
+	{
+		ret = queue_wait(&queue->reader_sleep_list, queue_timeout_block_type(timeout), timeout);
+		if (ret != ZK_SUCCESS)
+		{
+			goto mbox_fetch_exit;
+		}
+	}
+
+	if (mbox_pop(queue, msg) != ZK_NULL)
+	{
+		schedule();
+	}
+
+mbox_fetch_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief mbox_post() from interrupt context (never blocks, never schedules)
+ * @param higher_priority_woken set to ZK_TRUE if a reader above the interrupted task was woken
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_FAILED if the mailbox is full
+ * @note finish the ISR with zk_yield_from_isr(higher_priority_woken)
+ */
+zk_error_code_t mbox_post_from_isr(zk_uint32 mbox_handle, void *msg,
+								   zk_bool *higher_priority_woken)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	MBOX_CHECK_HANDLE(mbox_handle);
+	ZK_TRACE(ZK_TRACE_EV_QUEUE_WRITE, mbox_handle,
+			 sizeof(void *) | (ZK_TRACE_ARG_FROM_ISR << 16));
+
+	ZK_ENTER_CRITICAL();
+	if (queue_full(mbox_handle))
+	{
+		ret = ZK_ERR_FAILED;
+	}
+	else
+	{
+		zk_isr_note_woken(mbox_push(QUEUE_HANDLE_TO_POINTER(mbox_handle), msg),
+						  higher_priority_woken);
+	}
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief mbox_fetch() from interrupt context (never blocks, never schedules)
+ * @param higher_priority_woken set to ZK_TRUE if a writer above the interrupted task was woken
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_FAILED if the mailbox is empty
+ */
+zk_error_code_t mbox_fetch_from_isr(zk_uint32 mbox_handle, void **msg,
+									zk_bool *higher_priority_woken)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	ZK_CHECK_PARAM_NOT_NULL(msg);
+	MBOX_CHECK_HANDLE(mbox_handle);
+	ZK_TRACE(ZK_TRACE_EV_QUEUE_READ, mbox_handle,
+			 sizeof(void *) | (ZK_TRACE_ARG_FROM_ISR << 16));
+
+	ZK_ENTER_CRITICAL();
+	if (queue_empty(mbox_handle))
+	{
+		ret = ZK_ERR_FAILED;
+	}
+	else
+	{
+		zk_isr_note_woken(mbox_pop(QUEUE_HANDLE_TO_POINTER(mbox_handle), msg),
+						  higher_priority_woken);
+	}
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+#if ZK_USING_MEM_POOL
+/**
+ * @brief post a pool block, the block goes back to its pool if it cannot be posted
+ * @param mbox_handle mailbox handle
+ * @param pool_handle pool the block was allocated from
+ * @param block block from mem_pool_alloc(), already filled in
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if posted, otherwise the mbox_post() error
+ * @note either way the sender no longer owns the block; the receiver takes it with
+ *       mbox_fetch() and hands it back with mbox_free_block()
+ */
+zk_error_code_t mbox_send_block(zk_uint32 mbox_handle, zk_uint32 pool_handle, void *block,
+								zk_uint32 timeout)
+{
+	zk_error_code_t ret = mbox_post(mbox_handle, block, timeout);
+
+	if (ret != ZK_SUCCESS)
+	{
+		mem_pool_free(pool_handle, block);
+	}
+	return ret;
+}
+
+/**
+ * @brief return a block received through mbox_fetch() to the pool it was allocated from
+ */
+zk_error_code_t mbox_free_block(zk_uint32 pool_handle, void *block)
+{
+	return mem_pool_free(pool_handle, block);
+}
+#endif
+#endif
+
+#endif /* ZK_USING_QUEUE */
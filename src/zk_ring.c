@@ -0,0 +1,326 @@
+/**
+ * @file    zk_ring.c
+ * @brief   lock-free single-producer/single-consumer ring buffer
+ * @note    One producer (task or ISR) and one consumer share the ring. The producer only
+ *          writes head, the consumer only writes tail, so the data path never masks
+ *          interrupts. Only the optional notify path touches a semaphore.
+ */
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_RING
+
+/**
+ * @brief init a ring over caller-owned storage
+ * @param ring ring object
+ * @param buffer storage of capacity bytes
+ * @param capacity ring capacity in bytes, must be a power of two
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t ring_init(zk_ring_t *ring, zk_uint8 *buffer, zk_uint32 capacity)
+{
+	ZK_CHECK_PARAM_NOT_NULL(ring);
+	ZK_CHECK_PARAM_NOT_NULL(buffer);
+
+	if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	ring->buffer = buffer;
+	ring->mask = capacity - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->consumer_waiting = 0;
+	ring->notify_sem = ZK_RING_NO_NOTIFY;
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief bind a semaphore so that the consumer can block in ring_read_timeout()
+ * @param ring ring object
+ * @param sem_handle semaphore created with initial count 0, or ZK_RING_NO_NOTIFY to unbind
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note call before the producer and consumer start; ZK_ERR_NOT_SUPPORTED without
+ *       ZK_USING_SEMAPHORE
+ */
+zk_error_code_t ring_bind_notify(zk_ring_t *ring, zk_uint32 sem_handle)
+{
+	ZK_CHECK_PARAM_NOT_NULL(ring);
+
+	if (sem_handle != ZK_RING_NO_NOTIFY)
+	{
+#if ZK_USING_SEMAPHORE
+		ZK_CHECK_HANDLE_VALID(ZK_HANDLE_INDEX(sem_handle), SEM_MAX_NUM);
+#else
+		return ZK_ERR_NOT_SUPPORTED;
+#endif
+	}
+
+	ring->notify_sem = sem_handle;
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief number of bytes stored in the ring
+ */
+zk_uint32 ring_used(const zk_ring_t *ring)
+{
+	return ring->head - ring->tail;
+}
+
+/**
+ * @brief number of bytes that can still be written
+ */
+zk_uint32 ring_free(const zk_ring_t *ring)
+{
+	return ring->mask + 1 - (ring->head - ring->tail);
+}
+
+/**
+ * @brief copy data in and publish the new head
+ * @return zk_uint32 bytes written
+ */
+static zk_uint32 ring_produce(zk_ring_t *ring, const zk_uint8 *data, zk_uint32 len)
+{
+	zk_uint32 head = ring->head;
+	zk_uint32 offset = head & ring->mask;
+	zk_uint32 space = ring->mask + 1 - (head - ring->tail);
+	zk_uint32 first = 0;
+
+	if (len > space)
+	{
+		len = space;
+	}
+	if (len == 0)
+	{
+		return 0;
+	}
+
+	first = ring->mask + 1 - offset;
+	if (first > len)
+	{
+		first = len;
+	}
+	zk_memcpy(ring->buffer + offset, data, first);
+	if (len > first)
+	{
+		zk_memcpy(ring->buffer, data + first, len - first);
+	}
+
+	/* data must be visible before the consumer sees the new head */
+	ZK_MEMORY_BARRIER();
+	ring->head = head + len;
+	/* head must be visible before consumer_waiting is sampled */
+	ZK_MEMORY_BARRIER();
+	return len;
+}
+
+/**
+ * @brief check whether the consumer is waiting for data and claim the wakeup
+ * @return zk_bool ZK_TRUE if the caller must post notify_sem
+ */
+#if ZK_USING_SEMAPHORE
+static inline zk_bool ring_claim_notify(zk_ring_t *ring)
+{
+	if (ring->notify_sem == ZK_RING_NO_NOTIFY || !ring->consumer_waiting)
+	{
+		return ZK_FALSE;
+	}
+	ring->consumer_waiting = 0;
+	return ZK_TRUE;
+}
+#endif
+
+/**
+ * @brief write up to len bytes from the producer task
+ * @param ring ring object
+ * @param data source bytes
+ * @param len number of bytes to write
+ * @return zk_uint32 bytes actually written, 0 if the ring is full
+ */
+zk_uint32 ring_write(zk_ring_t *ring, const zk_uint8 *data, zk_uint32 len)
+{
+	zk_uint32 written = ring_produce(ring, data, len);
+
+#if ZK_USING_SEMAPHORE
+	if (written > 0 && ring_claim_notify(ring))
+	{
+		sem_release(ring->notify_sem);
+	}
+#endif
+	return written;
+}
+
+/**
+ * @brief write up to len bytes from the producer ISR
+ * @param ring ring object
+ * @param data source bytes
+ * @param len number of bytes to write
+ * @param higher_priority_woken set to ZK_TRUE if the woken consumer should run next
+ * @return zk_uint32 bytes actually written, 0 if the ring is full
+ * @note finish the ISR with zk_yield_from_isr(higher_priority_woken)
+ */
+zk_uint32 ring_write_from_isr(zk_ring_t *ring, const zk_uint8 *data, zk_uint32 len,
+							  zk_bool *higher_priority_woken)
+{
+	zk_uint32 written = ring_produce(ring, data, len);
+
+	ZK_ASSERT_ISR_PRIORITY();
+#if ZK_USING_SEMAPHORE
+	if (written > 0 && ring_claim_notify(ring))
+	{
+		sem_release_from_isr(ring->notify_sem, higher_priority_woken);
+	}
+#else
+	(void) higher_priority_woken;
+#endif
+	return written;
+}
+
+/**
+ * @brief read up to len bytes without blocking
+ * @param ring ring object
+ * @param data destination bytes
+ * @param len maximum number of bytes to read
+ * @return zk_uint32 bytes actually read, 0 if the ring is empty
+ */
+zk_uint32 ring_read(zk_ring_t *ring, zk_uint8 *data, zk_uint32 len)
+{
+	zk_uint32 tail = ring->tail;
+	zk_uint32 offset = tail & ring->mask;
+	zk_uint32 used = ring->head - tail;
+	zk_uint32 first = 0;
+
+	if (len > used)
+	{
+		len = used;
+	}
+	if (len == 0)
+	{
+		return 0;
+	}
+
+	/* do not read data older than the head we just sampled */
+	ZK_MEMORY_BARRIER();
+
+	first = ring->mask + 1 - offset;
+	if (first > len)
+	{
+		first = len;
+	}
+	zk_memcpy(data, ring->buffer + offset, first);
+	if (len > first)
+	{
+		zk_memcpy(data + first, ring->buffer, len - first);
+	}
+
+	/* finish reading before the producer may reuse the space */
+	ZK_MEMORY_BARRIER();
+	ring->tail = tail + len;
+	return len;
+}
+
+/**
+ * @brief read up to len bytes, blocking on the bound semaphore while the ring is empty
+ * @param ring ring object
+ * @param data destination bytes
+ * @param len maximum number of bytes to read
+ * @param read output, bytes actually read (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if at least one byte was read, otherwise error code
+ * @note without a bound semaphore this behaves like ring_read()
+ */
+zk_error_code_t ring_read_timeout(zk_ring_t *ring, zk_uint8 *data, zk_uint32 len,
+								  zk_uint32 *read, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 count = 0;
+#if ZK_USING_SEMAPHORE
+	zk_uint32 now = 0;
+	zk_uint32 deadline = get_current_time() + timeout;
+#endif
+
+	ZK_CHECK_PARAM_NOT_NULL(ring);
+	ZK_CHECK_PARAM_NOT_NULL(data);
+
+	while ((count = ring_read(ring, data, len)) == 0)
+	{
+		if (len == 0 || timeout == ZK_TIMEOUT_NONE || ring->notify_sem == ZK_RING_NO_NOTIFY)
+		{
+			ret = ZK_ERR_FAILED;
+			goto ring_read_timeout_exit;
+		}
+
+#if ZK_USING_SEMAPHORE
+		/* announce the wait, then re-check so a concurrent write cannot be missed */
+		ring->consumer_waiting = 1;
+		ZK_MEMORY_BARRIER();
+		if (ring_used(ring) > 0)
+		{
+			ring->consumer_waiting = 0;
+			continue;
+		}
+
+		if (timeout == ZK_TIMEOUT_INFINITE)
+		{
+			ret = sem_get(ring->notify_sem);
+		}
+		else
+		{
+			now = get_current_time();
+			ret = zk_time_is_reached(now, deadline) ? ZK_ERR_TIMEOUT
+													: sem_get_timeout(ring->notify_sem,
+																	  deadline - now);
+		}
+		ring->consumer_waiting = 0;
+
+		if (ret != ZK_SUCCESS)
+		{
+			goto ring_read_timeout_exit;
+		}
+#endif
+	}
+
+ring_read_timeout_exit:
+	if (read != ZK_NULL)
+	{
+		*read = count;
+	}
+	return ret;
+}
+
+/**
+ * @brief get the oldest stored bytes that are contiguous in the storage
+ * @param ring ring object
+ * @param span output, start of the bytes
+ * @return zk_uint32 number of contiguous bytes, 0 if the ring is empty
+ * @note the bytes stay owned by the ring until ring_consume(); a wrapped ring needs two spans
+ */
+zk_uint32 ring_read_span(const zk_ring_t *ring, const zk_uint8 **span)
+{
+	zk_uint32 tail = ring->tail;
+	zk_uint32 offset = tail & ring->mask;
+	zk_uint32 used = ring->head - tail;
+	zk_uint32 first = ring->mask + 1 - offset;
+
+	/* do not hand out data older than the head we just sampled */
+	ZK_MEMORY_BARRIER();
+	*span = ring->buffer + offset;
+	return (used < first) ? used : first;
+}
+
+/**
+ * @brief release bytes obtained with ring_read_span()
+ * @param ring ring object
+ * @param len number of bytes, at most the span length
+ */
+void ring_consume(zk_ring_t *ring, zk_uint32 len)
+{
+	/* finish reading before the producer may reuse the space */
+	ZK_MEMORY_BARRIER();
+	ring->tail += len;
+}
+
+#endif /* ZK_USING_RING */
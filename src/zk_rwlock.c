@@ -0,0 +1,424 @@
+/**
+ * @file    zk_rwlock.c
+ * @brief   reader-writer lock module
+ * @note    Any number of readers or one writer. A queued writer stops new readers so writers
+ *          cannot starve, and the write holder inherits the priority of blocked tasks.
+ *          Read lock/unlock swap the state word with LDREX/STREX while no writer is around.
+ */
+
+#include "zk_internal.h"
+
+#if ZK_USING_RWLOCK
+
+static rwlock_t g_rwlock_pool[RWLOCK_MAX_NUM];
+ZK_HANDLE_POOL_DEFINE(g_rwlock_handles, RWLOCK_MAX_NUM);
+extern task_control_block_t *volatile g_current_tcb;
+
+#define RWLOCK_HANDLE_TO_POINTER(handle) (&g_rwlock_pool[ZK_HANDLE_INDEX(handle)])
+
+#define CHECK_RWLOCK_HANDLE_VALID(handle)                                                          \
+	if (!zk_handle_is_valid(&g_rwlock_handles, handle))                                            \
+	return ZK_ERR_INVALID_HANDLE
+
+#define CHECK_RWLOCK_CREATED(handle)                                                               \
+	if (RWLOCK_HANDLE_TO_POINTER(handle)->is_used == RWLOCK_UNUSED)                                \
+	return ZK_ERR_STATE
+
+void rwlock_init(void)
+{
+	for (zk_uint32 i = 0; i < RWLOCK_MAX_NUM; i++)
+	{
+		g_rwlock_pool[i].writer = ZK_NULL;
+		g_rwlock_pool[i].state = 0;
+		g_rwlock_pool[i].is_used = RWLOCK_UNUSED;
+		zk_list_init(&g_rwlock_pool[i].reader_wait_list);
+		zk_list_init(&g_rwlock_pool[i].writer_wait_list);
+	}
+	zk_handle_pool_init(&g_rwlock_handles);
+}
+
+zk_error_code_t rwlock_create(zk_uint32 *rwlock_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	rwlock_t *rwlock = ZK_NULL;
+
+	ZK_ASSERT_NULL_POINTER(rwlock_handle);
+
+	ZK_ENTER_CRITICAL();
+
+	ret = zk_handle_alloc(&g_rwlock_handles, rwlock_handle);
+	if (ret != ZK_SUCCESS)
+	{
+		goto rwlock_create_exit;
+	}
+
+	rwlock = RWLOCK_HANDLE_TO_POINTER(*rwlock_handle);
+	rwlock->writer = ZK_NULL;
+	rwlock->state = 0;
+	zk_list_init(&rwlock->reader_wait_list);
+	zk_list_init(&rwlock->writer_wait_list);
+	rwlock->is_used = RWLOCK_USED;
+
+rwlock_create_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+zk_error_code_t rwlock_destroy(zk_uint32 rwlock_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	rwlock_t *rwlock = ZK_NULL;
+
+	CHECK_RWLOCK_HANDLE_VALID(rwlock_handle);
+	CHECK_RWLOCK_CREATED(rwlock_handle);
+
+	ZK_ENTER_CRITICAL();
+	rwlock = RWLOCK_HANDLE_TO_POINTER(rwlock_handle);
+
+	/* a concurrent destroy may have retired the handle since the unlocked check */
+	if (!zk_handle_is_valid(&g_rwlock_handles, rwlock_handle) || rwlock->is_used == RWLOCK_UNUSED ||
+		rwlock->state != 0 || !zk_list_is_empty(&rwlock->reader_wait_list) ||
+		!zk_list_is_empty(&rwlock->writer_wait_list))
+	{
+		ret = ZK_ERR_STATE;
+		goto rwlock_destroy_exit;
+	}
+
+	rwlock->is_used = RWLOCK_UNUSED;
+	zk_handle_free(&g_rwlock_handles, rwlock_handle);
+
+rwlock_destroy_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Hand the lock to waiters the current state admits
+ * @param rwlock Reader-writer lock
+ * @return zk_bool ZK_TRUE if any task was woken
+ * @note called within critical section. A free lock goes to the first queued writer,
+ *       otherwise every queued reader is admitted at once.
+ */
+static zk_bool rwlock_grant(rwlock_t *rwlock)
+{
+	task_control_block_t *tcb = ZK_NULL;
+	zk_bool woken = ZK_FALSE;
+
+	if (rwlock->state & RWLOCK_STATE_WRITER)
+	{
+		return ZK_FALSE;
+	}
+
+	if (!zk_list_is_empty(&rwlock->writer_wait_list))
+	{
+		if ((rwlock->state & RWLOCK_STATE_READER_MASK) != 0)
+		{
+			return ZK_FALSE;
+		}
+
+		tcb = ZK_LIST_GET_FIRST_ENTRY(&rwlock->writer_wait_list, task_control_block_t,
+									  event_sleep_list);
+		task_block_to_ready(tcb);
+		rwlock->writer = tcb;
+		rwlock->state = RWLOCK_STATE_WRITER;
+		if (!zk_list_is_empty(&rwlock->writer_wait_list))
+		{
+			rwlock->state |= RWLOCK_STATE_WRITER_WAITING;
+		}
+		return ZK_TRUE;
+	}
+
+	rwlock->state &= ~RWLOCK_STATE_WRITER_WAITING;
+	while (!zk_list_is_empty(&rwlock->reader_wait_list))
+	{
+		tcb = ZK_LIST_GET_FIRST_ENTRY(&rwlock->reader_wait_list, task_control_block_t,
+									  event_sleep_list);
+		task_block_to_ready(tcb);
+		rwlock->state++;
+		woken = ZK_TRUE;
+	}
+	return woken;
+}
+
+/**
+ * @brief Let the write holder inherit the priority of a task about to block
+ * @note called within critical section
+ */
+static inline void rwlock_inherit_priority(rwlock_t *rwlock, task_control_block_t *task)
+{
+	if ((rwlock->state & RWLOCK_STATE_WRITER) && rwlock->writer->priority > task->priority)
+	{
+		task_change_priority_temp(rwlock->writer, task->priority);
+	}
+}
+
+/**
+ * @brief Block the current task on one of the wait lists
+ * @return zk_error_code_t ZK_SUCCESS if the lock was handed over, ZK_ERR_TIMEOUT otherwise
+ * @note called within critical section, returns within critical section
+ */
+static zk_error_code_t rwlock_sleep(task_control_block_t *task, zk_list_node_t *wait_list,
+									zk_uint32 timeout)
+{
+	task->event_timeout_wakeup = EVENT_NO_TIMEOUT;
+	task->wake_up_time = get_current_time() + timeout;
+	task_ready_to_block(task, wait_list,
+						(timeout == ZK_TIMEOUT_INFINITE) ? BLOCK_TYPE_ENDLESS : BLOCK_TYPE_TIMEOUT,
+						BLOCK_SORT_PRIO);
+	schedule();
+	ZK_EXIT_CRITICAL();
+
+	ZK_ENTER_CRITICAL();
+	return (task->event_timeout_wakeup == EVENT_WAIT_TIMEOUT) ? ZK_ERR_TIMEOUT : ZK_SUCCESS;
+}
+
+/**
+ * @brief Take the lock for reading
+ * @param rwlock_handle Reader-writer lock handle
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Blocks while a writer holds the lock or is queued for it
+ */
+zk_error_code_t rwlock_read_lock(zk_uint32 rwlock_handle, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	rwlock_t *rwlock = ZK_NULL;
+	volatile zk_uint32 *state = ZK_NULL;
+	zk_uint32 value = 0;
+
+	CHECK_RWLOCK_HANDLE_VALID(rwlock_handle);
+	CHECK_RWLOCK_CREATED(rwlock_handle);
+
+	rwlock = RWLOCK_HANDLE_TO_POINTER(rwlock_handle);
+	state = &rwlock->state;
+
+	/* fast path: no writer holds or waits, a context switch in between fails the STREX */
+	value = zk_cpu_ldrex(state);
+	if ((value & (RWLOCK_STATE_WRITER | RWLOCK_STATE_WRITER_WAITING)) == 0 &&
+		zk_cpu_strex(value + 1, state) == 0)
+	{
+		return ZK_SUCCESS;
+	}
+	zk_cpu_clrex();
+
+	ZK_ENTER_CRITICAL();
+
+	if ((rwlock->state & (RWLOCK_STATE_WRITER | RWLOCK_STATE_WRITER_WAITING)) == 0)
+	{
+		rwlock->state++;
+		goto rwlock_read_lock_exit;
+	}
+
+	if (rwlock->writer == g_current_tcb)
+	{
+		ret = ZK_ERR_SYNC_DEADLOCK;
+		goto rwlock_read_lock_exit;
+	}
+
+	if (timeout == ZK_TIMEOUT_NONE)
+	{
+		ret = ZK_ERR_FAILED;
+		goto rwlock_read_lock_exit;
+	}
+
+	if (is_scheduler_suspending())
+	{
+		ret = ZK_ERR_STATE;
+		goto rwlock_read_lock_exit;
+	}
+
+	rwlock_inherit_priority(rwlock, g_current_tcb);
+	ret = rwlock_sleep(g_current_tcb, &rwlock->reader_wait_list, timeout);
+
+rwlock_read_lock_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Drop a read hold
+ * @param rwlock_handle Reader-writer lock handle
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Only the last reader leaving in front of a queued writer enters the critical section
+ */
+zk_error_code_t rwlock_read_unlock(zk_uint32 rwlock_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	rwlock_t *rwlock = ZK_NULL;
+	volatile zk_uint32 *state = ZK_NULL;
+	zk_uint32 value = 0;
+	zk_uint32 readers = 0;
+
+	CHECK_RWLOCK_HANDLE_VALID(rwlock_handle);
+	CHECK_RWLOCK_CREATED(rwlock_handle);
+
+	rwlock = RWLOCK_HANDLE_TO_POINTER(rwlock_handle);
+	state = &rwlock->state;
+
+	value = zk_cpu_ldrex(state);
+	readers = value & RWLOCK_STATE_READER_MASK;
+	if (readers > 1 || (readers == 1 && (value & RWLOCK_STATE_WRITER_WAITING) == 0))
+	{
+		if (zk_cpu_strex(value - 1, state) == 0)
+		{
+			return ZK_SUCCESS;
+		}
+	}
+	zk_cpu_clrex();
+
+	ZK_ENTER_CRITICAL();
+
+	if ((rwlock->state & RWLOCK_STATE_READER_MASK) == 0)
+	{
+		ret = ZK_ERR_SYNC_NOT_OWNER;
+		goto rwlock_read_unlock_exit;
+	}
+
+	rwlock->state--;
+	if (rwlock_grant(rwlock))
+	{
+		schedule();
+	}
+
+rwlock_read_unlock_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Take the lock for writing
+ * @param rwlock_handle Reader-writer lock handle
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Not recursive. While queued, the writer keeps new readers out.
+ */
+zk_error_code_t rwlock_write_lock(zk_uint32 rwlock_handle, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	rwlock_t *rwlock = ZK_NULL;
+	task_control_block_t *current_task = g_current_tcb;
+
+	CHECK_RWLOCK_HANDLE_VALID(rwlock_handle);
+	CHECK_RWLOCK_CREATED(rwlock_handle);
+
+	ZK_ENTER_CRITICAL();
+	rwlock = RWLOCK_HANDLE_TO_POINTER(rwlock_handle);
+
+	if (rwlock->state == 0)
+	{
+		rwlock->state = RWLOCK_STATE_WRITER;
+		rwlock->writer = current_task;
+		goto rwlock_write_lock_exit;
+	}
+
+	if (rwlock->writer == current_task)
+	{
+		ret = ZK_ERR_SYNC_DEADLOCK;
+		goto rwlock_write_lock_exit;
+	}
+
+	if (timeout == ZK_TIMEOUT_NONE)
+	{
+		ret = ZK_ERR_FAILED;
+		goto rwlock_write_lock_exit;
+	}
+
+	if (is_scheduler_suspending())
+	{
+		ret = ZK_ERR_STATE;
+		goto rwlock_write_lock_exit;
+	}
+
+	rwlock->state |= RWLOCK_STATE_WRITER_WAITING;
+	rwlock_inherit_priority(rwlock, current_task);
+	ret = rwlock_sleep(current_task, &rwlock->writer_wait_list, timeout);
+
+	if (ret == ZK_ERR_TIMEOUT && zk_list_is_empty(&rwlock->writer_wait_list))
+	{
+		/* last queued writer gave up, readers held back for it may go */
+		rwlock->state &= ~RWLOCK_STATE_WRITER_WAITING;
+		if (rwlock_grant(rwlock))
+		{
+			schedule();
+		}
+	}
+
+rwlock_write_lock_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Release the write lock
+ * @param rwlock_handle Reader-writer lock handle
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t rwlock_write_unlock(zk_uint32 rwlock_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	rwlock_t *rwlock = ZK_NULL;
+	task_control_block_t *current_task = g_current_tcb;
+	zk_bool need_reschedule = ZK_FALSE;
+	zk_uint8 priority = 0;
+
+	CHECK_RWLOCK_HANDLE_VALID(rwlock_handle);
+	CHECK_RWLOCK_CREATED(rwlock_handle);
+
+	ZK_ENTER_CRITICAL();
+	rwlock = RWLOCK_HANDLE_TO_POINTER(rwlock_handle);
+
+	if (!(rwlock->state & RWLOCK_STATE_WRITER) || rwlock->writer != current_task)
+	{
+		ret = ZK_ERR_SYNC_NOT_OWNER;
+		goto rwlock_write_unlock_exit;
+	}
+
+	/* drop only what the lock's waiters lent, boosts from held mutexes stay */
+#if ZK_USING_MUTEX
+	priority = mutex_held_priority(current_task);
+#else
+	priority = current_task->base_priority;
+#endif
+	if (current_task->priority != priority)
+	{
+		task_change_priority_temp(current_task, priority);
+		need_reschedule = ZK_TRUE;
+	}
+
+	rwlock->writer = ZK_NULL;
+	rwlock->state &= ~RWLOCK_STATE_WRITER;
+	if (rwlock_grant(rwlock))
+	{
+		need_reschedule = ZK_TRUE;
+	}
+
+	if (need_reschedule)
+	{
+		schedule();
+	}
+
+rwlock_write_unlock_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Whether a task holds any write lock
+ * @param tcb Task
+ * @return zk_bool ZK_TRUE if the task is the writer of at least one lock
+ * @note called within critical section
+ */
+zk_bool rwlock_is_owned_by(const task_control_block_t *tcb)
+{
+	for (zk_uint32 i = 0; i < RWLOCK_MAX_NUM; i++)
+	{
+		if (g_rwlock_pool[i].is_used == RWLOCK_USED &&
+			(g_rwlock_pool[i].state & RWLOCK_STATE_WRITER) && g_rwlock_pool[i].writer == tcb)
+		{
+			return ZK_TRUE;
+		}
+	}
+	return ZK_FALSE;
+}
+
+#endif /* ZK_USING_RWLOCK */
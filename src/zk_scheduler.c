@@ -4,9 +4,11 @@
  * @note    implement priority preemptive scheduling algorithm
  */
 
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_SCHED
+
 #include "zk_internal.h"
-#include "zk_cpu_cm3.h"
-#ifdef ZK_USING_HOOK
+#include "zk_port.h"
+#if ZK_USING_HOOK
 #include "zk_hook.h"
 #endif
 
@@ -15,8 +17,6 @@ extern task_control_block_t *volatile g_switch_next_tcb;
 
 /* global scheduler */
 task_scheduler_t g_scheduler;
-/* schedule time slice */
-static zk_uint32 g_schedule_time_slice = CONFIG_TICK_COUNT_INIT_VALUE;
 
 /**
  * @brief Initialize scheduler
@@ -27,53 +27,150 @@ void scheduler_init(void)
 	{
 		zk_list_init(&g_scheduler.ready_list[i]);
 	}
+#if ZK_USING_TIME_WHEEL
+	zk_time_wheel_init(&g_scheduler.time_wheel, get_current_time());
+#else
 	zk_list_init(&g_scheduler.delay_list);
-	zk_list_init(&g_scheduler.suspend_list);
 	zk_list_init(&g_scheduler.block_timeout_list);
+#endif
+	zk_list_init(&g_scheduler.suspend_list);
+#if ZK_USING_BUDGET
+	zk_list_init(&g_scheduler.budget_list);
+#endif
+#if ZK_USING_PREEMPT_THRESHOLD
+	zk_list_init(&g_scheduler.preempted_list);
+#endif
 
 	g_scheduler.scheduler_suspend_nesting = 0;
+#if ZK_PRIORITY_TWO_LEVEL
+	g_scheduler.priority_group = 0;
+	for (int i = 0; i < ZK_PRIORITY_GROUP_NUM; i++)
+	{
+		g_scheduler.priority_active[i] = 0;
+	}
+#else
 	g_scheduler.priority_active = 0;
+#endif
 	g_scheduler.re_schedule_pending = SCHEDULE_PENDING_NONE;
-	g_schedule_time_slice = SCHEDULE_TIME_SLICE_INIT_VALUE;
+	g_scheduler.pended_ticks = 0;
 }
 
 /**
  * @brief Check if scheduler is suspending
  * @return zk_uint8 1 if suspending, otherwise 0
+ * @note A single word load, no critical section: the nesting count is only changed by the
+ *       running task itself (scheduler_suspend/resume), never by an ISR, so every caller,
+ *       locked or not, reads a consistent value
  */
 zk_uint8 is_scheduler_suspending(void)
 {
-	zk_uint8 is_suspending = 0;
-	ZK_ENTER_CRITICAL();
-	is_suspending = g_scheduler.scheduler_suspend_nesting;
-	ZK_EXIT_CRITICAL();
-	return is_suspending;
+	return g_scheduler.scheduler_suspend_nesting != 0;
+}
+
+/**
+ * @brief Hand the decided g_switch_next_tcb to PendSV
+ * @note called within critical section, once the caller has picked the next task
+ */
+static inline void scheduler_switch_to_next(void)
+{
+#if ZK_USING_PREEMPT_THRESHOLD
+	/* a held task may also come back through the bitmap, e.g. boosted by inheritance */
+	zk_list_delete(&g_switch_next_tcb->threshold_node);
+	zk_list_init(&g_switch_next_tcb->threshold_node);
+#endif
+	ZK_TRACE(ZK_TRACE_EV_SWITCH, g_switch_next_tcb, g_switch_next_tcb->priority);
+	zk_cpu_trigger_pendsv();
 }
 
+#if ZK_USING_PREEMPT_THRESHOLD
+/**
+ * @brief Apply preemption thresholds to the highest priority ready task
+ * @return zk_bool ZK_TRUE if a threshold decided g_switch_next_tcb, ZK_FALSE to schedule
+ *         normally
+ * @note called within critical section, with g_switch_next_tcb set to the highest priority
+ *       ready task. A running task with a threshold keeps the CPU
+ *       against every task its threshold covers and is not time-sliced. Once preempted it
+ *       waits on preempted_list and gets the CPU back before any task its threshold still
+ *       covers; nested preemptions only come from ever higher priorities, so the list head
+ *       is always the one to check.
+ */
+static zk_bool scheduler_threshold_decide(void)
+{
+	task_control_block_t *held = ZK_NULL;
+
+	if (g_current_tcb->state == TASK_READY &&
+		g_current_tcb->preempt_threshold < g_current_tcb->priority)
+	{
+		if (g_switch_next_tcb->priority >= g_current_tcb->preempt_threshold)
+		{
+			/* drop a preemption decided earlier in the same PendSV window */
+			zk_list_delete(&g_current_tcb->threshold_node);
+			zk_list_init(&g_current_tcb->threshold_node);
+			g_switch_next_tcb = g_current_tcb;
+			return ZK_TRUE;
+		}
+		if (zk_list_is_empty(&g_current_tcb->threshold_node))
+		{
+			zk_list_add_after(&g_current_tcb->threshold_node, &g_scheduler.preempted_list);
+		}
+		return ZK_FALSE;
+	}
+
+	if (zk_list_is_empty(&g_scheduler.preempted_list))
+	{
+		return ZK_FALSE;
+	}
+	held = ZK_LIST_GET_FIRST_ENTRY(&g_scheduler.preempted_list, task_control_block_t,
+								   threshold_node);
+	if (g_switch_next_tcb->priority < held->preempt_threshold)
+	{
+		return ZK_FALSE;
+	}
+	g_switch_next_tcb = held;
+	return ZK_TRUE;
+}
+#endif
+
 /**
  * @brief Schedule next task
- * @note This function can be called from multiple contexts:
- *       1. SysTick interrupt (g_switch_next_tcb already set)
- *       2. task_delay/task_suspend (g_switch_next_tcb may not be set)
- *       3. Semaphore/Mutex/Queue operations
+ * @note Called within critical section, from task context (blocking calls, IPC posts) and
+ *       from zk_yield_from_isr(). The tick and scheduler_resume() paths decide the next task
+ *       in scheduler_advance_ticks() and go to scheduler_switch_to_next() directly.
  */
 void schedule(void)
 {
 	zk_uint8 need_switch = 0;
 
-	if (is_scheduler_suspending())
+	if (g_scheduler.scheduler_suspend_nesting != 0)
 	{
-		g_scheduler.re_schedule_pending = 1;
+		g_scheduler.re_schedule_pending = SCHEDULE_PENDING_PENDING;
 		return;
 	}
 
 	g_switch_next_tcb = get_highest_priority_task();
 
-	if (g_switch_next_tcb->priority != g_current_tcb->priority)
+#if ZK_USING_PREEMPT_THRESHOLD
+	if (scheduler_threshold_decide())
+	{
+		need_switch = (g_switch_next_tcb != g_current_tcb) ? 1 : 0;
+		goto schedule_now;
+	}
+#endif
+
+	/* a task that just blocked is not in its ready list, so there is nothing to rotate */
+	if (g_switch_next_tcb->priority != g_current_tcb->priority ||
+		g_current_tcb->state != TASK_READY)
 	{
 		need_switch = 1;
 		goto schedule_now;
 	}
+#if ZK_USING_EDF
+	/* the EDF band is not rotated, its head is the earliest deadline */
+	else if (g_current_tcb->priority == ZK_EDF_PRIORITY)
+	{
+		need_switch = (g_switch_next_tcb != g_current_tcb) ? 1 : 0;
+	}
+#endif
 	else
 	{
 		zk_list_node_t *ready_list_head = &g_scheduler.ready_list[g_current_tcb->priority];
@@ -94,9 +191,28 @@ void schedule(void)
 schedule_now:
 	if (need_switch == 1)
 	{
-		zk_cpu_trigger_pendsv();
+		scheduler_switch_to_next();
 	}
 }
+/**
+ * @brief Request the deferred context switch at the end of an ISR
+ * @param higher_priority_woken Flag accumulated by the _from_isr IPC calls
+ * @note Call once at ISR exit: any number of wakeups collapse into a single PendSV
+ */
+void zk_yield_from_isr(zk_bool higher_priority_woken)
+{
+	ZK_ASSERT_ISR_PRIORITY();
+
+	if (higher_priority_woken != ZK_TRUE)
+	{
+		return;
+	}
+
+	ZK_ENTER_CRITICAL();
+	schedule();
+	ZK_EXIT_CRITICAL();
+}
+
 /**
  * @brief Start scheduler
  */
@@ -113,7 +229,17 @@ void start_scheduler(void)
  */
 void clear_priority_active(zk_uint8 priority)
 {
-	g_scheduler.priority_active &= (~(ZK_BIT_MASK_0 << priority));
+#if ZK_PRIORITY_TWO_LEVEL
+	zk_uint32 group = priority / ZK_PRIORITY_WORD_BITS;
+
+	g_scheduler.priority_active[group] &= ~(1UL << (priority % ZK_PRIORITY_WORD_BITS));
+	if (g_scheduler.priority_active[group] == 0)
+	{
+		g_scheduler.priority_group &= ~(1UL << group);
+	}
+#else
+	g_scheduler.priority_active &= (~(1UL << priority));
+#endif
 }
 /**
  * @brief Set priority active bit
@@ -121,53 +247,254 @@ void clear_priority_active(zk_uint8 priority)
  */
 void set_priority_active(zk_uint8 priority)
 {
-	g_scheduler.priority_active |= (ZK_BIT_MASK_0 << priority);
+#if ZK_PRIORITY_TWO_LEVEL
+	zk_uint32 group = priority / ZK_PRIORITY_WORD_BITS;
+
+	g_scheduler.priority_active[group] |= (1UL << (priority % ZK_PRIORITY_WORD_BITS));
+	g_scheduler.priority_group |= (1UL << group);
+#else
+	g_scheduler.priority_active |= (1UL << priority);
+#endif
+}
+
+#if ZK_USING_TICKLESS
+/**
+ * @brief Check whether the idle priority is the only one with ready tasks
+ */
+static inline zk_bool scheduler_only_idle_priority_active(void)
+{
+#if ZK_PRIORITY_TWO_LEVEL
+	return g_scheduler.priority_group == (1UL << (ZK_PRIORITY_GROUP_NUM - 1)) &&
+		   g_scheduler.priority_active[ZK_PRIORITY_GROUP_NUM - 1] ==
+			   (1UL << (IDLE_TASK_PRIO % ZK_PRIORITY_WORD_BITS));
+#else
+	return g_scheduler.priority_active == (1UL << IDLE_TASK_PRIO);
+#endif
+}
+#endif
+
+
+#if ZK_USING_WAIT_INDEX
+static zk_wait_index_t g_wait_index_pool[ZK_WAIT_INDEX_NUM];
+
+/**
+ * @brief Lowest priority with waiters that still goes before a waiter of priority
+ * @return zk_int32 That priority, -1 if priority goes to the front
+ */
+static zk_int32 wait_index_find_prev(const zk_wait_index_t *index, zk_uint8 priority)
+{
+#if ZK_PRIORITY_TWO_LEVEL
+	zk_uint32 group = priority / ZK_PRIORITY_WORD_BITS;
+	zk_uint32 bit = priority % ZK_PRIORITY_WORD_BITS;
+	zk_uint32 word = index->active[group] & (0xFFFFFFFFUL >> (ZK_PRIORITY_WORD_BITS - 1 - bit));
+	zk_uint32 groups = 0;
+
+	if (word != 0)
+	{
+		return (zk_int32) (group * ZK_PRIORITY_WORD_BITS + zk_cpu_fls(word));
+	}
+	groups = index->group & ((1UL << group) - 1UL);
+	if (groups == 0)
+	{
+		return -1;
+	}
+	group = zk_cpu_fls(groups);
+	return (zk_int32) (group * ZK_PRIORITY_WORD_BITS + zk_cpu_fls(index->active[group]));
+#else
+	zk_uint32 word = index->active & (0xFFFFFFFFUL >> (ZK_PRIORITY_WORD_BITS - 1 - priority));
+
+	return (word != 0) ? (zk_int32) zk_cpu_fls(word) : -1;
+#endif
+}
+
+static void wait_index_set_active(zk_wait_index_t *index, zk_uint8 priority)
+{
+#if ZK_PRIORITY_TWO_LEVEL
+	index->active[priority / ZK_PRIORITY_WORD_BITS] |= 1UL << (priority % ZK_PRIORITY_WORD_BITS);
+	index->group |= 1UL << (priority / ZK_PRIORITY_WORD_BITS);
+#else
+	index->active |= 1UL << priority;
+#endif
 }
 
+static void wait_index_clear_active(zk_wait_index_t *index, zk_uint8 priority)
+{
+#if ZK_PRIORITY_TWO_LEVEL
+	zk_uint32 group = priority / ZK_PRIORITY_WORD_BITS;
+
+	index->active[group] &= ~(1UL << (priority % ZK_PRIORITY_WORD_BITS));
+	if (index->active[group] == 0)
+	{
+		index->group &= ~(1UL << group);
+	}
+#else
+	index->active &= ~(1UL << priority);
+#endif
+}
+
+/**
+ * @brief Queue a waiter behind the last one of the same or a higher priority, O(1)
+ */
+static void wait_index_insert(zk_wait_index_t *index, task_control_block_t *tcb)
+{
+	zk_int32 prev = wait_index_find_prev(index, tcb->priority);
+
+	zk_list_add_after(&tcb->event_sleep_list,
+					  (prev < 0) ? index->sleep_head : index->tail[prev]);
+	index->tail[tcb->priority] = &tcb->event_sleep_list;
+	wait_index_set_active(index, tcb->priority);
+	tcb->wait_index = index;
+	tcb->wait_priority = tcb->priority;
+}
+
+/**
+ * @brief Take a waiter off an indexed sleep list, the index is freed with the last one
+ */
+static void wait_index_remove(task_control_block_t *tcb)
+{
+	zk_wait_index_t *index = tcb->wait_index;
+	zk_list_node_t *prev = tcb->event_sleep_list.pre;
+	zk_uint8 priority = tcb->wait_priority;
+
+	if (index->tail[priority] == &tcb->event_sleep_list)
+	{
+		if (prev != index->sleep_head &&
+			ZK_LIST_GET_OWNER(prev, task_control_block_t, event_sleep_list)->wait_priority ==
+				priority)
+		{
+			index->tail[priority] = prev;
+		}
+		else
+		{
+			wait_index_clear_active(index, priority);
+		}
+	}
+	zk_list_delete(&tcb->event_sleep_list);
+	tcb->wait_index = ZK_NULL;
+
+	if (zk_list_is_empty(index->sleep_head))
+	{
+		index->sleep_head = ZK_NULL;
+	}
+}
+
+/**
+ * @brief Give a long sleep list an index, if one is free
+ * @note  The waiters are filed again in list order, which also settles any waiter whose
+ *        priority changed while it slept on the plain list
+ */
+static void wait_index_attach(zk_list_node_t *sleep_head)
+{
+	zk_wait_index_t *index = ZK_NULL;
+	zk_list_node_t pending;
+	zk_list_node_t *node = LIST_NODE_NULL;
+	zk_uint32 i = 0;
+
+	for (i = 0; i < ZK_WAIT_INDEX_NUM; i++)
+	{
+		if (g_wait_index_pool[i].sleep_head == ZK_NULL)
+		{
+			index = &g_wait_index_pool[i];
+			break;
+		}
+	}
+	if (index == ZK_NULL)
+	{
+		return;
+	}
+
+	zk_memclear(index, sizeof(zk_wait_index_t));
+	index->sleep_head = sleep_head;
+
+	zk_list_init(&pending);
+	while (!zk_list_is_empty(sleep_head))
+	{
+		zk_list_move_before(sleep_head->next, &pending);
+	}
+	while (!zk_list_is_empty(&pending))
+	{
+		node = pending.next;
+		zk_list_delete(node);
+		wait_index_insert(index, ZK_LIST_GET_OWNER(node, task_control_block_t, event_sleep_list));
+	}
+}
+
+/**
+ * @brief Move an indexed waiter whose priority changed to its new place
+ * @param tcb Blocked task, priority already updated
+ */
+void wait_index_requeue(task_control_block_t *tcb)
+{
+	zk_wait_index_t *index = tcb->wait_index;
+	zk_list_node_t *sleep_head = index->sleep_head;
+
+	wait_index_remove(tcb);
+	/* still within the critical section, a slot freed by the last waiter is not reused yet */
+	index->sleep_head = sleep_head;
+	wait_index_insert(index, tcb);
+}
+#endif
 
 /**
  * @brief Add task to endless block list
  * @param tcb Task control block
  * @param sleep_head Sleep list head
  * @param sort_type Block sort type
+ * @note  BLOCK_SORT_PRIO keeps the highest priority first and equal priorities in arrival
+ *        order; a list with a wait index is filed in O(1), otherwise it is walked
  */
 void add_task_to_endless_block_list(task_control_block_t *tcb, zk_list_node_t *sleep_head,
 									block_sort_type_t sort_type)
 {
 	zk_list_node_t *iterator = LIST_NODE_NULL;
 	task_control_block_t *tcb_iterator = ZK_NULL;
+#if ZK_USING_WAIT_INDEX
+	zk_uint32 walked = 0;
 
+	tcb->wait_index = ZK_NULL;
+#endif
+
+#if ZK_USING_TASK_MONITOR
+	tcb->wait_list = sleep_head;
+#endif
 	switch (sort_type)
 	{
 	case BLOCK_SORT_FIFO:
-		zk_list_add_after(&tcb->event_sleep_list, sleep_head);
+		zk_list_add_before(&tcb->event_sleep_list, sleep_head);
 		break;
 
 	case BLOCK_SORT_PRIO:
-		if (zk_list_is_empty(sleep_head))
+#if ZK_USING_WAIT_INDEX
+		if (!zk_list_is_empty(sleep_head))
 		{
-			zk_list_add_after(&tcb->event_sleep_list, sleep_head);
-		}
-		else
-		{
-			ZK_LIST_FOR_EACH_NODE(iterator, sleep_head)
-			{
-				tcb_iterator = ZK_LIST_GET_OWNER(iterator, task_control_block_t, event_sleep_list);
-				if (tcb_iterator->priority < tcb->priority)
-				{
-					break;
-				}
-			}
-
-			if (iterator == sleep_head)
+			tcb_iterator =
+				ZK_LIST_GET_FIRST_ENTRY(sleep_head, task_control_block_t, event_sleep_list);
+			if (tcb_iterator->wait_index != ZK_NULL)
 			{
-				zk_list_add_after(&tcb->event_sleep_list, &tcb_iterator->event_sleep_list);
+				wait_index_insert(tcb_iterator->wait_index, tcb);
+				break;
 			}
-			else
+		}
+#endif
+		ZK_LIST_FOR_EACH_NODE(iterator, sleep_head)
+		{
+			tcb_iterator = ZK_LIST_GET_OWNER(iterator, task_control_block_t, event_sleep_list);
+			if (tcb_iterator->priority > tcb->priority)
 			{
-				zk_list_add_before(&tcb->event_sleep_list, &tcb_iterator->event_sleep_list);
+				break;
 			}
+#if ZK_USING_WAIT_INDEX
+			walked++;
+#endif
 		}
+		/* before the first lower priority waiter, at the tail if there is none */
+		zk_list_add_before(&tcb->event_sleep_list, iterator);
+#if ZK_USING_WAIT_INDEX
+		if (walked >= ZK_WAIT_INDEX_THRESHOLD)
+		{
+			wait_index_attach(sleep_head);
+		}
+#endif
 		break;
 	}
 
@@ -178,9 +505,15 @@ void add_task_to_endless_block_list(task_control_block_t *tcb, zk_list_node_t *s
  * @brief Add task to time-sorted list
  * @param tcb Task control block
  * @param target_list Target list type
+ * @note With ZK_USING_TIME_WHEEL both list types share one wheel (O(1) insert),
+ *       the task state tells them apart on expiry
  */
 void add_task_to_time_sort_list(task_control_block_t *tcb, scheduler_state_list_t target_list)
 {
+#if ZK_USING_TIME_WHEEL
+	(void) target_list;
+	zk_time_wheel_insert(&g_scheduler.time_wheel, &tcb->state_node, tcb->wake_up_time);
+#else
 	zk_list_node_t *iterator = LIST_NODE_NULL;
 	task_control_block_t *tcb_iterator = ZK_NULL;
 	zk_list_node_t *target_list_head = ZK_NULL;
@@ -225,16 +558,59 @@ void add_task_to_time_sort_list(task_control_block_t *tcb, scheduler_state_list_
 			zk_list_add_before(&tcb->state_node, &tcb_iterator->state_node);
 		}
 	}
+#endif
 }
 
 
+#if ZK_USING_EDF
+/**
+ * @brief Insert into the EDF band ready list, which is kept sorted by absolute deadline
+ * @param tcb Task control block
+ * @note Equal deadlines queue in arrival order, so a running job is never preempted by a tie.
+ *       Tasks without a period only reach this priority through priority inheritance; they
+ *       go first, since they hold something an EDF job waits for.
+ */
+static void add_task_to_edf_ready_list(task_control_block_t *tcb)
+{
+	zk_list_node_t *ready_list = &g_scheduler.ready_list[ZK_EDF_PRIORITY];
+	zk_list_node_t *iterator = LIST_NODE_NULL;
+	task_control_block_t *tcb_iterator = ZK_NULL;
+
+	if (tcb->edf_period == 0)
+	{
+		zk_list_add_after(&tcb->state_node, ready_list);
+		return;
+	}
+
+	ZK_LIST_FOR_EACH_NODE(iterator, ready_list)
+	{
+		tcb_iterator = ZK_LIST_GET_OWNER(iterator, task_control_block_t, state_node);
+		if (tcb_iterator->edf_period != 0 &&
+			zk_time_is_before(tcb->edf_deadline, tcb_iterator->edf_deadline))
+		{
+			break;
+		}
+	}
+	zk_list_add_before(&tcb->state_node, iterator);
+}
+#endif
+
 /**
  * @brief Add task to ready list
  * @param tcb Task control block
  */
 void add_task_to_ready_list(task_control_block_t *tcb)
 {
-	zk_list_add_after(&tcb->state_node, &g_scheduler.ready_list[tcb->priority]);
+#if ZK_USING_EDF
+	if (tcb->priority == ZK_EDF_PRIORITY)
+	{
+		add_task_to_edf_ready_list(tcb);
+	}
+	else
+#endif
+	{
+		zk_list_add_after(&tcb->state_node, &g_scheduler.ready_list[tcb->priority]);
+	}
 	set_priority_active(tcb->priority);
 	tcb->state = TASK_READY;
 }
@@ -313,7 +689,16 @@ void remove_task_from_blocked_list(task_control_block_t *tcb)
 	{
 		zk_list_delete(&tcb->state_node);
 	}
-	zk_list_delete(&tcb->event_sleep_list);
+#if ZK_USING_WAIT_INDEX
+	if (tcb->wait_index != ZK_NULL)
+	{
+		wait_index_remove(tcb);
+	}
+	else
+#endif
+	{
+		zk_list_delete(&tcb->event_sleep_list);
+	}
 	tcb->state = TASK_UNKNOWN;
 }
 
@@ -333,6 +718,7 @@ void remove_task_from_timeout_blocked_list(task_control_block_t *tcb)
  */
 void task_ready_to_delay(task_control_block_t *tcb)
 {
+	ZK_TRACE(ZK_TRACE_EV_DELAY, tcb, tcb->wake_up_time);
 	remove_task_from_ready_list(tcb);
 	add_task_to_delay_list(tcb);
 }
@@ -343,6 +729,8 @@ void task_ready_to_delay(task_control_block_t *tcb)
  */
 void task_delay_to_ready(task_control_block_t *tcb)
 {
+	ZK_TRACE(ZK_TRACE_EV_READY, tcb, TASK_DELAY);
+	ZK_PERF_ADD(wakeups, 1);
 	remove_task_from_delay_list(tcb);
 	add_task_to_ready_list(tcb);
 }
@@ -357,6 +745,8 @@ void task_delay_to_ready(task_control_block_t *tcb)
 void task_ready_to_block(task_control_block_t *tcb, zk_list_node_t *sleep_head,
 						 block_type_t block_type, block_sort_type_t sort_type)
 {
+	ZK_TRACE(ZK_TRACE_EV_BLOCK, tcb, block_type);
+	ZK_PERF_ADD(ipc_blocks, 1);
 	remove_task_from_ready_list(tcb);
 	add_task_to_endless_block_list(tcb, sleep_head, sort_type);
 	if (block_type == BLOCK_TYPE_TIMEOUT)
@@ -371,6 +761,8 @@ void task_ready_to_block(task_control_block_t *tcb, zk_list_node_t *sleep_head,
  */
 void task_block_to_ready(task_control_block_t *tcb)
 {
+	ZK_TRACE(ZK_TRACE_EV_READY, tcb, tcb->state);
+	ZK_PERF_ADD(wakeups, 1);
 	remove_task_from_blocked_list(tcb);
 	add_task_to_ready_list(tcb);
 }
@@ -381,6 +773,7 @@ void task_block_to_ready(task_control_block_t *tcb)
  */
 void task_ready_to_suspend(task_control_block_t *tcb)
 {
+	ZK_TRACE(ZK_TRACE_EV_SUSPEND, tcb, 0);
 	remove_task_from_ready_list(tcb);
 	add_task_to_suspend_list(tcb);
 }
@@ -391,6 +784,7 @@ void task_ready_to_suspend(task_control_block_t *tcb)
  */
 void task_suspend_to_ready(task_control_block_t *tcb)
 {
+	ZK_TRACE(ZK_TRACE_EV_READY, tcb, TASK_SUSPEND);
 	remove_task_from_suspend_list(tcb);
 	add_task_to_ready_list(tcb);
 }
@@ -413,6 +807,45 @@ void task_suspend_to_block(task_control_block_t *tcb, zk_list_node_t *sleep_head
 	}
 }
 
+#if ZK_USING_TIME_WHEEL
+/**
+ * @brief Check all task wakeup conditions
+ * @param time Current time
+ * @note Only the slots between the last processed time and now are visited
+ *       (one slot per tick in normal operation)
+ */
+void check_task_wakeup(zk_uint32 time)
+{
+	zk_list_node_t *slot = LIST_NODE_NULL;
+	zk_list_node_t *iterator = LIST_NODE_NULL;
+	zk_list_node_t *iterator_next = LIST_NODE_NULL;
+	task_control_block_t *tcb_iterator = ZK_NULL;
+
+	while ((slot = zk_time_wheel_advance(&g_scheduler.time_wheel, time)) != LIST_NODE_NULL)
+	{
+		ZK_LIST_FOR_EACH_NODE_SAFE(iterator, iterator_next, slot)
+		{
+			tcb_iterator = ZK_LIST_GET_OWNER(iterator, task_control_block_t, state_node);
+			/* Entries of later revolutions share the slot, keep overflow-safe comparison */
+			if (!zk_time_is_reached(time, tcb_iterator->wake_up_time))
+			{
+				continue;
+			}
+
+			if (tcb_iterator->state == TASK_DELAY)
+			{
+				task_delay_to_ready(tcb_iterator);
+			}
+			else
+			{
+				tcb_iterator->event_timeout_wakeup = EVENT_WAIT_TIMEOUT;
+				ZK_PERF_ADD(ipc_timeouts, 1);
+				task_block_to_ready(tcb_iterator);
+			}
+		}
+	}
+}
+#else
 /**
  * @brief Check and wake up delayed tasks
  * @param time Current time
@@ -468,6 +901,7 @@ void check_task_block_wakeup(zk_uint32 time)
 		{
 			iterator_prev = iterator->pre;
 			tcb_iterator->event_timeout_wakeup = EVENT_WAIT_TIMEOUT;
+			ZK_PERF_ADD(ipc_timeouts, 1);
 			task_block_to_ready(tcb_iterator);
 			iterator = iterator_prev;
 		}
@@ -487,70 +921,401 @@ void check_task_wakeup(zk_uint32 time)
 	check_delay_task_wakeup(time);
 	check_task_block_wakeup(time);
 }
+#endif
+
+#if ZK_USING_BUDGET
 /**
- * @brief Increment tick
- * @return zk_uint32 ZK_TRUE if reschedule needed, otherwise ZK_FALSE
- * @note Fix: Only perform time-slice rotation when there are multiple tasks at the same priority
+ * @brief Move the replenishment time of a budgeted task past the given time
+ * @param tcb Task control block
+ * @param time Current time
+ * @note Whole periods the task spent blocked are skipped, so the windows stay aligned
  */
-zk_uint32 scheduler_increment_tick(void)
+static void scheduler_budget_refill(task_control_block_t *tcb, zk_uint32 time)
 {
-	zk_uint8 need_schedule = ZK_FALSE;
-	zk_uint32 current_time = get_current_time();
+	tcb->budget_left = tcb->budget;
+	do
+	{
+		tcb->budget_replenish_time += tcb->budget_period;
+	} while (zk_time_is_reached(time, tcb->budget_replenish_time));
+}
 
-	ZK_ENTER_CRITICAL();
+/**
+ * @brief Drop a task that ran out of budget to ZK_BUDGET_BACKGROUND_PRIORITY
+ * @param tcb Task control block
+ * @note Only the base priority changes while the task holds a mutex, so a waiter's
+ *       inheritance is kept; the unlock path then drops it to the background.
+ */
+static void scheduler_budget_demote(task_control_block_t *tcb)
+{
+	zk_list_node_t *iterator = LIST_NODE_NULL;
+	task_control_block_t *tcb_iterator = ZK_NULL;
 
-	if (is_scheduler_suspending())
+	tcb->budget_overruns++;
+	if (tcb->base_priority >= ZK_BUDGET_BACKGROUND_PRIORITY)
 	{
-		goto scheduler_increment_tick_exit;
+		return;
+	}
+
+	tcb->budget_demoted = 1;
+	tcb->budget_priority = tcb->base_priority;
+	tcb->base_priority = ZK_BUDGET_BACKGROUND_PRIORITY;
+#if ZK_USING_MUTEX
+	if (tcb->holding_mutex == ZK_NULL)
+#endif
+	{
+		task_resume_priority(tcb);
+	}
+
+	ZK_LIST_FOR_EACH_NODE(iterator, &g_scheduler.budget_list)
+	{
+		tcb_iterator = ZK_LIST_GET_OWNER(iterator, task_control_block_t, budget_node);
+		if (zk_time_is_before(tcb->budget_replenish_time, tcb_iterator->budget_replenish_time))
+		{
+			break;
+		}
+	}
+	zk_list_add_before(&tcb->budget_node, iterator);
+}
+
+/**
+ * @brief Replenish demoted tasks whose period ended, then charge the running task
+ * @param time Current time (before the last tick, as for wakeups)
+ * @param ticks Elapsed ticks, all charged to the task that was running
+ */
+static void scheduler_budget_account(zk_uint32 time, zk_uint32 ticks)
+{
+	task_control_block_t *tcb = ZK_NULL;
+
+	while (!zk_list_is_empty(&g_scheduler.budget_list))
+	{
+		tcb = ZK_LIST_GET_FIRST_ENTRY(&g_scheduler.budget_list, task_control_block_t,
+									  budget_node);
+		if (!zk_time_is_reached(time, tcb->budget_replenish_time))
+		{
+			break;
+		}
+		zk_list_delete(&tcb->budget_node);
+		zk_list_init(&tcb->budget_node);
+		scheduler_budget_refill(tcb, time);
+		tcb->budget_demoted = 0;
+		tcb->base_priority = tcb->budget_priority;
+		if (tcb->priority > tcb->base_priority)
+		{
+			task_resume_priority(tcb);
+		}
 	}
 
-	increment_time();
-	check_task_wakeup(current_time);
+	tcb = g_current_tcb;
+	if (tcb->budget == 0 || tcb->budget_demoted)
+	{
+		return;
+	}
+	if (zk_time_is_reached(time, tcb->budget_replenish_time))
+	{
+		scheduler_budget_refill(tcb, time);
+	}
+	if (tcb->budget_left > ticks)
+	{
+		tcb->budget_left -= ticks;
+		return;
+	}
+	tcb->budget_left = 0;
+	scheduler_budget_demote(tcb);
+}
+#endif
+
+/**
+ * @brief Advance time and run wakeups and time-slice rotation
+ * @param ticks Number of elapsed ticks (1 from SysTick, the pended count on resume)
+ * @return zk_bool ZK_TRUE if the caller must call schedule()
+ * @note called within critical section with the scheduler running. A batch moves time once
+ *       and sweeps the wake lists once; at most one time-slice rotation results from it.
+ *       The running task's own quantum is charged, so a preempted task resumes with what
+ *       was left of it.
+ */
+static zk_bool scheduler_advance_ticks(zk_uint32 ticks)
+{
+	/* wakeups are checked against the time before the last tick, as one-by-one ticks do */
+	zk_uint32 check_time = get_current_time() + ticks - 1;
+
+	ZK_PERF_ADD(ticks, ticks);
+	if (ticks == 1)
+	{
+		increment_time();
+	}
+	else
+	{
+		zk_time_step(ticks);
+	}
+	check_task_wakeup(check_time);
+#if ZK_USING_BUDGET
+	scheduler_budget_account(check_time, ticks);
+#endif
 
 	g_switch_next_tcb = get_highest_priority_task();
 
+#if ZK_USING_PREEMPT_THRESHOLD
+	if (scheduler_threshold_decide())
+	{
+		return (g_switch_next_tcb != g_current_tcb) ? ZK_TRUE : ZK_FALSE;
+	}
+#endif
+
 	if (g_switch_next_tcb->priority < g_current_tcb->priority)
 	{
-		schedule();
-		need_schedule = ZK_TRUE;
-		goto scheduler_increment_tick_exit;
+		return ZK_TRUE;
 	}
 
 	if (g_switch_next_tcb->priority == g_current_tcb->priority)
 	{
 		zk_list_node_t *ready_list = &g_scheduler.ready_list[g_current_tcb->priority];
 
+#if ZK_USING_EDF
+		/* no time slice in the EDF band: a job runs until an earlier deadline is released */
+		if (g_current_tcb->priority == ZK_EDF_PRIORITY)
+		{
+			return (g_switch_next_tcb != g_current_tcb) ? ZK_TRUE : ZK_FALSE;
+		}
+#endif
+
 		if (!zk_list_is_empty(ready_list) && ready_list->next != ready_list->pre)
 		{
-			if (--g_schedule_time_slice <= 0)
+			if (g_current_tcb->time_slice_left > ticks)
+			{
+				g_current_tcb->time_slice_left -= ticks;
+			}
+			else
 			{
-				g_schedule_time_slice = SCHEDULE_TIME_SLICE_INIT_VALUE;
+				g_current_tcb->time_slice_left = g_current_tcb->time_slice;
 
 				zk_list_move_to_tail(&g_current_tcb->state_node, ready_list);
 
 				g_switch_next_tcb =
 					ZK_LIST_GET_FIRST_ENTRY(ready_list, task_control_block_t, state_node);
 
-				schedule();
-				need_schedule = ZK_TRUE;
+				return ZK_TRUE;
 			}
 		}
 		else
 		{
-			g_schedule_time_slice = SCHEDULE_TIME_SLICE_INIT_VALUE;
+			g_current_tcb->time_slice_left = g_current_tcb->time_slice;
 		}
 	}
 
+	return ZK_FALSE;
+}
+
+/**
+ * @brief Increment tick
+ * @return zk_uint32 ZK_TRUE if reschedule needed, otherwise ZK_FALSE
+ * @note Fix: Only perform time-slice rotation when there are multiple tasks at the same priority.
+ *       While the scheduler is suspended the tick is only counted, scheduler_resume()
+ *       catches up on all of them in one batch.
+ */
+zk_uint32 scheduler_increment_tick(void)
+{
+	zk_uint8 need_schedule = ZK_FALSE;
+#if ZK_USING_TIMER || ZK_USING_TRACE
+	zk_uint32 current_time = get_current_time();
+#endif
+
+#if (ZK_TASK_STATS_MODE == 3)
+	zk_isr_enter();
+#endif
+
+	ZK_ENTER_CRITICAL();
+
+	/* already inside the critical section, read the nesting directly */
+	if (g_scheduler.scheduler_suspend_nesting != 0)
+	{
+		g_scheduler.pended_ticks++;
+		goto scheduler_increment_tick_exit;
+	}
+
+	ZK_TRACE(ZK_TRACE_EV_TICK, 0, current_time);
+	if (scheduler_advance_ticks(1))
+	{
+		/* g_switch_next_tcb (and any time-slice rotation) is already decided */
+		scheduler_switch_to_next();
+		need_schedule = ZK_TRUE;
+	}
+
 scheduler_increment_tick_exit:
 	ZK_EXIT_CRITICAL();
 
-#ifdef ZK_USING_TIMER
+#if ZK_USING_TIMER
 	timer_check(current_time);
 #endif
+#if ZK_USING_HEARTBEAT
+	heartbeat_check();
+#endif
 
-#ifdef ZK_USING_HOOK
+#if ZK_USING_HOOK
 	zk_hook_call_tick();
 #endif
 
+#if (ZK_TASK_STATS_MODE == 3)
+	zk_isr_exit();
+#endif
+
 	return need_schedule;
 }
+
+/**
+ * @brief Suspend the scheduler: stop preemption while interrupts stay enabled
+ * @note Calls nest. ISRs still run and may ready tasks; the switch is deferred until the
+ *       outermost scheduler_resume(). Must be called from a task.
+ */
+void scheduler_suspend(void)
+{
+	ZK_ENTER_CRITICAL();
+	g_scheduler.scheduler_suspend_nesting++;
+	ZK_EXIT_CRITICAL();
+}
+
+/**
+ * @brief Resume the scheduler
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_STATE if it was not suspended
+ * @note The outermost resume catches up on the ticks counted meanwhile in one batch, then
+ *       requests at most one context switch for everything that became ready.
+ */
+zk_error_code_t scheduler_resume(void)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_bool need_schedule = ZK_FALSE;
+
+	ZK_ENTER_CRITICAL();
+
+	if (g_scheduler.scheduler_suspend_nesting == 0)
+	{
+		ret = ZK_ERR_STATE;
+		goto scheduler_resume_exit;
+	}
+
+	if (--g_scheduler.scheduler_suspend_nesting != 0)
+	{
+		goto scheduler_resume_exit;
+	}
+
+	if (g_scheduler.pended_ticks > 0)
+	{
+		need_schedule = scheduler_advance_ticks(g_scheduler.pended_ticks);
+		g_scheduler.pended_ticks = 0;
+	}
+
+	/* the batch's decision already covers the tasks readied while suspended */
+	if (need_schedule)
+	{
+		g_scheduler.re_schedule_pending = SCHEDULE_PENDING_NONE;
+		scheduler_switch_to_next();
+	}
+	else if (g_scheduler.re_schedule_pending == SCHEDULE_PENDING_PENDING)
+	{
+		g_scheduler.re_schedule_pending = SCHEDULE_PENDING_NONE;
+		schedule();
+	}
+
+scheduler_resume_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+#if ZK_USING_TICKLESS
+/**
+ * @brief Update the nearest wake-up candidate from a timed task list
+ * @param list_head Time-sorted list head, or a time wheel slot
+ * @param now Current time
+ * @param idle_ticks Nearest wake-up distance found so far (in/out)
+ * @note Sorted lists only need their head; wheel slots are unsorted and are walked fully
+ */
+static void scheduler_update_idle_ticks(zk_list_node_t *list_head, zk_uint32 now,
+										zk_uint32 *idle_ticks)
+{
+	zk_list_node_t *iterator = LIST_NODE_NULL;
+	task_control_block_t *tcb = ZK_NULL;
+	zk_uint32 distance = 0;
+
+	ZK_LIST_FOR_EACH_NODE(iterator, list_head)
+	{
+		tcb = ZK_LIST_GET_OWNER(iterator, task_control_block_t, state_node);
+		distance = zk_time_is_reached(now, tcb->wake_up_time) ? 0 : (tcb->wake_up_time - now);
+		if (distance < *idle_ticks)
+		{
+			*idle_ticks = distance;
+		}
+#if !ZK_USING_TIME_WHEEL
+		break;
+#endif
+	}
+}
+
+/**
+ * @brief Calculate how many ticks the system can stay idle
+ * @return zk_uint32 Ticks until the nearest wake-up, ZK_TIMEOUT_INFINITE if nothing is pending,
+ *         0 if any task other than idle is ready
+ * @note Only the list heads are inspected: delay_list and block_timeout_list are sorted by
+ *       wake-up time (the wheel slots are walked instead), timers provide their expiry cache
+ */
+zk_uint32 scheduler_get_expected_idle_ticks(void)
+{
+	zk_uint32 idle_ticks = ZK_TIMEOUT_INFINITE;
+	zk_uint32 now = 0;
+	zk_list_node_t *idle_ready_list = &g_scheduler.ready_list[IDLE_TASK_PRIO];
+
+	ZK_ENTER_CRITICAL();
+
+	if (!scheduler_only_idle_priority_active() ||
+		idle_ready_list->next != idle_ready_list->pre ||
+		g_scheduler.re_schedule_pending == SCHEDULE_PENDING_PENDING)
+	{
+		idle_ticks = 0;
+		goto scheduler_get_expected_idle_ticks_exit;
+	}
+
+	now = get_current_time();
+#if ZK_USING_TIME_WHEEL
+	for (zk_uint32 i = 0; i < ZK_TIME_WHEEL_SIZE; i++)
+	{
+		scheduler_update_idle_ticks(&g_scheduler.time_wheel.slots[i], now, &idle_ticks);
+	}
+#else
+	scheduler_update_idle_ticks(&g_scheduler.delay_list, now, &idle_ticks);
+	scheduler_update_idle_ticks(&g_scheduler.block_timeout_list, now, &idle_ticks);
+#endif
+
+#if ZK_USING_TIMER
+	{
+		zk_uint32 timer_wake_up_time = 0;
+		zk_uint32 distance = 0;
+
+		if (timer_get_next_expiry(&timer_wake_up_time))
+		{
+			distance = zk_time_is_reached(now, timer_wake_up_time) ? 0 : (timer_wake_up_time - now);
+			if (distance < idle_ticks)
+			{
+				idle_ticks = distance;
+			}
+		}
+	}
+#endif
+#if ZK_USING_HEARTBEAT
+	{
+		zk_uint32 heartbeat_time = 0;
+		zk_uint32 distance = 0;
+
+		if (heartbeat_get_next_expiry(&heartbeat_time))
+		{
+			distance = zk_time_is_reached(now, heartbeat_time) ? 0 : (heartbeat_time - now);
+			if (distance < idle_ticks)
+			{
+				idle_ticks = distance;
+			}
+		}
+	}
+#endif
+
+scheduler_get_expected_idle_ticks_exit:
+	ZK_EXIT_CRITICAL();
+	return idle_ticks;
+}
+#endif
@@ -5,17 +5,20 @@
 
 #include "zk_internal.h"
 
+#if ZK_USING_SEMAPHORE
+
 static semaphore_t g_sem_pool[SEM_MAX_NUM];
+ZK_HANDLE_POOL_DEFINE(g_sem_handles, SEM_MAX_NUM);
 extern task_control_block_t *volatile g_current_tcb;
 
-#define SEM_HANDLE_TO_POINTER(handle) (&g_sem_pool[handle])
+#define SEM_HANDLE_TO_POINTER(handle) (&g_sem_pool[ZK_HANDLE_INDEX(handle)])
 
 #define CHECK_SEM_HANDLE_VALID(handle)                                                             \
-	if (handle >= SEM_MAX_NUM)                                                                     \
+	if (!zk_handle_is_valid(&g_sem_handles, handle))                                               \
 	return ZK_ERR_INVALID_HANDLE
 
 #define CHECK_SEM_CREATED(handle)                                                                  \
-	if (g_sem_pool[handle].is_used == SEM_UNUSED)                                                  \
+	if (SEM_HANDLE_TO_POINTER(handle)->is_used == SEM_UNUSED)                                      \
 	return ZK_ERR_STATE
 
 void sem_init(void)
@@ -24,26 +27,18 @@ void sem_init(void)
 	{
 		g_sem_pool[i].count = 0;
 		g_sem_pool[i].is_used = SEM_UNUSED;
+#if ZK_USING_QUEUE_SET
+		g_sem_pool[i].queue_set = QUEUE_SET_NONE;
+#endif
 		zk_list_init(&g_sem_pool[i].wait_list);
 	}
-}
-
-static zk_error_code_t get_sem_resource(zk_uint32 *sem_handle)
-{
-	for (zk_uint32 i = 0; i < SEM_MAX_NUM; i++)
-	{
-		if (g_sem_pool[i].is_used == SEM_UNUSED)
-		{
-			*sem_handle = i;
-			return ZK_SUCCESS;
-		}
-	}
-	return ZK_ERR_RESOURCE_UNAVAILABLE;
+	zk_handle_pool_init(&g_sem_handles);
 }
 
 zk_error_code_t sem_create(zk_uint32 *sem_handle, zk_uint32 initial_count)
 {
 	zk_error_code_t ret = ZK_SUCCESS;
+	semaphore_t *sem = ZK_NULL;
 
 	ZK_ASSERT_NULL_POINTER(sem_handle);
 
@@ -54,15 +49,19 @@ zk_error_code_t sem_create(zk_uint32 *sem_handle, zk_uint32 initial_count)
 
 	ZK_ENTER_CRITICAL();
 
-	ret = get_sem_resource(sem_handle);
+	ret = zk_handle_alloc(&g_sem_handles, sem_handle);
 	if (ret != ZK_SUCCESS)
 	{
 		goto sem_create_exit;
 	}
 
-	g_sem_pool[*sem_handle].count = initial_count;
-	g_sem_pool[*sem_handle].is_used = SEM_USED;
-	zk_list_init(&g_sem_pool[*sem_handle].wait_list);
+	sem = SEM_HANDLE_TO_POINTER(*sem_handle);
+	sem->count = initial_count;
+#if ZK_USING_QUEUE_SET
+	sem->queue_set = QUEUE_SET_NONE;
+#endif
+	sem->is_used = SEM_USED;
+	zk_list_init(&sem->wait_list);
 
 sem_create_exit:
 	ZK_EXIT_CRITICAL();
@@ -78,6 +77,7 @@ static zk_error_code_t sem_get_internal(zk_uint32 sem_handle, block_type_t block
 
 	CHECK_SEM_HANDLE_VALID(sem_handle);
 	CHECK_SEM_CREATED(sem_handle);
+	ZK_TRACE(ZK_TRACE_EV_SEM_GET, sem_handle, timeout);
 
 	ZK_ENTER_CRITICAL();
 
@@ -133,6 +133,28 @@ zk_error_code_t sem_get_timeout(zk_uint32 sem_handle, zk_uint32 timeout)
 	return sem_get_internal(sem_handle, BLOCK_TYPE_TIMEOUT, timeout);
 }
 
+#if ZK_USING_TIME64
+/**
+ * @brief Get semaphore, waiting at most until an absolute 64-bit tick
+ * @param sem_handle Semaphore handle
+ * @param deadline Tick from get_current_time64()
+ * @return zk_error_code_t ZK_SUCCESS if taken, ZK_ERR_TIMEOUT once the deadline is reached
+ */
+zk_error_code_t sem_get_until64(zk_uint32 sem_handle, zk_uint64 deadline)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 timeout = 0;
+
+	do
+	{
+		timeout = zk_timeout_until64(deadline);
+		ret = sem_get_internal(sem_handle, BLOCK_TYPE_TIMEOUT, timeout);
+	} while (ret == ZK_ERR_TIMEOUT);
+
+	return (ret == ZK_ERR_FAILED && timeout == ZK_TIMEOUT_NONE) ? ZK_ERR_TIMEOUT : ret;
+}
+#endif
+
 zk_error_code_t sem_release(zk_uint32 sem_handle)
 {
 	zk_error_code_t ret = ZK_SUCCESS;
@@ -141,6 +163,7 @@ zk_error_code_t sem_release(zk_uint32 sem_handle)
 
 	CHECK_SEM_HANDLE_VALID(sem_handle);
 	CHECK_SEM_CREATED(sem_handle);
+	ZK_TRACE(ZK_TRACE_EV_SEM_RELEASE, sem_handle, 0);
 
 	ZK_ENTER_CRITICAL();
 	sem = SEM_HANDLE_TO_POINTER(sem_handle);
@@ -161,6 +184,13 @@ zk_error_code_t sem_release(zk_uint32 sem_handle)
 	else
 	{
 		sem->count++;
+#if ZK_USING_QUEUE_SET
+		if (sem->queue_set != QUEUE_SET_NONE &&
+			queue_set_post(sem->queue_set, QUEUE_SET_MEMBER_SEM(sem_handle)) != ZK_NULL)
+		{
+			schedule();
+		}
+#endif
 	}
 
 sem_release_exit:
@@ -168,6 +198,258 @@ sem_release_exit:
 	return ret;
 }
 
+/**
+ * @brief ready up to n tasks from the head of a semaphore wait list
+ * @param sem semaphore
+ * @param n maximum number of tasks to wake
+ * @return zk_uint32 number of tasks woken
+ * @note called within critical section; the list is priority sorted, so the n highest
+ *       priority waiters are the ones woken
+ */
+static zk_uint32 sem_wakeup_n(semaphore_t *sem, zk_uint32 n)
+{
+	task_control_block_t *wakeup_task = ZK_NULL;
+	zk_uint32 woken = 0;
+
+	while (woken < n && !zk_list_is_empty(&sem->wait_list))
+	{
+		wakeup_task =
+			ZK_LIST_GET_FIRST_ENTRY(&sem->wait_list, task_control_block_t, event_sleep_list);
+		task_block_to_ready(wakeup_task);
+		woken++;
+	}
+	return woken;
+}
+
+/**
+ * @brief Release n units in one critical section
+ * @param sem_handle Semaphore handle
+ * @param n Units to release
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_SYNC_INVALID if the units left after handing
+ *         one to each waiter would overflow the count (nothing is released then)
+ * @note Equivalent to n sem_release() calls: up to n waiters are woken, the rest is added
+ *       to the count, and schedule() runs once at the end
+ */
+zk_error_code_t sem_release_n(zk_uint32 sem_handle, zk_uint32 n)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	semaphore_t *sem = ZK_NULL;
+	zk_uint32 woken = 0;
+	zk_uint32 waiting = 0;
+	zk_list_node_t *pos = ZK_NULL;
+
+	CHECK_SEM_HANDLE_VALID(sem_handle);
+	CHECK_SEM_CREATED(sem_handle);
+	ZK_TRACE(ZK_TRACE_EV_SEM_RELEASE, sem_handle, 0);
+
+	if (n == 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	ZK_ENTER_CRITICAL();
+	sem = SEM_HANDLE_TO_POINTER(sem_handle);
+
+	ZK_LIST_FOR_EACH_NODE(pos, &sem->wait_list)
+	{
+		if (++waiting == n)
+		{
+			break;
+		}
+	}
+	if (n - waiting > SEM_COUNT_MAX - sem->count)
+	{
+		ret = ZK_ERR_SYNC_INVALID;
+		goto sem_release_n_exit;
+	}
+
+	woken = sem_wakeup_n(sem, n);
+	n -= woken;
+	sem->count += n;
+#if ZK_USING_QUEUE_SET
+	while (sem->queue_set != QUEUE_SET_NONE && n-- > 0)
+	{
+		if (queue_set_post(sem->queue_set, QUEUE_SET_MEMBER_SEM(sem_handle)) != ZK_NULL)
+		{
+			woken++;
+		}
+	}
+#endif
+
+	if (woken > 0)
+	{
+		schedule();
+	}
+
+sem_release_n_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Wake every task currently waiting on the semaphore (broadcast)
+ * @param sem_handle Semaphore handle
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note The count is left unchanged and the woken tasks return ZK_SUCCESS from their
+ *       sem_get() without consuming a unit; schedule() runs once
+ */
+zk_error_code_t sem_flush(zk_uint32 sem_handle)
+{
+	CHECK_SEM_HANDLE_VALID(sem_handle);
+	CHECK_SEM_CREATED(sem_handle);
+	ZK_TRACE(ZK_TRACE_EV_SEM_RELEASE, sem_handle, 0);
+
+	ZK_ENTER_CRITICAL();
+	if (sem_wakeup_n(SEM_HANDLE_TO_POINTER(sem_handle), SEM_COUNT_MAX) > 0)
+	{
+		schedule();
+	}
+	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Release semaphore from interrupt context (never blocks, never schedules)
+ * @param sem_handle Semaphore handle
+ * @param higher_priority_woken Set to ZK_TRUE if a task above the interrupted one was woken
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Finish the ISR with zk_yield_from_isr(higher_priority_woken)
+ */
+zk_error_code_t sem_release_from_isr(zk_uint32 sem_handle, zk_bool *higher_priority_woken)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	semaphore_t *sem = ZK_NULL;
+	task_control_block_t *wakeup_task = ZK_NULL;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	CHECK_SEM_HANDLE_VALID(sem_handle);
+	CHECK_SEM_CREATED(sem_handle);
+	ZK_TRACE(ZK_TRACE_EV_SEM_RELEASE, sem_handle, ZK_TRACE_ARG_FROM_ISR);
+
+	ZK_ENTER_CRITICAL();
+	sem = SEM_HANDLE_TO_POINTER(sem_handle);
+
+	if (sem->count == SEM_COUNT_MAX)
+	{
+		ret = ZK_ERR_SYNC_INVALID;
+		goto sem_release_from_isr_exit;
+	}
+
+	if (!zk_list_is_empty(&sem->wait_list))
+	{
+		wakeup_task =
+			ZK_LIST_GET_FIRST_ENTRY(&sem->wait_list, task_control_block_t, event_sleep_list);
+		task_block_to_ready(wakeup_task);
+		zk_isr_note_woken(wakeup_task, higher_priority_woken);
+	}
+	else
+	{
+		sem->count++;
+#if ZK_USING_QUEUE_SET
+		if (sem->queue_set != QUEUE_SET_NONE)
+		{
+			zk_isr_note_woken(queue_set_post(sem->queue_set, QUEUE_SET_MEMBER_SEM(sem_handle)),
+							  higher_priority_woken);
+		}
+#endif
+	}
+
+sem_release_from_isr_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Take semaphore from interrupt context without blocking
+ * @param sem_handle Semaphore handle
+ * @return zk_error_code_t ZK_SUCCESS if taken, ZK_ERR_FAILED if count is zero
+ */
+zk_error_code_t sem_try_get_from_isr(zk_uint32 sem_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	semaphore_t *sem = ZK_NULL;
+
+	ZK_ASSERT_ISR_PRIORITY();
+	CHECK_SEM_HANDLE_VALID(sem_handle);
+	CHECK_SEM_CREATED(sem_handle);
+
+	ZK_ENTER_CRITICAL();
+	sem = SEM_HANDLE_TO_POINTER(sem_handle);
+
+	if (sem->count > 0)
+	{
+		sem->count--;
+	}
+	else
+	{
+		ret = ZK_ERR_FAILED;
+	}
+
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+#if ZK_USING_QUEUE_SET
+/**
+ * @brief Attach a semaphore to a queue set
+ * @param sem_handle Semaphore handle
+ * @param set_handle Queue set handle
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE if the count is not zero or the
+ *         semaphore already belongs to a set
+ * @note A zero count keeps the set in step: every id in it stands for one available token
+ */
+zk_error_code_t sem_join_queue_set(zk_uint32 sem_handle, zk_uint32 set_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	semaphore_t *sem = ZK_NULL;
+
+	CHECK_SEM_HANDLE_VALID(sem_handle);
+	CHECK_SEM_CREATED(sem_handle);
+
+	ZK_ENTER_CRITICAL();
+	sem = SEM_HANDLE_TO_POINTER(sem_handle);
+	if (sem->count != 0 || sem->queue_set != QUEUE_SET_NONE)
+	{
+		ret = ZK_ERR_STATE;
+		goto sem_join_queue_set_exit;
+	}
+	sem->queue_set = set_handle;
+
+sem_join_queue_set_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Detach a semaphore from its queue set
+ * @param sem_handle Semaphore handle
+ * @param set_handle Queue set the semaphore must belong to
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE if the count is not zero or the
+ *         semaphore is not in this set
+ */
+zk_error_code_t sem_leave_queue_set(zk_uint32 sem_handle, zk_uint32 set_handle)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	semaphore_t *sem = ZK_NULL;
+
+	CHECK_SEM_HANDLE_VALID(sem_handle);
+	CHECK_SEM_CREATED(sem_handle);
+
+	ZK_ENTER_CRITICAL();
+	sem = SEM_HANDLE_TO_POINTER(sem_handle);
+	if (sem->count != 0 || sem->queue_set != set_handle)
+	{
+		ret = ZK_ERR_STATE;
+		goto sem_leave_queue_set_exit;
+	}
+	sem->queue_set = QUEUE_SET_NONE;
+
+sem_leave_queue_set_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+#endif
+
 zk_error_code_t sem_destroy(zk_uint32 sem_handle)
 {
 	zk_error_code_t ret = ZK_SUCCESS;
@@ -179,6 +461,12 @@ zk_error_code_t sem_destroy(zk_uint32 sem_handle)
 
 	ZK_ENTER_CRITICAL();
 	sem = SEM_HANDLE_TO_POINTER(sem_handle);
+	/* a concurrent destroy may have retired the handle since the unlocked check */
+	if (!zk_handle_is_valid(&g_sem_handles, sem_handle) || sem->is_used == SEM_UNUSED)
+	{
+		ret = ZK_ERR_STATE;
+		goto sem_destroy_exit;
+	}
 
 	while (!zk_list_is_empty(&sem->wait_list))
 	{
@@ -188,9 +476,17 @@ zk_error_code_t sem_destroy(zk_uint32 sem_handle)
 	}
 
 	sem->count = 0;
+#if ZK_USING_QUEUE_SET
+	sem->queue_set = QUEUE_SET_NONE;
+#endif
 	sem->is_used = SEM_UNUSED;
+	zk_handle_free(&g_sem_handles, sem_handle);
 
 	schedule();
+
+sem_destroy_exit:
 	ZK_EXIT_CRITICAL();
 	return ret;
 }
+
+#endif /* ZK_USING_SEMAPHORE */
@@ -0,0 +1,109 @@
+/**
+ * @file    zk_string.c
+ * @brief   word and burst paths of zk_memcpy / zk_memset
+ * @note    zk_def.h handles sizes below ZK_MEM_INLINE_MAX inline and calls here for the
+ *          rest. Blocks move four words per iteration, which ARMCC and GCC turn into one
+ *          LDM/STM pair on Cortex-M. Kept out of line so the word accesses never alias
+ *          the caller's typed objects under inlining.
+ */
+
+#include "zk_def.h"
+
+#define ZK_MEM_WORD_MASK (sizeof(zk_uint32) - 1)
+#define ZK_MEM_BURST_BYTES (4 * sizeof(zk_uint32))
+
+/**
+ * @brief Copy size bytes, by words when both pointers share their word alignment
+ * @param dest destination, must not overlap src
+ * @param src source
+ * @param size bytes to copy
+ * @note Pointers with different alignment stay on the byte loop: LDM/STM cannot access
+ *       unaligned words, and single unaligned LDR/STR would trap if UNALIGN_TRP is set.
+ */
+void zk_memcpy_block(void *dest, const void *src, zk_uint32 size)
+{
+	zk_uint8 *dest_addr = (zk_uint8 *) dest;
+	const zk_uint8 *src_addr = (const zk_uint8 *) src;
+	zk_uint32 *dest_word = ZK_NULL;
+	const zk_uint32 *src_word = ZK_NULL;
+	zk_uint32 w0 = 0, w1 = 0, w2 = 0, w3 = 0;
+
+	if ((((zk_uint32) dest_addr ^ (zk_uint32) src_addr) & ZK_MEM_WORD_MASK) == 0)
+	{
+		while (((zk_uint32) dest_addr & ZK_MEM_WORD_MASK) != 0 && size > 0)
+		{
+			*dest_addr++ = *src_addr++;
+			size--;
+		}
+
+		dest_word = (zk_uint32 *) dest_addr;
+		src_word = (const zk_uint32 *) src_addr;
+		while (size >= ZK_MEM_BURST_BYTES)
+		{
+			w0 = src_word[0];
+			w1 = src_word[1];
+			w2 = src_word[2];
+			w3 = src_word[3];
+			dest_word[0] = w0;
+			dest_word[1] = w1;
+			dest_word[2] = w2;
+			dest_word[3] = w3;
+			src_word += 4;
+			dest_word += 4;
+			size -= ZK_MEM_BURST_BYTES;
+		}
+		while (size >= sizeof(zk_uint32))
+		{
+			*dest_word++ = *src_word++;
+			size -= sizeof(zk_uint32);
+		}
+		dest_addr = (zk_uint8 *) dest_word;
+		src_addr = (const zk_uint8 *) src_word;
+	}
+
+	while (size-- > 0)
+	{
+		*dest_addr++ = *src_addr++;
+	}
+}
+
+/**
+ * @brief Fill size bytes with data, by words once the destination is aligned
+ * @param addr destination
+ * @param data fill byte
+ * @param size bytes to fill
+ */
+void zk_memset_block(void *addr, zk_uint8 data, zk_uint32 size)
+{
+	zk_uint8 *base_addr = (zk_uint8 *) addr;
+	zk_uint32 *word_addr = ZK_NULL;
+	zk_uint32 word = (zk_uint32) data * 0x01010101UL;
+
+	while (((zk_uint32) base_addr & ZK_MEM_WORD_MASK) != 0 && size > 0)
+	{
+		*base_addr++ = data;
+		size--;
+	}
+
+	word_addr = (zk_uint32 *) base_addr;
+	while (size >= ZK_MEM_BURST_BYTES)
+	{
+		word_addr[0] = word;
+		word_addr[1] = word;
+		word_addr[2] = word;
+		word_addr[3] = word;
+		word_addr += 4;
+		size -= ZK_MEM_BURST_BYTES;
+	}
+	while (size >= sizeof(zk_uint32))
+	{
+		*word_addr++ = word;
+		size -= sizeof(zk_uint32);
+	}
+
+	base_addr = (zk_uint8 *) word_addr;
+	while (size-- > 0)
+	{
+		*base_addr++ = data;
+	}
+}
@@ -3,8 +3,11 @@
  * @brief   ZK-RTOS task management module
  */
 
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_SCHED
+
+#include "zk_rtos.h"
 #include "zk_internal.h"
-#ifdef ZK_USING_HOOK
+#if ZK_USING_HOOK
 #include "zk_hook.h"
 #endif
 
@@ -12,48 +15,154 @@ extern task_scheduler_t g_scheduler;
 
 task_control_block_t *volatile g_current_tcb = ZK_NULL;
 task_control_block_t *volatile g_switch_next_tcb = ZK_NULL;
+#if ZK_USING_PERF_COUNTERS
+volatile zk_perf_counters_t g_zk_perf_counters = {
+	.magic = ZK_PERF_COUNTERS_MAGIC,
+	.version = ZK_PERF_COUNTERS_VERSION,
+	.size = (zk_uint16) sizeof(zk_perf_counters_t),
+};
+/* The PendSV handlers hard-code this offset */
+typedef char
+	zk_perf_switch_offset_check[(offsetof(zk_perf_counters_t, context_switches) == 8) ? 1 : -1];
+#endif
 static zk_uint32 g_idle_task_handle = 0;
 
-zk_error_code_t task_create(task_init_parameter_t *parameter, zk_uint32 *task_handle)
-{
-	zk_error_code_t ret = ZK_SUCCESS;
-	task_control_block_t *tcb = ZK_NULL;
-	void *stack_mem = ZK_NULL;
+/* Idle task lives in static storage so that startup does no heap work */
+static task_control_block_t g_idle_task_tcb;
+static zk_uint32 g_idle_task_stack[IDLE_TASK_STACK_SIZE / sizeof(zk_uint32)];
 
-	ZK_ASSERT_NULL_POINTER(parameter);
-	ZK_ASSERT_NULL_POINTER(task_handle);
+/* Deleted tasks whose TCB and stack the idle task still has to free */
+static zk_list_node_t g_task_delete_list = {&g_task_delete_list, &g_task_delete_list};
 
-	ZK_ASSERT_PARAM(parameter->priority <= MIN_TASK_PRIORITY);
+#if ZK_USING_TASK_LIST
+/* Every task not yet deleted */
+static zk_list_node_t g_task_list = {&g_task_list, &g_task_list};
+#endif
 
-	tcb = (task_control_block_t *) mem_alloc(sizeof(task_control_block_t));
-	if (tcb == ZK_NULL)
-	{
-		return ZK_ERR_NOT_ENOUGH_MEMORY;
-	}
+#if ZK_USING_STACK_WATCH
+/* Where the idle watch stopped */
+static zk_list_node_t *g_stack_watch_node = &g_task_list;
+static zk_uint32 g_stack_watch_word = 0;
+#endif
 
-	stack_mem = mem_alloc(parameter->stack_size);
-	if (stack_mem == ZK_NULL)
+#if ZK_USING_TASK_MONITOR
+/* Next entry of the snapshot in progress, and the system time of the previous one */
+static zk_list_node_t *g_monitor_node = &g_task_list;
+static zk_uint8 g_monitor_busy = 0;
+static zk_uint64 g_monitor_total_time = 0;
+#endif
+
+/**
+ * @brief Fill a new stack with the boundary pattern, a word at a time
+ * @param stack_mem Word aligned stack storage
+ * @param size Stack size in bytes
+ */
+static void task_fill_stack(void *stack_mem, zk_uint32 size)
+{
+	zk_uint32 *word = (zk_uint32 *) stack_mem;
+	zk_uint32 count = size / sizeof(zk_uint32);
+
+	while (count-- > 0)
 	{
-		mem_free(tcb);
-		return ZK_ERR_NOT_ENOUGH_MEMORY;
+		*word++ = TASK_STACK_BOUNDARY;
 	}
+	zk_memset(word, TASK_MAGIC_NUMBER, size & (sizeof(zk_uint32) - 1));
+}
 
-	zk_memset(stack_mem, TASK_MAGIC_NUMBER, parameter->stack_size);
+/**
+ * @brief Initialize a TCB over the given stack and make the task ready
+ * @param parameter task init parameter
+ * @param tcb task control block storage
+ * @param stack_mem stack storage of parameter->stack_size bytes
+ * @param static_alloc ZK_TRUE if tcb and stack_mem belong to the caller
+ * @param task_handle task handle (output parameter)
+ */
+static void task_init_tcb(task_init_parameter_t *parameter, task_control_block_t *tcb,
+						  void *stack_mem, zk_uint8 static_alloc, zk_uint32 *task_handle)
+{
+	task_fill_stack(stack_mem, parameter->stack_size);
 
 	tcb->base_priority = parameter->priority;
 	tcb->priority = parameter->priority;
+#if ZK_USING_EDF
+	tcb->edf_period = parameter->edf_period;
+	tcb->edf_relative_deadline =
+		(parameter->edf_deadline != 0) ? parameter->edf_deadline : parameter->edf_period;
+	tcb->edf_release = get_current_time();
+	tcb->edf_deadline = tcb->edf_release + tcb->edf_relative_deadline;
+	tcb->edf_jobs = 0;
+	tcb->edf_misses = 0;
+	if (tcb->edf_period != 0)
+	{
+		tcb->base_priority = ZK_EDF_PRIORITY;
+		tcb->priority = ZK_EDF_PRIORITY;
+	}
+#endif
+#if ZK_USING_BUDGET
+	tcb->budget = (parameter->budget_period != 0) ? parameter->budget : 0;
+	tcb->budget_period = parameter->budget_period;
+	tcb->budget_left = tcb->budget;
+	tcb->budget_replenish_time = get_current_time() + tcb->budget_period;
+	tcb->budget_overruns = 0;
+	zk_list_init(&tcb->budget_node);
+	tcb->budget_priority = tcb->base_priority;
+	tcb->budget_demoted = 0;
+#endif
+#if ZK_USING_PREEMPT_THRESHOLD
+	tcb->preempt_threshold = (parameter->preempt_threshold != 0 &&
+							  parameter->preempt_threshold < tcb->base_priority)
+								 ? parameter->preempt_threshold
+								 : tcb->base_priority;
+	zk_list_init(&tcb->threshold_node);
+#endif
 	zk_memcpy(tcb->task_name, parameter->name, CONFIG_TASK_NAME_LEN);
 	tcb->task_name[CONFIG_TASK_NAME_LEN - 1] = ZK_STRING_TERMINATOR;
 
 	tcb->stack_base = stack_mem;
 	tcb->stack_size = parameter->stack_size;
+	tcb->stack_unused = parameter->stack_size & ~(sizeof(zk_uint32) - 1);
+	tcb->static_alloc = static_alloc;
+
+#if ZK_USING_TASK_NOTIFY
+	tcb->notify_value = 0;
+	tcb->notify_state = TASK_NOTIFY_NONE;
+#endif
+#if ZK_USING_ARENA
+	tcb->arena = ZK_NULL;
+#endif
+#if ZK_USING_HEARTBEAT
+	tcb->heartbeat_period = 0;
+	tcb->heartbeat_deadline = 0;
+	zk_list_init(&tcb->heartbeat_node);
+	tcb->heartbeat_missed = 0;
+#endif
+#if ZK_USING_WAIT_INDEX
+	tcb->wait_index = ZK_NULL;
+#endif
 
 	tcb->run_time_ticks = 0;
 	tcb->last_switch_in_time = 0;
+#if ZK_TASK_STATS_CYCLES
+	tcb->switch_in_cycles = 0;
+	tcb->run_cycles = 0;
+#endif
+#if (ZK_TASK_STATS_MODE == 3)
+	tcb->switch_in_isr_cycles = 0;
+	tcb->burst_count = 0;
+	tcb->burst_min = 0xFFFFFFFFUL;
+	tcb->burst_max = 0;
+#endif
+
+	tcb->time_slice =
+		(parameter->time_slice != 0) ? parameter->time_slice : SCHEDULE_TIME_SLICE_INIT_VALUE;
+	tcb->time_slice_left = tcb->time_slice;
 
-#ifdef ZK_USING_MUTEX
+#if ZK_USING_MUTEX
 	tcb->holding_mutex = ZK_NULL;
 #endif
+#if ZK_USING_QUEUE
+	tcb->queue_transfer = ZK_NULL;
+#endif
 
 	tcb->stack = zk_arch_prepare_stack(stack_mem, parameter);
 	tcb->state = TASK_UNKNOWN;
@@ -61,11 +170,73 @@ zk_error_code_t task_create(task_init_parameter_t *parameter, zk_uint32 *task_ha
 
 	ZK_ENTER_CRITICAL();
 
+#if ZK_USING_TASK_MONITOR
+	tcb->wait_list = ZK_NULL;
+	tcb->monitor_run_time = 0;
+#endif
+#if ZK_USING_TASK_LIST
+	zk_list_add_before(&tcb->task_node, &g_task_list);
+#endif
 	add_task_to_ready_list(tcb);
 
 	*task_handle = (zk_uint32) tcb;
 
 	ZK_EXIT_CRITICAL();
+}
+
+zk_error_code_t task_create(task_init_parameter_t *parameter, zk_uint32 *task_handle)
+{
+	task_control_block_t *tcb = ZK_NULL;
+	void *stack_mem = ZK_NULL;
+
+	ZK_ASSERT_NULL_POINTER(parameter);
+	ZK_ASSERT_NULL_POINTER(task_handle);
+
+	ZK_ASSERT_PARAM(parameter->priority <= MIN_TASK_PRIORITY);
+
+	tcb = (task_control_block_t *) mem_alloc_region(ZK_TASK_MEM_CAPS,
+													 sizeof(task_control_block_t));
+	if (tcb == ZK_NULL)
+	{
+		return ZK_ERR_NOT_ENOUGH_MEMORY;
+	}
+
+	stack_mem = mem_alloc_region(ZK_TASK_MEM_CAPS, parameter->stack_size);
+	if (stack_mem == ZK_NULL)
+	{
+		mem_free(tcb);
+		return ZK_ERR_NOT_ENOUGH_MEMORY;
+	}
+
+	task_init_tcb(parameter, tcb, stack_mem, ZK_FALSE, task_handle);
+
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Create a task over caller-provided TCB and stack storage
+ * @param parameter task init parameter, stack_size is the size of stack_buffer in bytes
+ * @param tcb TCB storage, must stay valid for the lifetime of the task
+ * @param stack_buffer stack storage, word aligned (the stack top is 8-byte aligned by the port)
+ * @param task_handle task handle (output parameter)
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note No heap work is done, so the whole system can be laid out at link time
+ */
+zk_error_code_t task_create_static(task_init_parameter_t *parameter, task_control_block_t *tcb,
+								   void *stack_buffer, zk_uint32 *task_handle)
+{
+	ZK_CHECK_PARAM_NOT_NULL(parameter);
+	ZK_CHECK_PARAM_NOT_NULL(tcb);
+	ZK_CHECK_PARAM_NOT_NULL(stack_buffer);
+	ZK_CHECK_PARAM_NOT_NULL(task_handle);
+
+	if (parameter->priority > MIN_TASK_PRIORITY || parameter->stack_size == 0 ||
+		((zk_uint32) stack_buffer & (sizeof(zk_uint32) - 1)) != 0)
+	{
+		return ZK_ERR_INVALID_PARAM;
+	}
+
+	task_init_tcb(parameter, tcb, stack_buffer, ZK_TRUE, task_handle);
 
 	return ZK_SUCCESS;
 }
@@ -74,15 +245,22 @@ zk_error_code_t task_create(task_init_parameter_t *parameter, zk_uint32 *task_ha
 /**
  * @brief Get the highest priority ready task
  * @return TCB pointer of the highest priority task
- * @note Optimization: uses CLZ instruction for O(1) time complexity (optimized from O(n))
+ * @note Optimization: uses CLZ instruction for O(1) time complexity (optimized from O(n)).
+ *       Above 32 priorities a second CLZ on the group word picks the word first.
  */
 task_control_block_t *get_highest_priority_task(void)
 {
 	task_control_block_t *highest_ready_tcb = ZK_NULL;
 
 	/* 使用CLZ硬件指令快速查找最高优先级 */
+#if ZK_PRIORITY_TWO_LEVEL
+	zk_uint8 group = zk_cpu_clz(g_scheduler.priority_group);
+	zk_uint8 highest_priority = (zk_uint8) (group * ZK_PRIORITY_WORD_BITS) +
+								zk_cpu_clz(g_scheduler.priority_active[group]);
+#else
 	zk_uint8 leading_zeros = zk_cpu_clz(g_scheduler.priority_active);
 	zk_uint8 highest_priority = leading_zeros;
+#endif
 
 	highest_ready_tcb = ZK_LIST_GET_FIRST_ENTRY(&g_scheduler.ready_list[highest_priority],
 												task_control_block_t, state_node);
@@ -91,190 +269,983 @@ task_control_block_t *get_highest_priority_task(void)
 }
 
 
+/**
+ * @brief Free the memory of deleted tasks, one task per call
+ * @note Runs in the idle task, so a task that deleted itself has been switched out for good
+ */
+static void task_reclaim_deleted(void)
+{
+	task_control_block_t *tcb = ZK_NULL;
+
+	ZK_ENTER_CRITICAL();
+	if (!zk_list_is_empty(&g_task_delete_list))
+	{
+		tcb = ZK_LIST_GET_FIRST_ENTRY(&g_task_delete_list, task_control_block_t, state_node);
+		zk_list_delete(&tcb->state_node);
+	}
+	ZK_EXIT_CRITICAL();
+
+	if (tcb == ZK_NULL)
+	{
+		return;
+	}
+	zk_arch_release_stack(tcb->stack);
+	if (!tcb->static_alloc)
+	{
+		mem_free(tcb->stack_base);
+		mem_free(tcb);
+	}
+}
+
 void idle_task(void *parameter)
 {
 	// Idle task runs when no other tasks are ready
 	// Parameter is unused
 	while (1)
 	{
-#ifdef ZK_USING_HOOK
+#if ZK_USING_HOOK
 		/* 调用空闲任务钩子 */
 		zk_hook_call_idle();
 #endif
-		// In actual implementation, this would typically include
-		// low power mode handling or background resource reclamation
+		task_reclaim_deleted();
+#if ZK_USING_STACK_WATCH
+		task_stack_watch_step();
+#endif
+#if ZK_USING_PM
+		pm_idle(scheduler_get_expected_idle_ticks());
+#elif ZK_USING_TICKLESS
+		{
+			zk_uint32 idle_ticks = scheduler_get_expected_idle_ticks();
+			if (idle_ticks >= ZK_TICKLESS_MIN_IDLE_TICKS)
+			{
+				zk_cpu_tickless_sleep(idle_ticks);
+			}
+		}
+#endif
 	}
 }
 void idle_task_create(void)
 {
-	task_init_parameter_t *parameter =
-		(task_init_parameter_t *) mem_alloc(sizeof(task_init_parameter_t));
-	ZK_ASSERT_NULL_POINTER(parameter);
+	task_init_parameter_t parameter;
 
-	parameter->name[0] = 'I';
-	parameter->name[1] = 'D';
-	parameter->name[2] = 'L';
-	parameter->name[3] = 'E';
-	parameter->name[4] = ZK_STRING_TERMINATOR;
+	zk_memclear(&parameter, sizeof(task_init_parameter_t));
+	parameter.name[0] = 'I';
+	parameter.name[1] = 'D';
+	parameter.name[2] = 'L';
+	parameter.name[3] = 'E';
+	parameter.name[4] = ZK_STRING_TERMINATOR;
 	// Idle task has lowest priority
-	parameter->priority = IDLE_TASK_PRIO;
-	parameter->private_data = ZK_NULL;
-	parameter->stack_size = IDLE_TASK_STACK_SIZE;
-	parameter->task_entry = idle_task;
-	task_create(parameter, &g_idle_task_handle);
-	mem_free(parameter);
+	parameter.priority = IDLE_TASK_PRIO;
+	parameter.private_data = ZK_NULL;
+	parameter.stack_size = sizeof(g_idle_task_stack);
+	parameter.task_entry = idle_task;
+	task_create_static(&parameter, &g_idle_task_tcb, g_idle_task_stack, &g_idle_task_handle);
 }
 
-zk_error_code_t task_delay(zk_uint32 delay_time)
+/**
+ * @brief Take a task off the ready, delay, block or suspend list it is on
+ * @param tcb Task control block
+ * @note A task pulled out of an IPC wait sees it as a timeout when it runs again
+ */
+static void task_remove_from_state_list(task_control_block_t *tcb)
+{
+	switch (tcb->state)
+	{
+	case TASK_READY:
+		remove_task_from_ready_list(tcb);
+#if ZK_USING_PREEMPT_THRESHOLD
+		zk_list_delete(&tcb->threshold_node);
+		zk_list_init(&tcb->threshold_node);
+#endif
+		break;
+	case TASK_DELAY:
+		remove_task_from_delay_list(tcb);
+		break;
+	case TASK_SUSPEND:
+		remove_task_from_suspend_list(tcb);
+		break;
+	case TASK_ENDLESS_BLOCKED:
+	case TASK_TIMEOUT_BLOCKED:
+		remove_task_from_blocked_list(tcb);
+		tcb->event_timeout_wakeup = EVENT_WAIT_TIMEOUT;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Suspend a task until task_resume()
+ * @param task_handle task handle, 0 for the calling task
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_STATE if the task is already suspended
+ *         or suspends itself while the scheduler is suspended
+ * @note A delayed or blocked task leaves its wait; the interrupted call returns ZK_ERR_TIMEOUT
+ *       after the resume. The idle task cannot be suspended.
+ */
+zk_error_code_t task_suspend(zk_uint32 task_handle)
 {
 	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *tcb = ZK_NULL;
+
 	ZK_ENTER_CRITICAL();
-	if (is_scheduler_suspending())
+	tcb = (task_handle == 0) ? g_current_tcb : TASK_HANDLE_TO_TCB(task_handle);
+	if (tcb == &g_idle_task_tcb)
+	{
+		ret = ZK_ERR_INVALID_PARAM;
+		goto task_suspend_exit;
+	}
+	if (tcb->state == TASK_SUSPEND || tcb->state == TASK_DELETED ||
+		(tcb == g_current_tcb && is_scheduler_suspending()))
 	{
 		ret = ZK_ERR_STATE;
-		goto task_delay_exit;
+		goto task_suspend_exit;
 	}
 
-	ZK_ASSERT_PARAM((delay_time > 0) && (delay_time < ZK_TSK_DLY_MAX));
-	g_current_tcb->wake_up_time = get_current_time() + delay_time;
-	task_ready_to_delay(g_current_tcb);
-	schedule();
+	ZK_TRACE(ZK_TRACE_EV_SUSPEND, tcb, 0);
+	task_remove_from_state_list(tcb);
+	add_task_to_suspend_list(tcb);
+	if (tcb == g_current_tcb)
+	{
+		schedule();
+	}
 
-task_delay_exit:
+task_suspend_exit:
 	ZK_EXIT_CRITICAL();
 	return ret;
 }
 
-void task_change_priority_temp(task_control_block_t *tcb, zk_uint8 new_priority)
+/**
+ * @brief Make a suspended task ready again
+ * @param task_handle task handle
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_STATE if the task is not suspended
+ */
+zk_error_code_t task_resume(zk_uint32 task_handle)
 {
-	tcb->priority = new_priority;
-	if (tcb->state == TASK_READY)
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *tcb = TASK_HANDLE_TO_TCB(task_handle);
+
+	if (task_handle == 0)
 	{
-		remove_task_from_ready_list(tcb);
-		add_task_to_ready_list(tcb);
+		return ZK_ERR_INVALID_HANDLE;
 	}
-}
 
-void task_resume_priority(task_control_block_t *tcb)
-{
-	tcb->priority = tcb->base_priority;
-	if (tcb->state == TASK_READY)
+	ZK_ENTER_CRITICAL();
+	if (tcb->state != TASK_SUSPEND)
 	{
-		remove_task_from_ready_list(tcb);
-		add_task_to_ready_list(tcb);
+		ret = ZK_ERR_STATE;
+		goto task_resume_exit;
 	}
+
+	task_suspend_to_ready(tcb);
+	schedule();
+
+task_resume_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
 }
 
 /**
- * @brief   Check if task stack has overflowed
- * @param   tcb Task control block pointer
- * @return  ZK_TRUE: stack overflow, ZK_FALSE: normal
+ * @brief Delete a task
+ * @param task_handle task handle, 0 for the calling task (does not return then)
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_STATE if the task holds a mutex or
+ *         a write lock, or deletes itself while the scheduler is suspended or from an ISR
+ * @note The task leaves every kernel list at once but stays on the delete list until the
+ *       idle task reclaims it: the TCB and stack of a task_create() task are freed then, and
+ *       static storage may only be reused after that. The handle must not be used again.
+ *       The idle task cannot be deleted.
  */
-zk_bool task_check_stack_overflow(task_control_block_t *tcb)
+zk_error_code_t task_delete(zk_uint32 task_handle)
 {
-	zk_uint8 *stack_bottom = (zk_uint8 *) tcb->stack_base;
-	zk_uint32 check_size = 16;
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *tcb = ZK_NULL;
 
-	if (check_size > tcb->stack_size)
+	ZK_ENTER_CRITICAL();
+	tcb = (task_handle == 0) ? g_current_tcb : TASK_HANDLE_TO_TCB(task_handle);
+	if (tcb == &g_idle_task_tcb)
 	{
-		check_size = tcb->stack_size;
+		ret = ZK_ERR_INVALID_PARAM;
+		goto task_delete_exit;
+	}
+	/* the interrupted task cannot be switched out for good before the ISR returns */
+	if (tcb->state == TASK_DELETED ||
+		(tcb == g_current_tcb && (is_scheduler_suspending() || zk_cpu_is_in_interrupt())))
+	{
+		ret = ZK_ERR_STATE;
+		goto task_delete_exit;
+	}
+#if ZK_USING_MUTEX
+	/* waiters would be left with a lock nobody can release, or with an owner that was freed */
+	if (tcb->holding_mutex != ZK_NULL || mutex_is_owned_by(tcb))
+	{
+		ret = ZK_ERR_STATE;
+		goto task_delete_exit;
+	}
+#endif
+#if ZK_USING_RWLOCK
+	/* the lock would point at a freed writer */
+	if (rwlock_is_owned_by(tcb))
+	{
+		ret = ZK_ERR_STATE;
+		goto task_delete_exit;
 	}
+#endif
 
-	for (zk_uint32 i = 0; i < check_size; i++)
+	task_remove_from_state_list(tcb);
+#if ZK_USING_BUDGET
+	zk_list_delete(&tcb->budget_node);
+	zk_list_init(&tcb->budget_node);
+#endif
+#if ZK_USING_HEARTBEAT
+	heartbeat_remove(tcb);
+#endif
+#if ZK_USING_STACK_WATCH
+	if (g_stack_watch_node == &tcb->task_node)
 	{
-		if (stack_bottom[i] != TASK_MAGIC_NUMBER)
-		{
-#ifdef ZK_USING_HOOK
-			zk_hook_call_stack_overflow(tcb);
+		g_stack_watch_node = tcb->task_node.next;
+		g_stack_watch_word = ZK_STACK_GUARD_BYTES / sizeof(zk_uint32);
+	}
 #endif
-			return ZK_TRUE;
+#if ZK_USING_TASK_MONITOR
+	if (g_monitor_node == &tcb->task_node)
+	{
+		g_monitor_node = tcb->task_node.next;
+	}
+#endif
+#if ZK_USING_TASK_LIST
+	zk_list_delete(&tcb->task_node);
+#endif
+	zk_list_add_before(&tcb->state_node, &g_task_delete_list);
+	tcb->state = TASK_DELETED;
+
+	if (tcb == g_current_tcb)
+	{
+		schedule();
+		ZK_EXIT_CRITICAL();
+		/* the pending switch never comes back here */
+		for (;;)
+		{
 		}
 	}
 
-	return ZK_FALSE;
+task_delete_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
 }
 
-/**
- * @brief   Calculate task stack usage
- * @param   tcb Task control block pointer
- * @return  Stack usage in bytes
- */
-zk_uint32 task_get_stack_usage(task_control_block_t *tcb)
+zk_error_code_t task_delay(zk_uint32 delay_time)
 {
-	zk_uint8 *stack_ptr = (zk_uint8 *) tcb->stack_base;
-	zk_uint32 unused = 0;
-
-	for (zk_uint32 i = 0; i < tcb->stack_size; i++)
+	zk_error_code_t ret = ZK_SUCCESS;
+	ZK_ENTER_CRITICAL();
+	if (is_scheduler_suspending())
 	{
-		if (stack_ptr[i] == TASK_MAGIC_NUMBER)
-		{
-			unused++;
-		}
-		else
-		{
-			break;
-		}
+		ret = ZK_ERR_STATE;
+		goto task_delay_exit;
 	}
 
-	return tcb->stack_size - unused;
+	ZK_ASSERT_PARAM((delay_time > 0) && (delay_time < ZK_TSK_DLY_MAX));
+	g_current_tcb->wake_up_time = get_current_time() + delay_time;
+	task_ready_to_delay(g_current_tcb);
+	schedule();
+
+task_delay_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
 }
 
 /**
- * @brief   Update task runtime statistics (called during context switch)
- * @param   old_tcb TCB of the task being switched out
- * @param   new_tcb TCB of the task being switched in
+ * @brief Delay the current task until an absolute time, for fixed-rate periodic tasks
+ * @param last_wake_time In: time of the previous wake-up, set it to get_current_time() before
+ *                       the first call. Out: advanced by period
+ * @param period Period in ticks
+ * @return zk_error_code_t ZK_SUCCESS if the task slept, ZK_ERR_TIMEOUT if the new wake-up time
+ *         has already passed (the task overran its period and returns immediately)
+ * @note The wake-up time is derived from the previous one, not from the current time, so the
+ *       execution time of the loop body does not add up as drift
  */
-void task_update_runtime_stats(task_control_block_t *old_tcb, task_control_block_t *new_tcb)
+zk_error_code_t task_delay_until(zk_uint32 *last_wake_time, zk_uint32 period)
 {
-	zk_uint32 current_time = get_total_run_time();
+	zk_error_code_t ret = ZK_SUCCESS;
+	zk_uint32 wake_up_time = 0;
 
-	if (old_tcb != ZK_NULL && old_tcb->last_switch_in_time > 0)
+	ZK_CHECK_PARAM_NOT_NULL(last_wake_time);
+	ZK_ENTER_CRITICAL();
+	if (is_scheduler_suspending())
 	{
-		zk_uint32 delta = current_time - old_tcb->last_switch_in_time;
-		old_tcb->run_time_ticks += delta;
+		ret = ZK_ERR_STATE;
+		goto task_delay_until_exit;
 	}
 
-	if (new_tcb != ZK_NULL)
+	ZK_ASSERT_PARAM((period > 0) && (period < ZK_TSK_DLY_MAX));
+	wake_up_time = *last_wake_time + period;
+	*last_wake_time = wake_up_time;
+	/* equal to now is still a future tick boundary: wakeups are checked before the increment */
+	if (zk_time_is_after(get_current_time(), wake_up_time))
 	{
-		new_tcb->last_switch_in_time = current_time;
+		ret = ZK_ERR_TIMEOUT;
+		goto task_delay_until_exit;
 	}
 
-#ifdef ZK_USING_HOOK
-	zk_hook_call_task_switch(old_tcb, new_tcb);
-#endif
+	g_current_tcb->wake_up_time = wake_up_time;
+	task_ready_to_delay(g_current_tcb);
+	schedule();
+
+task_delay_until_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
 }
 
+#if ZK_USING_TIME64
 /**
- * @brief   Get task runtime
- * @param   tcb Task control block pointer
- * @return  Task accumulated runtime in ticks
+ * @brief Delay the current task until an absolute 64-bit tick
+ * @param deadline Tick from get_current_time64() to wake at
+ * @return zk_error_code_t ZK_SUCCESS if the task slept, ZK_ERR_TIMEOUT if the deadline has
+ *         already passed
+ * @note Deadlines further away than ZK_TSK_DLY_MAX are slept in several delays
  */
-zk_uint32 task_get_runtime(task_control_block_t *tcb)
+zk_error_code_t task_delay_until64(zk_uint64 deadline)
 {
-	zk_uint32 runtime = 0;
+	zk_error_code_t ret = ZK_ERR_TIMEOUT;
+	zk_uint32 timeout = 0;
 
-	ZK_ENTER_CRITICAL();
-	runtime = tcb->run_time_ticks;
-	ZK_EXIT_CRITICAL();
-
-	return runtime;
+	while ((timeout = zk_timeout_until64(deadline)) != ZK_TIMEOUT_NONE)
+	{
+		ret = task_delay(timeout);
+		if (ret != ZK_SUCCESS)
+		{
+			break;
+		}
+	}
+	return ret;
 }
+#endif
 
+#if ZK_USING_SLACK
 /**
- * @brief   Get task CPU usage
- * @param   tcb Task control block pointer
- * @return  CPU usage (percentage * 100)
+ * @brief Delay the current task by at least delay_time and at most delay_time + slack ticks
+ * @param delay_time Minimum delay in ticks
+ * @param slack Tolerated extra delay in ticks
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note The wake-up is rounded onto the boundary in the window shared by the most other
+ *       slack wakeups (see zk_time_apply_slack), so the idle task sleeps longer between them
  */
-zk_uint32 task_get_cpu_usage(task_control_block_t *tcb)
+zk_error_code_t task_delay_slack(zk_uint32 delay_time, zk_uint32 slack)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	ZK_ENTER_CRITICAL();
+	if (is_scheduler_suspending())
+	{
+		ret = ZK_ERR_STATE;
+		goto task_delay_slack_exit;
+	}
+
+	ZK_ASSERT_PARAM((delay_time > 0) && (delay_time + slack < ZK_TSK_DLY_MAX));
+	g_current_tcb->wake_up_time = zk_time_apply_slack(get_current_time() + delay_time, slack);
+	task_ready_to_delay(g_current_tcb);
+	schedule();
+
+task_delay_slack_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+#endif
+
+#if ZK_USING_EDF
+/**
+ * @brief End the current job of an EDF task and wait for the release of the next one
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_TIMEOUT if the finished job missed its deadline
+ *         (counted in task_get_edf_stats), ZK_ERR_STATE for a task without edf_period
+ * @note Releases are strictly periodic from the creation time. A job that overran into the
+ *       next period starts that job at once, under the deadline of that job.
+ */
+zk_error_code_t task_edf_next_period(void)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *tcb = ZK_NULL;
+	zk_uint32 now = 0;
+
+	ZK_ENTER_CRITICAL();
+	tcb = g_current_tcb;
+	if (is_scheduler_suspending() || tcb->edf_period == 0)
+	{
+		ret = ZK_ERR_STATE;
+		goto task_edf_next_period_exit;
+	}
+
+	now = get_current_time();
+	tcb->edf_jobs++;
+	if (zk_time_is_after(now, tcb->edf_deadline))
+	{
+		tcb->edf_misses++;
+		ret = ZK_ERR_TIMEOUT;
+	}
+
+	tcb->edf_release += tcb->edf_period;
+	tcb->edf_deadline = tcb->edf_release + tcb->edf_relative_deadline;
+	if (zk_time_is_after(now, tcb->edf_release))
+	{
+		/* still ready: re-queue under the new deadline */
+		remove_task_from_ready_list(tcb);
+		add_task_to_ready_list(tcb);
+	}
+	else
+	{
+		tcb->wake_up_time = tcb->edf_release;
+		task_ready_to_delay(tcb);
+	}
+	schedule();
+
+task_edf_next_period_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief   Get the deadline statistics of an EDF task
+ * @param   tcb Task control block pointer
+ * @param   stats Output statistics
+ * @return  zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t task_get_edf_stats(task_control_block_t *tcb, task_edf_stats_t *stats)
+{
+	ZK_CHECK_PARAM_NOT_NULL(tcb);
+	ZK_CHECK_PARAM_NOT_NULL(stats);
+
+	ZK_ENTER_CRITICAL();
+	stats->period = tcb->edf_period;
+	stats->deadline = tcb->edf_relative_deadline;
+	stats->jobs = tcb->edf_jobs;
+	stats->misses = tcb->edf_misses;
+	ZK_EXIT_CRITICAL();
+
+	return ZK_SUCCESS;
+}
+#endif
+
+#if ZK_USING_PREEMPT_THRESHOLD
+/**
+ * @brief Change the preemption threshold of a task
+ * @param task_handle task handle, 0 for the calling task
+ * @param threshold New threshold: only tasks with a priority numerically below it preempt the
+ *        task while it runs. The task's own priority disables the threshold, 0 makes the task
+ *        non-preemptible.
+ * @param old_threshold Previous threshold, may be ZK_NULL
+ * @return zk_error_code_t ZK_SUCCESS if success, ZK_ERR_INVALID_PARAM if the threshold is a
+ *         lower priority than the task's base priority
+ * @note An inheritance boost above the threshold takes over as the limit while it lasts.
+ *       Lowering the protection of the calling task lets waiting tasks preempt it at once.
+ */
+zk_error_code_t task_set_preempt_threshold(zk_uint32 task_handle, zk_uint8 threshold,
+										   zk_uint8 *old_threshold)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *tcb = ZK_NULL;
+
+	ZK_ENTER_CRITICAL();
+	tcb = (task_handle == 0) ? g_current_tcb : TASK_HANDLE_TO_TCB(task_handle);
+	if (threshold > tcb->base_priority)
+	{
+		ret = ZK_ERR_INVALID_PARAM;
+		goto task_set_preempt_threshold_exit;
+	}
+
+	if (old_threshold != ZK_NULL)
+	{
+		*old_threshold = tcb->preempt_threshold;
+	}
+	tcb->preempt_threshold = threshold;
+	if (threshold == tcb->base_priority)
+	{
+		/* a preempted task without a threshold is an ordinary ready task */
+		zk_list_delete(&tcb->threshold_node);
+		zk_list_init(&tcb->threshold_node);
+	}
+	schedule();
+
+task_set_preempt_threshold_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+#endif
+
+#if ZK_USING_ARENA
+/**
+ * @brief   Set the default arena of a task
+ * @param   task_handle Task handle, 0 for the calling task
+ * @param   arena Arena used by task_arena_alloc(), ZK_NULL for none
+ * @return  zk_error_code_t ZK_SUCCESS
+ * @note    The task does not own the arena, task_delete() leaves it alone
+ */
+zk_error_code_t task_set_arena(zk_uint32 task_handle, zk_arena_t *arena)
+{
+	task_control_block_t *tcb = ZK_NULL;
+
+	ZK_ENTER_CRITICAL();
+	tcb = (task_handle == 0) ? g_current_tcb : TASK_HANDLE_TO_TCB(task_handle);
+	tcb->arena = arena;
+	ZK_EXIT_CRITICAL();
+
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief   Get the default arena of the calling task
+ * @return  zk_arena_t* Arena, ZK_NULL if none is set
+ */
+zk_arena_t *task_get_arena(void)
+{
+	return g_current_tcb->arena;
+}
+
+/**
+ * @brief   Allocate from the default arena of the calling task
+ * @param   size Requested size in bytes
+ * @return  Allocated memory, NULL if no arena is set or it is full
+ */
+void *task_arena_alloc(zk_uint32 size)
+{
+	return arena_alloc(g_current_tcb->arena, size);
+}
+#endif
+
+void task_change_priority_temp(task_control_block_t *tcb, zk_uint8 new_priority)
+{
+	/* leave the old ready list first, its bitmap bit is cleared by the old priority */
+	if (tcb->state == TASK_READY)
+	{
+		remove_task_from_ready_list(tcb);
+		tcb->priority = new_priority;
+		add_task_to_ready_list(tcb);
+	}
+	else
+	{
+		tcb->priority = new_priority;
+#if ZK_USING_WAIT_INDEX
+		/* an indexed sleep list must stay sorted, the index relies on it */
+		if (tcb->wait_index != ZK_NULL)
+		{
+			wait_index_requeue(tcb);
+		}
+#endif
+	}
+}
+
+void task_resume_priority(task_control_block_t *tcb)
+{
+	task_change_priority_temp(tcb, tcb->base_priority);
+}
+
+/**
+ * @brief   Check if task stack has overflowed
+ * @param   tcb Task control block pointer
+ * @return  ZK_TRUE: stack overflow, ZK_FALSE: normal
+ */
+zk_bool task_check_stack_overflow(task_control_block_t *tcb)
+{
+	/* with the MPU guard the band itself faults, check the bytes right above it */
+	zk_uint8 *stack_bottom = (zk_uint8 *) tcb->stack_base + ZK_STACK_GUARD_BYTES;
+	zk_uint32 check_size = 16;
+
+	if (check_size > tcb->stack_size)
+	{
+		check_size = tcb->stack_size;
+	}
+
+	for (zk_uint32 i = 0; i < check_size; i++)
+	{
+		if (stack_bottom[i] != TASK_MAGIC_NUMBER)
+		{
+#if ZK_USING_HOOK
+			zk_hook_call_stack_overflow(tcb);
+#endif
+			return ZK_TRUE;
+		}
+	}
+
+	return ZK_FALSE;
+}
+
+/**
+ * @brief   Record a new high-water mark, keeping the deeper of concurrent scans
+ * @param   tcb Task control block pointer
+ * @param   unused Untouched bytes found above stack_base
+ */
+static void task_update_stack_unused(task_control_block_t *tcb, zk_uint32 unused)
+{
+	ZK_ENTER_CRITICAL();
+	if (unused < tcb->stack_unused)
+	{
+		tcb->stack_unused = unused;
+	}
+	ZK_EXIT_CRITICAL();
+}
+
+/**
+ * @brief   Calculate task stack usage
+ * @param   tcb Task control block pointer
+ * @return  Peak stack usage in bytes
+ * @note    Scans words up from stack_base, but never past the cached high-water mark: a
+ *          stack only gets dirtier, so the part above it is known to be used
+ */
+zk_uint32 task_get_stack_usage(task_control_block_t *tcb)
+{
+	const zk_uint32 *stack_word = (const zk_uint32 *) tcb->stack_base;
+	zk_uint32 limit = tcb->stack_unused / sizeof(zk_uint32);
+	zk_uint32 i = ZK_STACK_GUARD_BYTES / sizeof(zk_uint32);
+
+	while (i < limit && stack_word[i] == TASK_STACK_BOUNDARY)
+	{
+		i++;
+	}
+	task_update_stack_unused(tcb, i * sizeof(zk_uint32));
+
+	return tcb->stack_size - tcb->stack_unused;
+}
+
+#if ZK_USING_TASK_LIST
+/**
+ * @brief   Check that a handle names a task that was created and not yet deleted
+ * @param   task_handle Task handle
+ * @return  zk_bool ZK_TRUE if the task is in the task list
+ * @note    Called within critical section, walks the task list
+ */
+zk_bool task_handle_is_valid(zk_uint32 task_handle)
+{
+	zk_list_node_t *iterator = ZK_NULL;
+
+	ZK_LIST_FOR_EACH_NODE(iterator, &g_task_list)
+	{
+		if (ZK_LIST_GET_OWNER(iterator, task_control_block_t, task_node) ==
+			TASK_HANDLE_TO_TCB(task_handle))
+		{
+			return ZK_TRUE;
+		}
+	}
+	return ZK_FALSE;
+}
+#endif
+
+#if ZK_USING_STACK_WATCH
+/**
+ * @brief   Check the next ZK_STACK_WATCH_CHUNK_WORDS stack words of the task list
+ * @note    Called from the idle task. Each task is scanned up to its cached mark over as
+ *          many calls as needed, then the watch moves on to the next task.
+ */
+void task_stack_watch_step(void)
+{
+	task_control_block_t *tcb = ZK_NULL;
+	const zk_uint32 *stack_word = ZK_NULL;
+	zk_uint32 limit = 0;
+	zk_uint32 end = 0;
+
+	if (g_stack_watch_node == &g_task_list)
+	{
+		ZK_ENTER_CRITICAL();
+		g_stack_watch_node = g_task_list.next;
+		ZK_EXIT_CRITICAL();
+		g_stack_watch_word = ZK_STACK_GUARD_BYTES / sizeof(zk_uint32);
+		if (g_stack_watch_node == &g_task_list)
+		{
+			return;
+		}
+	}
+
+	tcb = ZK_LIST_GET_OWNER(g_stack_watch_node, task_control_block_t, task_node);
+	stack_word = (const zk_uint32 *) tcb->stack_base;
+	limit = tcb->stack_unused / sizeof(zk_uint32);
+	end = g_stack_watch_word + ZK_STACK_WATCH_CHUNK_WORDS;
+	if (end > limit)
+	{
+		end = limit;
+	}
+
+	while (g_stack_watch_word < end && stack_word[g_stack_watch_word] == TASK_STACK_BOUNDARY)
+	{
+		g_stack_watch_word++;
+	}
+	if (g_stack_watch_word < limit && g_stack_watch_word == end)
+	{
+		return;
+	}
+
+	task_update_stack_unused(tcb, g_stack_watch_word * sizeof(zk_uint32));
+	ZK_ENTER_CRITICAL();
+	g_stack_watch_node = g_stack_watch_node->next;
+	ZK_EXIT_CRITICAL();
+	g_stack_watch_word = ZK_STACK_GUARD_BYTES / sizeof(zk_uint32);
+}
+
+/**
+ * @brief   Copy the cached stack high-water marks of all tasks
+ * @param   stats Output array
+ * @param   max_count Number of entries in stats
+ * @return  Number of entries filled, in creation order
+ * @note    No stack is scanned here; the marks are as fresh as the idle watch has made them
+ */
+zk_uint32 task_get_all_stack_stats(task_stack_stats_t *stats, zk_uint32 max_count)
+{
+	zk_list_node_t *iterator = LIST_NODE_NULL;
+	task_control_block_t *tcb = ZK_NULL;
+	zk_uint32 count = 0;
+
+	if (stats == ZK_NULL)
+	{
+		return 0;
+	}
+
+	ZK_ENTER_CRITICAL();
+	ZK_LIST_FOR_EACH_NODE(iterator, &g_task_list)
+	{
+		if (count >= max_count)
+		{
+			break;
+		}
+		tcb = ZK_LIST_GET_OWNER(iterator, task_control_block_t, task_node);
+		stats[count].task_handle = (zk_uint32) tcb;
+		stats[count].stack_size = tcb->stack_size;
+		stats[count].stack_peak = tcb->stack_size - tcb->stack_unused;
+		count++;
+	}
+	ZK_EXIT_CRITICAL();
+
+	return count;
+}
+#endif
+
+#if (ZK_TASK_STATS_MODE == 1)
+/**
+ * @brief   Update task runtime statistics (called during context switch)
+ * @param   old_tcb TCB of the task being switched out
+ * @param   new_tcb TCB of the task being switched in
+ */
+void task_update_runtime_stats(task_control_block_t *old_tcb, task_control_block_t *new_tcb)
+{
+	zk_uint32 current_time = get_total_run_time();
+
+	if (old_tcb != ZK_NULL && old_tcb->last_switch_in_time > 0)
+	{
+		zk_uint32 delta = current_time - old_tcb->last_switch_in_time;
+		old_tcb->run_time_ticks += delta;
+	}
+
+	if (new_tcb != ZK_NULL)
+	{
+		new_tcb->last_switch_in_time = current_time;
+	}
+
+#if ZK_USING_HOOK
+	zk_hook_call_task_switch(old_tcb, new_tcb);
+#endif
+}
+#endif
+
+#if (ZK_TASK_STATS_MODE == 3)
+/* ISR time bracketed by zk_isr_enter()/zk_isr_exit() */
+static volatile zk_uint64 g_isr_cycles = 0;
+static zk_uint32 g_isr_nesting = 0;
+static zk_uint32 g_isr_enter_cycles = 0;
+
+/**
+ * @brief   Mark the start of an ISR body for cycle accounting
+ * @note    For kernel-aware ISRs (priority not above ZK_MAX_SYSCALL_INTERRUPT_PRIORITY);
+ *          nested ISRs are counted once, by the outermost pair
+ */
+void zk_isr_enter(void)
+{
+	ZK_ENTER_CRITICAL();
+	if (g_isr_nesting++ == 0)
+	{
+		g_isr_enter_cycles = zk_cpu_cycle_count();
+	}
+	ZK_EXIT_CRITICAL();
+}
+
+/**
+ * @brief   Mark the end of an ISR body for cycle accounting
+ */
+void zk_isr_exit(void)
+{
+	ZK_ENTER_CRITICAL();
+	if (g_isr_nesting > 0 && --g_isr_nesting == 0)
+	{
+		g_isr_cycles += (zk_uint32) (zk_cpu_cycle_count() - g_isr_enter_cycles);
+	}
+	ZK_EXIT_CRITICAL();
+}
+
+/**
+ * @brief   Get the cycles spent in bracketed ISRs since the scheduler started
+ */
+zk_uint64 zk_get_isr_cycles(void)
+{
+	zk_uint64 cycles = 0;
+
+	ZK_ENTER_CRITICAL();
+	cycles = g_isr_cycles;
+	ZK_EXIT_CRITICAL();
+	return cycles;
+}
+
+/**
+ * @brief   Length of the burst a task has been running since switch-in, ISR time excluded
+ */
+static inline zk_uint32 task_current_burst_cycles(task_control_block_t *tcb, zk_uint32 now)
+{
+	return (now - tcb->switch_in_cycles) - ((zk_uint32) g_isr_cycles - tcb->switch_in_isr_cycles);
+}
+
+/**
+ * @brief   Update task cycle statistics (called during context switch)
+ * @param   old_tcb TCB of the task being switched out
+ * @param   new_tcb TCB of the task being switched in
+ */
+void task_update_runtime_stats(task_control_block_t *old_tcb, task_control_block_t *new_tcb)
+{
+	zk_uint32 now = zk_cpu_cycle_count();
+	zk_uint32 burst = 0;
+
+	if (old_tcb != ZK_NULL)
+	{
+		burst = task_current_burst_cycles(old_tcb, now);
+		old_tcb->run_cycles += burst;
+		old_tcb->burst_count++;
+		if (burst < old_tcb->burst_min)
+		{
+			old_tcb->burst_min = burst;
+		}
+		if (burst > old_tcb->burst_max)
+		{
+			old_tcb->burst_max = burst;
+		}
+	}
+
+	if (new_tcb != ZK_NULL)
+	{
+		new_tcb->switch_in_cycles = now;
+		new_tcb->switch_in_isr_cycles = (zk_uint32) g_isr_cycles;
+	}
+
+#if ZK_USING_HOOK
+	zk_hook_call_task_switch(old_tcb, new_tcb);
+#endif
+}
+#endif
+
+#if ZK_TASK_STATS_CYCLES
+/**
+ * @brief   Cycles a task has run, including the burst in progress
+ * @note    called within critical section; the switch path only folds finished bursts
+ */
+static zk_uint64 task_get_run_cycles(task_control_block_t *tcb)
+{
+	zk_uint64 cycles = tcb->run_cycles;
+
+	if (tcb == g_current_tcb)
+	{
+#if (ZK_TASK_STATS_MODE == 3)
+		cycles += task_current_burst_cycles(tcb, zk_cpu_cycle_count());
+#else
+		cycles += (zk_uint32) (zk_cpu_cycle_count() - tcb->switch_in_cycles);
+#endif
+	}
+	return cycles;
+}
+
+/**
+ * @brief   Get cycle-accurate run statistics of a task
+ * @param   tcb Task control block pointer
+ * @param   stats Output statistics
+ * @return  zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note    Burst figures are only collected with ZK_TASK_STATS_MODE 3, they read 0 otherwise
+ */
+zk_error_code_t task_get_cycle_stats(task_control_block_t *tcb, task_cycle_stats_t *stats)
+{
+	ZK_CHECK_PARAM_NOT_NULL(tcb);
+	ZK_CHECK_PARAM_NOT_NULL(stats);
+
+	zk_memclear(stats, sizeof(task_cycle_stats_t));
+
+	ZK_ENTER_CRITICAL();
+	stats->run_cycles = task_get_run_cycles(tcb);
+#if (ZK_TASK_STATS_MODE == 3)
+	stats->burst_count = tcb->burst_count;
+	if (tcb->burst_count > 0)
+	{
+		stats->burst_min = tcb->burst_min;
+		stats->burst_max = tcb->burst_max;
+		stats->burst_avg = (zk_uint32) ((tcb->run_cycles) / tcb->burst_count);
+	}
+#endif
+	ZK_EXIT_CRITICAL();
+
+	return ZK_SUCCESS;
+}
+#endif
+
+/**
+ * @brief   Get task runtime
+ * @param   tcb Task control block pointer
+ * @return  Task accumulated runtime in ticks (always 0 with ZK_TASK_STATS_MODE 0)
+ */
+zk_uint32 task_get_runtime(task_control_block_t *tcb)
+{
+	zk_uint32 runtime = 0;
+
+	ZK_ENTER_CRITICAL();
+#if ZK_TASK_STATS_CYCLES
+	runtime = (zk_uint32) (task_get_run_cycles(tcb) / ZK_CPU_CYCLES_PER_TICK);
+#else
+	runtime = (zk_uint32) tcb->run_time_ticks;
+#endif
+	ZK_EXIT_CRITICAL();
+
+	return runtime;
+}
+
+#if ZK_USING_TIME64
+/**
+ * @brief   Get task runtime without the 32-bit wrap
+ * @param   tcb Task control block pointer
+ * @return  Task accumulated runtime in ticks
+ */
+zk_uint64 task_get_runtime64(task_control_block_t *tcb)
+{
+	zk_uint64 runtime = 0;
+
+	ZK_ENTER_CRITICAL();
+#if ZK_TASK_STATS_CYCLES
+	runtime = task_get_run_cycles(tcb) / ZK_CPU_CYCLES_PER_TICK;
+#else
+	runtime = tcb->run_time_ticks;
+#endif
+	ZK_EXIT_CRITICAL();
+
+	return runtime;
+}
+#endif
+
+/**
+ * @brief   Get task CPU usage
+ * @param   tcb Task control block pointer
+ * @return  CPU usage (percentage * 100)
+ * @note    Computed in 64 bits, so it no longer wraps after ~4e5 ticks; the total runtime
+ *          itself wraps after 2^32 ticks unless ZK_USING_TIME64 is set
+ */
+zk_uint32 task_get_cpu_usage(task_control_block_t *tcb)
 {
 	zk_uint32 usage = 0;
+#if ZK_USING_TIME64
+	zk_uint64 total_time;
+#else
 	zk_uint32 total_time;
-	zk_uint32 task_time;
+#endif
 
 	ZK_ENTER_CRITICAL();
 
+#if ZK_USING_TIME64
+	total_time = get_total_run_time64();
+#else
 	total_time = get_total_run_time();
-	task_time = tcb->run_time_ticks;
+#endif
 
 	if (total_time == 0)
 	{
@@ -282,9 +1253,348 @@ zk_uint32 task_get_cpu_usage(task_control_block_t *tcb)
 		return 0;
 	}
 
-	usage = (task_time * 10000) / total_time;
+#if ZK_TASK_STATS_CYCLES
+	usage = (zk_uint32) ((task_get_run_cycles(tcb) * 10000) /
+						 ((zk_uint64) total_time * ZK_CPU_CYCLES_PER_TICK));
+#else
+	usage = (zk_uint32) (((zk_uint64) tcb->run_time_ticks * 10000) / total_time);
+#endif
 
 	ZK_EXIT_CRITICAL();
 
 	return usage;
 }
+
+#if ZK_USING_TASK_MONITOR
+/**
+ * @brief   Run time of a task in the unit of task_monitor_total_time()
+ * @note    Called within critical section
+ */
+static zk_uint64 task_monitor_run_time(task_control_block_t *tcb)
+{
+#if ZK_TASK_STATS_CYCLES
+	return task_get_run_cycles(tcb);
+#else
+	return (zk_uint64) tcb->run_time_ticks;
+#endif
+}
+
+/**
+ * @brief   System run time, in cycles with ZK_TASK_STATS_MODE 2/3 and in ticks otherwise
+ */
+static zk_uint64 task_monitor_total_time(void)
+{
+#if ZK_USING_TIME64
+	zk_uint64 total = get_total_run_time64();
+#else
+	zk_uint64 total = get_total_run_time();
+#endif
+
+#if ZK_TASK_STATS_CYCLES
+	total *= ZK_CPU_CYCLES_PER_TICK;
+#endif
+	return total;
+}
+
+/**
+ * @brief   Take a "top"-style snapshot of all tasks
+ * @param   info Output array
+ * @param   max_count Number of entries in info
+ * @return  Number of entries filled in creation order, 0 while another snapshot is running
+ * @note    The critical section is held for one task at a time, never for the whole walk.
+ *          cpu_usage covers the time since the previous snapshot (since boot for the first);
+ *          stack_peak is as fresh as the idle stack watch or task_get_stack_usage() made it.
+ */
+zk_uint32 task_monitor_snapshot(task_monitor_info_t *info, zk_uint32 max_count)
+{
+	task_control_block_t *tcb = ZK_NULL;
+	task_monitor_info_t *entry = ZK_NULL;
+	zk_uint64 total = 0;
+	zk_uint64 interval = 0;
+	zk_uint64 run = 0;
+	zk_uint64 delta = 0;
+	zk_uint32 count = 0;
+	zk_uint32 i = 0;
+
+	if (info == ZK_NULL || max_count == 0)
+	{
+		return 0;
+	}
+
+	ZK_ENTER_CRITICAL();
+	if (g_monitor_busy)
+	{
+		ZK_EXIT_CRITICAL();
+		return 0;
+	}
+	g_monitor_busy = 1;
+	g_monitor_node = g_task_list.next;
+	total = task_monitor_total_time();
+	interval = total - g_monitor_total_time;
+	g_monitor_total_time = total;
+	ZK_EXIT_CRITICAL();
+
+	while (count < max_count)
+	{
+		entry = &info[count];
+
+		ZK_ENTER_CRITICAL();
+		if (g_monitor_node == &g_task_list)
+		{
+			ZK_EXIT_CRITICAL();
+			break;
+		}
+		tcb = ZK_LIST_GET_OWNER(g_monitor_node, task_control_block_t, task_node);
+		g_monitor_node = g_monitor_node->next;
+
+		entry->task_handle = (zk_uint32) tcb;
+		for (i = 0; i < CONFIG_TASK_NAME_LEN; i++)
+		{
+			entry->name[i] = tcb->task_name[i];
+		}
+		entry->state = (zk_uint8) tcb->state;
+		entry->priority = tcb->priority;
+		entry->base_priority = tcb->base_priority;
+		entry->stack_size = tcb->stack_size;
+		entry->stack_peak = tcb->stack_size - tcb->stack_unused;
+		entry->wait_object =
+			(tcb->state == TASK_ENDLESS_BLOCKED || tcb->state == TASK_TIMEOUT_BLOCKED)
+				? (zk_uint32) tcb->wait_list
+				: 0;
+
+		/* the previous sample is the other half of the double buffer */
+		run = task_monitor_run_time(tcb);
+		delta = run - tcb->monitor_run_time;
+		tcb->monitor_run_time = run;
+		ZK_EXIT_CRITICAL();
+
+		/* a task skipped by a short array carries two intervals, clamp it */
+		if (delta > interval)
+		{
+			delta = interval;
+		}
+		entry->cpu_usage = (interval == 0) ? 0 : (zk_uint16) ((delta * 10000) / interval);
+		count++;
+	}
+
+	ZK_ENTER_CRITICAL();
+	g_monitor_busy = 0;
+	ZK_EXIT_CRITICAL();
+
+	return count;
+}
+
+/**
+ * @brief   Print a task_monitor_snapshot() table with zk_printf
+ * @param   info Scratch array, one entry per task to show
+ * @param   max_count Number of entries in info
+ * @note    Meant as the handler of a console "top" command, nothing is allocated
+ */
+void task_monitor_print(task_monitor_info_t *info, zk_uint32 max_count)
+{
+	static const char *const state_names[] = {"ready",	 "delay",	"suspend", "block",
+											  "block_t", "unknown", "deleted"};
+	const zk_uint32 state_num = sizeof(state_names) / sizeof(state_names[0]);
+	zk_uint32 count = task_monitor_snapshot(info, max_count);
+	const char *state = ZK_NULL;
+
+	zk_printf("%-*s %-7s %4s %4s %7s %11s %s\r\n", CONFIG_TASK_NAME_LEN, "name", "state",
+			  "prio", "base", "cpu%", "stack", "wait");
+	for (zk_uint32 i = 0; i < count; i++)
+	{
+		state = (info[i].state < state_num) ? state_names[info[i].state] : "?";
+		zk_printf("%-*.*s %-7s %4u %4u %4u.%02u %5u/%-5u 0x%x\r\n", CONFIG_TASK_NAME_LEN,
+				  CONFIG_TASK_NAME_LEN, (const char *) info[i].name, state, info[i].priority,
+				  info[i].base_priority, info[i].cpu_usage / 100, info[i].cpu_usage % 100,
+				  info[i].stack_peak, info[i].stack_size, info[i].wait_object);
+	}
+}
+#endif
+
+#if ZK_USING_TASK_NOTIFY
+/* Shared sleep list of tasks blocked in task_notify_wait(), the waker knows its target */
+static zk_list_node_t g_notify_wait_list = {&g_notify_wait_list, &g_notify_wait_list};
+
+/**
+ * @brief Apply a notification to the target task
+ * @param tcb target task
+ * @param value notification argument
+ * @param action task_notify_action_t
+ * @param woken_tcb set to tcb if it was blocked in task_notify_wait() and is now ready
+ * @return zk_error_code_t ZK_SUCCESS, or ZK_ERR_FAILED for NO_OVERWRITE on a pending value
+ * @note called within critical section
+ */
+static zk_error_code_t task_notify_internal(task_control_block_t *tcb, zk_uint32 value,
+											task_notify_action_t action,
+											task_control_block_t **woken_tcb)
+{
+	zk_uint8 prev_state = tcb->notify_state;
+
+	*woken_tcb = ZK_NULL;
+
+	switch (action)
+	{
+	case TASK_NOTIFY_SET_BITS:
+		tcb->notify_value |= value;
+		break;
+
+	case TASK_NOTIFY_INCREMENT:
+		tcb->notify_value++;
+		break;
+
+	case TASK_NOTIFY_OVERWRITE:
+		tcb->notify_value = value;
+		break;
+
+	case TASK_NOTIFY_NO_OVERWRITE:
+		if (prev_state == TASK_NOTIFY_PENDING)
+		{
+			return ZK_ERR_FAILED;
+		}
+		tcb->notify_value = value;
+		break;
+
+	case TASK_NOTIFY_NO_ACTION:
+	default:
+		break;
+	}
+
+	tcb->notify_state = TASK_NOTIFY_PENDING;
+
+	/* A waiter that already timed out is READY and only has to see the PENDING state */
+	if (prev_state == TASK_NOTIFY_WAITING &&
+		(tcb->state == TASK_ENDLESS_BLOCKED || tcb->state == TASK_TIMEOUT_BLOCKED))
+	{
+		tcb->event_timeout_wakeup = EVENT_NO_TIMEOUT;
+		task_block_to_ready(tcb);
+		*woken_tcb = tcb;
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Send a notification to a task
+ * @param task_handle target task handle
+ * @param value notification argument
+ * @param action how value is combined with the task's notification word
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ */
+zk_error_code_t task_notify(zk_uint32 task_handle, zk_uint32 value, task_notify_action_t action)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *woken_tcb = ZK_NULL;
+
+	if (task_handle == 0)
+	{
+		return ZK_ERR_INVALID_HANDLE;
+	}
+
+	ZK_ENTER_CRITICAL();
+
+	ret = task_notify_internal(TASK_HANDLE_TO_TCB(task_handle), value, action, &woken_tcb);
+	if (woken_tcb != ZK_NULL)
+	{
+		schedule();
+	}
+
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Send a notification to a task from interrupt context (never schedules)
+ * @param task_handle target task handle
+ * @param value notification argument
+ * @param action how value is combined with the task's notification word
+ * @param higher_priority_woken set to ZK_TRUE if a task above the interrupted one was woken
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Finish the ISR with zk_yield_from_isr(higher_priority_woken)
+ */
+zk_error_code_t task_notify_from_isr(zk_uint32 task_handle, zk_uint32 value,
+									 task_notify_action_t action, zk_bool *higher_priority_woken)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *woken_tcb = ZK_NULL;
+
+	ZK_ASSERT_ISR_PRIORITY();
+
+	if (task_handle == 0)
+	{
+		return ZK_ERR_INVALID_HANDLE;
+	}
+
+	ZK_ENTER_CRITICAL();
+
+	ret = task_notify_internal(TASK_HANDLE_TO_TCB(task_handle), value, action, &woken_tcb);
+	if (woken_tcb != ZK_NULL)
+	{
+		zk_isr_note_woken(woken_tcb, higher_priority_woken);
+	}
+
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+
+/**
+ * @brief Wait for a notification to the calling task
+ * @param clear_on_entry bits cleared in the notification word before waiting (if none pending)
+ * @param clear_on_exit bits cleared in the notification word after it was read
+ * @param value notification word at the time of wakeup (may be NULL)
+ * @param timeout ZK_TIMEOUT_NONE, ticks, or ZK_TIMEOUT_INFINITE
+ * @return zk_error_code_t ZK_SUCCESS if a notification was received, otherwise error code
+ */
+zk_error_code_t task_notify_wait(zk_uint32 clear_on_entry, zk_uint32 clear_on_exit,
+								 zk_uint32 *value, zk_uint32 timeout)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_control_block_t *current_tcb = g_current_tcb;
+
+	ZK_ENTER_CRITICAL();
+
+	if (current_tcb->notify_state != TASK_NOTIFY_PENDING)
+	{
+		current_tcb->notify_value &= ~clear_on_entry;
+
+		if (timeout == ZK_TIMEOUT_NONE)
+		{
+			ret = ZK_ERR_FAILED;
+			goto task_notify_wait_exit;
+		}
+
+		if (is_scheduler_suspending())
+		{
+			ret = ZK_ERR_STATE;
+			goto task_notify_wait_exit;
+		}
+
+		current_tcb->notify_state = TASK_NOTIFY_WAITING;
+		current_tcb->event_timeout_wakeup = EVENT_NO_TIMEOUT;
+		current_tcb->wake_up_time = get_current_time() + timeout;
+		task_ready_to_block(current_tcb, &g_notify_wait_list,
+							(timeout == ZK_TIMEOUT_INFINITE) ? BLOCK_TYPE_ENDLESS
+															 : BLOCK_TYPE_TIMEOUT,
+							BLOCK_SORT_FIFO);
+		schedule();
+		ZK_EXIT_CRITICAL();
+
+		ZK_ENTER_CRITICAL();
+		if (current_tcb->notify_state != TASK_NOTIFY_PENDING)
+		{
+			current_tcb->notify_state = TASK_NOTIFY_NONE;
+			ret = ZK_ERR_TIMEOUT;
+			goto task_notify_wait_exit;
+		}
+	}
+
+	if (value != ZK_NULL)
+	{
+		*value = current_tcb->notify_value;
+	}
+	current_tcb->notify_value &= ~clear_on_exit;
+	current_tcb->notify_state = TASK_NOTIFY_NONE;
+
+task_notify_wait_exit:
+	ZK_EXIT_CRITICAL();
+	return ret;
+}
+#endif /* ZK_USING_TASK_NOTIFY */
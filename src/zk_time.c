@@ -5,19 +5,38 @@
 
 #include "zk_internal.h"
 
-static volatile zk_uint32 g_current_time = 0;
+static volatile zk_uint32 g_current_time = CONFIG_TICK_COUNT_INIT_VALUE;
 static volatile zk_uint32 g_total_run_time = 0;
+#if ZK_USING_TIME64
+/* Upper halves, carried when the low words wrap; only written with interrupts masked */
+static volatile zk_uint32 g_current_time_high = 0;
+static volatile zk_uint32 g_total_run_time_high = 0;
+#endif
 
 void zk_time_init(void)
 {
 	g_current_time = CONFIG_TICK_COUNT_INIT_VALUE;
 	g_total_run_time = 0;
+#if ZK_USING_TIME64
+	g_current_time_high = 0;
+	g_total_run_time_high = 0;
+#endif
 }
 
 void increment_time(void)
 {
 	g_current_time++;
 	g_total_run_time++;
+#if ZK_USING_TIME64
+	if (g_current_time == 0)
+	{
+		g_current_time_high++;
+	}
+	if (g_total_run_time == 0)
+	{
+		g_total_run_time_high++;
+	}
+#endif
 }
 
 zk_uint32 get_current_time(void)
@@ -33,3 +52,81 @@ zk_uint32 get_total_run_time(void)
 {
 	return g_total_run_time;
 }
+
+/**
+ * @brief   Advance system time by several ticks at once
+ * @param   ticks Number of ticks elapsed (suppressed by tickless idle, or pended while the
+ *          scheduler was suspended)
+ * @note    Called with interrupts disabled
+ */
+void zk_time_step(zk_uint32 ticks)
+{
+#if ZK_USING_TIME64
+	if (g_current_time + ticks < g_current_time)
+	{
+		g_current_time_high++;
+	}
+	if (g_total_run_time + ticks < g_total_run_time)
+	{
+		g_total_run_time_high++;
+	}
+#endif
+	g_current_time += ticks;
+	g_total_run_time += ticks;
+}
+
+#if ZK_USING_TIME64
+/**
+ * @brief   Get the 64-bit monotonic tick count
+ * @return  Ticks, the low 32 bits equal get_current_time()
+ * @note    Both halves are read under one critical section, so the value never tears;
+ *          callable from tasks and from ISRs at or below ZK_MAX_SYSCALL_INTERRUPT_PRIORITY
+ */
+zk_uint64 get_current_time64(void)
+{
+	zk_uint32 high = 0;
+	zk_uint32 low = 0;
+
+	ZK_ENTER_CRITICAL();
+	high = g_current_time_high;
+	low = g_current_time;
+	ZK_EXIT_CRITICAL();
+	return ((zk_uint64) high << 32) | low;
+}
+
+/**
+ * @brief   Get the 64-bit total system runtime in ticks
+ */
+zk_uint64 get_total_run_time64(void)
+{
+	zk_uint32 high = 0;
+	zk_uint32 low = 0;
+
+	ZK_ENTER_CRITICAL();
+	high = g_total_run_time_high;
+	low = g_total_run_time;
+	ZK_EXIT_CRITICAL();
+	return ((zk_uint64) high << 32) | low;
+}
+
+/**
+ * @brief   Convert an absolute 64-bit deadline to a relative timeout for the *_timeout calls
+ * @param   deadline Absolute tick from get_current_time64()
+ * @return  ZK_TIMEOUT_NONE once the deadline is reached, otherwise the remaining ticks,
+ *          capped below ZK_TSK_DLY_MAX; the *_until64 waits re-arm until the deadline
+ */
+zk_uint32 zk_timeout_until64(zk_uint64 deadline)
+{
+	zk_uint64 now = get_current_time64();
+
+	if (deadline <= now)
+	{
+		return ZK_TIMEOUT_NONE;
+	}
+	if (deadline - now >= ZK_TSK_DLY_MAX)
+	{
+		return ZK_TSK_DLY_MAX - 1;
+	}
+	return (zk_uint32) (deadline - now);
+}
+#endif
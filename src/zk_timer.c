@@ -5,57 +5,96 @@
  *          1. Check timers directly in SysTick interrupt
  *          2. Use expired_list to shorten critical section time
  *          3. Execute callback functions outside critical section
+ *          4. Cache the nearest expiry, so a tick without due timers costs one compare
+ *          With ZK_USING_TIME_WHEEL running timers are hashed into a wheel (O(1) insert)
+ *          instead of the sorted list. With ZK_TIMER_MODE_TASK the SysTick only moves expired
+ *          timers to a pending list and the callbacks run in the timer service task instead.
  */
 
+#define ZK_CRITICAL_SUBSYS ZK_CRITICAL_SUBSYS_TIMER
+
+#include "zk_rtos.h"
 #include "zk_internal.h"
 
+#if ZK_USING_TIMER
+
+#if (ZK_TIMER_MODE != ZK_TIMER_MODE_ISR) && (ZK_TIMER_MODE != ZK_TIMER_MODE_TASK)
+#error "ZK_TIMER_MODE must be ZK_TIMER_MODE_ISR or ZK_TIMER_MODE_TASK"
+#endif
+
 static timer_manager_t g_timer_manager;
 static timer_t g_timer_pool[TIMER_MAX_NUM];
+ZK_HANDLE_POOL_DEFINE(g_timer_handles, TIMER_MAX_NUM);
 
-#define TIMER_HANDLE_TO_POINTER(handle) (&g_timer_pool[handle])
+#if (ZK_TIMER_MODE == ZK_TIMER_MODE_TASK)
+static task_control_block_t g_timer_task_tcb;
+static zk_uint32 g_timer_task_stack[ZK_TIMER_TASK_STACK_SIZE / sizeof(zk_uint32)];
+static zk_uint32 g_timer_task_handle;
+
+static void timer_task(void *parameter);
+#endif
+
+#define TIMER_HANDLE_TO_POINTER(handle) (&g_timer_pool[ZK_HANDLE_INDEX(handle)])
 
 #define CHECK_TIMER_HANDLE_VALID(handle)                                                           \
-	if (handle >= TIMER_MAX_NUM)                                                                   \
+	if (!zk_handle_is_valid(&g_timer_handles, handle))                                             \
 	return ZK_ERR_INVALID_HANDLE
 
 #define CHECK_TIMER_CREATED(handle)                                                                \
-	if (g_timer_pool[handle].is_used == 0)                                                         \
+	if (TIMER_HANDLE_TO_POINTER(handle)->is_used == 0)                                             \
 	return ZK_ERR_STATE
 
+#if ZK_USING_SLACK
+#define TIMER_DUE_TIME(timer) ((timer)->due_time)
+#else
+#define TIMER_DUE_TIME(timer) ((timer)->wake_up_time)
+#endif
+
 /**
  * @brief Initialize timer module
+ * @note  In ZK_TIMER_MODE_TASK also creates the timer service task, so it is called by
+ *        zk_kernel_init() after the semaphore pool is ready
  */
 void timer_init(void)
 {
 	zk_uint32 i;
+#if (ZK_TIMER_MODE == ZK_TIMER_MODE_TASK)
+	task_init_parameter_t parameter;
+#endif
+
 	for (i = 0; i < TIMER_MAX_NUM; i++)
 	{
 		g_timer_pool[i].is_used = 0;
 		g_timer_pool[i].status = TIMER_STOP;
 		zk_list_init(&g_timer_pool[i].list);
 	}
+	zk_handle_pool_init(&g_timer_handles);
+#if ZK_USING_TIME_WHEEL
+	zk_time_wheel_init(&g_timer_manager.timers_wheel, get_current_time());
+#else
 	zk_list_init(&g_timer_manager.timers_list);
-}
+#endif
+	g_timer_manager.next_expiry = 0;
+	g_timer_manager.next_expiry_valid = ZK_FALSE;
 
-/**
- * @brief Get available timer resource
- */
-static zk_error_code_t get_timer_resource(zk_uint32 *timer_handle)
-{
-	zk_uint32 i;
-	for (i = 0; i < TIMER_MAX_NUM; i++)
-	{
-		if (g_timer_pool[i].is_used == 0)
-		{
-			break;
-		}
-	}
-	if (i >= TIMER_MAX_NUM)
+#if (ZK_TIMER_MODE == ZK_TIMER_MODE_TASK)
+	zk_list_init(&g_timer_manager.expired_list);
+	if (sem_create(&g_timer_manager.wakeup_sem, 0) != ZK_SUCCESS)
 	{
-		return ZK_ERR_RESOURCE_UNAVAILABLE;
+		return;
 	}
-	*timer_handle = i;
-	return ZK_SUCCESS;
+
+	zk_memclear(&parameter, sizeof(task_init_parameter_t));
+	parameter.name[0] = 'T';
+	parameter.name[1] = 'M';
+	parameter.name[2] = 'R';
+	parameter.name[3] = ZK_STRING_TERMINATOR;
+	parameter.priority = ZK_TIMER_TASK_PRIO;
+	parameter.private_data = ZK_NULL;
+	parameter.stack_size = sizeof(g_timer_task_stack);
+	parameter.task_entry = timer_task;
+	task_create_static(&parameter, &g_timer_task_tcb, g_timer_task_stack, &g_timer_task_handle);
+#endif
 }
 
 /**
@@ -76,20 +115,24 @@ zk_error_code_t timer_create(zk_uint32 *timer_handle, timer_mode_t mode, zk_uint
 
 	ZK_ENTER_CRITICAL();
 
-	ret = get_timer_resource(timer_handle);
+	ret = zk_handle_alloc(&g_timer_handles, timer_handle);
 	if (ret != ZK_SUCCESS)
 	{
 		goto timer_create_exit;
 	}
 
-	g_timer_pool[*timer_handle].interval = interval;
-	g_timer_pool[*timer_handle].mode = mode;
-	g_timer_pool[*timer_handle].param = param;
-	g_timer_pool[*timer_handle].handler = handler;
-	g_timer_pool[*timer_handle].wake_up_time = 0;
-	g_timer_pool[*timer_handle].status = TIMER_STOP;
-	zk_list_init(&g_timer_pool[*timer_handle].list);
-	g_timer_pool[*timer_handle].is_used = 1;
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->interval = interval;
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->mode = mode;
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->param = param;
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->handler = handler;
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->wake_up_time = 0;
+#if ZK_USING_SLACK
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->slack = 0;
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->due_time = 0;
+#endif
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->status = TIMER_STOP;
+	zk_list_init(&TIMER_HANDLE_TO_POINTER(*timer_handle)->list);
+	TIMER_HANDLE_TO_POINTER(*timer_handle)->is_used = 1;
 
 timer_create_exit:
 	ZK_EXIT_CRITICAL();
@@ -97,22 +140,19 @@ timer_create_exit:
 }
 
 /**
- * @brief Insert timer into sorted timer list (ordered by timeout time)
+ * @brief Insert timer into the running timers (sorted list, or wheel slot)
  * @param timer Timer to insert
  * @note Called within critical section
  */
 static void add_timer_to_list(timer_t *timer)
 {
+#if ZK_USING_TIME_WHEEL
+	zk_time_wheel_insert(&g_timer_manager.timers_wheel, &timer->list, timer->wake_up_time);
+#else
 	zk_list_node_t *target_list = &g_timer_manager.timers_list;
 	zk_list_node_t *iterator = ZK_NULL;
 	timer_t *timer_iterator = ZK_NULL;
 
-	if (zk_list_is_empty(target_list))
-	{
-		zk_list_add_after(&timer->list, target_list);
-		return;
-	}
-
 	ZK_LIST_FOR_EACH_NODE(iterator, target_list)
 	{
 		timer_iterator = ZK_LIST_GET_OWNER(iterator, timer_t, list);
@@ -122,24 +162,81 @@ static void add_timer_to_list(timer_t *timer)
 		}
 	}
 
-	if (iterator == target_list)
+	/* iterator is the first later timer, or the list head: insert in front of it */
+	zk_list_add_before(&timer->list, iterator);
+#endif
+
+	if (!g_timer_manager.next_expiry_valid ||
+		zk_time_is_before(timer->wake_up_time, g_timer_manager.next_expiry))
 	{
-		zk_list_add_before(&timer->list, target_list);
+		g_timer_manager.next_expiry = timer->wake_up_time;
+		g_timer_manager.next_expiry_valid = ZK_TRUE;
 	}
-	else
+}
+
+/**
+ * @brief Recompute the nearest expiry cache from the running timers
+ * @note Called within critical section, only after timers expired. The wheel is not sorted,
+ *       so the pool is scanned (TIMER_MAX_NUM entries) instead of every slot.
+ */
+static void timer_update_next_expiry(void)
+{
+#if ZK_USING_TIME_WHEEL
+	zk_uint32 i;
+
+	g_timer_manager.next_expiry_valid = ZK_FALSE;
+	for (i = 0; i < TIMER_MAX_NUM; i++)
+	{
+		if (g_timer_pool[i].status != TIMER_RUNNING)
+		{
+			continue;
+		}
+		if (!g_timer_manager.next_expiry_valid ||
+			zk_time_is_before(g_timer_pool[i].wake_up_time, g_timer_manager.next_expiry))
+		{
+			g_timer_manager.next_expiry = g_timer_pool[i].wake_up_time;
+			g_timer_manager.next_expiry_valid = ZK_TRUE;
+		}
+	}
+#else
+	if (zk_list_is_empty(&g_timer_manager.timers_list))
 	{
-		zk_list_add_before(&timer->list, iterator);
+		g_timer_manager.next_expiry_valid = ZK_FALSE;
+		return;
 	}
+	g_timer_manager.next_expiry =
+		ZK_LIST_GET_FIRST_ENTRY(&g_timer_manager.timers_list, timer_t, list)->wake_up_time;
+	g_timer_manager.next_expiry_valid = ZK_TRUE;
+#endif
+}
+
+/**
+ * @brief Set the nominal expiry of a timer and the wake-up time it is queued by
+ * @param timer Timer, not linked
+ * @param due Expiry before the slack window is applied
+ */
+static void timer_set_due(timer_t *timer, zk_uint32 due)
+{
+#if ZK_USING_SLACK
+	timer->due_time = due;
+	due = zk_time_apply_slack(due, timer->slack);
+#endif
+	timer->wake_up_time = due;
 }
 
 /**
  * @brief Remove timer from timer list
  * @param timer Timer to remove
- * @note Called within critical section
+ * @note Called within critical section; also unlinks an expired timer whose callback has
+ *       not run yet, so stopping it cancels that callback. The expiry cache is left as is:
+ *       being early only costs one wasted check.
  */
 static void remove_timer_from_list(timer_t *timer)
 {
-	zk_list_delete(&timer->list);
+	if (timer->status == TIMER_RUNNING || timer->status == TIMER_EXPIRED)
+	{
+		zk_list_delete(&timer->list);
+	}
 }
 
 /**
@@ -157,12 +254,9 @@ zk_error_code_t timer_start(zk_uint32 timer_handle)
 
 	timer = TIMER_HANDLE_TO_POINTER(timer_handle);
 
-	if (timer->status == TIMER_RUNNING)
-	{
-		remove_timer_from_list(timer);
-	}
+	remove_timer_from_list(timer);
 
-	timer->wake_up_time = get_current_time() + timer->interval;
+	timer_set_due(timer, get_current_time() + timer->interval);
 	timer->status = TIMER_RUNNING;
 
 	add_timer_to_list(timer);
@@ -215,58 +309,141 @@ zk_error_code_t timer_delete(zk_uint32 timer_handle)
 
 	timer = TIMER_HANDLE_TO_POINTER(timer_handle);
 
-	/* 如果定时器正在运行，先停止 */
-	if (timer->status == TIMER_RUNNING)
+	/* a concurrent delete may have retired the handle since the unlocked check */
+	if (!zk_handle_is_valid(&g_timer_handles, timer_handle) || timer->is_used == 0)
 	{
-		remove_timer_from_list(timer);
-		timer->status = TIMER_STOP;
+		ret = ZK_ERR_STATE;
+		goto timer_delete_exit;
 	}
 
+	/* 如果定时器正在运行，先停止 */
+	remove_timer_from_list(timer);
+	timer->status = TIMER_STOP;
+
 	timer->is_used = 0;
+	zk_handle_free(&g_timer_handles, timer_handle);
 
+timer_delete_exit:
 	ZK_EXIT_CRITICAL();
 	return ret;
 }
 
 /**
- * @brief Check and process expired timers (called in SysTick interrupt)
- * @param current_time Current system time
- * @note Optimization: use temporary expired_list to shorten critical section time
+ * @brief Move one due timer from the running timers to the tail of expired_list
+ * @note Called within critical section
  */
-void timer_check(zk_uint32 current_time)
+static void timer_expire(timer_t *timer, zk_list_node_t *expired_list)
 {
-	zk_list_node_t expired_list;
-	zk_list_node_t *iterator;
+	zk_list_delete(&timer->list);
+	zk_list_add_before(&timer->list, expired_list);
+	timer->status = TIMER_EXPIRED;
+}
+
+/**
+ * @brief Move the timers that are due at current_time to the tail of expired_list
+ * @return ZK_TRUE if at least one timer expired
+ * @note The cache is read without the critical section: this runs in the SysTick handler,
+ *       which nothing that arms a timer can preempt
+ */
+static zk_bool timer_collect_expired(zk_uint32 current_time, zk_list_node_t *expired_list)
+{
+	zk_bool found = ZK_FALSE;
 	timer_t *timer;
+#if ZK_USING_TIME_WHEEL
+	zk_list_node_t *slot;
+	zk_list_node_t *iterator;
+	zk_list_node_t *iterator_next;
+#endif
 
-	zk_list_init(&expired_list);
+	if (!g_timer_manager.next_expiry_valid ||
+		!zk_time_is_reached(current_time, g_timer_manager.next_expiry))
+	{
+		return ZK_FALSE;
+	}
 
 	ZK_ENTER_CRITICAL();
 
+#if ZK_USING_TIME_WHEEL
+	/* the wheel is only stepped when something is due, advance() catches up the idle slots */
+	while ((slot = zk_time_wheel_advance(&g_timer_manager.timers_wheel, current_time)) !=
+		   LIST_NODE_NULL)
+	{
+		ZK_LIST_FOR_EACH_NODE_SAFE(iterator, iterator_next, slot)
+		{
+			timer = ZK_LIST_GET_OWNER(iterator, timer_t, list);
+			/* Entries of later revolutions share the slot */
+			if (zk_time_is_reached(current_time, timer->wake_up_time))
+			{
+				timer_expire(timer, expired_list);
+				found = ZK_TRUE;
+			}
+		}
+	}
+#else
 	while (!zk_list_is_empty(&g_timer_manager.timers_list))
 	{
 		timer = ZK_LIST_GET_FIRST_ENTRY(&g_timer_manager.timers_list, timer_t, list);
 
 		if ((zk_int32) (current_time - timer->wake_up_time) >= 0)
 		{
-			remove_timer_from_list(timer);
-
-			zk_list_add_before(&timer->list, &expired_list);
+			timer_expire(timer, expired_list);
+			found = ZK_TRUE;
 		}
 		else
 		{
 			break;
 		}
 	}
+#endif
+	timer_update_next_expiry();
 
 	ZK_EXIT_CRITICAL();
+	return found;
+}
+
+/**
+ * @brief Move an auto-reload timer to its next period boundary
+ * @param timer Timer whose due time is the expiry that just fired
+ * @param now Current time
+ * @note Called within critical section. The period is counted from the previous due time
+ *       (not from the slack-adjusted wake-up), so callback run time, tick latency and slack
+ *       do not accumulate as drift. Periods that are already over (callback longer than the
+ *       interval) are skipped, not replayed.
+ */
+static void timer_advance_period(timer_t *timer, zk_uint32 now)
+{
+	zk_uint32 due = TIMER_DUE_TIME(timer) + timer->interval;
 
-	while (!zk_list_is_empty(&expired_list))
+	/* a due time equal to now still fires on the next tick, like any other expiry */
+	if (zk_time_is_after(now, due))
 	{
-		iterator = expired_list.next;
-		timer = ZK_LIST_GET_OWNER(iterator, timer_t, list);
+		due += ((now - due + timer->interval - 1) / timer->interval) * timer->interval;
+	}
+	timer_set_due(timer, due);
+}
 
-		zk_list_delete(iterator);
+/**
+ * @brief Run the callbacks of the timers in expired_list, then re-arm or stop them
+ * @note Each timer is unlinked under the critical section, so timer_stop() from a
+ *       context that preempts the caller still cancels a callback that has not started.
+ *       A timer restarted, stopped or deleted by its own callback keeps that new state.
+ */
+static void timer_run_expired(zk_list_node_t *expired_list)
+{
+	timer_t *timer;
+
+	for (;;)
+	{
+		ZK_ENTER_CRITICAL();
+		if (zk_list_is_empty(expired_list))
+		{
+			ZK_EXIT_CRITICAL();
+			break;
+		}
+		timer = ZK_LIST_GET_FIRST_ENTRY(expired_list, timer_t, list);
+		zk_list_delete(&timer->list);
+		timer->status = TIMER_FIRING;
+		ZK_EXIT_CRITICAL();
 
 		if (timer->handler != ZK_NULL)
 		{
@@ -274,20 +451,96 @@ void timer_check(zk_uint32 current_time)
 		}
 
 		ZK_ENTER_CRITICAL();
-		if (timer->mode == TIMER_AUTO_RELOAD)
-		{
-			timer->wake_up_time = get_current_time() + timer->interval;
-			add_timer_to_list(timer);
-			timer->status = TIMER_RUNNING;
-		}
-		else
+		if (timer->status == TIMER_FIRING)
 		{
-			timer->status = TIMER_STOP;
+			if (timer->mode == TIMER_AUTO_RELOAD)
+			{
+				timer_advance_period(timer, get_current_time());
+				add_timer_to_list(timer);
+				timer->status = TIMER_RUNNING;
+			}
+			else
+			{
+				timer->status = TIMER_STOP;
+			}
 		}
 		ZK_EXIT_CRITICAL();
 	}
 }
 
+#if (ZK_TIMER_MODE == ZK_TIMER_MODE_TASK)
+/**
+ * @brief Timer service task: runs the callbacks the SysTick handed over
+ */
+static void timer_task(void *parameter)
+{
+	(void) parameter;
+	for (;;)
+	{
+		sem_get(g_timer_manager.wakeup_sem);
+		timer_run_expired(&g_timer_manager.expired_list);
+	}
+}
+
+/**
+ * @brief Check expired timers (called in SysTick interrupt)
+ * @param current_time Current system time
+ * @note Only moves the expired timers to the pending list; the service task is signalled
+ *       when the list turns non-empty, so a starved task costs one semaphore count at most
+ */
+void timer_check(zk_uint32 current_time)
+{
+	zk_bool was_empty = zk_list_is_empty(&g_timer_manager.expired_list);
+	zk_bool woken = ZK_FALSE;
+
+	if (timer_collect_expired(current_time, &g_timer_manager.expired_list) && was_empty)
+	{
+		sem_release_from_isr(g_timer_manager.wakeup_sem, &woken);
+		zk_yield_from_isr(woken);
+	}
+}
+#else
+/**
+ * @brief Check and process expired timers (called in SysTick interrupt)
+ * @param current_time Current system time
+ * @note Optimization: use temporary expired_list to shorten critical section time
+ */
+void timer_check(zk_uint32 current_time)
+{
+	zk_list_node_t expired_list;
+
+	zk_list_init(&expired_list);
+
+	if (timer_collect_expired(current_time, &expired_list))
+	{
+		timer_run_expired(&expired_list);
+	}
+}
+#endif
+
+/**
+ * @brief Get wake-up time of the nearest running timer
+ * @param wake_up_time Output parameter, absolute wake-up time from the expiry cache
+ * @return ZK_TRUE if a timer is running, otherwise ZK_FALSE
+ * @note Used by tickless idle to bound the sleep duration; after a timer was stopped the
+ *       cached time can be earlier than needed, never later
+ */
+zk_bool timer_get_next_expiry(zk_uint32 *wake_up_time)
+{
+	zk_bool found = ZK_FALSE;
+
+	ZK_ENTER_CRITICAL();
+
+	if (g_timer_manager.next_expiry_valid)
+	{
+		*wake_up_time = g_timer_manager.next_expiry;
+		found = ZK_TRUE;
+	}
+
+	ZK_EXIT_CRITICAL();
+	return found;
+}
+
 /**
  * @brief Reset timer (modify interval time)
  * @param timer_handle Timer handle
@@ -311,7 +564,7 @@ zk_error_code_t timer_reset(zk_uint32 timer_handle, zk_uint32 new_interval)
 	ZK_ENTER_CRITICAL();
 
 	timer = TIMER_HANDLE_TO_POINTER(timer_handle);
-	was_running = (timer->status == TIMER_RUNNING);
+	was_running = (timer->status == TIMER_RUNNING || timer->status == TIMER_EXPIRED);
 
 	if (was_running)
 	{
@@ -322,7 +575,7 @@ zk_error_code_t timer_reset(zk_uint32 timer_handle, zk_uint32 new_interval)
 
 	if (was_running)
 	{
-		timer->wake_up_time = get_current_time() + timer->interval;
+		timer_set_due(timer, get_current_time() + timer->interval);
 		add_timer_to_list(timer);
 		timer->status = TIMER_RUNNING;
 	}
@@ -331,6 +584,32 @@ zk_error_code_t timer_reset(zk_uint32 timer_handle, zk_uint32 new_interval)
 	return ret;
 }
 
+#if ZK_USING_SLACK
+/**
+ * @brief Allow a timer to fire up to slack ticks late so its wakeup can share a tick
+ * @param timer_handle Timer handle
+ * @param slack Tolerated lateness in ticks, 0 restores exact expiry
+ * @return Error code
+ * @note Takes effect from the next start or reload; a slack of about a tenth of the
+ *       interval already lines most timers up on common ticks
+ */
+zk_error_code_t timer_set_slack(zk_uint32 timer_handle, zk_uint32 slack)
+{
+	CHECK_TIMER_HANDLE_VALID(timer_handle);
+	CHECK_TIMER_CREATED(timer_handle);
+
+	if (slack >= ZK_TSK_DLY_MAX)
+	{
+		return ZK_ERR_OUT_OF_RANGE;
+	}
+
+	ZK_ENTER_CRITICAL();
+	TIMER_HANDLE_TO_POINTER(timer_handle)->slack = slack;
+	ZK_EXIT_CRITICAL();
+	return ZK_SUCCESS;
+}
+#endif
+
 /**
  * @brief Get timer remaining time
  * @param timer_handle Timer handle
@@ -351,7 +630,7 @@ zk_error_code_t timer_get_remaining(zk_uint32 timer_handle, zk_uint32 *remaining
 
 	timer = TIMER_HANDLE_TO_POINTER(timer_handle);
 
-	if (timer->status != TIMER_RUNNING)
+	if (timer->status != TIMER_RUNNING && timer->status != TIMER_EXPIRED)
 	{
 		*remaining = 0;
 		ret = ZK_ERR_STATE;
@@ -373,3 +652,5 @@ timer_get_remaining_exit:
 	ZK_EXIT_CRITICAL();
 	return ret;
 }
+
+#endif /* ZK_USING_TIMER */
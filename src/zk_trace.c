@@ -0,0 +1,161 @@
+/**
+ * @file    zk_trace.c
+ * @brief   binary trace ring for scheduler and IPC events
+ * @note    Records are 12 bytes (cycle stamp, event | argument, object) written with
+ *          interrupts masked, so trace points are safe from tasks and ISRs. When the ring
+ *          is full the oldest record is overwritten and counted as dropped. The stream
+ *          written by zk_trace_dump() is described in docs/二进制跟踪格式.md.
+ */
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_TRACE
+
+#if (ZK_TRACE_BUFFER_RECORDS & (ZK_TRACE_BUFFER_RECORDS - 1)) != 0
+#error "ZK_TRACE_BUFFER_RECORDS must be a power of two"
+#endif
+
+#define ZK_TRACE_MASK (ZK_TRACE_BUFFER_RECORDS - 1)
+#define ZK_TRACE_VERSION 1
+#define ZK_TRACE_HEADER_SIZE 16
+#define ZK_TRACE_DUMP_CHUNK 8
+
+static zk_trace_record_t g_trace_buffer[ZK_TRACE_BUFFER_RECORDS];
+/* free-running indices, head - tail is the number of stored records */
+static zk_uint32 g_trace_head = 0;
+static zk_uint32 g_trace_tail = 0;
+static zk_uint32 g_trace_dropped = 0;
+
+/**
+ * @brief Append one record
+ * @param event Event id (zk_trace_event_t, or ZK_TRACE_EV_USER and above)
+ * @param object TCB address or IPC handle
+ * @param arg Event argument, low 24 bits are kept
+ * @note Masks interrupts with the raw port call: a trace point must not show up in the
+ *       critical section statistics it is used to explain
+ */
+void zk_trace_record(zk_uint32 event, zk_uint32 object, zk_uint32 arg)
+{
+	zk_trace_record_t *record = ZK_NULL;
+
+	zk_cpu_enter_critical();
+	record = &g_trace_buffer[g_trace_head & ZK_TRACE_MASK];
+	record->stamp = zk_cpu_cycle_count();
+	record->info = (arg << 8) | (event & 0xFFUL);
+	record->object = object;
+	g_trace_head++;
+	if (g_trace_head - g_trace_tail > ZK_TRACE_BUFFER_RECORDS)
+	{
+		g_trace_tail++;
+		g_trace_dropped++;
+	}
+	zk_cpu_exit_critical();
+}
+
+/**
+ * @brief Remove the oldest records from the ring
+ * @param records Output array
+ * @param max_records Capacity of records
+ * @return zk_uint32 Number of records copied
+ */
+zk_uint32 zk_trace_read(zk_trace_record_t *records, zk_uint32 max_records)
+{
+	zk_uint32 count = 0;
+
+	if (records == ZK_NULL)
+	{
+		return 0;
+	}
+
+	/* one record at a time: the producer is never held off for the whole copy */
+	while (count < max_records)
+	{
+		zk_cpu_enter_critical();
+		if (g_trace_tail == g_trace_head)
+		{
+			zk_cpu_exit_critical();
+			break;
+		}
+		records[count] = g_trace_buffer[g_trace_tail & ZK_TRACE_MASK];
+		g_trace_tail++;
+		zk_cpu_exit_critical();
+		count++;
+	}
+	return count;
+}
+
+/**
+ * @brief Default byte sink of zk_trace_dump()
+ */
+__attribute__((weak)) void zk_trace_output(const zk_uint8 *data, zk_uint32 len)
+{
+	zk_uint32 i = 0;
+
+	for (i = 0; i < len; i++)
+	{
+		zk_putc((char) data[i]);
+	}
+}
+
+static void zk_trace_put_u32(zk_uint8 *out, zk_uint32 value)
+{
+	out[0] = (zk_uint8) value;
+	out[1] = (zk_uint8) (value >> 8);
+	out[2] = (zk_uint8) (value >> 16);
+	out[3] = (zk_uint8) (value >> 24);
+}
+
+/**
+ * @brief Drain the ring as one packet: header, then the records oldest first
+ * @note Call from a low-priority task; records logged meanwhile stay for the next dump
+ */
+void zk_trace_dump(void)
+{
+	zk_trace_record_t chunk[ZK_TRACE_DUMP_CHUNK];
+	zk_uint8 header[ZK_TRACE_HEADER_SIZE];
+	zk_uint8 bytes[sizeof(zk_trace_record_t)];
+	zk_uint32 pending = 0;
+	zk_uint32 dropped = 0;
+	zk_uint32 count = 0;
+	zk_uint32 i = 0;
+
+	zk_cpu_enter_critical();
+	pending = g_trace_head - g_trace_tail;
+	dropped = g_trace_dropped;
+	g_trace_dropped = 0;
+	zk_cpu_exit_critical();
+
+	header[0] = 'Z';
+	header[1] = 'K';
+	header[2] = 'T';
+	header[3] = 'R';
+	header[4] = ZK_TRACE_VERSION;
+	header[5] = (zk_uint8) sizeof(zk_trace_record_t);
+	header[6] = (zk_uint8) pending;
+	header[7] = (zk_uint8) (pending >> 8);
+	zk_trace_put_u32(&header[8], ZK_CPU_CYCLES_PER_TICK * ZK_TICK_RATE_HZ);
+	zk_trace_put_u32(&header[12], dropped);
+	zk_trace_output(header, sizeof(header));
+
+	/* exactly pending records follow, even if newer ones overwrote some of them meanwhile */
+	while (pending > 0)
+	{
+		count =
+			zk_trace_read(chunk, (pending < ZK_TRACE_DUMP_CHUNK) ? pending : ZK_TRACE_DUMP_CHUNK);
+		if (count == 0)
+		{
+			break;
+		}
+		for (i = 0; i < count; i++)
+		{
+			zk_trace_put_u32(&bytes[0], chunk[i].stamp);
+			zk_trace_put_u32(&bytes[4], chunk[i].info);
+			zk_trace_put_u32(&bytes[8], chunk[i].object);
+			zk_trace_output(bytes, sizeof(bytes));
+		}
+		pending -= count;
+	}
+}
+
+#endif
@@ -0,0 +1,336 @@
+/**
+ * @file    zk_workqueue.c
+ * @brief   deferred work queues (interrupt bottom halves)
+ * @note    An ISR hands a caller-owned zk_work_t to a queue and returns; the queue's worker
+ *          task runs work->fn(work->arg) later at its own priority. Submitted work is pushed
+ *          onto a LIFO with LDREX/STREX, so submitting never masks interrupts; only the
+ *          empty -> non-empty transition posts the worker's semaphore. The worker takes the
+ *          whole stack in one swap and runs it oldest first. Delayed work arms a one-shot
+ *          software timer whose callback submits the work.
+ */
+
+#include "zk_rtos.h"
+#include "zk_internal.h"
+
+#if ZK_USING_WORKQUEUE
+
+static zk_workqueue_t g_system_workqueue;
+static task_control_block_t g_workqueue_task_tcb;
+static zk_uint32 g_workqueue_task_stack[ZK_WORKQUEUE_TASK_STACK_SIZE / sizeof(zk_uint32)];
+
+#define WORKQUEUE_OR_SYSTEM(queue) ((queue) == ZK_NULL ? &g_system_workqueue : (queue))
+
+/**
+ * @brief Claim an idle work item for submission
+ * @return zk_bool ZK_FALSE if it is already pending
+ */
+static zk_bool work_claim(zk_work_t *work)
+{
+	for (;;)
+	{
+		if (zk_cpu_ldrex(&work->state) != ZK_WORK_IDLE)
+		{
+			zk_cpu_clrex();
+			return ZK_FALSE;
+		}
+		if (zk_cpu_strex(ZK_WORK_PENDING, &work->state) == 0)
+		{
+			return ZK_TRUE;
+		}
+	}
+}
+
+/**
+ * @brief Push a claimed work item onto the pending stack
+ * @return zk_bool ZK_TRUE if the stack was empty, i.e. the worker has to be woken
+ * @note An interrupt between LDREX and STREX clears the exclusive monitor, the push retries
+ */
+static zk_bool work_push(zk_workqueue_t *queue, zk_work_t *work)
+{
+	zk_uint32 top = 0;
+
+	do
+	{
+		top = zk_cpu_ldrex(&queue->pending);
+		work->next = (zk_work_t *) top;
+	} while (zk_cpu_strex((zk_uint32) work, &queue->pending) != 0);
+
+	return top == 0;
+}
+
+/**
+ * @brief Take every pending work item
+ * @return zk_work_t* Oldest work item first, ZK_NULL if nothing is pending
+ */
+static zk_work_t *work_take_all(zk_workqueue_t *queue)
+{
+	zk_work_t *newest = ZK_NULL;
+	zk_work_t *oldest = ZK_NULL;
+	zk_work_t *next = ZK_NULL;
+	zk_uint32 top = 0;
+
+	do
+	{
+		top = zk_cpu_ldrex(&queue->pending);
+	} while (zk_cpu_strex(0, &queue->pending) != 0);
+
+	/* the stack is newest first, reverse it so work runs in submission order */
+	newest = (zk_work_t *) top;
+	while (newest != ZK_NULL)
+	{
+		next = newest->next;
+		newest->next = oldest;
+		oldest = newest;
+		newest = next;
+	}
+	return oldest;
+}
+
+static void workqueue_task(void *parameter)
+{
+	zk_workqueue_t *queue = (zk_workqueue_t *) parameter;
+	zk_work_t *work = ZK_NULL;
+	zk_work_t *next = ZK_NULL;
+	zk_work_fn_t fn = ZK_NULL;
+	void *arg = ZK_NULL;
+
+	for (;;)
+	{
+		sem_get(queue->wakeup_sem);
+
+		work = work_take_all(queue);
+		while (work != ZK_NULL)
+		{
+			next = work->next;
+			fn = work->fn;
+			arg = work->arg;
+			/* idle before the call, so fn may submit its own work item again */
+			work->state = ZK_WORK_IDLE;
+			fn(arg);
+			work = next;
+		}
+	}
+}
+
+/**
+ * @brief Bind a work item to its function
+ * @param work work item, owned by the caller and kept alive while it is pending
+ * @param fn function run in the worker task
+ * @param arg argument passed to fn
+ * @note Do not re-init a pending work item
+ */
+void work_init(zk_work_t *work, zk_work_fn_t fn, void *arg)
+{
+	work->next = ZK_NULL;
+	work->fn = fn;
+	work->arg = arg;
+	work->state = ZK_WORK_IDLE;
+}
+
+/**
+ * @brief Create a work queue with its own worker task
+ * @param queue work queue object, owned by the caller
+ * @param priority worker task priority
+ * @param stack_size worker task stack size in bytes
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note The worker stays for the lifetime of the system; work of one queue runs one item at
+ *       a time, so use separate queues for work that must not wait behind each other
+ */
+zk_error_code_t workqueue_create(zk_workqueue_t *queue, zk_uint8 priority,
+								 zk_uint32 stack_size)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+	task_init_parameter_t parameter;
+
+	ZK_CHECK_PARAM_NOT_NULL(queue);
+
+	queue->pending = 0;
+	ret = sem_create(&queue->wakeup_sem, 0);
+	if (ret != ZK_SUCCESS)
+	{
+		return ret;
+	}
+
+	zk_memclear(&parameter, sizeof(task_init_parameter_t));
+	parameter.name[0] = 'W';
+	parameter.name[1] = 'Q';
+	parameter.name[2] = ZK_STRING_TERMINATOR;
+	parameter.priority = priority;
+	parameter.private_data = queue;
+	parameter.stack_size = stack_size;
+	parameter.task_entry = workqueue_task;
+	ret = task_create(&parameter, &queue->task_handle);
+	if (ret != ZK_SUCCESS)
+	{
+		sem_destroy(queue->wakeup_sem);
+	}
+	return ret;
+}
+
+/**
+ * @brief Submit work from a task
+ * @param queue target queue, ZK_NULL for the system work queue
+ * @param work initialized work item
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE if the work is already pending (it still
+ *         runs once)
+ */
+zk_error_code_t work_submit(zk_workqueue_t *queue, zk_work_t *work)
+{
+	ZK_CHECK_PARAM_NOT_NULL(work);
+
+	queue = WORKQUEUE_OR_SYSTEM(queue);
+	if (!work_claim(work))
+	{
+		return ZK_ERR_STATE;
+	}
+	if (work_push(queue, work))
+	{
+		return sem_release(queue->wakeup_sem);
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Submit work from an ISR
+ * @param queue target queue, ZK_NULL for the system work queue
+ * @param work initialized work item
+ * @param higher_priority_woken set when the worker should preempt the interrupted task
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE if the work is already pending (it still
+ *         runs once)
+ * @note Finish the ISR with zk_yield_from_isr()
+ */
+zk_error_code_t work_submit_from_isr(zk_workqueue_t *queue, zk_work_t *work,
+									 zk_bool *higher_priority_woken)
+{
+	ZK_ASSERT_ISR_PRIORITY();
+
+	ZK_CHECK_PARAM_NOT_NULL(work);
+
+	queue = WORKQUEUE_OR_SYSTEM(queue);
+	if (!work_claim(work))
+	{
+		return ZK_ERR_STATE;
+	}
+	if (work_push(queue, work))
+	{
+		return sem_release_from_isr(queue->wakeup_sem, higher_priority_woken);
+	}
+	return ZK_SUCCESS;
+}
+
+/**
+ * @brief Whether a work item is submitted and has not started running yet
+ */
+zk_bool work_is_pending(const zk_work_t *work)
+{
+	return work->state == ZK_WORK_PENDING;
+}
+
+#if ZK_USING_TIMER
+/**
+ * @brief Timer callback of delayed work, runs in the tick ISR or in the timer task
+ */
+static void delayed_work_timeout(void *param)
+{
+	zk_delayed_work_t *dwork = (zk_delayed_work_t *) param;
+	zk_bool woken = ZK_FALSE;
+
+	if (zk_cpu_is_in_interrupt())
+	{
+		work_submit_from_isr(dwork->queue, &dwork->work, &woken);
+		zk_yield_from_isr(woken);
+	}
+	else
+	{
+		work_submit(dwork->queue, &dwork->work);
+	}
+}
+
+/**
+ * @brief Bind a delayed work item to its function and create its one-shot timer
+ * @param dwork delayed work item, owned by the caller
+ * @param fn function run in the worker task
+ * @param arg argument passed to fn
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Takes one software timer from the timer pool
+ */
+zk_error_code_t delayed_work_init(zk_delayed_work_t *dwork, zk_work_fn_t fn, void *arg)
+{
+	ZK_CHECK_PARAM_NOT_NULL(dwork);
+	ZK_CHECK_PARAM_NOT_NULL(fn);
+
+	work_init(&dwork->work, fn, arg);
+	dwork->queue = ZK_NULL;
+	return timer_create(&dwork->timer_handle, TIMER_ONESHOT, 1, delayed_work_timeout, dwork);
+}
+
+/**
+ * @brief Submit work after a delay
+ * @param queue target queue, ZK_NULL for the system work queue
+ * @param dwork delayed work item
+ * @param ticks delay in ticks, 0 submits at once
+ * @return zk_error_code_t ZK_SUCCESS if success, otherwise error code
+ * @note Submitting again before the timer fires restarts the delay
+ */
+zk_error_code_t delayed_work_submit(zk_workqueue_t *queue, zk_delayed_work_t *dwork,
+									zk_uint32 ticks)
+{
+	zk_error_code_t ret = ZK_SUCCESS;
+
+	ZK_CHECK_PARAM_NOT_NULL(dwork);
+
+	dwork->queue = queue;
+	if (ticks == 0)
+	{
+		return work_submit(queue, &dwork->work);
+	}
+
+	ret = timer_reset(dwork->timer_handle, ticks);
+	if (ret != ZK_SUCCESS)
+	{
+		return ret;
+	}
+	return timer_start(dwork->timer_handle);
+}
+
+/**
+ * @brief Cancel delayed work whose timer has not fired yet
+ * @return zk_error_code_t ZK_SUCCESS, ZK_ERR_STATE if the timer is not running (the work is
+ *         already submitted or was never armed)
+ */
+zk_error_code_t delayed_work_cancel(zk_delayed_work_t *dwork)
+{
+	ZK_CHECK_PARAM_NOT_NULL(dwork);
+
+	return timer_stop(dwork->timer_handle);
+}
+#endif /* ZK_USING_TIMER */
+
+/**
+ * @brief Create the system work queue
+ * @note  Called by zk_kernel_init() after the semaphore pool is ready
+ */
+void workqueue_init(void)
+{
+	task_init_parameter_t parameter;
+
+	g_system_workqueue.pending = 0;
+	if (sem_create(&g_system_workqueue.wakeup_sem, 0) != ZK_SUCCESS)
+	{
+		return;
+	}
+
+	zk_memclear(&parameter, sizeof(task_init_parameter_t));
+	parameter.name[0] = 'W';
+	parameter.name[1] = 'Q';
+	parameter.name[2] = '0';
+	parameter.name[3] = ZK_STRING_TERMINATOR;
+	parameter.priority = ZK_WORKQUEUE_TASK_PRIO;
+	parameter.private_data = &g_system_workqueue;
+	parameter.stack_size = sizeof(g_workqueue_task_stack);
+	parameter.task_entry = workqueue_task;
+	task_create_static(&parameter, &g_workqueue_task_tcb, g_workqueue_task_stack,
+					   &g_system_workqueue.task_handle);
+}
+
+#endif /* ZK_USING_WORKQUEUE */